@@ -63,6 +63,7 @@ struct ovrApplFrameIn {
     int64_t FrameIndex = 0;
     /// timing
     double PredictedDisplayTime = 0.0;
+    int64_t PredictedDisplayTimeNs = 0; // raw XrTime, exact integer nanoseconds
     double RealTimeInSeconds = 0.0;
     float DeltaSeconds = 0.0f;
     /// device config
@@ -120,12 +121,37 @@ struct ovrApplFrameIn {
 
     static const int kButtonLeftThumbStick = 1 << 11;
     static const int kButtonRightThumbStick = 1 << 12;
+    static const int kNumButtonBits = 13;
+
+    /// seconds each button / touch bit has been held, indexed by bit position, 0 while up
+    float ButtonHeldSeconds[kNumButtonBits] = {};
 
     inline bool Clicked(const uint32_t& b) const {
         const bool isDown = (b & AllButtons) != 0;
         const bool wasDown = (b & LastFrameAllButtons) != 0;
         return (wasDown && !isDown);
     }
+    /// buttons and touches share one bit space, so b can mix kButton and kTouch bits
+    inline bool Pressed(const uint32_t& b) const {
+        const bool isDown = (b & (AllButtons | AllTouches)) != 0;
+        const bool wasDown = (b & (LastFrameAllButtons | LastFrameAllTouches)) != 0;
+        return (!wasDown && isDown);
+    }
+    inline bool Released(const uint32_t& b) const {
+        const bool isDown = (b & (AllButtons | AllTouches)) != 0;
+        const bool wasDown = (b & (LastFrameAllButtons | LastFrameAllTouches)) != 0;
+        return (wasDown && !isDown);
+    }
+    /// longest hold among the bits in b
+    inline float HeldSeconds(const uint32_t& b) const {
+        float held = 0.0f;
+        for (int bit = 0; bit < kNumButtonBits; bit++) {
+            if ((b & (1u << bit)) != 0 && ButtonHeldSeconds[bit] > held) {
+                held = ButtonHeldSeconds[bit];
+            }
+        }
+        return held;
+    }
     inline bool Touched(const uint32_t& t) const {
         const bool isDown = (t & AllTouches) != 0;
         const bool wasDown = (t & LastFrameAllTouches) != 0;
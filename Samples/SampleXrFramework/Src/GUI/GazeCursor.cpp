@@ -32,6 +32,7 @@ Authors     :   Jonathan E. Wright
 #include "Render/GlTexture.h"
 #include "Render/GlProgram.h"
 #include "Render/GlGeometry.h"
+#include "Render/GlStreamBuffer.h"
 
 using OVR::Bounds3f;
 using OVR::Matrix4f;
@@ -416,13 +417,24 @@ void OvrGazeCursorLocal::Frame(
 
     // Update cursor geometry.
     // Z-pass positions.
-    UpdateCursorPositions(ZPassVertexAttribs, ZPassCursorSurface.geo.localBounds, CursorTransform);
-    ZPassCursorSurface.geo.Update(ZPassVertexAttribs, false);
+    Bounds3f zPassBounds;
+    UpdateCursorPositions(ZPassVertexAttribs, zPassBounds, CursorTransform);
 
     // Z-fail positions.
-    UpdateCursorPositions(
-        ZFailVertexAttribs, ZFailCursorSurface.geo.localBounds, CursorScatterTransform);
-    ZFailCursorSurface.geo.Update(ZFailVertexAttribs, false);
+    Bounds3f zFailBounds;
+    UpdateCursorPositions(ZFailVertexAttribs, zFailBounds, CursorScatterTransform);
+
+    // An earlier frame may still be drawn from the surfaces, the bounds go with the upload.
+    RunFrameGlTask([this,
+                    zPassAttribs = ZPassVertexAttribs,
+                    zPassBounds,
+                    zFailAttribs = ZFailVertexAttribs,
+                    zFailBounds]() {
+        ZPassCursorSurface.geo.localBounds = zPassBounds;
+        ZPassCursorSurface.geo.Update(zPassAttribs, false);
+        ZFailCursorSurface.geo.localBounds = zFailBounds;
+        ZFailCursorSurface.geo.Update(zFailAttribs, false);
+    });
 }
 
 //==============================
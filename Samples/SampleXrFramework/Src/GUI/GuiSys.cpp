@@ -38,6 +38,7 @@ Authors     :   Jonathan E. Wright
 
 #include "VRMenu.h"
 #include "VRMenuMgr.h"
+#include "VRMenuBroadphase.h"
 #include "VRMenuComponent.h"
 #include "SoundLimiter.h"
 #include "VRMenuEventHandler.h"
@@ -177,6 +178,11 @@ class OvrGuiSysLocal : public OvrGuiSys {
 
     virtual HitTestResult TestRayIntersection(const Vector3f& start, const Vector3f& dir)
         const override;
+    virtual void TestRayIntersections(
+        const Vector3f* starts,
+        const Vector3f* dirs,
+        const int count,
+        HitTestResult* results) const override;
 
     virtual void AddMenu(VRMenu* menu) override;
     virtual VRMenu* GetMenu(char const* menuName) const override;
@@ -255,6 +261,8 @@ class OvrGuiSysLocal : public OvrGuiSys {
 
     std::vector<VRMenu*> Menus;
     std::vector<VRMenu*> ActiveMenus;
+    mutable ovrMenuBroadphase Broadphase; // over ActiveMenus
+    mutable std::vector<ovrMenuBroadphase::ovrCandidate> HitCandidates;
 
     ovrInfoText InfoText;
     long long LastVrFrameNumber;
@@ -395,6 +403,7 @@ void OvrGuiSysLocal::Init(
     }
 
     TextureManager = ovrTextureManager::Create();
+    SetResidencyTextureManager(TextureManager);
 
     IsInitialized = true;
 
@@ -799,8 +808,15 @@ void OvrGuiSysLocal::Frame(
         GazeCursor->Frame(centerViewMatrix, traceMat, vrFrame.DeltaSeconds);
     }
 
+    {
+        /// OVR_PERF_TIMER( OvrGuiSys_Frame_TextureManager_Update );
+        // upload what the decode threads finished, within the per-frame budget
+        TextureManager->Update();
+    }
+
     {
         /// OVR_PERF_TIMER( OvrGuiSys_Frame_Font_Finish );
+        DefaultFont->UpdateGlyphs();
         DefaultFontSurface->Finish(centerViewMatrix);
     }
 
@@ -908,27 +924,57 @@ void OvrGuiSys::ovrDummySoundEffectPlayer::LoadSoundAsset(const char* name) {
 HitTestResult OvrGuiSysLocal::TestRayIntersection(const Vector3f& start, const Vector3f& dir)
     const {
     HitTestResult result;
+    TestRayIntersections(&start, &dir, 1, &result);
+    return result;
+}
 
-    for (int i = static_cast<int>(ActiveMenus.size()) - 1; i >= 0; --i) {
-        VRMenu* curMenu = ActiveMenus[i];
-        if (curMenu == nullptr) {
-            continue;
-        }
-        VRMenuObject* root = GetVRMenuMgr().ToObject(curMenu->GetRootHandle());
-        if (root == nullptr) {
-            continue;
-        }
+//==============================
+// OvrGuiSysLocal::TestRayIntersections
+void OvrGuiSysLocal::TestRayIntersections(
+    const Vector3f* starts,
+    const Vector3f* dirs,
+    const int count,
+    HitTestResult* results) const {
+    // the menus may have moved since the last query
+    Broadphase.Update(GetVRMenuMgr(), ActiveMenus);
+
+    for (int i = 0; i < count; ++i) {
+        HitTestResult& result = results[i];
+        result = HitTestResult();
+
+        HitCandidates.resize(0);
+        Broadphase.QueryRay(starts[i], dirs[i].Normalized(), HitCandidates);
+
+        int resultMenu = -1;
+        for (const auto& candidate : HitCandidates) {
+            // nearest first, so nothing after this can be hit closer
+            if (candidate.T > result.t) {
+                break;
+            }
+            VRMenu* curMenu = ActiveMenus[candidate.MenuIndex];
+            VRMenuObject* root = GetVRMenuMgr().ToObject(curMenu->GetRootHandle());
+            if (root == nullptr) {
+                continue;
+            }
 
-        HitTestResult r;
-        menuHandle_t hitHandle = root->HitTest(
-            *this, curMenu->GetMenuPose(), start, dir, ContentFlags_t(CONTENT_SOLID), r);
-        if (hitHandle.IsValid() && r.t < result.t) {
-            result = r;
-            result.RayStart = start;
-            result.RayDir = dir;
+            HitTestResult r;
+            menuHandle_t hitHandle = root->HitTest(
+                *this,
+                curMenu->GetMenuPose(),
+                starts[i],
+                dirs[i],
+                ContentFlags_t(CONTENT_SOLID),
+                r);
+            // at the same distance the menu opened last wins, as when testing them back to front
+            if (hitHandle.IsValid() &&
+                (r.t < result.t || (r.t == result.t && candidate.MenuIndex > resultMenu))) {
+                result = r;
+                result.RayStart = starts[i];
+                result.RayDir = dirs[i];
+                resultMenu = candidate.MenuIndex;
+            }
         }
     }
-    return result;
 }
 
 } // namespace OVRFW
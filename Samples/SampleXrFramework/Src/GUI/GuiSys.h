@@ -113,6 +113,13 @@ class OvrGuiSys {
 
     virtual HitTestResult TestRayIntersection(const OVR::Vector3f& start, const OVR::Vector3f& dir)
         const = 0;
+    // Tests several rays against the open menus at once, e.g. one per input device. results must
+    // have room for count results.
+    virtual void TestRayIntersections(
+        const OVR::Vector3f* starts,
+        const OVR::Vector3f* dirs,
+        const int count,
+        HitTestResult* results) const = 0;
 
     //-------------------------------------------------------------
     // Menu management
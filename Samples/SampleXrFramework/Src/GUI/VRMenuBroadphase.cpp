@@ -0,0 +1,291 @@
+/************************************************************************************
+
+Filename    :   VRMenuBroadphase.cpp
+Content     :   Bounding volume hierarchy over the open menus for ray hit tests.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "VRMenuBroadphase.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "VRMenu.h"
+#include "VRMenuMgr.h"
+#include "VRMenuObject.h"
+
+using OVR::Bounds3f;
+using OVR::Posef;
+using OVR::Vector3f;
+
+namespace OVRFW {
+
+// VRMenuObject::IntersectRayBounds() counts a ray starting this close to the bounds as a hit.
+static const float START_INSIDE_TOLERANCE = 0.1f;
+
+// refitting may loosen the tree this much before it is rebuilt
+static const float MAX_REFIT_AREA_GROWTH = 2.0f;
+
+static float SurfaceArea(Bounds3f const& bounds) {
+    if (bounds.IsInverted()) {
+        return 0.0f;
+    }
+    Vector3f const size = bounds.GetSize();
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool RayHitsBounds(
+    Vector3f const& start,
+    Vector3f const& rcpDir,
+    Bounds3f const& bounds,
+    float& t) {
+    float tMin = 0.0f;
+    float tMax = FLT_MAX;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (bounds.b[0][axis] > bounds.b[1][axis]) {
+            return false; // empty
+        }
+        float t0 = (bounds.b[0][axis] - start[axis]) * rcpDir[axis];
+        float t1 = (bounds.b[1][axis] - start[axis]) * rcpDir[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax) {
+            return false;
+        }
+    }
+    t = tMin;
+    return true;
+}
+
+//==============================
+// ovrMenuBroadphase::Update
+void ovrMenuBroadphase::Update(OvrVRMenuMgr const& menuMgr, std::vector<VRMenu*> const& menus) {
+    bool const resized = menus.size() != Menus.size();
+    if (resized) {
+        Menus.resize(menus.size());
+    }
+    bool rebuild = resized;
+    bool refit = false;
+
+    for (int i = 0; i < static_cast<int>(menus.size()); ++i) {
+        ovrMenuBounds& m = Menus[i];
+        bool const menuChanged = resized || m.Menu != menus[i];
+        if (menuChanged) {
+            m.Menu = menus[i];
+            rebuild = true;
+        }
+
+        VRMenuObject const* root =
+            m.Menu != nullptr ? menuMgr.ToObject(m.Menu->GetRootHandle()) : nullptr;
+        ovrBoundsType type = BOUNDS_NONE;
+        Posef pose;
+        Bounds3f cullBounds;
+        cullBounds.Clear();
+        if (root != nullptr && !(root->GetFlags() & VRMENUOBJECT_DONT_RENDER) &&
+            !(root->GetFlags() & VRMENUOBJECT_DONT_HIT_ALL)) {
+            // the root's model pose as in VRMenuObject::HitTest_r()
+            Posef const& menuPose = m.Menu->GetMenuPose();
+            Posef const& localPose = root->GetLocalPose();
+            pose.Rotation = menuPose.Rotation * localPose.Rotation;
+            pose.Translation =
+                menuPose.Translation + menuPose.Rotation.Rotate(localPose.Translation);
+            if (root->NumChildren() == 0) {
+                type = BOUNDS_ALWAYS_TEST;
+            } else if (!root->GetCullBounds().IsInverted()) {
+                type = BOUNDS_CULL;
+                cullBounds = root->GetCullBounds();
+            }
+        }
+
+        if (menuChanged || (type == BOUNDS_ALWAYS_TEST) != (m.Type == BOUNDS_ALWAYS_TEST)) {
+            rebuild = true;
+        } else if (
+            type == m.Type && pose.Translation == m.Pose.Translation &&
+            pose.Rotation == m.Pose.Rotation && cullBounds.GetMins() == m.CullBounds.GetMins() &&
+            cullBounds.GetMaxs() == m.CullBounds.GetMaxs()) {
+            continue;
+        }
+        m.Type = type;
+        m.Pose = pose;
+        m.CullBounds = cullBounds;
+        if (type == BOUNDS_CULL) {
+            Vector3f const tolerance(START_INSIDE_TOLERANCE);
+            m.WorldBounds =
+                Bounds3f::Transform(pose, Bounds3f::Expand(cullBounds, -tolerance, tolerance));
+        } else {
+            m.WorldBounds.Clear();
+        }
+        if (!rebuild && type != BOUNDS_ALWAYS_TEST) {
+            Nodes[m.Node].Dirty = true;
+            refit = true;
+        }
+    }
+
+    if (rebuild) {
+        Build();
+    } else if (refit) {
+        Refit();
+        if (Area > BuildArea * MAX_REFIT_AREA_GROWTH) {
+            Build();
+        }
+    }
+}
+
+//==============================
+// ovrMenuBroadphase::Build
+void ovrMenuBroadphase::Build() {
+    MenuOrder.resize(0);
+    AlwaysTest.resize(0);
+    for (int i = 0; i < static_cast<int>(Menus.size()); ++i) {
+        if (Menus[i].Type == BOUNDS_ALWAYS_TEST) {
+            AlwaysTest.push_back(i);
+        } else {
+            MenuOrder.push_back(i);
+        }
+    }
+
+    Nodes.resize(0);
+    Area = 0.0f;
+    if (!MenuOrder.empty()) {
+        Nodes.resize(1);
+        Nodes[0].Parent = -1;
+        BuildNode(0, 0, static_cast<int>(MenuOrder.size()));
+    }
+    BuildArea = Area;
+}
+
+//==============================
+// ovrMenuBroadphase::BuildNode
+void ovrMenuBroadphase::BuildNode(int const nodeIndex, int const first, int const count) {
+    Bounds3f bounds;
+    bounds.Clear();
+    Bounds3f centers;
+    centers.Clear();
+    for (int i = first; i < first + count; ++i) {
+        Bounds3f const& menuBounds = Menus[MenuOrder[i]].WorldBounds;
+        if (!menuBounds.IsInverted()) {
+            bounds = Bounds3f::Union(bounds, menuBounds);
+            centers.AddPoint(menuBounds.GetCenter());
+        }
+    }
+
+    ovrNode& node = Nodes[nodeIndex];
+    node.Bounds = bounds;
+    node.Left = -1;
+    node.First = first;
+    node.Count = count;
+    node.Dirty = false;
+    Area += SurfaceArea(bounds);
+
+    if (count <= MAX_MENUS_PER_LEAF) {
+        for (int i = first; i < first + count; ++i) {
+            Menus[MenuOrder[i]].Node = nodeIndex;
+        }
+        return;
+    }
+
+    // median split along the axis the menus are spread out most on, which keeps the depth at
+    // log2 of the menu count
+    int axis = 0;
+    if (!centers.IsInverted()) {
+        Vector3f const spread = centers.GetSize();
+        axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+    }
+    int const half = count / 2;
+    std::nth_element(
+        MenuOrder.begin() + first,
+        MenuOrder.begin() + first + half,
+        MenuOrder.begin() + first + count,
+        [this, axis](int const a, int const b) {
+            return Menus[a].WorldBounds.GetCenter()[axis] < Menus[b].WorldBounds.GetCenter()[axis];
+        });
+
+    int const left = static_cast<int>(Nodes.size());
+    Nodes.resize(left + 2); // invalidates node
+    Nodes[nodeIndex].Left = left;
+    Nodes[left].Parent = nodeIndex;
+    Nodes[left + 1].Parent = nodeIndex;
+    BuildNode(left, first, half);
+    BuildNode(left + 1, first + half, count - half);
+}
+
+//==============================
+// ovrMenuBroadphase::Refit
+void ovrMenuBroadphase::Refit() {
+    // children come after their parents, so going backwards refits bottom up
+    for (int i = static_cast<int>(Nodes.size()) - 1; i >= 0; --i) {
+        ovrNode& node = Nodes[i];
+        if (!node.Dirty) {
+            continue;
+        }
+        Area -= SurfaceArea(node.Bounds);
+        if (node.Left < 0) {
+            node.Bounds.Clear();
+            for (int j = node.First; j < node.First + node.Count; ++j) {
+                node.Bounds = Bounds3f::Union(node.Bounds, Menus[MenuOrder[j]].WorldBounds);
+            }
+        } else {
+            node.Bounds = Bounds3f::Union(Nodes[node.Left].Bounds, Nodes[node.Left + 1].Bounds);
+        }
+        Area += SurfaceArea(node.Bounds);
+        node.Dirty = false;
+        if (node.Parent >= 0) {
+            Nodes[node.Parent].Dirty = true;
+        }
+    }
+}
+
+//==============================
+// ovrMenuBroadphase::QueryRay
+void ovrMenuBroadphase::QueryRay(
+    Vector3f const& start,
+    Vector3f const& dir,
+    std::vector<ovrCandidate>& candidates) const {
+    size_t const firstCandidate = candidates.size();
+    for (int const menuIndex : AlwaysTest) {
+        candidates.push_back({menuIndex, 0.0f});
+    }
+
+    if (!Nodes.empty()) {
+        Vector3f rcpDir;
+        for (int axis = 0; axis < 3; ++axis) {
+            rcpDir[axis] = (fabsf(dir[axis]) > MATH_FLOAT_SMALLEST_NON_DENORMAL)
+                ? (1.0f / dir[axis])
+                : MATH_FLOAT_HUGE_NUMBER;
+        }
+
+        int stack[MAX_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0) {
+            ovrNode const& node = Nodes[stack[--stackSize]];
+            float t;
+            if (!RayHitsBounds(start, rcpDir, node.Bounds, t)) {
+                continue;
+            }
+            if (node.Left >= 0) {
+                stack[stackSize++] = node.Left;
+                stack[stackSize++] = node.Left + 1;
+                continue;
+            }
+            for (int i = node.First; i < node.First + node.Count; ++i) {
+                int const menuIndex = MenuOrder[i];
+                if (RayHitsBounds(start, rcpDir, Menus[menuIndex].WorldBounds, t)) {
+                    candidates.push_back({menuIndex, t});
+                }
+            }
+        }
+    }
+
+    std::sort(
+        candidates.begin() + firstCandidate,
+        candidates.end(),
+        [](ovrCandidate const& a, ovrCandidate const& b) { return a.T < b.T; });
+}
+
+} // namespace OVRFW
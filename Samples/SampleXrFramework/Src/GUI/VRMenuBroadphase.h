@@ -0,0 +1,83 @@
+/************************************************************************************
+
+Filename    :   VRMenuBroadphase.h
+Content     :   Bounding volume hierarchy over the open menus for ray hit tests.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "OVR_Math.h"
+
+namespace OVRFW {
+
+class VRMenu;
+class OvrVRMenuMgr;
+
+// Bounds each menu by its root object's cull bounds placed at the menu pose, the same bounds
+// VRMenuObject::HitTest() rejects a ray with before it looks at any object, so skipping the menus
+// a ray misses here never loses a hit. Update() refits the tree as menus move and rebuilds it
+// only when menus open or close, or when refitting has let the bounds grow too loose.
+class ovrMenuBroadphase {
+   public:
+    struct ovrCandidate {
+        int MenuIndex; // in the menus passed to Update()
+        float T; // distance along the ray to the menu bounds
+    };
+
+    ovrMenuBroadphase() : BuildArea(0.0f), Area(0.0f) {}
+
+    void Update(OvrVRMenuMgr const& menuMgr, std::vector<VRMenu*> const& menus);
+
+    // Appends the menus the ray may hit, nearest first. The direction must be normalized so the
+    // distances compare with HitTestResult::t.
+    void QueryRay(
+        OVR::Vector3f const& start,
+        OVR::Vector3f const& dir,
+        std::vector<ovrCandidate>& candidates) const;
+
+   private:
+    static const int MAX_MENUS_PER_LEAF = 4;
+    static const int MAX_DEPTH = 64;
+
+    enum ovrBoundsType {
+        BOUNDS_NONE, // the menu can't be hit
+        BOUNDS_CULL, // culled with WorldBounds
+        BOUNDS_ALWAYS_TEST // a root without children isn't culled by HitTest() either
+    };
+
+    struct ovrMenuBounds {
+        VRMenu* Menu;
+        ovrBoundsType Type;
+        OVR::Posef Pose; // of the root object
+        OVR::Bounds3f CullBounds; // of the root object
+        OVR::Bounds3f WorldBounds;
+        int Node; // leaf holding the menu
+    };
+
+    struct ovrNode {
+        OVR::Bounds3f Bounds;
+        int Parent;
+        int Left; // the children are Left and Left + 1, or -1 for a leaf
+        int First; // the menus of a leaf, in MenuOrder
+        int Count;
+        bool Dirty; // Bounds needs to be refit
+    };
+
+    void Build();
+    void BuildNode(int const nodeIndex, int const first, int const count);
+    void Refit();
+
+    std::vector<ovrMenuBounds> Menus;
+    std::vector<int> MenuOrder; // menus with BOUNDS_CULL or BOUNDS_NONE, in leaf order
+    std::vector<int> AlwaysTest; // menus with BOUNDS_ALWAYS_TEST
+    std::vector<ovrNode> Nodes; // parents come before their children
+    float BuildArea; // summed surface area of the nodes right after the last build
+    float Area; // summed surface area of the nodes now
+};
+
+} // namespace OVRFW
@@ -32,6 +32,7 @@ Authors     :   Jonathan E. Wright
 #include "Render/DebugLines.h"
 #include "Render/BitmapFont.h"
 #include "Misc/Log.h"
+#include "JobSystem.h"
 
 #include "VRMenuObject.h"
 #include "GuiSys.h"
@@ -374,7 +375,21 @@ class VRMenuMgrLocal : public OvrVRMenuMgr {
         SubmittedMenuObject* submitted,
         int const maxIndices,
         int& curIndex,
+        int const distanceIndex);
+    bool CanReuseSubmission(
+        VRMenuObject const* obj,
+        VRMenuRenderFlags_t const& flags,
+        Posef const& parentModelPose,
+        Vector4f const& parentColor,
+        Vector3f const& parentScale,
+        int const numFree,
         int const distanceIndex) const;
+    void ReuseSubmission(
+        OvrGuiSys& guiSys,
+        VRMenuObject const* obj,
+        SubmittedMenuObject* submitted,
+        int& curIndex,
+        int const distanceIndex);
 
     //--------------------------------------------------------------
     // private members
@@ -389,10 +404,31 @@ class VRMenuMgrLocal : public OvrVRMenuMgr {
 
     bool Initialized; // true if Init has been called
 
-    SubmittedMenuObject Submitted[MAX_SUBMITTED]; // all objects that have been submitted for
-                                                  // rendering on the current frame
+    // text drawn for a submitted object, kept so an unchanged object can draw it again
+    struct ovrSubmittedText {
+        menuHandle_t Handle;
+        fontParms_t FontParms;
+        Vector3f Position;
+        Vector3f Normal;
+        Vector3f Up;
+        float Scale;
+        Vector4f Color;
+    };
+
+    // Double buffered so the previous frame's submissions are still around to copy from while
+    // the current frame is submitted.
+    SubmittedMenuObject Submitted[2][MAX_SUBMITTED];
+    std::vector<ovrSubmittedText> SubmittedText[2];
+    int SubmitBuffer; // buffer the current frame is submitted to
+    int RenderBuffer; // buffer of the last finished frame
+    int64_t SubmitFrame; // incremented by Finish
+    bool SubmissionChanged; // something was submitted differently than on the previous frame
+    bool SubmitOverflow; // MAX_SUBMITTED was reached, so the submissions can't be reused
+    int NumReused; // submissions copied from the previous frame
+    Vector3f SortViewPos; // view position the sort keys were made for
     std::vector<SurfSort>
         SortKeys; // sort key consisting of distance from view and submission index
+    std::vector<Matrix4f> Transforms; // model matrix of each sorted object, see AppendSurfaceList
     int NumSubmitted; // number of currently submitted menu objects
     mutable int NumToRender; // number of submitted objects to render
 
@@ -416,6 +452,7 @@ class VRMenuMgrLocal : public OvrVRMenuMgr {
     static bool ShowPoses;
     static bool ShowStats; // show stats like number of draw calls
     static bool ShowWrapWidths;
+    static bool RetainSubmissions; // reuse the submissions of unchanged subtrees
 
     static void DebugCollision(void* appPtr, const char* cmdLine);
     static void DebugMenuBounds(void* appPtr, const char* cmdLine);
@@ -423,6 +460,12 @@ class VRMenuMgrLocal : public OvrVRMenuMgr {
     static void DebugMenuPoses(void* appPtr, const char* cmdLine);
     static void DebugShowStats(void* appPtr, const char* cmdLine);
     static void DebugWordWrap(void* appPtr, const char* cmdLine);
+    static void DebugRetainSubmissions(void* appPtr, const char* cmdLine);
+
+    static bool ShowingDebugInfo() {
+        return ShowCollision || ShowDebugBounds || ShowDebugHierarchy || ShowPoses ||
+            ShowWrapWidths;
+    }
 };
 
 bool VRMenuMgrLocal::ShowCollision = false;
@@ -432,6 +475,7 @@ bool VRMenuMgrLocal::ShowDebugNormals = false;
 bool VRMenuMgrLocal::ShowPoses = false;
 bool VRMenuMgrLocal::ShowStats = false;
 bool VRMenuMgrLocal::ShowWrapWidths = false;
+bool VRMenuMgrLocal::RetainSubmissions = true;
 
 void VRMenuMgrLocal::DebugCollision(void* appPtr, const char* parms) {
     ovrLexer lex(parms);
@@ -481,10 +525,29 @@ void VRMenuMgrLocal::DebugWordWrap(void* appPtr, const char* parms) {
     ALOG("ShowWrapWidths( '%s' ): show = %i", parms, show);
 }
 
+void VRMenuMgrLocal::DebugRetainSubmissions(void* appPtr, const char* parms) {
+    ovrLexer lex(parms);
+    int retain;
+    lex.ParseInt(retain, 1);
+    RetainSubmissions = retain != 0;
+    ALOG("RetainSubmissions( '%s' ): retain = %i", parms, retain);
+}
+
 //==================================
 // VRMenuMgrLocal::VRMenuMgrLocal
 VRMenuMgrLocal::VRMenuMgrLocal(OvrGuiSys& guiSys)
-    : GuiSys(guiSys), CurrentId(0), Initialized(false), NumSubmitted(0), NumToRender(0) {}
+    : GuiSys(guiSys),
+      CurrentId(0),
+      Initialized(false),
+      SubmitBuffer(0),
+      RenderBuffer(1),
+      SubmitFrame(0),
+      SubmissionChanged(true),
+      SubmitOverflow(false),
+      NumReused(0),
+      SortViewPos(0.0f),
+      NumSubmitted(0),
+      NumToRender(0) {}
 
 //==================================
 // VRMenuMgrLocal::~VRMenuMgrLocal
@@ -501,7 +564,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
     }
 
     // diffuse only
-    if (GUIProgramDiffuseOnly.VertexShader == 0 || GUIProgramDiffuseOnly.FragmentShader == 0) {
+    if (!GUIProgramDiffuseOnly.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -520,8 +583,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             uniformCount);
     }
     // diffuse alpha discard only
-    if (GUIProgramDiffuseAlphaDiscard.VertexShader == 0 ||
-        GUIProgramDiffuseAlphaDiscard.FragmentShader == 0) {
+    if (!GUIProgramDiffuseAlphaDiscard.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -540,8 +602,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             uniformCount);
     }
     // diffuse + additive
-    if (GUIProgramDiffusePlusAdditive.VertexShader == 0 ||
-        GUIProgramDiffusePlusAdditive.FragmentShader == 0) {
+    if (!GUIProgramDiffusePlusAdditive.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -559,8 +620,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             uniformCount);
     }
     // diffuse + diffuse
-    if (GUIProgramDiffuseComposite.VertexShader == 0 ||
-        GUIProgramDiffuseComposite.FragmentShader == 0) {
+    if (!GUIProgramDiffuseComposite.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -578,8 +638,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             uniformCount);
     }
     // diffuse color ramped
-    if (GUIProgramDiffuseColorRamp.VertexShader == 0 ||
-        GUIProgramDiffuseColorRamp.FragmentShader == 0) {
+    if (!GUIProgramDiffuseColorRamp.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -596,8 +655,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             GUIDiffuseOnlyVertexShaderSrc, GUIColorRampFragmentSrc, uniformParms, uniformCount);
     }
     // diffuse, color ramp, and a specific target for the color ramp
-    if (GUIProgramDiffuseColorRampTarget.VertexShader == 0 ||
-        GUIProgramDiffuseColorRampTarget.FragmentShader == 0) {
+    if (!GUIProgramDiffuseColorRampTarget.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -616,7 +674,7 @@ void VRMenuMgrLocal::Init(OvrGuiSys& guiSys) {
             uniformParms,
             uniformCount);
     }
-    if (GUIProgramAlphaDiffuse.VertexShader == 0 || GUIProgramAlphaDiffuse.FragmentShader == 0) {
+    if (!GUIProgramAlphaDiffuse.IsValid()) {
         static OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             {"UniformColor", OVRFW::ovrProgramParmType::FLOAT_VECTOR4},
@@ -843,12 +901,13 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
     SubmittedMenuObject* submitted,
     int const maxIndices,
     int& curIndex,
-    int const distanceIndex) const {
+    int const distanceIndex) {
     if (curIndex >= maxIndices) {
         // If this happens we're probably not correctly clearing the submitted surfaces each frame
         // OR we've got a LOT of surfaces.
         ALOG("maxIndices = %i, curIndex = %i", maxIndices, curIndex);
         /// assert_WITH_TAG( curIndex < maxIndices, "VrMenu" );
+        SubmitOverflow = true;
         return;
     }
 
@@ -858,6 +917,22 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
         return;
     }
 
+    if (CanReuseSubmission(
+            obj,
+            flags,
+            parentModelPose,
+            parentColor,
+            parentScale,
+            maxIndices - curIndex,
+            distanceIndex)) {
+        ReuseSubmission(guiSys, obj, submitted, curIndex, distanceIndex);
+        cullBounds = obj->GetCullBounds();
+        return;
+    }
+    int const firstSubmitted = curIndex;
+    int const firstText = static_cast<int>(SubmittedText[SubmitBuffer].size());
+    bool viewDependent = (oFlags & VRMENUOBJECT_FLAG_BILLBOARD) != 0;
+
     Posef const& localPose = obj->GetLocalPose();
     Vector3f const& localScale = obj->GetLocalScale();
     Vector4f const& localColor = obj->GetColor();
@@ -1014,6 +1089,7 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
                 if (curIndex - submissionIndex == 0) {
                     SubmittedMenuObject& sub = submitted[curIndex];
                     sub.SurfaceIndex = -1;
+                    sub.DistanceIndex = distanceIndex >= 0 ? distanceIndex : curIndex;
                     sub.Pose = itemPose;
                     sub.Scale = scale;
                     sub.Flags = rFlags;
@@ -1023,6 +1099,16 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
                     curIndex++;
                 }
             } else {
+                ovrSubmittedText submittedText;
+                submittedText.Handle = obj->GetHandle();
+                submittedText.FontParms = fontParms;
+                submittedText.Position = position;
+                submittedText.Normal = textNormal;
+                submittedText.Up = textUp;
+                submittedText.Scale = textScale.x * fp.Scale;
+                submittedText.Color = textColor;
+                SubmittedText[SubmitBuffer].push_back(submittedText);
+
                 /// OVR_PERF_ACCUMULATE( SubmitForRenderingRecursive_DrawText3D );
                 guiSys.GetDefaultFontSurface().DrawText3D(
                     guiSys.GetDefaultFont(),
@@ -1101,6 +1187,9 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
                 maxIndices,
                 curIndex,
                 di);
+            if (child->SubmitCache.Frame == SubmitFrame && child->SubmitCache.ViewDependent) {
+                viewDependent = true;
+            }
 
             Posef pose = child->GetLocalPose();
             pose.Translation = pose.Translation * scale;
@@ -1182,6 +1271,101 @@ void VRMenuMgrLocal::SubmitForRenderingRecursive(
                 obj->GetSurfaces()[0].GetName().c_str());
         }
     }
+
+    VRMenuObject::ovrSubmitCache& cache = obj->SubmitCache;
+    cache.Frame = SubmitOverflow ? -1 : SubmitFrame;
+    cache.FirstSubmitted = firstSubmitted;
+    cache.NumSubmitted = curIndex - firstSubmitted;
+    cache.FirstText = firstText;
+    cache.NumText = static_cast<int>(SubmittedText[SubmitBuffer].size()) - firstText;
+    cache.DistanceIndex = distanceIndex;
+    cache.ViewDependent = viewDependent;
+    cache.ParentPose = parentModelPose;
+    cache.ParentColor = parentColor;
+    cache.ParentScale = parentScale;
+    cache.RenderFlags = flags;
+    obj->RenderDirty = false;
+    SubmissionChanged = true;
+}
+
+//==============================
+// VRMenuMgrLocal::CanReuseSubmission
+// True if the object and its descendants would be submitted just like on the previous frame.
+bool VRMenuMgrLocal::CanReuseSubmission(
+    VRMenuObject const* obj,
+    VRMenuRenderFlags_t const& flags,
+    Posef const& parentModelPose,
+    Vector4f const& parentColor,
+    Vector3f const& parentScale,
+    int const numFree,
+    int const distanceIndex) const {
+    if (!RetainSubmissions || obj->RenderDirty || ShowingDebugInfo()) {
+        return false;
+    }
+    // A subtree copied wholesale doesn't update the caches of the objects below its root, so
+    // those are walked again the first frame their root can't be copied.
+    VRMenuObject::ovrSubmitCache const& cache = obj->SubmitCache;
+    if (cache.Frame != SubmitFrame - 1 || cache.ViewDependent || cache.NumSubmitted > numFree) {
+        return false;
+    }
+    // within a subtree either all objects sort by an ancestor's distance, or none do
+    if ((cache.DistanceIndex >= 0) != (distanceIndex >= 0)) {
+        return false;
+    }
+    return cache.RenderFlags.GetValue() == flags.GetValue() &&
+        cache.ParentPose.Translation == parentModelPose.Translation &&
+        cache.ParentPose.Rotation == parentModelPose.Rotation &&
+        cache.ParentColor == parentColor && cache.ParentScale == parentScale;
+}
+
+//==============================
+// VRMenuMgrLocal::ReuseSubmission
+// Copies the object's submissions from the previous frame and draws its text again.
+void VRMenuMgrLocal::ReuseSubmission(
+    OvrGuiSys& guiSys,
+    VRMenuObject const* obj,
+    SubmittedMenuObject* submitted,
+    int& curIndex,
+    int const distanceIndex) {
+    VRMenuObject::ovrSubmitCache& cache = obj->SubmitCache;
+
+    SubmittedMenuObject const* previous = &Submitted[RenderBuffer][cache.FirstSubmitted];
+    int const shift = curIndex - cache.FirstSubmitted;
+    for (int i = 0; i < cache.NumSubmitted; ++i) {
+        SubmittedMenuObject& sub = submitted[curIndex + i];
+        sub = previous[i];
+        sub.DistanceIndex = distanceIndex >= 0 ? distanceIndex : previous[i].DistanceIndex + shift;
+    }
+    if (shift != 0 || distanceIndex != cache.DistanceIndex) {
+        SubmissionChanged = true;
+    }
+
+    std::vector<ovrSubmittedText> const& previousText = SubmittedText[RenderBuffer];
+    std::vector<ovrSubmittedText>& text = SubmittedText[SubmitBuffer];
+    int const firstText = static_cast<int>(text.size());
+    for (int i = 0; i < cache.NumText; ++i) {
+        ovrSubmittedText const& t = previousText[cache.FirstText + i];
+        text.push_back(t);
+        VRMenuObject const* textObj = ToObject(t.Handle);
+        if (textObj != NULL) {
+            guiSys.GetDefaultFontSurface().DrawText3D(
+                guiSys.GetDefaultFont(),
+                t.FontParms,
+                t.Position,
+                t.Normal,
+                t.Up,
+                t.Scale,
+                t.Color,
+                textObj->GetText().c_str());
+        }
+    }
+
+    cache.Frame = SubmitFrame;
+    cache.FirstSubmitted = curIndex;
+    cache.FirstText = firstText;
+    cache.DistanceIndex = distanceIndex;
+    curIndex += cache.NumSubmitted;
+    NumReused += cache.NumSubmitted;
 }
 
 //==============================
@@ -1213,7 +1397,7 @@ void VRMenuMgrLocal::SubmitForRendering(
         Vector4f(1.0f),
         Vector3f(1.0f),
         cullBounds,
-        Submitted,
+        Submitted[SubmitBuffer],
         MAX_SUBMITTED,
         NumSubmitted,
         -1);
@@ -1228,7 +1412,23 @@ void VRMenuMgrLocal::Finish(Matrix4f const& viewMatrix) {
     // free any deleted component objects
     ExecutePendingComponentDeletions();
 
-    if (NumSubmitted == 0) {
+    int const numSubmitted = NumSubmitted;
+    bool const changed = SubmissionChanged || numSubmitted != NumToRender;
+    if (ShowStats) {
+        ALOG("VRMenuMgr: reused %i of %i submissions", NumReused, numSubmitted);
+    }
+
+    // the submissions just finished are rendered, and copied from during the next frame
+    RenderBuffer = SubmitBuffer;
+    SubmitBuffer ^= 1;
+    SubmittedText[SubmitBuffer].clear();
+    SubmitFrame++;
+    SubmissionChanged = false;
+    SubmitOverflow = false;
+    NumReused = 0;
+    NumSubmitted = 0;
+
+    if (numSubmitted == 0) {
         NumToRender = 0;
         return;
     }
@@ -1237,9 +1437,18 @@ void VRMenuMgrLocal::Finish(Matrix4f const& viewMatrix) {
                                                     // could use Transposed() here instead
     Vector3f viewPos = invViewMatrix.GetTranslation();
 
+    // The same submissions seen from about the same place sort the same way, so keep the
+    // order until the view has moved further than this.
+    static const float RESORT_DISTANCE = 0.01f;
+    if (!changed && (viewPos - SortViewPos).LengthSq() < RESORT_DISTANCE * RESORT_DISTANCE) {
+        return;
+    }
+    SortViewPos = viewPos;
+
     // sort surfaces
-    SortKeys.resize(NumSubmitted);
-    for (int i = 0; i < NumSubmitted; ++i) {
+    SubmittedMenuObject const* submitted = Submitted[RenderBuffer];
+    SortKeys.resize(numSubmitted);
+    for (int i = 0; i < numSubmitted; ++i) {
         // The sort key is a combination of the distance squared, reinterpreted as an integer, and
         // the submission index. This sorts on distance while still allowing submission order to
         // contribute in the equal case. The DistanceIndex is used to force a submitted object to
@@ -1248,17 +1457,16 @@ void VRMenuMgrLocal::Finish(Matrix4f const& viewMatrix) {
         // DistanceIndex will then be sorted against each other based only on their submission
         // index.
         float const distSq =
-            (Submitted[Submitted[i].DistanceIndex].Pose.Translation - viewPos).LengthSq();
+            (submitted[submitted[i].DistanceIndex].Pose.Translation - viewPos).LengthSq();
         int64_t sortKey = *reinterpret_cast<unsigned const*>(&distSq);
         SortKeys[i].Key = (sortKey << 32ULL) |
-            (NumSubmitted -
+            (numSubmitted -
              i); // invert i because we want items submitted sooner to be considered "further away"
     }
 
     std::sort(SortKeys.begin(), SortKeys.end());
 
-    NumToRender = NumSubmitted;
-    NumSubmitted = 0;
+    NumToRender = numSubmitted;
 }
 
 //==============================
@@ -1270,12 +1478,18 @@ void VRMenuMgrLocal::AppendSurfaceList(
         return;
     }
 
-    for (int i = 0; i < NumToRender; ++i) {
-        int idx = abs(static_cast<int>(SortKeys[i].Key & 0xFFFFFFFF) - NumToRender);
-        SubmittedMenuObject const& cur = Submitted[idx];
+    Matrix4f const invViewMatrix = centerViewMatrix.Inverted();
+    Vector3f const viewPos = invViewMatrix.GetTranslation();
+
+    // The transforms are worked out in parallel; emitting the surfaces writes to the menu
+    // objects, so that stays serial and in sorted order.
+    static const int OBJECTS_PER_BATCH = 32;
+    Transforms.resize(NumToRender);
+    auto buildTransforms = [&](const int /*batch*/, const int begin, const int end) {
+        for (int i = begin; i < end; ++i) {
+            int idx = abs(static_cast<int>(SortKeys[i].Key & 0xFFFFFFFF) - NumToRender);
+            SubmittedMenuObject const& cur = Submitted[RenderBuffer][idx];
 
-        VRMenuObject* obj = static_cast<VRMenuObject*>(ToObject(cur.Handle));
-        if (obj != NULL) {
             Vector3f translation(
                 cur.Pose.Translation.x + cur.Offsets.x,
                 cur.Pose.Translation.y + cur.Offsets.y,
@@ -1283,9 +1497,6 @@ void VRMenuMgrLocal::AppendSurfaceList(
 
             Matrix4f transform(cur.Pose.Rotation);
             if (cur.Flags & VRMENU_RENDER_BILLBOARD) {
-                Matrix4f invViewMatrix = centerViewMatrix.Inverted();
-                Vector3f viewPos = invViewMatrix.GetTranslation();
-
                 Vector3f normal = viewPos - cur.Pose.Translation;
                 Vector3f up(0.0f, 1.0f, 0.0f);
                 float length = normal.Length();
@@ -1305,14 +1516,29 @@ void VRMenuMgrLocal::AppendSurfaceList(
 
             transform *= scaleMatrix;
             transform.SetTranslation(translation);
+            Transforms[i] = transform;
+        }
+    };
+    ovrJobSystem* jobSystem = GetJobSystem();
+    if (jobSystem != nullptr) {
+        jobSystem->ParallelFor(NumToRender, OBJECTS_PER_BATCH, buildTransforms);
+    } else {
+        buildTransforms(0, 0, NumToRender);
+    }
 
+    for (int i = 0; i < NumToRender; ++i) {
+        int idx = abs(static_cast<int>(SortKeys[i].Key & 0xFFFFFFFF) - NumToRender);
+        SubmittedMenuObject const& cur = Submitted[RenderBuffer][idx];
+
+        VRMenuObject* obj = static_cast<VRMenuObject*>(ToObject(cur.Handle));
+        if (obj != NULL) {
             // TODO: do we need to use SubmittedMenuObject at all now that we can use
             // ovrSurfaceDef? We still need to sort for now but ideally SurfaceRenderer
             // would sort all surfaces before rendering.
 
             obj->BuildDrawSurface(
                 *this,
-                transform,
+                Transforms[i],
                 cur.SurfaceName.c_str(),
                 cur.SurfaceIndex,
                 cur.Color,
@@ -1327,8 +1553,6 @@ void VRMenuMgrLocal::AppendSurfaceList(
         }
     }
 
-    glDisable(GL_POLYGON_OFFSET_FILL);
-
     if (ShowStats) {
         ALOG("VRMenuMgr: submitted %i surfaces", NumToRender);
     }
@@ -180,6 +180,20 @@ void VRMenuSurfaceTexture::LoadTexture(
     Texture = GlTexture(texId, width, height);
 }
 
+//==============================
+// VRMenuSurfaceTexture::LoadAtlasImage
+void VRMenuSurfaceTexture::LoadAtlasImage(
+    eSurfaceTextureType const type,
+    ovrDynamicTextureAtlas::ovrAtlasImage const& image) {
+    Free();
+
+    assert(type >= 0 && type < SURFACE_TEXTURE_MAX);
+
+    Type = type;
+    OwnsTexture = false; // the page belongs to the atlas
+    Texture = GlTexture(image.Texture.texture, GL_TEXTURE_2D, image.Width, image.Height);
+}
+
 //==============================
 // VRMenuSurfaceTexture::Free
 void VRMenuSurfaceTexture::Free() {
@@ -223,6 +237,10 @@ VRMenuSurface::VRMenuSurface()
           2.0f,
           2.0f) // if we clip exactly at the edges we get sharp, aliased edges
       ,
+      AtlasUVs(0.0f, 0.0f, 1.0f, 1.0f),
+      UsesAtlas(false),
+      DrawClipUVs(-1.0f, -1.0f, 2.0f, 2.0f),
+      DrawOffsetUVs(0.0f, 0.0f),
       Contents(CONTENT_SOLID),
       Visible(true),
       ProgramType(PROGRAM_MAX) {}
@@ -454,6 +472,20 @@ void VRMenuSurface::BuildDrawSurface(
     FadeDirection = fadeDirection;
     ClipUVs = clipUVs;
     OffsetUVs = offsetUVs;
+    if (UsesAtlas) {
+        // Clip and offset are given for the image, and the texture coordinates are on the
+        // atlas page.
+        const Vector2f rectSize(AtlasUVs.z - AtlasUVs.x, AtlasUVs.w - AtlasUVs.y);
+        DrawClipUVs = Vector4f(
+            AtlasUVs.x + clipUVs.x * rectSize.x,
+            AtlasUVs.y + clipUVs.y * rectSize.y,
+            AtlasUVs.x + clipUVs.z * rectSize.x,
+            AtlasUVs.y + clipUVs.w * rectSize.y);
+        DrawOffsetUVs = Vector2f(offsetUVs.x * rectSize.x, offsetUVs.y * rectSize.y);
+    } else {
+        DrawClipUVs = clipUVs;
+        DrawOffsetUVs = offsetUVs;
+    }
     ColorTableOffset = colorTableOffset;
 
     /// uniform binding - match the uniforms to what they were setup in VRMenuMgrLocal::Init
@@ -469,16 +501,16 @@ void VRMenuSurface::BuildDrawSurface(
             gc.Textures[0] = Textures[diffuseIndex].GetTexture();
             gc.UniformData[0].Data = &Color;
             gc.UniformData[1].Data = &FadeDirection;
-            gc.UniformData[2].Data = &OffsetUVs;
+            gc.UniformData[2].Data = &DrawOffsetUVs;
             gc.UniformData[3].Data = &gc.Textures[0];
-            gc.UniformData[4].Data = &ClipUVs;
+            gc.UniformData[4].Data = &DrawClipUVs;
             break;
 
         case PROGRAM_ADDITIVE_ONLY:
             gc.Textures[0] = Textures[additiveIndex].GetTexture();
             gc.UniformData[0].Data = &Color;
             gc.UniformData[1].Data = &FadeDirection;
-            gc.UniformData[2].Data = &OffsetUVs;
+            gc.UniformData[2].Data = &DrawOffsetUVs;
             gc.UniformData[3].Data = &gc.Textures[0];
             break;
 
@@ -486,9 +518,9 @@ void VRMenuSurface::BuildDrawSurface(
             gc.Textures[0] = Textures[diffuseADIndex].GetTexture();
             gc.UniformData[0].Data = &Color;
             gc.UniformData[1].Data = &FadeDirection;
-            gc.UniformData[2].Data = &OffsetUVs;
+            gc.UniformData[2].Data = &DrawOffsetUVs;
             gc.UniformData[3].Data = &gc.Textures[0];
-            gc.UniformData[4].Data = &ClipUVs;
+            gc.UniformData[4].Data = &DrawClipUVs;
             break;
 
         case PROGRAM_DIFFUSE_PLUS_ADDITIVE:
@@ -515,7 +547,7 @@ void VRMenuSurface::BuildDrawSurface(
             gc.Textures[2] = Textures[rampIndex].GetTexture();
             gc.UniformData[0].Data = &Color;
             gc.UniformData[1].Data = &FadeDirection;
-            gc.UniformData[2].Data = &OffsetUVs;
+            gc.UniformData[2].Data = &DrawOffsetUVs;
             gc.UniformData[3].Data = &gc.Textures[0];
             gc.UniformData[4].Data = &gc.Textures[1];
             gc.UniformData[5].Data = &gc.Textures[2];
@@ -723,12 +755,33 @@ void VRMenuSurface::CreateFromSurfaceParms(OvrGuiSys& guiSys, VRMenuSurfaceParms
 
     SurfaceName = parms.SurfaceName;
 
+    // A surface with a single image can sample it from a shared atlas page, so menus end up
+    // binding a handful of textures. Crops are left to surfaces with their own texture.
+    ovrDynamicTextureAtlas& atlas = guiSys.GetTextureManager().GetAtlas();
+    int numImageNames = 0;
+    for (int i = 0; i < VRMENUSURFACE_IMAGE_MAX; ++i) {
+        numImageNames += parms.ImageNames[i].empty() ? 0 : 1;
+    }
+    const bool tryAtlas = atlas.IsEnabled() && numImageNames == 1 && parms.ImageTexId[0] == 0 &&
+        parms.CropUV == Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
+
     {
         /// OVR_PERF_TIMER( VerifyImageParms );
         // verify the input parms have a valid image name and texture type
         bool isValid = false;
         for (int i = 0; i < VRMENUSURFACE_IMAGE_MAX; ++i) {
+            ovrDynamicTextureAtlas::ovrAtlasImage atlasImage;
             if (!parms.ImageNames[i].empty() &&
+                (parms.TextureTypes[i] >= SURFACE_TEXTURE_DIFFUSE &&
+                 parms.TextureTypes[i] < SURFACE_TEXTURE_MAX) &&
+                tryAtlas &&
+                atlas.LoadImageFile(guiSys.GetFileSys(), parms.ImageNames[i].c_str(), atlasImage)) {
+                isValid = true;
+                Textures[i].LoadAtlasImage(parms.TextureTypes[i], atlasImage);
+                AtlasUVs = atlasImage.UVRect;
+                UsesAtlas = true;
+            } else if (
+                !parms.ImageNames[i].empty() &&
                 (parms.TextureTypes[i] >= SURFACE_TEXTURE_DIFFUSE &&
                  parms.TextureTypes[i] < SURFACE_TEXTURE_MAX)) {
                 isValid = true;
@@ -783,7 +836,9 @@ void VRMenuSurface::CreateFromSurfaceParms(OvrGuiSys& guiSys, VRMenuSurfaceParms
     }
 
     Border = parms.Border;
-    CropUV = parms.CropUV;
+    // The geometry flips v, so the crop of the atlas rect is flipped too.
+    CropUV = UsesAtlas ? Vector4f(AtlasUVs.x, 1.0f - AtlasUVs.w, AtlasUVs.z, 1.0f - AtlasUVs.y)
+                       : parms.CropUV;
     OffsetUVs = parms.OffsetUVs;
     Anchors = parms.Anchors;
     Contents = parms.Contents;
@@ -883,6 +938,21 @@ void VRMenuSurface::Free() {
     for (int i = 0; i < VRMENUSURFACE_IMAGE_MAX; ++i) {
         Textures[i].Free();
     }
+    UsesAtlas = false;
+    AtlasUVs = Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+//==============================
+// VRMenuSurface::ReleaseAtlas
+// Replacing the image of an atlas surface goes back to mapping the whole texture.
+void VRMenuSurface::ReleaseAtlas() {
+    if (!UsesAtlas) {
+        return;
+    }
+    UsesAtlas = false;
+    AtlasUVs = Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
+    CropUV = Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
+    RegenerateSurfaceGeometry();
 }
 
 //==============================
@@ -920,6 +990,7 @@ void VRMenuSurface::LoadTexture(
         /// );
         return;
     }
+    ReleaseAtlas();
     Textures[textureIndex].LoadTexture(guiSys, type, imageName, true);
 }
 
@@ -936,6 +1007,7 @@ void VRMenuSurface::LoadTexture(
         /// );
         return;
     }
+    ReleaseAtlas();
     Textures[textureIndex].LoadTexture(type, texId, width, height);
 }
 
@@ -984,7 +1056,9 @@ VRMenuObject::VRMenuObject(VRMenuObjectParms const& parms, menuHandle_t const ha
       MinsBoundsExpand(0.0f),
       MaxsBoundsExpand(0.0f),
       TextMetrics(),
-      TextSurface(nullptr) {
+      TextSurface(nullptr),
+      MenuMgr(nullptr),
+      RenderDirty(true) {
     CullBounds.Clear();
 }
 
@@ -1017,6 +1091,7 @@ VRMenuObject::~VRMenuObject() {
 // VRMenuObject::Init
 void VRMenuObject::Init(OvrGuiSys& guiSys, VRMenuObjectParms const& parms) {
     /// OVR_PERF_TIMER( VRMenuObjectInit );
+    MenuMgr = &guiSys.GetVRMenuMgr();
     for (int i = 0; i < static_cast<int>(parms.SurfaceParms.size()); ++i) {
         int idx = AllocSurface();
         Surfaces[idx].CreateFromSurfaceParms(guiSys, parms.SurfaceParms[i]);
@@ -1056,6 +1131,7 @@ void VRMenuObject::FreeChildren(OvrVRMenuMgr& menuMgr) {
         menuMgr.FreeObject(Children[i]);
     }
     Children.resize(0);
+    MarkRenderDirty();
     // NOTE! bounds will be incorrect now until submitted for rendering
 }
 
@@ -1090,6 +1166,7 @@ void VRMenuObject::AddChild(OvrVRMenuMgr& menuMgr, menuHandle_t const handle) {
     if (child != NULL) {
         child->SetParentHandle(this->Handle);
     }
+    MarkRenderDirty();
     // NOTE: bounds will be incorrect until submitted for rendering
 }
 void VRMenuObject::AddChild(VRMenuObject* child) {
@@ -1097,6 +1174,7 @@ void VRMenuObject::AddChild(VRMenuObject* child) {
     if (child != nullptr) {
         child->SetParentHandle(this->Handle);
     }
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1105,6 +1183,12 @@ void VRMenuObject::RemoveChild(OvrVRMenuMgr& menuMgr, menuHandle_t const handle)
     for (int i = 0; i < static_cast<int>(Children.size()); ++i) {
         if (Children[i] == handle) {
             Children.erase(Children.cbegin() + i);
+            // so marking the child dirty doesn't walk up into its old parent
+            VRMenuObject* child = menuMgr.ToObject(handle);
+            if (child != NULL && child->ParentHandle == Handle) {
+                child->ParentHandle.Release();
+            }
+            MarkRenderDirty();
             return;
         }
     }
@@ -1118,6 +1202,7 @@ void VRMenuObject::FreeChild(OvrVRMenuMgr& menuMgr, menuHandle_t const handle) {
         if (childHandle == handle) {
             Children.erase(Children.cbegin() + i);
             menuMgr.FreeObject(childHandle);
+            MarkRenderDirty();
             return;
         }
     }
@@ -1754,7 +1839,10 @@ Vector2f const& VRMenuObject::GetColorTableOffset() const {
 //==============================
 // VRMenuObject::SetColorTableOffset
 void VRMenuObject::SetColorTableOffset(Vector2f const& ofs) {
-    ColorTableOffset = ofs;
+    if (ColorTableOffset != ofs) {
+        ColorTableOffset = ofs;
+        MarkRenderDirty();
+    }
 }
 
 //==============================
@@ -1766,14 +1854,32 @@ Vector4f const& VRMenuObject::GetColor() const {
 //==============================
 // VRMenuObject::SetColor
 void VRMenuObject::SetColor(Vector4f const& c) {
-    Color = c;
+    if (Color != c) {
+        Color = c;
+        MarkRenderDirty();
+    }
 }
 
 void VRMenuObject::SetVisible(bool visible) {
     if (visible) {
-        Flags &= ~VRMenuObjectFlags_t(VRMENUOBJECT_DONT_RENDER);
+        RemoveFlags(VRMenuObjectFlags_t(VRMENUOBJECT_DONT_RENDER));
     } else {
-        Flags |= VRMenuObjectFlags_t(VRMENUOBJECT_DONT_RENDER);
+        AddFlags(VRMenuObjectFlags_t(VRMENUOBJECT_DONT_RENDER));
+    }
+}
+
+//==============================
+// VRMenuObject::MarkRenderDirty
+void VRMenuObject::MarkRenderDirty() {
+    RenderDirty = true;
+    if (MenuMgr == nullptr) {
+        return;
+    }
+    // Walk all the way up: an ancestor may still be dirty from a frame it was hidden in, and
+    // that says nothing about the ones above it.
+    for (VRMenuObject* parent = MenuMgr->ToObject(ParentHandle); parent != nullptr;
+         parent = MenuMgr->ToObject(parent->ParentHandle)) {
+        parent->RenderDirty = true;
     }
 }
 
@@ -1900,6 +2006,7 @@ void VRMenuObject::SetSurfaceTexture(
         return;
     }
     Surfaces[surfaceIndex].LoadTexture(guiSys, textureIndex, type, imageName);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1917,6 +2024,7 @@ void VRMenuObject::SetSurfaceTexture(
         return;
     }
     Surfaces[surfaceIndex].LoadTexture(textureIndex, type, texId, width, height);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1933,6 +2041,7 @@ void VRMenuObject::SetSurfaceTexture(
     }
     Surfaces[surfaceIndex].LoadTexture(
         textureIndex, type, texture.texture, texture.Width, texture.Height);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1951,6 +2060,7 @@ void VRMenuObject::SetSurfaceTextureTakeOwnership(
     }
     Surfaces[surfaceIndex].LoadTexture(textureIndex, type, texId, width, height);
     Surfaces[surfaceIndex].SetOwnership(textureIndex, true);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1968,6 +2078,7 @@ void VRMenuObject::SetSurfaceTextureTakeOwnership(
     Surfaces[surfaceIndex].LoadTexture(
         textureIndex, type, texture.texture, texture.Width, texture.Height);
     Surfaces[surfaceIndex].SetOwnership(textureIndex, true);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -1986,6 +2097,7 @@ void VRMenuObject::RegenerateSurfaceGeometry(
     }
 
     Surfaces[surfaceIndex].RegenerateSurfaceGeometry();
+    MarkRenderDirty();
 }
 
 //==============================
@@ -2010,6 +2122,7 @@ void VRMenuObject::SetSurfaceDims(int const surfaceIndex, Vector2f const& dims)
     }
 
     Surfaces[surfaceIndex].SetDims(dims);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -2034,6 +2147,7 @@ void VRMenuObject::SetSurfaceBorder(int const surfaceIndex, Vector4f const& bord
     }
 
     Surfaces[surfaceIndex].SetBorder(border);
+    MarkRenderDirty();
 }
 
 //==============================
@@ -2041,6 +2155,7 @@ void VRMenuObject::SetSurfaceBorder(int const surfaceIndex, Vector4f const& bord
 void VRMenuObject::SetLocalBoundsExpand(Vector3f const mins, Vector3f const& maxs) {
     MinsBoundsExpand = mins;
     MaxsBoundsExpand = maxs;
+    MarkRenderDirty();
 }
 
 //==============================
@@ -2096,7 +2211,10 @@ int VRMenuObject::FindSurfaceWithTextureType(
 // VRMenuObject::SetSurfaceColor
 void VRMenuObject::SetSurfaceColor(int const surfaceIndex, Vector4f const& color) {
     VRMenuSurface& surf = Surfaces[surfaceIndex];
-    surf.SetColor(color);
+    if (surf.GetColor() != color) {
+        surf.SetColor(color);
+        MarkRenderDirty();
+    }
 }
 
 //==============================
@@ -2110,7 +2228,10 @@ Vector4f const& VRMenuObject::GetSurfaceColor(int const surfaceIndex) const {
 // VRMenuObject::SetSurfaceVisible
 void VRMenuObject::SetSurfaceVisible(int const surfaceIndex, bool const v) {
     VRMenuSurface& surf = Surfaces[surfaceIndex];
-    surf.SetVisible(v);
+    if (surf.GetVisible() != v) {
+        surf.SetVisible(v);
+        MarkRenderDirty();
+    }
 }
 
 //==============================
@@ -2131,6 +2252,7 @@ int VRMenuObject::NumSurfaces() const {
 int VRMenuObject::AllocSurface() {
     int newIndex = static_cast<int>(Surfaces.size());
     Surfaces.emplace_back(VRMenuSurface());
+    MarkRenderDirty();
     return newIndex;
 }
 
@@ -2142,13 +2264,19 @@ void VRMenuObject::CreateFromSurfaceParms(
     VRMenuSurfaceParms const& parms) {
     VRMenuSurface& surf = Surfaces[surfaceIndex];
     surf.CreateFromSurfaceParms(guiSys, parms);
+    MarkRenderDirty();
 }
 
 //==============================
 // VRMenuObject::SetText
 void VRMenuObject::SetText(char const* text) {
+    // labels often set the same text every frame; keep its text surface as it is
+    if (Text == text) {
+        return;
+    }
     Text = text;
     TextDirty = true;
+    MarkRenderDirty();
 }
 
 //==============================
@@ -2160,6 +2288,7 @@ void VRMenuObject::SetTextWordWrapped(
     FontParms.WrapWidth = widthInMeters;
     SetText(text);
     font.WordWrapText(Text, widthInMeters, FontParms.Scale);
+    MarkRenderDirty();
 }
 
 //==============================
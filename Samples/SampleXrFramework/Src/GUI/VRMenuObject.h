@@ -36,6 +36,7 @@ Authors     :   Jonathan E. Wright
 
 #include "Render/Egl.h" // GLuint
 #include "Render/BitmapFont.h" // HorizontalJustification & VerticalJustification
+#include "Render/DynamicTextureAtlas.h"
 #include "Misc/Log.h"
 
 #include "CollisionPrimitive.h"
@@ -685,6 +686,10 @@ class VRMenuSurfaceTexture {
         const GLuint texId,
         const int width,
         const int height);
+    // Samples the image from its atlas page. The size is the image's, not the page's.
+    void LoadAtlasImage(
+        eSurfaceTextureType const type,
+        ovrDynamicTextureAtlas::ovrAtlasImage const& image);
     void Free();
     void SetOwnership(const bool isOwner) {
         OwnsTexture = isOwner;
@@ -833,6 +838,7 @@ class VRMenuSurface {
     OVR::Vector2f const& GetOffsetUVs() const {
         return OffsetUVs;
     }
+    // Offsets of a surface packed into the texture atlas can't wrap around the image.
     void SetOffsetUVs(OVR::Vector2f const& uvs) {
         OffsetUVs = uvs;
     }
@@ -883,6 +889,10 @@ class VRMenuSurface {
     OVR::Vector4f ClipUVs; // UV boundaries for fragment clipping
     OVR::Vector2f OffsetUVs; // UV offsets
     OVR::Vector4f CropUV; // Crop range in UV space
+    OVR::Vector4f AtlasUVs; // rect of the image on its atlas page
+    bool UsesAtlas; // the single image is sampled from an atlas page
+    OVR::Vector4f DrawClipUVs; // ClipUVs as passed to the shader, mapped to the atlas rect
+    OVR::Vector2f DrawOffsetUVs; // OffsetUVs as passed to the shader
     OVR::Vector4f FadeDirection; // fade direction for some shaders
     OVR::Vector2f ColorTableOffset; // color table offset
     std::string SurfaceName; // name of the surface for debugging
@@ -894,6 +904,7 @@ class VRMenuSurface {
     mutable ovrSurfaceDef SurfaceDef;
 
    private:
+    void ReleaseAtlas();
     void CreateImageGeometry(
         int const textureWidth,
         int const textureHeight,
@@ -1057,13 +1068,18 @@ class VRMenuObject {
         return Flags;
     }
     void SetFlags(VRMenuObjectFlags_t const& flags) {
-        Flags = flags;
+        if (Flags.GetValue() != flags.GetValue()) {
+            Flags = flags;
+            MarkRenderDirty();
+        }
     }
     void AddFlags(VRMenuObjectFlags_t const& flags) {
-        Flags |= flags;
+        SetFlags(Flags | flags);
     }
     void RemoveFlags(VRMenuObjectFlags_t const& flags) {
-        Flags &= ~flags;
+        VRMenuObjectFlags_t newFlags = Flags;
+        newFlags &= ~flags;
+        SetFlags(newFlags);
     }
 
     void ModifyFlags(bool const add, VRMenuObjectFlags_t const& flags) {
@@ -1091,6 +1107,7 @@ class VRMenuObject {
 
         Text = std::string(buf.data());
         TextDirty = true;
+        MarkRenderDirty();
     }
 
     void
@@ -1100,7 +1117,10 @@ class VRMenuObject {
         return Hilighted;
     }
     void SetHilighted(bool const b) {
-        Hilighted = b;
+        if (Hilighted != b) {
+            Hilighted = b;
+            MarkRenderDirty();
+        }
     }
     bool IsSelected() const {
         return Selected;
@@ -1121,52 +1141,79 @@ class VRMenuObject {
         return LocalPose;
     }
     void SetLocalPose(OVR::Posef const& pose) {
-        LocalPose = pose;
+        if (!PosesMatch(LocalPose, pose)) {
+            LocalPose = pose;
+            MarkRenderDirty();
+        }
     }
     OVR::Vector3f const& GetLocalPosition() const {
         return LocalPose.Translation;
     }
     void SetLocalPosition(OVR::Vector3f const& pos) {
-        LocalPose.Translation = pos;
+        if (LocalPose.Translation != pos) {
+            LocalPose.Translation = pos;
+            MarkRenderDirty();
+        }
     }
     OVR::Quatf const& GetLocalRotation() const {
         return LocalPose.Rotation;
     }
     void SetLocalRotation(OVR::Quatf const& rot) {
-        LocalPose.Rotation = rot;
+        if (LocalPose.Rotation != rot) {
+            LocalPose.Rotation = rot;
+            MarkRenderDirty();
+        }
     }
     OVR::Vector3f GetLocalScale() const;
     void SetLocalScale(OVR::Vector3f const& scale) {
-        LocalScale = scale;
+        if (LocalScale != scale) {
+            LocalScale = scale;
+            MarkRenderDirty();
+        }
     }
 
     OVR::Posef const& GetHilightPose() const {
         return HilightPose;
     }
     void SetHilightPose(OVR::Posef const& pose) {
-        HilightPose = pose;
+        if (!PosesMatch(HilightPose, pose)) {
+            HilightPose = pose;
+            MarkRenderDirty();
+        }
     }
     float GetHilightScale() const {
         return HilightScale;
     }
     void SetHilightScale(float const s) {
-        HilightScale = s;
+        if (HilightScale != s) {
+            HilightScale = s;
+            MarkRenderDirty();
+        }
     }
 
     void SetTextLocalPose(OVR::Posef const& pose) {
-        TextLocalPose = pose;
+        if (!PosesMatch(TextLocalPose, pose)) {
+            TextLocalPose = pose;
+            MarkRenderDirty();
+        }
     }
     OVR::Posef const& GetTextLocalPose() const {
         return TextLocalPose;
     }
     void SetTextLocalPosition(OVR::Vector3f const& pos) {
-        TextLocalPose.Translation = pos;
+        if (TextLocalPose.Translation != pos) {
+            TextLocalPose.Translation = pos;
+            MarkRenderDirty();
+        }
     }
     OVR::Vector3f const& GetTextLocalPosition() const {
         return TextLocalPose.Translation;
     }
     void SetTextLocalRotation(OVR::Quatf const& rot) {
-        TextLocalPose.Rotation = rot;
+        if (TextLocalPose.Rotation != rot) {
+            TextLocalPose.Rotation = rot;
+            MarkRenderDirty();
+        }
     }
     OVR::Quatf const& GetTextLocalRotation() const {
         return TextLocalPose.Rotation;
@@ -1176,7 +1223,10 @@ class VRMenuObject {
         return WrapScale;
     }
     void SetTextLocalScale(OVR::Vector3f const& scale) {
-        TextLocalScale = scale;
+        if (TextLocalScale != scale) {
+            TextLocalScale = scale;
+            MarkRenderDirty();
+        }
     }
 
     void SetLocalBoundsExpand(OVR::Vector3f const mins, OVR::Vector3f const& maxs);
@@ -1202,7 +1252,10 @@ class VRMenuObject {
         return TextColor;
     }
     void SetTextColor(OVR::Vector4f const& c) {
-        TextColor = c;
+        if (TextColor != c) {
+            TextColor = c;
+            MarkRenderDirty();
+        }
     }
 
     std::string const& GetName() const {
@@ -1221,6 +1274,7 @@ class VRMenuObject {
 
     void SetFontParms(VRMenuFontParms const& fontParms) {
         FontParms = fontParms;
+        MarkRenderDirty();
     }
     VRMenuFontParms const& GetFontParms() const {
         return FontParms;
@@ -1230,11 +1284,19 @@ class VRMenuObject {
         return FadeDirection;
     }
     void SetFadeDirection(OVR::Vector3f const& dir) {
-        FadeDirection = dir;
+        if (FadeDirection != dir) {
+            FadeDirection = dir;
+            MarkRenderDirty();
+        }
     }
 
     void SetVisible(bool visible);
 
+    // Makes VRMenuMgr submit this object again on the next frame instead of reusing what it
+    // submitted for it last frame. The setters call this, so it's only needed after changing
+    // something they don't cover.
+    void MarkRenderDirty();
+
     // returns the index of the first surface with SURFACE_TEXTURE_ADDITIVE.
     // If singular is true, then the matching surface must have only one texture map and it must be
     // of that type.
@@ -1319,7 +1381,9 @@ class VRMenuObject {
     VRMenuSurface const& GetSurface(int const s) const {
         return Surfaces[s];
     }
+    // The surface may be changed through the reference, so this counts as a change to the object.
     VRMenuSurface& GetSurface(int const s) {
+        MarkRenderDirty();
         return Surfaces[s];
     }
     std::vector<VRMenuSurface> const& GetSurfaces() const {
@@ -1426,7 +1490,41 @@ class VRMenuObject {
 
     mutable ovrTextSurface* TextSurface;
 
+    // What VRMenuMgr submitted for this object and its descendants on the last frame it walked
+    // them. While nothing in the subtree is dirty and the inputs from the parent are the same,
+    // the submissions are copied from the previous frame instead.
+    struct ovrSubmitCache {
+        ovrSubmitCache()
+            : Frame(-1),
+              FirstSubmitted(0),
+              NumSubmitted(0),
+              FirstText(0),
+              NumText(0),
+              DistanceIndex(-1),
+              ViewDependent(false) {}
+
+        int64_t Frame; // submission frame of the menu manager
+        int FirstSubmitted;
+        int NumSubmitted;
+        int FirstText;
+        int NumText;
+        int DistanceIndex; // passed down by an ancestor, or -1
+        bool ViewDependent; // the subtree has billboards, which face the view every frame
+        OVR::Posef ParentPose;
+        OVR::Vector4f ParentColor;
+        OVR::Vector3f ParentScale;
+        VRMenuRenderFlags_t RenderFlags;
+    };
+
+    OvrVRMenuMgr* MenuMgr; // for walking up to the parents
+    mutable bool RenderDirty; // this object or one of its descendants changed since last submitted
+    mutable ovrSubmitCache SubmitCache;
+
    private:
+    static bool PosesMatch(OVR::Posef const& a, OVR::Posef const& b) {
+        return a.Translation == b.Translation && a.Rotation == b.Rotation;
+    }
+
     // only VRMenuMgrLocal static methods can construct and destruct a menu object.
     VRMenuObject(VRMenuObjectParms const& parms, menuHandle_t const handle);
     ~VRMenuObject();
@@ -0,0 +1,93 @@
+/************************************************************************************
+
+Filename    :   ActionStateSnapshot.cpp
+Content     :   Per-frame snapshot of a fixed set of OpenXR action states, with
+                press / release / hold tracking.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#include "ActionStateSnapshot.h"
+
+#include "Misc/Log.h"
+
+#define OXR(func)                                        \
+    if (XR_FAILED(func)) {                               \
+        ALOGV("OpenXR error on fuction: %s: \n", #func); \
+    }
+
+namespace OVRFW {
+
+int ovrActionStateSnapshot::Add(XrAction action, XrActionType type, XrPath subactionPath) {
+    for (int i = 0; i < GetCount(); ++i) {
+        if (States[i].Action == action && States[i].SubactionPath == subactionPath) {
+            return i;
+        }
+    }
+    ovrActionState state;
+    state.Action = action;
+    state.SubactionPath = subactionPath;
+    state.Type = type;
+    States.push_back(state);
+    return GetCount() - 1;
+}
+
+void ovrActionStateSnapshot::Clear() {
+    States.clear();
+}
+
+void ovrActionStateSnapshot::Update(XrSession session, const XrTime frameTime) {
+    XrActionStateGetInfo getInfo = {XR_TYPE_ACTION_STATE_GET_INFO};
+    for (ovrActionState& s : States) {
+        getInfo.action = s.Action;
+        getInfo.subactionPath = s.SubactionPath;
+
+        bool down = false;
+        switch (s.Type) {
+            case XR_ACTION_TYPE_BOOLEAN_INPUT: {
+                XrActionStateBoolean state = {XR_TYPE_ACTION_STATE_BOOLEAN};
+                OXR(xrGetActionStateBoolean(session, &getInfo, &state));
+                s.IsActive = state.isActive != XR_FALSE;
+                s.BoolValue = state.currentState != XR_FALSE;
+                down = s.BoolValue;
+                break;
+            }
+            case XR_ACTION_TYPE_FLOAT_INPUT: {
+                XrActionStateFloat state = {XR_TYPE_ACTION_STATE_FLOAT};
+                OXR(xrGetActionStateFloat(session, &getInfo, &state));
+                s.IsActive = state.isActive != XR_FALSE;
+                s.FloatValue = state.currentState;
+                down = s.FloatValue > PRESS_THRESHOLD;
+                break;
+            }
+            case XR_ACTION_TYPE_VECTOR2F_INPUT: {
+                XrActionStateVector2f state = {XR_TYPE_ACTION_STATE_VECTOR2F};
+                OXR(xrGetActionStateVector2f(session, &getInfo, &state));
+                s.IsActive = state.isActive != XR_FALSE;
+                s.Vector2Value = state.currentState;
+                break;
+            }
+            case XR_ACTION_TYPE_POSE_INPUT: {
+                XrActionStatePose state = {XR_TYPE_ACTION_STATE_POSE};
+                OXR(xrGetActionStatePose(session, &getInfo, &state));
+                s.IsActive = state.isActive != XR_FALSE;
+                break;
+            }
+            default:
+                break;
+        }
+
+        // an inactive action reads as released
+        down = down && s.IsActive;
+        s.Pressed = down && !s.IsDown;
+        s.Released = !down && s.IsDown;
+        s.IsDown = down;
+        if (s.Pressed) {
+            s.DownTime = frameTime;
+        }
+        s.HeldSeconds = down ? (frameTime - s.DownTime) * 1e-9f : 0.0f;
+    }
+}
+
+} // namespace OVRFW
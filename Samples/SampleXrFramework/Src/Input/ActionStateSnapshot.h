@@ -0,0 +1,86 @@
+/************************************************************************************
+
+Filename    :   ActionStateSnapshot.h
+Content     :   Per-frame snapshot of a fixed set of OpenXR action states, with
+                press / release / hold tracking.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <openxr/openxr.h>
+
+namespace OVRFW {
+
+class ovrActionStateSnapshot {
+   public:
+    // Float actions count as down above this value, matching kTrigger / kGripTrigger.
+    static constexpr float PRESS_THRESHOLD = 0.1f;
+
+    struct ovrActionState {
+        XrAction Action = XR_NULL_HANDLE;
+        XrPath SubactionPath = XR_NULL_PATH;
+        XrActionType Type = XR_ACTION_TYPE_BOOLEAN_INPUT;
+
+        // current value, only the one matching Type is written
+        bool IsActive = false;
+        bool BoolValue = false;
+        float FloatValue = 0.0f;
+        XrVector2f Vector2Value = {0.0f, 0.0f};
+
+        // edges, for boolean and float actions
+        bool IsDown = false;
+        bool Pressed = false; // went down this frame
+        bool Released = false; // went up this frame
+        XrTime DownTime = 0; // frame time the current press started
+        float HeldSeconds = 0.0f; // 0 while up
+    };
+
+    // Registers an action / subaction path pair and returns its index. Registering the same
+    // pair twice returns the first index. Set up once, after the actions are created.
+    int Add(XrAction action, XrActionType type, XrPath subactionPath = XR_NULL_PATH);
+    void Clear();
+
+    // Reads every registered action, one runtime call each. Call once per frame after
+    // xrSyncActions. frameTime is the frame's predicted display time.
+    void Update(XrSession session, const XrTime frameTime);
+
+    int GetCount() const {
+        return static_cast<int>(States.size());
+    }
+    const ovrActionState& Get(const int index) const {
+        return States[index];
+    }
+
+    bool IsActive(const int index) const {
+        return States[index].IsActive;
+    }
+    bool IsDown(const int index) const {
+        return States[index].IsDown;
+    }
+    bool Pressed(const int index) const {
+        return States[index].Pressed;
+    }
+    bool Released(const int index) const {
+        return States[index].Released;
+    }
+    float HeldSeconds(const int index) const {
+        return States[index].HeldSeconds;
+    }
+    float GetFloat(const int index) const {
+        return States[index].FloatValue;
+    }
+    XrVector2f GetVector2(const int index) const {
+        return States[index].Vector2Value;
+    }
+
+   private:
+    std::vector<ovrActionState> States;
+};
+
+} // namespace OVRFW
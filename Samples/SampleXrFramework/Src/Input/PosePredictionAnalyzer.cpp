@@ -0,0 +1,170 @@
+/************************************************************************************
+
+Filename    :   PosePredictionAnalyzer.cpp
+Content     :   Measures tracking prediction error by re-locating spaces once the
+                predicted display time has passed.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#include "PosePredictionAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace OVRFW {
+
+static float PositionErrorMm(const XrVector3f& a, const XrVector3f& b) {
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return sqrtf(dx * dx + dy * dy + dz * dz) * 1000.0f;
+}
+
+static float AngularErrorDeg(const XrQuaternionf& a, const XrQuaternionf& b) {
+    // q and -q are the same rotation, so take the shorter arc
+    const float d = fabsf(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w);
+    return 2.0f * acosf(std::min(d, 1.0f)) * (180.0f / 3.14159265358979f);
+}
+
+//==============================================================
+// ovrErrorHistogram
+
+void ovrErrorHistogram::Clear() {
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        Buckets[i] = 0;
+    }
+    Count = 0;
+    Sum = 0.0;
+    Max = 0.0f;
+}
+
+void ovrErrorHistogram::Add(const float value) {
+    const int bucket = std::min(static_cast<int>(value / BucketSize), NUM_BUCKETS - 1);
+    Buckets[std::max(bucket, 0)]++;
+    Count++;
+    Sum += value;
+    Max = std::max(Max, value);
+}
+
+float ovrErrorHistogram::Percentile(const float fraction) const {
+    if (Count == 0) {
+        return 0.0f;
+    }
+    const uint32_t target = static_cast<uint32_t>(ceilf(fraction * Count));
+    uint32_t accumulated = 0;
+    for (int i = 0; i < NUM_BUCKETS - 1; ++i) {
+        accumulated += Buckets[i];
+        if (accumulated >= target) {
+            return (i + 1) * BucketSize;
+        }
+    }
+    // only the overflow bucket is left, its upper bound is the largest value seen
+    return Max;
+}
+
+//==============================================================
+// ovrPosePredictionAnalyzer
+
+ovrPosePredictionAnalyzer::ovrPosePredictionAnalyzer() {
+    for (int i = 0; i < TRACKED_MAX; ++i) {
+        PositionHistogram[i] = ovrErrorHistogram(1.0f); // 1 mm
+        AngularHistogram[i] = ovrErrorHistogram(0.1f); // 0.1 degree
+    }
+    Clear();
+}
+
+void ovrPosePredictionAnalyzer::Clear() {
+    PendingHead = 0;
+    PendingCount = 0;
+    DroppedCount = 0;
+    LastError = ovrPredictionError();
+    for (int i = 0; i < TRACKED_MAX; ++i) {
+        PositionHistogram[i].Clear();
+        AngularHistogram[i].Clear();
+    }
+}
+
+void ovrPosePredictionAnalyzer::AddPrediction(
+    const int64_t frameIndex,
+    const XrTime displayTime,
+    const XrPosef poses[TRACKED_MAX],
+    const bool valid[TRACKED_MAX]) {
+    if (PendingCount == MAX_PENDING) {
+        // the runtime never caught up with this one, give up on it
+        PendingHead = (PendingHead + 1) % MAX_PENDING;
+        PendingCount--;
+        DroppedCount++;
+    }
+
+    ovrPendingPrediction& p = Pending[(PendingHead + PendingCount) % MAX_PENDING];
+    p.FrameIndex = frameIndex;
+    p.DisplayTime = displayTime;
+    for (int i = 0; i < TRACKED_MAX; ++i) {
+        p.Pose[i] = poses[i];
+        p.Valid[i] = valid[i];
+    }
+    PendingCount++;
+}
+
+int ovrPosePredictionAnalyzer::Resolve(
+    XrSpace baseSpace,
+    const XrSpace spaces[TRACKED_MAX],
+    const XrTime now,
+    const XrDuration settleTime,
+    const ovrLocateSpacesFn& locateSpaces) {
+    int resolved = 0;
+    while (PendingCount > 0) {
+        const ovrPendingPrediction& p = Pending[PendingHead];
+        if (p.DisplayTime + settleTime > now) {
+            break; // predictions are queued in display order, the rest are newer
+        }
+
+        // locate all the spaces that had a prediction in one go
+        XrSpace located[TRACKED_MAX];
+        int locatedIndex[TRACKED_MAX];
+        uint32_t locatedCount = 0;
+        for (int i = 0; i < TRACKED_MAX; ++i) {
+            if (p.Valid[i] && spaces[i] != XR_NULL_HANDLE) {
+                located[locatedCount] = spaces[i];
+                locatedIndex[locatedCount] = i;
+                locatedCount++;
+            }
+        }
+        XrSpaceLocation locations[TRACKED_MAX];
+        for (uint32_t l = 0; l < locatedCount; ++l) {
+            locations[l] = {XR_TYPE_SPACE_LOCATION};
+        }
+        if (locatedCount > 0) {
+            locateSpaces(baseSpace, p.DisplayTime, locatedCount, located, locations);
+        }
+
+        ovrPredictionError error;
+        error.FrameIndex = p.FrameIndex;
+        error.DisplayTime = p.DisplayTime;
+        for (uint32_t l = 0; l < locatedCount; ++l) {
+            const XrSpaceLocation& loc = locations[l];
+            // an estimated pose is no better than the prediction, don't score against it
+            const XrSpaceLocationFlags tracked =
+                XR_SPACE_LOCATION_POSITION_TRACKED_BIT | XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT;
+            if ((loc.locationFlags & tracked) != tracked) {
+                continue;
+            }
+            const int i = locatedIndex[l];
+            error.Valid[i] = true;
+            error.PositionError[i] = PositionErrorMm(p.Pose[i].position, loc.pose.position);
+            error.AngularError[i] = AngularErrorDeg(p.Pose[i].orientation, loc.pose.orientation);
+            PositionHistogram[i].Add(error.PositionError[i]);
+            AngularHistogram[i].Add(error.AngularError[i]);
+        }
+        LastError = error;
+
+        PendingHead = (PendingHead + 1) % MAX_PENDING;
+        PendingCount--;
+        resolved++;
+    }
+    return resolved;
+}
+
+} // namespace OVRFW
@@ -0,0 +1,135 @@
+/************************************************************************************
+
+Filename    :   PosePredictionAnalyzer.h
+Content     :   Measures tracking prediction error by re-locating spaces once the
+                predicted display time has passed.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <openxr/openxr.h>
+
+namespace OVRFW {
+
+// Fixed-bucket histogram; the last bucket also collects every value past the range.
+class ovrErrorHistogram {
+   public:
+    static const int NUM_BUCKETS = 64;
+
+    explicit ovrErrorHistogram(const float bucketSize = 1.0f) : BucketSize(bucketSize) {
+        Clear();
+    }
+
+    void Clear();
+    void Add(const float value);
+    // Upper bound of the bucket holding the given fraction (0..1) of the samples.
+    float Percentile(const float fraction) const;
+
+    float GetBucketSize() const {
+        return BucketSize;
+    }
+    uint32_t GetBucket(const int index) const {
+        return Buckets[index];
+    }
+    uint32_t GetCount() const {
+        return Count;
+    }
+    float GetMean() const {
+        return Count > 0 ? static_cast<float>(Sum / Count) : 0.0f;
+    }
+    float GetMax() const {
+        return Max;
+    }
+
+   private:
+    float BucketSize;
+    uint32_t Buckets[NUM_BUCKETS];
+    uint32_t Count;
+    double Sum;
+    float Max;
+};
+
+class ovrPosePredictionAnalyzer {
+   public:
+    enum ovrTrackedSpace { TRACKED_HEAD, TRACKED_LEFT_GRIP, TRACKED_RIGHT_GRIP, TRACKED_MAX };
+
+    // Predictions are kept until their display time has passed; anything older than
+    // this many frames is dropped unresolved.
+    static const int MAX_PENDING = 16;
+
+    struct ovrPredictionError {
+        int64_t FrameIndex = -1;
+        XrTime DisplayTime = 0;
+        bool Valid[TRACKED_MAX] = {};
+        float PositionError[TRACKED_MAX] = {}; // millimeters
+        float AngularError[TRACKED_MAX] = {}; // degrees
+    };
+
+    // Locates count spaces relative to baseSpace at time, e.g. XrApp::LocateSpaces.
+    typedef std::function<void(
+        XrSpace baseSpace,
+        XrTime time,
+        uint32_t count,
+        const XrSpace* spaces,
+        XrSpaceLocation* locations)>
+        ovrLocateSpacesFn;
+
+    ovrPosePredictionAnalyzer();
+
+    void Clear();
+
+    // Records the poses the app was given for displayTime. valid[i] false skips that space.
+    void AddPrediction(
+        const int64_t frameIndex,
+        const XrTime displayTime,
+        const XrPosef poses[TRACKED_MAX],
+        const bool valid[TRACKED_MAX]);
+
+    // Re-locates every pending prediction whose display time is at least settleTime before
+    // now, and accumulates the difference into the histograms. Returns the number resolved.
+    int Resolve(
+        XrSpace baseSpace,
+        const XrSpace spaces[TRACKED_MAX],
+        const XrTime now,
+        const XrDuration settleTime,
+        const ovrLocateSpacesFn& locateSpaces);
+
+    // Most recently resolved frame, FrameIndex is -1 until the first one resolves.
+    const ovrPredictionError& GetLastError() const {
+        return LastError;
+    }
+    const ovrErrorHistogram& GetPositionHistogram(const ovrTrackedSpace space) const {
+        return PositionHistogram[space];
+    }
+    const ovrErrorHistogram& GetAngularHistogram(const ovrTrackedSpace space) const {
+        return AngularHistogram[space];
+    }
+    int GetDroppedCount() const {
+        return DroppedCount;
+    }
+
+   private:
+    struct ovrPendingPrediction {
+        int64_t FrameIndex;
+        XrTime DisplayTime;
+        XrPosef Pose[TRACKED_MAX];
+        bool Valid[TRACKED_MAX];
+    };
+
+    ovrPendingPrediction Pending[MAX_PENDING];
+    int PendingHead; // oldest entry
+    int PendingCount;
+    int DroppedCount;
+
+    ovrPredictionError LastError;
+    ovrErrorHistogram PositionHistogram[TRACKED_MAX];
+    ovrErrorHistogram AngularHistogram[TRACKED_MAX];
+};
+
+} // namespace OVRFW
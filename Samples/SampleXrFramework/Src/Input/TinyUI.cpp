@@ -223,15 +223,28 @@ void TinyUI::Update(const OVRFW::ovrApplFrameIn& in) {
         }
     }
 
-    /// hit test
+    /// hit test all the devices in one go
+    RayStarts.resize(Devices.size());
+    RayDirs.resize(Devices.size());
+    RayHits.resize(Devices.size());
+    for (size_t i = 0; i < Devices.size(); ++i) {
+        RayStarts[i] = Devices[i].pointerStart;
+        RayDirs[i] = (Devices[i].pointerEnd - Devices[i].pointerStart).Normalized();
+    }
+    if (!Devices.empty()) {
+        GuiSys->TestRayIntersections(
+            RayStarts.data(), RayDirs.data(), static_cast<int>(Devices.size()), RayHits.data());
+    }
+
     bool hitHandled = false;
-    for (auto& device : Devices) {
-        Vector3f pointerStart = device.pointerStart;
+    for (size_t i = 0; i < Devices.size(); ++i) {
+        auto& device = Devices[i];
+        Vector3f pointerStart = RayStarts[i];
+        Vector3f pointerDir = RayDirs[i];
         Vector3f pointerEnd = device.pointerEnd;
-        Vector3f pointerDir = (pointerEnd - pointerStart).Normalized();
         Vector3f targetEnd = pointerStart + pointerDir * 10.0f;
 
-        HitTestResult hit = GuiSys->TestRayIntersection(pointerStart, pointerDir);
+        const HitTestResult& hit = RayHits[i];
         if (hit.HitHandle.IsValid()) {
             device.pointerEnd = pointerStart + hit.RayDir * hit.t - pointerDir * 0.025f;
             device.hitObject = GuiSys->GetVRMenuMgr().ToObject(hit.HitHandle);
@@ -137,6 +137,9 @@ class TinyUI {
     std::unordered_map<VRMenuObject*, std::function<void(void)>> ButtonHandlers;
     std::vector<OVRFW::TinyUI::HitTestDevice> Devices;
     std::vector<OVRFW::TinyUI::HitTestDevice> PreviousFrameDevices;
+    std::vector<OVR::Vector3f> RayStarts;
+    std::vector<OVR::Vector3f> RayDirs;
+    std::vector<OVRFW::HitTestResult> RayHits;
     bool UpdateColors;
     std::function<void(void)> UnhandledClickHandler;
 };
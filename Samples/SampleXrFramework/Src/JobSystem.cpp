@@ -0,0 +1,222 @@
+/************************************************************************************
+
+Filename    :   JobSystem.cpp
+Content     :   Small work-stealing thread pool for splitting per-frame loops across
+                the big cores.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "Misc/Log.h"
+
+#if defined(ANDROID)
+#include <sched.h>
+#include <sys/prctl.h> // for prctl( PR_SET_NAME )
+#endif // defined(ANDROID)
+
+namespace OVRFW {
+
+static ovrJobSystem* JobSystem = nullptr;
+
+ovrJobSystem* GetJobSystem() {
+    return JobSystem;
+}
+
+void SetJobSystem(ovrJobSystem* jobSystem) {
+    JobSystem = jobSystem;
+}
+
+// Queue of the pool worker running on this thread, -1 outside the pool.
+static thread_local int ThreadQueueIndex = -1;
+
+ovrJobSystem::ovrJobSystem() : NumWorkers(0), PendingJobs(0), Exit(false) {}
+
+ovrJobSystem::~ovrJobSystem() {
+    Shutdown();
+}
+
+std::vector<int> ovrJobSystem::GetBigCores() {
+    const int numCores = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<int> cores;
+    std::vector<long> maxFreq;
+    for (int i = 0; i < numCores; i++) {
+        long freq = 0;
+        char path[128];
+        snprintf(
+            path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", i);
+        FILE* f = fopen(path, "r");
+        if (f != nullptr) {
+            if (fscanf(f, "%ld", &freq) != 1) {
+                freq = 0;
+            }
+            fclose(f);
+        }
+        cores.push_back(i);
+        maxFreq.push_back(freq);
+    }
+    if (cores.empty()) {
+        return cores;
+    }
+
+    const long slowest = *std::min_element(maxFreq.begin(), maxFreq.end());
+    std::vector<int> bigCores;
+    for (int i = 0; i < static_cast<int>(cores.size()); i++) {
+        if (maxFreq[i] > slowest) {
+            bigCores.push_back(cores[i]);
+        }
+    }
+    return bigCores.empty() ? cores : bigCores;
+}
+
+void ovrJobSystem::Init(const int numWorkers) {
+    Shutdown();
+
+    BigCores = GetBigCores();
+    // the thread calling ParallelFor takes one of the big cores
+    const int defaultWorkers = static_cast<int>(BigCores.size()) - 1;
+    NumWorkers = std::max(0, std::min(MAX_WORKERS, numWorkers < 0 ? defaultWorkers : numWorkers));
+
+    Queues.reset(new ovrJobQueue[NumWorkers + 1]);
+    PendingJobs = 0;
+    Exit = false;
+    for (int i = 0; i < NumWorkers; i++) {
+        Workers.push_back(std::thread(&ovrJobSystem::WorkerThreadFunction, this, i));
+    }
+
+    ALOG("ovrJobSystem: %d workers, %d big cores", NumWorkers, static_cast<int>(BigCores.size()));
+}
+
+void ovrJobSystem::Shutdown() {
+    if (Workers.empty()) {
+        NumWorkers = 0;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(WakeMutex);
+        Exit = true;
+    }
+    WakeCondition.notify_all();
+    for (std::thread& worker : Workers) {
+        worker.join();
+    }
+    Workers.clear();
+    NumWorkers = 0;
+    if (JobSystem == this) {
+        JobSystem = nullptr;
+    }
+}
+
+void ovrJobSystem::ParallelFor(const int count, const int batchSize, const ovrBatchFunction& fn) {
+    if (count <= 0) {
+        return;
+    }
+    const int size = std::max(1, batchSize);
+    const int numBatches = GetNumBatches(count, size);
+    if (NumWorkers == 0 || numBatches == 1) {
+        for (int b = 0; b < numBatches; b++) {
+            fn(b, b * size, std::min(count, (b + 1) * size));
+        }
+        return;
+    }
+
+    std::atomic<int> remaining(numBatches);
+
+    // deal the batches out round robin, the stealing evens out the rest
+    const int numQueues = NumWorkers + 1;
+    for (int b = 0; b < numBatches; b++) {
+        ovrJob job;
+        job.Function = &fn;
+        job.Remaining = &remaining;
+        job.Batch = b;
+        job.Begin = b * size;
+        job.End = std::min(count, (b + 1) * size);
+        ovrJobQueue& queue = Queues[b % numQueues];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Jobs.push_back(job);
+    }
+    {
+        std::lock_guard<std::mutex> lock(WakeMutex);
+        PendingJobs += numBatches;
+    }
+    WakeCondition.notify_all();
+
+    // Help out until every batch is done. This may also run batches of a ParallelFor
+    // issued by another thread, which is fine since batches don't depend on each other.
+    const int queueIndex = ThreadQueueIndex >= 0 ? ThreadQueueIndex : NumWorkers;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        ovrJob job;
+        if (PopJob(queueIndex, job)) {
+            RunJob(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ovrJobSystem::PopJob(const int queueIndex, ovrJob& job) {
+    const int numQueues = NumWorkers + 1;
+    for (int i = 0; i < numQueues; i++) {
+        const int q = (queueIndex + i) % numQueues;
+        ovrJobQueue& queue = Queues[q];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (queue.Jobs.empty()) {
+            continue;
+        }
+        // own queue from the front, in item order; steal from the back
+        if (i == 0) {
+            job = queue.Jobs.front();
+            queue.Jobs.pop_front();
+        } else {
+            job = queue.Jobs.back();
+            queue.Jobs.pop_back();
+        }
+        PendingJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ovrJobSystem::RunJob(const ovrJob& job) {
+    (*job.Function)(job.Batch, job.Begin, job.End);
+    job.Remaining->fetch_sub(1, std::memory_order_release);
+}
+
+void ovrJobSystem::WorkerThreadFunction(const int workerIndex) {
+#if defined(ANDROID)
+    char threadName[16];
+    snprintf(threadName, sizeof(threadName), "OVR::Job%d", workerIndex);
+    prctl(PR_SET_NAME, (long)threadName, 0, 0, 0);
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (const int core : BigCores) {
+        CPU_SET(core, &cpuSet);
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        ALOGW("ovrJobSystem: failed to pin worker %d to the big cores", workerIndex);
+    }
+#endif // defined(ANDROID)
+
+    ThreadQueueIndex = workerIndex;
+
+    for (;;) {
+        ovrJob job;
+        if (PopJob(workerIndex, job)) {
+            RunJob(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(WakeMutex);
+        WakeCondition.wait(lock, [this] { return PendingJobs.load() > 0 || Exit; });
+        if (Exit) {
+            break;
+        }
+    }
+}
+
+} // namespace OVRFW
@@ -0,0 +1,94 @@
+/************************************************************************************
+
+Filename    :   JobSystem.h
+Content     :   Small work-stealing thread pool for splitting per-frame loops across
+                the big cores.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OVRFW {
+
+// Each worker owns a job queue and pops from its front, stealing from the back of the
+// other queues once its own is empty. The thread calling ParallelFor runs jobs too
+// instead of blocking, so a pool with no workers simply runs everything inline.
+//
+// Jobs must not touch GL; only the thread that owns the context may.
+class ovrJobSystem {
+   public:
+    static const int MAX_WORKERS = 8;
+
+    // batch index, first item, one past the last item
+    typedef std::function<void(const int, const int, const int)> ovrBatchFunction;
+
+    ovrJobSystem();
+    ~ovrJobSystem();
+
+    // numWorkers < 0 starts one worker per big core, less one for the calling thread.
+    // Workers are pinned to the big cores on Android.
+    void Init(const int numWorkers = -1);
+    void Shutdown();
+
+    int GetNumWorkers() const {
+        return NumWorkers;
+    }
+
+    // Splits [0, count) into batches of batchSize items and runs fn on every batch, returning
+    // once all of them are done. Batches are numbered in item order, so results written per
+    // batch can be merged in the same order every frame regardless of which thread ran them.
+    void ParallelFor(const int count, const int batchSize, const ovrBatchFunction& fn);
+
+    static int GetNumBatches(const int count, const int batchSize) {
+        return (count + batchSize - 1) / batchSize;
+    }
+
+    // The cores clocked above the slowest ones, or all of them when they are all the same.
+    static std::vector<int> GetBigCores();
+
+   private:
+    struct ovrJob {
+        const ovrBatchFunction* Function;
+        std::atomic<int>* Remaining;
+        int Batch;
+        int Begin;
+        int End;
+    };
+
+    struct ovrJobQueue {
+        std::mutex Mutex;
+        std::deque<ovrJob> Jobs;
+    };
+
+    bool PopJob(const int queueIndex, ovrJob& job);
+    void RunJob(const ovrJob& job);
+    void WorkerThreadFunction(const int workerIndex);
+
+    int NumWorkers;
+    std::vector<int> BigCores;
+    std::vector<std::thread> Workers;
+    // one per worker, and a last one shared by the threads outside the pool
+    std::unique_ptr<ovrJobQueue[]> Queues;
+    std::atomic<int> PendingJobs;
+    std::mutex WakeMutex;
+    std::condition_variable WakeCondition;
+    bool Exit;
+};
+
+// The job system that per-frame work may be split across, or NULL to run it serially.
+// Set by XrApp.
+ovrJobSystem* GetJobSystem();
+void SetJobSystem(ovrJobSystem* jobSystem);
+
+} // namespace OVRFW
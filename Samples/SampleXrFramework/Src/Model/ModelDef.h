@@ -49,16 +49,52 @@ struct MaterialParms {
           EnableDiffuseAniso(false),
           EnableEmissiveLodClamp(true),
           Transparent(false),
-          PolygonOffset(false) {}
+          PolygonOffset(false),
+          LodLevels(0),
+          LodMaxScreenError(0.001f),
+          OptimizeGeometry(false),
+          QuantizeVertexAttributes(false) {}
 
     bool UseSrgbTextureFormats; // use sRGB textures
     bool EnableDiffuseAniso; // enable anisotropic filtering on the diffuse texture
     bool EnableEmissiveLodClamp; // enable LOD clamp on the emissive texture to avoid light bleeding
     bool Transparent; // surfaces with this material flag need to render in a transparent pass
     bool PolygonOffset; // render with polygon offset enabled
+    int LodLevels; // simplified levels to generate per surface, 0 to load only the full detail
+    float LodMaxScreenError; // simplification error allowed on screen, in screen heights
+    bool OptimizeGeometry; // reorder triangles and vertices for the vertex cache and overdraw
+    bool QuantizeVertexAttributes; // see GlGeometry::VERTEX_FORMAT_QUANTIZED
     std::function<bool(ModelFile&, const std::string&)> ImageUriHandler; // custom image URI handler
 };
 
+// Totals over the surfaces of a loaded model, as loaded and as uploaded.
+struct ModelGeometryStats {
+    ModelGeometryStats()
+        : numTriangles(0),
+          cacheMissesLoaded(0),
+          cacheMissesUploaded(0),
+          vertexBytesLoaded(0),
+          vertexBytesUploaded(0),
+          indexBytesLoaded(0),
+          indexBytesUploaded(0) {}
+
+    // average vertices transformed per triangle, see ComputeAcmr()
+    float GetAcmrLoaded() const {
+        return numTriangles > 0 ? static_cast<float>(cacheMissesLoaded) / numTriangles : 0.0f;
+    }
+    float GetAcmrUploaded() const {
+        return numTriangles > 0 ? static_cast<float>(cacheMissesUploaded) / numTriangles : 0.0f;
+    }
+
+    size_t numTriangles;
+    double cacheMissesLoaded;
+    double cacheMissesUploaded;
+    size_t vertexBytesLoaded; // as floats
+    size_t vertexBytesUploaded;
+    size_t indexBytesLoaded; // as in the file
+    size_t indexBytesUploaded;
+};
+
 enum ModelJointAnimation {
     MODEL_JOINT_ANIMATION_NONE,
     MODEL_JOINT_ANIMATION_ROTATE,
@@ -244,6 +280,18 @@ struct ModelMaterial {
     bool doubleSided;
 };
 
+// A simplified stand-in for a surface. The surfaceDef is a copy of the full detail one with
+// other geometry, so changes made to the full detail graphics command after loading have to
+// be made to the levels as well.
+struct ModelSurfaceLod {
+    ModelSurfaceLod() : screenCoverage(0.0f) {}
+
+    ovrSurfaceDef surfaceDef;
+    // Used once the bounding sphere of the surface covers at most this fraction of the
+    // screen height.
+    float screenCoverage;
+};
+
 struct ModelSurface {
     ModelSurface() : material(nullptr) {}
 
@@ -251,6 +299,7 @@ struct ModelSurface {
     ovrSurfaceDef surfaceDef;
     VertexAttribs attribs; // Only populated if morph targets are used
     std::vector<VertexAttribs> targets;
+    std::vector<ModelSurfaceLod> lods; // coarser with each level, see MaterialParms::LodLevels
 };
 
 struct Model {
@@ -298,6 +347,7 @@ class ModelNode {
           scale(1.0f, 1.0f, 1.0f),
           parentIndex(-1),
           skinIndex(-1),
+          lodOwnerIndex(-1),
           camera(nullptr),
           model(nullptr),
           localTransform(OVR::Matrix4f::Identity()),
@@ -322,6 +372,12 @@ class ModelNode {
     std::vector<int> children;
     int parentIndex;
     int skinIndex;
+    // MSFT_lod: nodes whose models are drawn instead of this one's, coarsest last, with this
+    // node's transform. lodScreenCoverage[i] is where lodNodes[i] takes over, and an extra
+    // value past the last level is where the node is no longer drawn at all.
+    std::vector<int> lodNodes;
+    std::vector<float> lodScreenCoverage;
+    int lodOwnerIndex; // the node this one is a level of, which is drawn instead
     const ModelCamera* camera;
     Model* model;
 
@@ -428,6 +484,8 @@ class ModelNodeState {
           rotation(0.0f, 0.0f, 0.0f, 1.0f),
           translation(0.0f, 0.0f, 0.0f),
           scale(1.0f, 1.0f, 1.0f),
+          transformVersion(0),
+          lodLevel(0),
           localTransform(OVR::Matrix4f::Identity()),
           globalTransform(OVR::Matrix4f::Identity()) {}
 
@@ -453,6 +511,12 @@ class ModelNodeState {
     OVR::Vector3f translation;
     OVR::Vector3f scale;
     std::vector<float> weights;
+    // Incremented whenever globalTransform is recalculated.
+    uint32_t transformVersion;
+    // Levels of detail picked when last drawn, kept to switch with hysteresis. lodLevel is
+    // 0 for the node's own model and i + 1 for node->lodNodes[i].
+    int lodLevel;
+    std::vector<uint8_t> surfaceLodLevels;
 
    private:
     OVR::Matrix4f localTransform;
@@ -490,7 +554,7 @@ class ModelSubSceneState {
 
 class ModelState {
    public:
-    ModelState() : DontRenderForClientUid(0), mf(nullptr) {
+    ModelState() : DontRenderForClientUid(0), transformVersion(0), mf(nullptr) {
         modelMatrix.Identity();
     }
 
@@ -504,6 +568,8 @@ class ModelState {
 
     long long DontRenderForClientUid; // skip rendering the model if the current scene's client uid
                                       // matches this
+    // Incremented whenever the global transform of any node is recalculated.
+    uint32_t transformVersion;
     std::vector<ModelNodeState> nodeStates;
     std::vector<ModelAnimationTimeLineState> animationTimelineStates;
     std::vector<ModelSubSceneState> subSceneStates;
@@ -61,6 +61,9 @@ ModelFile::~ModelFile() {
     for (int i = 0; i < static_cast<int>(Models.size()); i++) {
         for (int j = 0; j < static_cast<int>(Models[i].surfaces.size()); j++) {
             const_cast<GlGeometry*>(&(Models[i].surfaces[j].surfaceDef.geo))->Free();
+            for (ModelSurfaceLod& lod : Models[i].surfaces[j].lods) {
+                lod.surfaceDef.geo.Free();
+            }
         }
     }
 
@@ -621,6 +624,7 @@ void ModelNodeState::GenerateStateFromNode(const ModelNode* _node, ModelState* _
     // These values should be calculated already.
     localTransform = node->GetLocalTransform();
     globalTransform = node->GetGlobalTransform();
+    transformVersion++;
 }
 
 void ModelNodeState::CalculateLocalTransform() {
@@ -637,6 +641,8 @@ void ModelNodeState::RecalculateMatrix() {
     } else {
         globalTransform = state->nodeStates[node->parentIndex].globalTransform * localTransform;
     }
+    transformVersion++;
+    state->transformVersion++;
 
     for (int i = 0; i < static_cast<int>(node->children.size()); i++) {
         state->nodeStates[node->children[i]].RecalculateMatrix();
@@ -80,6 +80,9 @@ class ModelFile {
     std::vector<ModelAnimationTimeLine> AnimationTimeLines;
     std::vector<ModelSkin> Skins;
     std::vector<ModelSubScene> SubScenes;
+
+    // Surfaces of Models as the glTF loader read and uploaded them, without levels of detail.
+    ModelGeometryStats GeometryStats;
 };
 
 // Pass in the programs that will be used for the model materials.
@@ -27,6 +27,8 @@ Authors     :   John Carmack, J.M.P. van Waveren
 
 #include "Model/ModelDef.h"
 #include "ModelFileLoading.h"
+#include "ModelLod.h"
+#include "Render/MeshOptimizer.h"
 
 #include "OVR_Std.h"
 #include "OVR_JSON.h"
@@ -598,6 +600,61 @@ bool ReadVertexAttributes(
     return loaded;
 }
 
+// Narrows the indices read from the file to TriangleIndex. With materialParms.OptimizeGeometry,
+// the triangles are reordered for the vertex cache and overdraw first, unless keepTriangleOrder,
+// and the vertices for fetching. Vertices no triangle uses are left out when there are too many
+// for TriangleIndex otherwise. The morph targets get the same vertex order.
+static bool PrepareSurfaceIndices(
+    const MaterialParms& materialParms,
+    const bool keepTriangleOrder,
+    const size_t fileIndexSize,
+    std::vector<uint32_t>& fileIndices,
+    VertexAttribs& attribs,
+    std::vector<VertexAttribs>& targets,
+    std::vector<TriangleIndex>& indices,
+    ModelGeometryStats& stats) {
+    const size_t vertexCount = attribs.position.size();
+    for (const uint32_t index : fileIndices) {
+        if (index >= vertexCount) {
+            ALOGW("Error: Invalid index %u of %zu vertices on gltfPrimitive", index, vertexCount);
+            return false;
+        }
+    }
+
+    stats.numTriangles += fileIndices.size() / 3;
+    stats.cacheMissesLoaded += ComputeAcmr(fileIndices, vertexCount) * (fileIndices.size() / 3);
+    stats.vertexBytesLoaded +=
+        GlGeometry::GetVertexSize(attribs, GlGeometry::VERTEX_FORMAT_FLOAT) * vertexCount;
+    stats.indexBytesLoaded += fileIndices.size() * fileIndexSize;
+
+    if (materialParms.OptimizeGeometry && !keepTriangleOrder) {
+        std::vector<uint32_t> clusters;
+        OptimizeVertexCache(fileIndices, vertexCount, &clusters);
+        OptimizeOverdraw(fileIndices, attribs.position, clusters);
+    }
+    if (materialParms.OptimizeGeometry ||
+        vertexCount > static_cast<size_t>(GlGeometry::GetMaxGeometryVertices())) {
+        std::vector<uint32_t> order;
+        OptimizeVertexFetch(fileIndices, vertexCount, order);
+        RemapVertexAttribs(attribs, order);
+        for (VertexAttribs& target : targets) {
+            RemapVertexAttribs(target, order);
+        }
+    }
+    if (attribs.position.size() > static_cast<size_t>(GlGeometry::GetMaxGeometryVertices())) {
+        ALOGW(
+            "Error: %zu vertices on gltfPrimitive, only %d supported",
+            attribs.position.size(),
+            GlGeometry::GetMaxGeometryVertices());
+        return false;
+    }
+
+    indices.assign(fileIndices.begin(), fileIndices.end());
+    stats.cacheMissesUploaded +=
+        ComputeAcmr(indices, attribs.position.size()) * (indices.size() / 3);
+    return true;
+}
+
 // Requires the buffers and images to already be loaded in the model
 bool LoadModelFile_glTF_Json(
     ModelFile& modelFile,
@@ -1137,28 +1194,64 @@ bool LoadModelFile_glTF_Json(
                                         loaded = false;
                                     }
 
-                                    // Reduced severity to warning: this doesn't break most data
-                                    // types, but can cause unexpected results.
-                                    if (modelFile.Accessors[indicesIndex].componentType !=
-                                        GL_UNSIGNED_SHORT) {
-                                        ALOGW(
-                                            "Warning: Currently, only componentType of %d supported for indices, %d requested",
-                                            GL_UNSIGNED_SHORT,
-                                            modelFile.Accessors[indicesIndex].componentType);
+                                    // Indices of any size are read as 32 bit and narrowed to
+                                    // TriangleIndex once the vertices are compacted.
+                                    if (loaded) {
+                                        const int indexType =
+                                            modelFile.Accessors[indicesIndex].componentType;
+                                        if (indexType != GL_UNSIGNED_BYTE &&
+                                            indexType != GL_UNSIGNED_SHORT &&
+                                            indexType != GL_UNSIGNED_INT) {
+                                            ALOGW(
+                                                "Error: Invalid componentType %d for indices",
+                                                indexType);
+                                            loaded = false;
+                                        }
                                     }
 
                                     if (loaded) {
-                                        ReadSurfaceDataFromAccessor(
-                                            indices,
+                                        std::vector<uint32_t> fileIndices;
+                                        loaded = ReadSurfaceDataFromAccessor(
+                                            fileIndices,
                                             modelFile,
-                                            primitive.GetChildInt32ByName("indices", -1),
+                                            indicesIndex,
                                             ACCESSOR_SCALAR,
-                                            GL_UNSIGNED_SHORT,
+                                            GL_UNSIGNED_INT,
                                             -1,
                                             false);
+                                        // Blended triangles are drawn in the order the file has.
+                                        const bool keepTriangleOrder =
+                                            newGltfSurface.material->alphaMode !=
+                                                ALPHA_MODE_OPAQUE ||
+                                            materialParms.Transparent;
+                                        const size_t fileIndexSize = getComponentSize(
+                                            modelFile.Accessors[indicesIndex].componentType);
+                                        if (loaded) {
+                                            loaded = PrepareSurfaceIndices(
+                                                materialParms,
+                                                keepTriangleOrder,
+                                                fileIndexSize,
+                                                fileIndices,
+                                                attribs,
+                                                newGltfSurface.targets,
+                                                indices,
+                                                modelFile.GeometryStats);
+                                        }
                                     }
 
-                                    newGltfSurface.surfaceDef.geo.Create(attribs, indices);
+                                    // Morph targets rewrite the vertices as floats.
+                                    const GlGeometry::VertexFormat vertexFormat =
+                                        materialParms.QuantizeVertexAttributes &&
+                                            newGltfSurface.targets.empty()
+                                        ? GlGeometry::VERTEX_FORMAT_QUANTIZED
+                                        : GlGeometry::VERTEX_FORMAT_FLOAT;
+                                    newGltfSurface.surfaceDef.geo.Create(
+                                        attribs, indices, vertexFormat);
+                                    modelFile.GeometryStats.vertexBytesUploaded +=
+                                        GlGeometry::GetVertexSize(attribs, vertexFormat) *
+                                        attribs.position.size();
+                                    modelFile.GeometryStats.indexBytesUploaded +=
+                                        indices.size() * sizeof(TriangleIndex);
                                     bool skinned =
                                         (attribs.jointIndices.size() == attribs.position.size() &&
                                          attribs.jointWeights.size() == attribs.position.size());
@@ -1308,6 +1401,10 @@ bool LoadModelFile_glTF_Json(
                                             .cullEnable = false;
                                     }
 
+                                    // Simplified levels copy the finished surface.
+                                    GenerateModelSurfaceLods(
+                                        newGltfSurface, attribs, indices, materialParms);
+
                                     // Retain original vertex data if we use morph targets
                                     if (!newGltfSurface.targets.empty()) {
                                         newGltfSurface.attribs = std::move(attribs);
@@ -1630,9 +1727,59 @@ bool LoadModelFile_glTF_Json(
                                 }
                             }
 
+                            // MSFT_lod, with the switch points in the node extras
+                            const OVR::JsonReader nodeExtensions =
+                                node.GetChildByName("extensions");
+                            if (nodeExtensions.IsObject()) {
+                                const OVR::JsonReader lodExtension =
+                                    nodeExtensions.GetChildByName("MSFT_lod");
+                                if (lodExtension.IsObject()) {
+                                    const OVR::JsonReader ids = lodExtension.GetChildByName("ids");
+                                    if (ids.IsArray()) {
+                                        while (!ids.IsEndOfArray()) {
+                                            pGltfNode->lodNodes.push_back(
+                                                ids.GetNextArrayInt32(-1));
+                                        }
+                                    }
+                                    const OVR::JsonReader extras = node.GetChildByName("extras");
+                                    if (extras.IsObject()) {
+                                        const OVR::JsonReader coverages =
+                                            extras.GetChildByName("MSFT_screencoverage");
+                                        if (coverages.IsArray()) {
+                                            while (!coverages.IsEndOfArray()) {
+                                                pGltfNode->lodScreenCoverage.push_back(
+                                                    coverages.GetNextArrayFloat(0.0f));
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+
                             nodeIndex++;
                         }
                     }
+
+                    for (int i = 0; i < static_cast<int>(modelFile.Nodes.size()); i++) {
+                        ModelNode& lodOwner = modelFile.Nodes[i];
+                        for (const int lodNode : lodOwner.lodNodes) {
+                            if (lodNode < 0 ||
+                                lodNode >= static_cast<int>(modelFile.Nodes.size()) ||
+                                lodNode == i) {
+                                ALOGW("Error: Invalid MSFT_lod node index %d on gltfNode", lodNode);
+                                loaded = false;
+                                break;
+                            }
+                            modelFile.Nodes[lodNode].lodOwnerIndex = i;
+                        }
+                        // MSFT_screencoverage has a value per level, where the next one takes
+                        // over, and the one of the last level is where the node stops being
+                        // drawn. Levels without a value are never switched to.
+                        std::vector<float>& coverage = lodOwner.lodScreenCoverage;
+                        if (coverage.size() < lodOwner.lodNodes.size()) {
+                            coverage.resize(lodOwner.lodNodes.size(), 0.0f);
+                        }
+                        coverage.resize(std::min(coverage.size(), lodOwner.lodNodes.size() + 1));
+                    }
                 }
             } // END NODES
 
@@ -2113,6 +2260,18 @@ bool LoadModelFile_glTF_Json(
                     static_cast<int>(modelFile.AnimationTimeLines.size()));
                 LOGV("\tSkins          : %d", static_cast<int>(modelFile.Skins.size()));
                 LOGV("\tSubScenes      : %d", static_cast<int>(modelFile.SubScenes.size()));
+                if (materialParms.OptimizeGeometry || materialParms.QuantizeVertexAttributes) {
+                    const ModelGeometryStats& stats = modelFile.GeometryStats;
+                    ALOG(
+                        "Geometry of '%s': ACMR %.3f -> %.3f, vertices %zu -> %zu bytes, indices %zu -> %zu bytes",
+                        modelFile.FileName.c_str(),
+                        stats.GetAcmrLoaded(),
+                        stats.GetAcmrUploaded(),
+                        stats.vertexBytesLoaded,
+                        stats.vertexBytesUploaded,
+                        stats.indexBytesLoaded,
+                        stats.indexBytesUploaded);
+                }
             } else {
                 ALOGW("Could not load model '%s'", modelFile.FileName.c_str());
             }
@@ -0,0 +1,482 @@
+/************************************************************************************
+
+Filename    :   ModelLod.cpp
+Content     :   Quadric error mesh simplification for model levels of detail.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "ModelLod.h"
+#include "Render/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+using OVR::Bounds3f;
+using OVR::Vector3d;
+using OVR::Vector3f;
+
+namespace OVRFW {
+
+// Surfaces with fewer triangles don't get levels.
+static const int MIN_LOD_TRIANGLES = 256;
+// A level has to get rid of at least this fraction of the triangles of the level before it.
+static const float MIN_LOD_REDUCTION = 0.2f;
+// Simplification stops at errors past this fraction of the surface's bounds diagonal.
+static const float MAX_LOD_RELATIVE_ERROR = 0.05f;
+// Open borders are held in place this many times harder than the surface.
+static const double BORDER_WEIGHT = 10.0;
+// A collapse may not turn a triangle further than about 85 degrees.
+static const float MIN_FLIP_COS = 0.1f;
+
+static const uint32_t NO_POSITION = UINT32_MAX;
+
+static Vector3d ToDouble(const Vector3f& v) {
+    return Vector3d(v.x, v.y, v.z);
+}
+
+static uint64_t EdgeKey(const uint32_t a, const uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+//==============================================================
+// ovrMeshSimplifier::ovrQuadric
+
+ovrMeshSimplifier::ovrQuadric::ovrQuadric()
+    : a2(0.0),
+      b2(0.0),
+      c2(0.0),
+      ab(0.0),
+      ac(0.0),
+      bc(0.0),
+      ad(0.0),
+      bd(0.0),
+      cd(0.0),
+      d2(0.0),
+      weight(0.0) {}
+
+void ovrMeshSimplifier::ovrQuadric::AddPlane(
+    const Vector3d& normal,
+    const double distance,
+    const double w) {
+    a2 += w * normal.x * normal.x;
+    b2 += w * normal.y * normal.y;
+    c2 += w * normal.z * normal.z;
+    ab += w * normal.x * normal.y;
+    ac += w * normal.x * normal.z;
+    bc += w * normal.y * normal.z;
+    ad += w * normal.x * distance;
+    bd += w * normal.y * distance;
+    cd += w * normal.z * distance;
+    d2 += w * distance * distance;
+    weight += w;
+}
+
+void ovrMeshSimplifier::ovrQuadric::Add(const ovrQuadric& other) {
+    a2 += other.a2;
+    b2 += other.b2;
+    c2 += other.c2;
+    ab += other.ab;
+    ac += other.ac;
+    bc += other.bc;
+    ad += other.ad;
+    bd += other.bd;
+    cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+}
+
+float ovrMeshSimplifier::ovrQuadric::Error(const Vector3f& p) const {
+    if (weight <= 0.0) {
+        return 0.0f;
+    }
+    const double x = p.x;
+    const double y = p.y;
+    const double z = p.z;
+    const double q = a2 * x * x + b2 * y * y + c2 * z * z +
+        2.0 * (ab * x * y + ac * x * z + bc * y * z) + 2.0 * (ad * x + bd * y + cd * z) + d2;
+    return static_cast<float>(sqrt(std::max(q, 0.0) / weight));
+}
+
+//==============================================================
+// ovrMeshSimplifier
+
+void ovrMeshSimplifier::Init(
+    const std::vector<Vector3f>& positions,
+    const std::vector<TriangleIndex>& indices) {
+    Positions = positions;
+    Indices = indices;
+    Indices.resize(Indices.size() / 3 * 3);
+    Error = 0.0f;
+
+    // Vertices that only differ in their other attributes get the same position id.
+    const uint32_t vertexCount = static_cast<uint32_t>(Positions.size());
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+        const Vector3f& pa = Positions[a];
+        const Vector3f& pb = Positions[b];
+        if (pa.x != pb.x) {
+            return pa.x < pb.x;
+        }
+        if (pa.y != pb.y) {
+            return pa.y < pb.y;
+        }
+        return pa.z < pb.z;
+    });
+    PositionIds.assign(vertexCount, 0);
+    uint32_t numPositions = 0;
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        if (i == 0 || !(Positions[order[i]] == Positions[order[i - 1]])) {
+            numPositions++;
+        }
+        PositionIds[order[i]] = numPositions - 1;
+    }
+
+    // A position with more than one vertex in use sits on a seam.
+    Kinds.assign(numPositions, KIND_MANIFOLD);
+    std::vector<uint8_t> used(vertexCount, 0);
+    std::vector<uint8_t> wedges(numPositions, 0);
+    for (const TriangleIndex index : Indices) {
+        if (used[index] == 0) {
+            used[index] = 1;
+            if (++wedges[PositionIds[index]] > 1) {
+                Kinds[PositionIds[index]] = KIND_LOCKED;
+            }
+        }
+    }
+
+    // An edge used twice in the same direction is non-manifold, and an edge without its
+    // opposite is on an open border.
+    std::vector<uint64_t> edges;
+    edges.reserve(Indices.size());
+    for (size_t t = 0; t < Indices.size(); t += 3) {
+        for (int e = 0; e < 3; ++e) {
+            const uint32_t a = PositionIds[Indices[t + e]];
+            const uint32_t b = PositionIds[Indices[t + (e + 1) % 3]];
+            if (a != b) {
+                edges.push_back(EdgeKey(a, b));
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    const auto isBorderEdge = [&edges](const uint32_t a, const uint32_t b) {
+        return !std::binary_search(edges.begin(), edges.end(), EdgeKey(b, a));
+    };
+    BorderNext.assign(numPositions, NO_POSITION);
+    BorderPrev.assign(numPositions, NO_POSITION);
+    std::vector<uint8_t> borderOut(numPositions, 0);
+    std::vector<uint8_t> borderIn(numPositions, 0);
+    for (size_t i = 0; i < edges.size();) {
+        size_t end = i + 1;
+        while (end < edges.size() && edges[end] == edges[i]) {
+            end++;
+        }
+        const uint32_t a = static_cast<uint32_t>(edges[i] >> 32);
+        const uint32_t b = static_cast<uint32_t>(edges[i]);
+        if (end - i > 1) {
+            Kinds[a] = KIND_LOCKED;
+            Kinds[b] = KIND_LOCKED;
+        } else if (isBorderEdge(a, b)) {
+            borderOut[a] = std::min(borderOut[a] + 1, 2);
+            borderIn[b] = std::min(borderIn[b] + 1, 2);
+            BorderNext[a] = b;
+            BorderPrev[b] = a;
+        }
+        i = end;
+    }
+    for (uint32_t p = 0; p < numPositions; ++p) {
+        if (Kinds[p] != KIND_LOCKED && (borderOut[p] != 0 || borderIn[p] != 0)) {
+            Kinds[p] = (borderOut[p] == 1 && borderIn[p] == 1) ? KIND_BORDER : KIND_LOCKED;
+        }
+    }
+
+    // Every triangle adds its plane to its corners, weighted by area, and every border edge
+    // adds a plane through it, perpendicular to the triangle, to keep the border in place.
+    Quadrics.assign(numPositions, ovrQuadric());
+    for (size_t t = 0; t < Indices.size(); t += 3) {
+        const Vector3d p[3] = {
+            ToDouble(Positions[Indices[t + 0]]),
+            ToDouble(Positions[Indices[t + 1]]),
+            ToDouble(Positions[Indices[t + 2]])};
+        Vector3d normal = (p[1] - p[0]).Cross(p[2] - p[0]);
+        const double length = normal.Length();
+        if (length <= 0.0) {
+            continue;
+        }
+        normal /= length;
+        for (int c = 0; c < 3; ++c) {
+            Quadrics[PositionIds[Indices[t + c]]].AddPlane(
+                normal, -normal.Dot(p[0]), length * 0.5);
+        }
+        for (int e = 0; e < 3; ++e) {
+            const uint32_t a = PositionIds[Indices[t + e]];
+            const uint32_t b = PositionIds[Indices[t + (e + 1) % 3]];
+            if (a == b || !isBorderEdge(a, b)) {
+                continue;
+            }
+            const Vector3d edge = p[(e + 1) % 3] - p[e];
+            const double edgeLengthSq = edge.LengthSq();
+            if (edgeLengthSq <= 0.0) {
+                continue;
+            }
+            const Vector3d side = edge.Cross(normal).Normalized();
+            const double distance = -side.Dot(p[e]);
+            Quadrics[a].AddPlane(side, distance, edgeLengthSq * BORDER_WEIGHT);
+            Quadrics[b].AddPlane(side, distance, edgeLengthSq * BORDER_WEIGHT);
+        }
+    }
+}
+
+bool ovrMeshSimplifier::CollapseFlips(const uint32_t from, const uint32_t to) const {
+    const Vector3f& fromPosition = Positions[from];
+    const Vector3f& toPosition = Positions[to];
+    for (uint32_t i = TriangleOffsets[from]; i < TriangleOffsets[from + 1]; ++i) {
+        const uint32_t t = VertexTriangles[i];
+        const uint32_t c[3] = {
+            Remap[Indices[t + 0]], Remap[Indices[t + 1]], Remap[Indices[t + 2]]};
+        // the triangles on the collapsed edge go away
+        const uint32_t toPositionId = PositionIds[to];
+        if (PositionIds[c[0]] == toPositionId || PositionIds[c[1]] == toPositionId ||
+            PositionIds[c[2]] == toPositionId) {
+            continue;
+        }
+        const int corner = c[0] == from ? 0 : (c[1] == from ? 1 : 2);
+        const Vector3f& a = Positions[c[(corner + 1) % 3]];
+        const Vector3f& b = Positions[c[(corner + 2) % 3]];
+        const Vector3f before = (a - fromPosition).Cross(b - fromPosition);
+        const Vector3f after = (a - toPosition).Cross(b - toPosition);
+        if (before.Dot(after) <= MIN_FLIP_COS * before.Length() * after.Length()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+float ovrMeshSimplifier::Simplify(const size_t targetIndexCount, const float maxError) {
+    const uint32_t vertexCount = static_cast<uint32_t>(Positions.size());
+    // Every pass collapses the cheapest edges that don't share a position with an edge
+    // collapsed earlier in the pass, so the costs it sorted by stay valid.
+    while (Indices.size() > targetIndexCount) {
+        Collapses.clear();
+        for (size_t t = 0; t < Indices.size(); t += 3) {
+            // each corner towards both of the others
+            for (int e = 0; e < 6; ++e) {
+                const uint32_t from = Indices[t + e / 2];
+                const uint32_t to = Indices[t + (e / 2 + 1 + e % 2) % 3];
+                const uint32_t fromPosition = PositionIds[from];
+                const uint32_t toPosition = PositionIds[to];
+                if (fromPosition == toPosition || Kinds[fromPosition] == KIND_LOCKED) {
+                    continue;
+                }
+                if (Kinds[fromPosition] == KIND_BORDER && BorderNext[fromPosition] != toPosition &&
+                    BorderPrev[fromPosition] != toPosition) {
+                    continue;
+                }
+                ovrQuadric quadric = Quadrics[fromPosition];
+                quadric.Add(Quadrics[toPosition]);
+                Collapses.push_back({from, to, quadric.Error(Positions[to])});
+            }
+        }
+        if (Collapses.empty()) {
+            break;
+        }
+        std::sort(
+            Collapses.begin(), Collapses.end(), [](const ovrCollapse& a, const ovrCollapse& b) {
+                if (a.error != b.error) {
+                    return a.error < b.error;
+                }
+                return a.from != b.from ? a.from < b.from : a.to < b.to;
+            });
+
+        TriangleOffsets.assign(vertexCount + 1, 0);
+        for (const TriangleIndex index : Indices) {
+            TriangleOffsets[index + 1]++;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            TriangleOffsets[v + 1] += TriangleOffsets[v];
+        }
+        VertexTriangles.resize(Indices.size());
+        std::vector<uint32_t> cursor(TriangleOffsets.begin(), TriangleOffsets.end() - 1);
+        for (size_t i = 0; i < Indices.size(); ++i) {
+            VertexTriangles[cursor[Indices[i]]++] = static_cast<uint32_t>(i / 3 * 3);
+        }
+
+        Remap.resize(vertexCount);
+        std::iota(Remap.begin(), Remap.end(), 0);
+        Touched.assign(Kinds.size(), 0);
+        const size_t triangleCount = Indices.size() / 3;
+        const size_t targetTriangleCount = targetIndexCount / 3;
+        // A collapse usually takes two triangles and is listed twice, once from each side of
+        // its edge. Collapses far more expensive than the ones that would be enough are left
+        // for a later pass, where the cheap ones skipped in this one get their turn.
+        const size_t enough = std::min(triangleCount - targetTriangleCount, Collapses.size());
+        const float passError = std::max(Collapses[enough - 1].error * 1.5f, 1e-6f);
+        size_t removed = 0;
+        int collapsed = 0;
+        bool errorLimitReached = false;
+        for (const ovrCollapse& collapse : Collapses) {
+            if (collapse.error > maxError) {
+                errorLimitReached = true;
+                break;
+            }
+            if (collapse.error > passError) {
+                break;
+            }
+            if (triangleCount - std::min(removed, triangleCount) <= targetTriangleCount) {
+                break;
+            }
+            const uint32_t fromPosition = PositionIds[collapse.from];
+            const uint32_t toPosition = PositionIds[collapse.to];
+            if (Touched[fromPosition] != 0 || Touched[toPosition] != 0 ||
+                CollapseFlips(collapse.from, collapse.to)) {
+                continue;
+            }
+            Remap[collapse.from] = collapse.to;
+            Touched[fromPosition] = 1;
+            Touched[toPosition] = 1;
+            Quadrics[toPosition].Add(Quadrics[fromPosition]);
+            if (Kinds[fromPosition] == KIND_BORDER) {
+                // the collapsed position drops out of the border either way
+                const uint32_t prev = BorderPrev[fromPosition];
+                const uint32_t next = BorderNext[fromPosition];
+                BorderNext[prev] = next;
+                BorderPrev[next] = prev;
+                removed += 1;
+            } else {
+                removed += 2;
+            }
+            Error = std::max(Error, collapse.error);
+            collapsed++;
+        }
+
+        size_t numIndices = 0;
+        for (size_t t = 0; t < Indices.size(); t += 3) {
+            const uint32_t c[3] = {
+                Remap[Indices[t + 0]], Remap[Indices[t + 1]], Remap[Indices[t + 2]]};
+            if (PositionIds[c[0]] == PositionIds[c[1]] || PositionIds[c[1]] == PositionIds[c[2]] ||
+                PositionIds[c[2]] == PositionIds[c[0]]) {
+                continue;
+            }
+            for (int i = 0; i < 3; ++i) {
+                Indices[numIndices++] = static_cast<TriangleIndex>(c[i]);
+            }
+        }
+        Indices.resize(numIndices);
+
+        if (collapsed == 0 || errorLimitReached) {
+            break;
+        }
+    }
+    return Error;
+}
+
+//==============================================================
+// GenerateModelSurfaceLods
+
+template <typename T>
+static void CopyVertices(
+    const std::vector<T>& source,
+    const std::vector<uint32_t>& order,
+    std::vector<T>& dest) {
+    if (source.empty()) {
+        return;
+    }
+    dest.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        dest[i] = source[order[i]];
+    }
+}
+
+// Keeps only the vertices the indices use, in the order they are first used.
+static void CompactVertices(
+    const VertexAttribs& attribs,
+    const std::vector<TriangleIndex>& indices,
+    const bool optimizeTriangleOrder,
+    VertexAttribs& outAttribs,
+    std::vector<TriangleIndex>& outIndices) {
+    outIndices = indices;
+    if (optimizeTriangleOrder) {
+        OptimizeVertexCache(outIndices, attribs.position.size());
+    }
+    std::vector<uint32_t> order;
+    OptimizeVertexFetch(outIndices, attribs.position.size(), order);
+    CopyVertices(attribs.position, order, outAttribs.position);
+    CopyVertices(attribs.normal, order, outAttribs.normal);
+    CopyVertices(attribs.tangent, order, outAttribs.tangent);
+    CopyVertices(attribs.binormal, order, outAttribs.binormal);
+    CopyVertices(attribs.color, order, outAttribs.color);
+    CopyVertices(attribs.uv0, order, outAttribs.uv0);
+    CopyVertices(attribs.uv1, order, outAttribs.uv1);
+    CopyVertices(attribs.jointIndices, order, outAttribs.jointIndices);
+    CopyVertices(attribs.jointWeights, order, outAttribs.jointWeights);
+}
+
+void GenerateModelSurfaceLods(
+    ModelSurface& surface,
+    const VertexAttribs& attribs,
+    const std::vector<TriangleIndex>& indices,
+    const MaterialParms& materialParms) {
+    if (materialParms.LodLevels <= 0 || !surface.targets.empty() ||
+        static_cast<int>(indices.size()) < MIN_LOD_TRIANGLES * 3) {
+        return;
+    }
+    const Bounds3f& bounds = surface.surfaceDef.geo.localBounds;
+    if (bounds.IsInverted()) {
+        return;
+    }
+    const float diameter = (bounds.b[1] - bounds.b[0]).Length();
+    if (diameter <= 0.0f) {
+        return;
+    }
+
+    // Blended triangles keep the order of the full detail surface.
+    const bool optimizeTriangleOrder = materialParms.OptimizeGeometry &&
+        surface.surfaceDef.graphicsCommand.GpuState.blendEnable == ovrGpuState::BLEND_DISABLE;
+    const GlGeometry::VertexFormat vertexFormat = materialParms.QuantizeVertexAttributes
+        ? GlGeometry::VERTEX_FORMAT_QUANTIZED
+        : GlGeometry::VERTEX_FORMAT_FLOAT;
+
+    ovrMeshSimplifier simplifier;
+    simplifier.Init(attribs.position, indices);
+    size_t previousCount = indices.size();
+    float previousCoverage = FLT_MAX;
+    for (int level = 0; level < materialParms.LodLevels; ++level) {
+        const size_t targetCount = previousCount / 6 * 3;
+        const float error = simplifier.Simplify(targetCount, MAX_LOD_RELATIVE_ERROR * diameter);
+        const size_t count = simplifier.GetIndices().size();
+        const float reduction = 1.0f - static_cast<float>(count) / previousCount;
+        if (count == 0 || reduction < MIN_LOD_REDUCTION) {
+            break;
+        }
+
+        VertexAttribs lodAttribs;
+        std::vector<TriangleIndex> lodIndices;
+        CompactVertices(
+            attribs, simplifier.GetIndices(), optimizeTriangleOrder, lodAttribs, lodIndices);
+
+        ModelSurfaceLod lod;
+        lod.surfaceDef = surface.surfaceDef;
+        lod.surfaceDef.geo = GlGeometry();
+        lod.surfaceDef.geo.Create(lodAttribs, lodIndices, vertexFormat);
+        // The error covers error / diameter of whatever the surface covers on screen.
+        if (error > 0.0f) {
+            previousCoverage =
+                std::min(previousCoverage, materialParms.LodMaxScreenError * diameter / error);
+        }
+        lod.screenCoverage = previousCoverage;
+        surface.lods.push_back(lod);
+        previousCount = count;
+    }
+
+    // The texture uniforms point into the graphics command they belong to, and the levels
+    // won't move again.
+    for (ModelSurfaceLod& lod : surface.lods) {
+        lod.surfaceDef.graphicsCommand.BindUniformTextures();
+    }
+}
+
+} // namespace OVRFW
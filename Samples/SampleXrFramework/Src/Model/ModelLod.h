@@ -0,0 +1,92 @@
+/************************************************************************************
+
+Filename    :   ModelLod.h
+Content     :   Quadric error mesh simplification for model levels of detail.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+#include "Render/GlGeometry.h"
+#include "ModelDef.h"
+
+namespace OVRFW {
+
+// Simplifies a triangle list by collapsing edges onto one of their vertices, cheapest first by
+// the quadric error metric, so the remaining triangles keep using the original vertices and
+// their attributes. Positions that have more than one vertex, as on texture or normal seams,
+// and non-manifold edges are kept as they are, and open borders only collapse along themselves.
+class ovrMeshSimplifier {
+   public:
+    void Init(
+        const std::vector<OVR::Vector3f>& positions,
+        const std::vector<TriangleIndex>& indices);
+
+    // Continues from the last call until at most targetIndexCount indices are left, or until
+    // the next collapse would move the surface further than maxError. Returns the largest error
+    // of any collapse so far, in the units of the positions.
+    float Simplify(const size_t targetIndexCount, const float maxError);
+
+    const std::vector<TriangleIndex>& GetIndices() const {
+        return Indices;
+    }
+
+   private:
+    enum ovrVertexKind : uint8_t { KIND_MANIFOLD, KIND_BORDER, KIND_LOCKED };
+
+    struct ovrQuadric {
+        ovrQuadric();
+
+        void AddPlane(const OVR::Vector3d& normal, const double distance, const double weight);
+        void Add(const ovrQuadric& other);
+        // Root mean square distance of p from the planes.
+        float Error(const OVR::Vector3f& p) const;
+
+        double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+        double weight;
+    };
+
+    struct ovrCollapse {
+        uint32_t from; // vertex
+        uint32_t to;
+        float error;
+    };
+
+    bool CollapseFlips(const uint32_t from, const uint32_t to) const;
+
+    std::vector<OVR::Vector3f> Positions;
+    std::vector<TriangleIndex> Indices;
+    std::vector<uint32_t> PositionIds; // vertices at the same position share an id
+    std::vector<ovrVertexKind> Kinds; // by position id
+    std::vector<uint32_t> BorderNext; // by position id, along the open border
+    std::vector<uint32_t> BorderPrev;
+    std::vector<ovrQuadric> Quadrics; // by position id
+    float Error;
+
+    // scratch for Simplify()
+    std::vector<ovrCollapse> Collapses;
+    std::vector<uint32_t> Remap;
+    std::vector<uint8_t> Touched;
+    std::vector<uint32_t> TriangleOffsets; // triangles around each vertex
+    std::vector<uint32_t> VertexTriangles;
+};
+
+// Adds up to materialParms.LodLevels simplified copies of surface.surfaceDef to surface.lods,
+// each with about half the triangles of the level before. Each level only keeps the vertices
+// it uses, ordered and stored as MaterialParms::OptimizeGeometry and QuantizeVertexAttributes
+// ask. Surfaces with morph targets or few triangles are left alone, and so is a surface once a
+// level no longer removes enough triangles. Call it once the surface's graphics command is set
+// up.
+void GenerateModelSurfaceLods(
+    ModelSurface& surface,
+    const VertexAttribs& attribs,
+    const std::vector<TriangleIndex>& indices,
+    const MaterialParms& materialParms);
+
+} // namespace OVRFW
@@ -29,7 +29,10 @@ Authors     :   John Carmack
 
 #include <stdlib.h>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
 
+#include "JobSystem.h"
 #include "Misc/Log.h"
 #include "Render/Egl.h"
 
@@ -129,11 +132,57 @@ static float BoundsSortCullKey(const Bounds3f& bounds, const Matrix4f& mvp) {
     return maxW; // couldn't cull
 }
 
+// Switching to a coarser level waits until the coverage is this fraction below where the
+// level starts, so a surface sitting right at a switch point doesn't flicker between levels.
+static const float LOD_HYSTERESIS = 0.1f;
+
+// The fraction of the screen height covered by the bounding sphere of the bounds.
+static float ScreenCoverage(
+    const Bounds3f& localBounds,
+    const Matrix4f& modelMatrix,
+    const Vector3f& eyePosition,
+    const float projectionScale) {
+    if (localBounds.IsInverted()) {
+        return FLT_MAX;
+    }
+    float maxScaleSq = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        const Vector3f column(
+            modelMatrix.M[0][axis], modelMatrix.M[1][axis], modelMatrix.M[2][axis]);
+        maxScaleSq = std::max(maxScaleSq, column.LengthSq());
+    }
+    const float radius = localBounds.GetSize().Length() * 0.5f * sqrtf(maxScaleSq);
+    const float distance = (modelMatrix.Transform(localBounds.GetCenter()) - eyePosition).Length();
+    if (distance <= radius) {
+        return FLT_MAX;
+    }
+    return radius * projectionScale / distance;
+}
+
+// Level 0 is the full detail, and threshold( i ) is the coverage at or below which level i
+// may be used, decreasing with i.
+template <typename _threshold_>
+static int SelectLodLevel(
+    const int previousLevel,
+    const float coverage,
+    const int numLevels,
+    const _threshold_& threshold) {
+    int level = std::min(previousLevel, numLevels - 1);
+    while (level > 0 && coverage > threshold(level)) {
+        level--;
+    }
+    while (level + 1 < numLevels && coverage < threshold(level + 1) * (1.0f - LOD_HYSTERESIS)) {
+        level++;
+    }
+    return level;
+}
+
 struct bsort_t {
     float key;
     Matrix4f modelMatrix;
     const std::vector<Matrix4f>* joints;
     const ovrSurfaceDef* surface;
+    int fullDetailIndexCount; // of the surface the drawn one stands in for
     bool transparent;
 
     bool operator<(const bsort_t& b2) const {
@@ -156,23 +205,56 @@ struct bsort_t {
     };
 };
 
-void BuildModelSurfaceList(
-    std::vector<ovrDrawSurface>& surfaceList,
-    const std::vector<ModelNodeState*>& emitNodes,
-    const std::vector<ovrDrawSurface>& emitSurfaces,
-    const Matrix4f& viewMatrix,
-    const Matrix4f& projectionMatrix) {
-    // A mobile GPU will be in trouble if it draws more than this.
-    static const int MAX_DRAW_SURFACES = 1024;
-    bsort_t bsort[MAX_DRAW_SURFACES];
-
-    const Matrix4f vpMatrix = projectionMatrix * viewMatrix;
-
-    int numSurfaces = 0;
+// Picks the level of detail of the node's model, when it has MSFT_lod levels, and returns the
+// model to draw, or nullptr when the node is too small to draw at all.
+static const Model* SelectNodeLod(
+    ModelNodeState& nodeState,
+    const Vector3f& eyePosition,
+    const float projectionScale) {
+    const ModelNode& node = *nodeState.GetNode();
+    if (node.lodNodes.empty()) {
+        return node.model;
+    }
+    Bounds3f bounds(Bounds3f::Init);
+    for (const ModelSurface& surface : node.model->surfaces) {
+        if (!surface.surfaceDef.geo.localBounds.IsInverted()) {
+            bounds = Bounds3f::Union(bounds, surface.surfaceDef.geo.localBounds);
+        }
+    }
+    const float coverage =
+        ScreenCoverage(bounds, nodeState.GetGlobalTransform(), eyePosition, projectionScale);
+    const int numLodNodes = static_cast<int>(node.lodNodes.size());
+    // the value past the last level, when there is one, is a level that draws nothing
+    const int numLevels =
+        static_cast<int>(std::min(node.lodScreenCoverage.size(), node.lodNodes.size() + 1)) + 1;
+    nodeState.lodLevel =
+        SelectLodLevel(nodeState.lodLevel, coverage, numLevels, [&node](const int level) {
+            return node.lodScreenCoverage[level - 1];
+        });
+    if (nodeState.lodLevel == 0) {
+        return node.model;
+    }
+    if (nodeState.lodLevel > numLodNodes) {
+        return nullptr;
+    }
+    return nodeState.state->mf->Nodes[node.lodNodes[nodeState.lodLevel - 1]].model;
+}
 
-    for (int nodeNum = 0; nodeNum < static_cast<int>(emitNodes.size()); nodeNum++) {
-        const ModelNodeState& nodeState = *emitNodes[nodeNum];
-        if (nodeState.GetNode() != NULL && nodeState.GetNode()->model != NULL) {
+// Culls the surfaces of emitNodes[begin, end), picks their levels of detail and appends the
+// ones that survive to bsort.
+static void CullModelNodes(
+    const std::vector<ModelNodeState*>& emitNodes,
+    const int begin,
+    const int end,
+    const Matrix4f& vpMatrix,
+    const Vector3f& eyePosition,
+    const float projectionScale,
+    std::vector<bsort_t>& bsort) {
+    for (int nodeNum = begin; nodeNum < end; nodeNum++) {
+        ModelNodeState& nodeState = *emitNodes[nodeNum];
+        // MSFT_lod levels are drawn in place of the node they belong to.
+        if (nodeState.GetNode() != NULL && nodeState.GetNode()->model != NULL &&
+            nodeState.GetNode()->lodOwnerIndex < 0) {
             // #TODO currently we aren't properly updating the geo local bounds for skinned animated
             // objects.  Fix that.
             bool allowCulling = true;
@@ -180,13 +262,19 @@ void BuildModelSurfaceList(
                 allowCulling = false;
             }
 
-            if (nodeState.GetNode()->model != nullptr) {
-                const Model& modelDef = *nodeState.GetNode()->model;
+            const Model* model = SelectNodeLod(nodeState, eyePosition, projectionScale);
+            if (model != nullptr) {
+                const Model& modelDef = *model;
+                const Matrix4f globalTransform = nodeState.GetGlobalTransform();
+                const Matrix4f mvp = vpMatrix * globalTransform;
+                if (nodeState.surfaceLodLevels.size() < modelDef.surfaces.size()) {
+                    nodeState.surfaceLodLevels.resize(modelDef.surfaces.size(), 0);
+                }
                 for (int surfaceNum = 0; surfaceNum < static_cast<int>(modelDef.surfaces.size());
                      surfaceNum++) {
-                    const ovrSurfaceDef& surfaceDef = modelDef.surfaces[surfaceNum].surfaceDef;
-                    const float sort = BoundsSortCullKey(
-                        surfaceDef.geo.localBounds, vpMatrix * nodeState.GetGlobalTransform());
+                    const ModelSurface& modelSurface = modelDef.surfaces[surfaceNum];
+                    const ovrSurfaceDef& surfaceDef = modelSurface.surfaceDef;
+                    const float sort = BoundsSortCullKey(surfaceDef.geo.localBounds, mvp);
                     if (sort == 0) {
                         if (allowCulling) {
                             if (LogRenderSurfaces) {
@@ -200,10 +288,6 @@ void BuildModelSurfaceList(
                         }
                     }
 
-                    if (numSurfaces == MAX_DRAW_SURFACES) {
-                        break;
-                    }
-
                     /*
                                         // Update the Joint Uniform Buffer
                                         if ( nodeState.node->skinIndex >= 0 )
@@ -260,17 +344,88 @@ void BuildModelSurfaceList(
                                         }
                     */
 
-                    bsort[numSurfaces].key = sort;
-                    bsort[numSurfaces].modelMatrix = nodeState.GetGlobalTransform();
-                    bsort[numSurfaces].surface = &surfaceDef;
-                    bsort[numSurfaces].transparent =
+                    const ovrSurfaceDef* drawSurfaceDef = &surfaceDef;
+                    if (!modelSurface.lods.empty()) {
+                        const float coverage = ScreenCoverage(
+                            surfaceDef.geo.localBounds,
+                            globalTransform,
+                            eyePosition,
+                            projectionScale);
+                        uint8_t& level = nodeState.surfaceLodLevels[surfaceNum];
+                        level = static_cast<uint8_t>(SelectLodLevel(
+                            level,
+                            coverage,
+                            static_cast<int>(modelSurface.lods.size()) + 1,
+                            [&modelSurface](const int l) {
+                                return modelSurface.lods[l - 1].screenCoverage;
+                            }));
+                        if (level > 0) {
+                            drawSurfaceDef = &modelSurface.lods[level - 1].surfaceDef;
+                        }
+                    }
+
+                    bsort_t b;
+                    b.key = sort;
+                    b.modelMatrix = globalTransform;
+                    b.joints = nullptr;
+                    b.surface = drawSurfaceDef;
+                    b.fullDetailIndexCount = surfaceDef.geo.indexCount;
+                    b.transparent =
                         (surfaceDef.graphicsCommand.GpuState.blendEnable !=
                          ovrGpuState::BLEND_DISABLE);
-                    numSurfaces++;
+                    bsort.push_back(b);
                 }
             }
         }
     }
+}
+
+void BuildModelSurfaceList(
+    std::vector<ovrDrawSurface>& surfaceList,
+    const std::vector<ModelNodeState*>& emitNodes,
+    const std::vector<ovrDrawSurface>& emitSurfaces,
+    const Matrix4f& viewMatrix,
+    const Matrix4f& projectionMatrix,
+    ovrModelLodCounters* lodCounters) {
+    // A mobile GPU will be in trouble if it draws more than this.
+    static const int MAX_DRAW_SURFACES = 1024;
+    // Nodes culled per job when there is a job system.
+    static const int NODES_PER_BATCH = 64;
+
+    const Matrix4f vpMatrix = projectionMatrix * viewMatrix;
+    const Vector3f eyePosition = viewMatrix.Inverted().GetTranslation();
+    const float projectionScale = projectionMatrix.M[1][1];
+
+    std::vector<bsort_t> bsort;
+    bsort.reserve(MAX_DRAW_SURFACES);
+
+    const int numNodes = static_cast<int>(emitNodes.size());
+    ovrJobSystem* jobSystem = GetJobSystem();
+    if (jobSystem != nullptr && numNodes > NODES_PER_BATCH) {
+        // Every batch culls into its own list and the lists are joined in batch order, so
+        // the result matches a serial cull exactly.
+        std::vector<std::vector<bsort_t>> batchLists(
+            ovrJobSystem::GetNumBatches(numNodes, NODES_PER_BATCH));
+        jobSystem->ParallelFor(
+            numNodes, NODES_PER_BATCH, [&](const int batch, const int begin, const int end) {
+                CullModelNodes(
+                    emitNodes,
+                    begin,
+                    end,
+                    vpMatrix,
+                    eyePosition,
+                    projectionScale,
+                    batchLists[batch]);
+            });
+        for (const std::vector<bsort_t>& batchList : batchLists) {
+            bsort.insert(bsort.end(), batchList.begin(), batchList.end());
+        }
+    } else {
+        CullModelNodes(emitNodes, 0, numNodes, vpMatrix, eyePosition, projectionScale, bsort);
+    }
+    if (static_cast<int>(bsort.size()) > MAX_DRAW_SURFACES) {
+        bsort.resize(MAX_DRAW_SURFACES);
+    }
 
     for (int i = 0; i < static_cast<int>(emitSurfaces.size()); i++) {
         const ovrDrawSurface& drawSurf = emitSurfaces[i];
@@ -284,23 +439,27 @@ void BuildModelSurfaceList(
             continue;
         }
 
-        if (numSurfaces == MAX_DRAW_SURFACES) {
+        if (static_cast<int>(bsort.size()) == MAX_DRAW_SURFACES) {
             break;
         }
 
-        bsort[numSurfaces].key = sort;
-        bsort[numSurfaces].modelMatrix = drawSurf.modelMatrix;
-        bsort[numSurfaces].surface = &surfaceDef;
-        bsort[numSurfaces].transparent =
+        bsort_t b;
+        b.key = sort;
+        b.modelMatrix = drawSurf.modelMatrix;
+        b.joints = nullptr;
+        b.surface = &surfaceDef;
+        b.fullDetailIndexCount = surfaceDef.geo.indexCount;
+        b.transparent =
             (surfaceDef.graphicsCommand.GpuState.blendEnable != ovrGpuState::BLEND_DISABLE);
-        numSurfaces++;
+        bsort.push_back(b);
     }
 
     // sort by the far W and transparency
     // IMPORTANT: use a stable sort so surfaces with identical bounds
     // will sort consistently from frame to frame, rather than randomly
     // as happens with qsort.
-    std::stable_sort(bsort, bsort + numSurfaces);
+    std::stable_sort(bsort.begin(), bsort.end());
+    const int numSurfaces = static_cast<int>(bsort.size());
 
     // ----TODO_DRAWEYEVIEW : don't overwrite surfaces which may have already been added to the
     // surfaceList.
@@ -309,6 +468,14 @@ void BuildModelSurfaceList(
         surfaceList[i].modelMatrix = bsort[i].modelMatrix;
         surfaceList[i].surface = bsort[i].surface;
     }
+
+    if (lodCounters != nullptr) {
+        *lodCounters = ovrModelLodCounters();
+        for (int i = 0; i < numSurfaces; i++) {
+            lodCounters->numTrianglesFullDetail += bsort[i].fullDetailIndexCount / 3;
+            lodCounters->numTrianglesDrawn += bsort[i].surface->geo.indexCount / 3;
+        }
+    }
 }
 
 } // namespace OVRFW
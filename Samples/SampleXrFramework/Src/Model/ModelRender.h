@@ -34,15 +34,27 @@ Authors     :   John Carmack
 #include <vector>
 
 namespace OVRFW {
+
+// Triangles of the surfaces in the list, as drawn and as they would be at full detail.
+struct ovrModelLodCounters {
+    ovrModelLodCounters() : numTrianglesFullDetail(0), numTrianglesDrawn(0) {}
+
+    int numTrianglesFullDetail;
+    int numTrianglesDrawn;
+};
+
 // The model surfaces are culled and added to the sorted surface list.
 // Application specific surfaces from the emit list are also added to the sorted surface list.
 // The surface list is sorted such that opaque surfaces come first, sorted front-to-back,
 // and transparent surfaces come last, sorted back-to-front.
+// Model surfaces with levels of detail are drawn at the coarsest level allowed by the screen
+// height their bounding sphere covers, and the picked levels are kept in the node states.
 void BuildModelSurfaceList(
     std::vector<ovrDrawSurface>& surfaceList,
     const std::vector<ModelNodeState*>& emitNodes,
     const std::vector<ovrDrawSurface>& emitSurfaces,
     const OVR::Matrix4f& viewMatrix,
-    const OVR::Matrix4f& projectionMatrix);
+    const OVR::Matrix4f& projectionMatrix,
+    ovrModelLodCounters* lodCounters = nullptr);
 
 } // namespace OVRFW
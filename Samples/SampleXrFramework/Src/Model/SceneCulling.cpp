@@ -0,0 +1,460 @@
+/************************************************************************************
+
+Filename    :   SceneCulling.cpp
+Content     :   Bounding volume hierarchy over model node world bounds, with frustum
+                and coarse occlusion culling.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#include "SceneCulling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using OVR::Bounds3f;
+using OVR::Matrix4f;
+using OVR::Vector3f;
+using OVR::Vector4f;
+
+namespace OVRFW {
+
+// Corners closer than this in clip w are treated as crossing the eye plane.
+static const float MIN_CLIP_W = 1e-3f;
+
+static void TransformCorners(const Bounds3f& bounds, const Matrix4f& mvp, Vector4f c[8]) {
+    for (int i = 0; i < 8; i++) {
+        const Vector4f world(
+            bounds.b[(i & 1)].x, bounds.b[(i & 2) >> 1].y, bounds.b[(i & 4) >> 2].z, 1.0f);
+        c[i] = mvp.Transform(world);
+    }
+}
+
+//==============================================================
+// ovrCoarseOcclusionBuffer
+
+void ovrCoarseOcclusionBuffer::Begin(
+    const Matrix4f& leftViewProjMatrix,
+    const Matrix4f& rightViewProjMatrix) {
+    ViewProjMatrix[0] = leftViewProjMatrix;
+    ViewProjMatrix[1] = rightViewProjMatrix;
+    for (int view = 0; view < NUM_VIEWS; view++) {
+        std::fill(Depth[view], Depth[view] + WIDTH * HEIGHT, FLT_MAX);
+    }
+}
+
+void ovrCoarseOcclusionBuffer::AddOccluder(const Bounds3f& worldBounds) {
+    // corner index bits are x, y, z; each face in winding order
+    static const int faces[6][4] = {
+        {0, 2, 6, 4}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 5, 7, 6}};
+
+    for (int view = 0; view < NUM_VIEWS; view++) {
+        Vector4f c[8];
+        TransformCorners(worldBounds, ViewProjMatrix[view], c);
+        // Back faces are always farther than the front faces covering the same tiles, so
+        // drawing them is harmless and saves working out which ones they are.
+        for (int f = 0; f < 6; f++) {
+            const Vector4f quad[4] = {
+                c[faces[f][0]], c[faces[f][1]], c[faces[f][2]], c[faces[f][3]]};
+            RasterizeQuad(Depth[view], quad);
+        }
+    }
+}
+
+void ovrCoarseOcclusionBuffer::RasterizeQuad(float* depth, const Vector4f clip[4]) {
+    float sx[4];
+    float sy[4];
+    float maxW = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        if (clip[i].w < MIN_CLIP_W) {
+            return; // a face crossing the eye plane doesn't project to a quad
+        }
+        sx[i] = (clip[i].x / clip[i].w * 0.5f + 0.5f) * WIDTH;
+        sy[i] = (clip[i].y / clip[i].w * 0.5f + 0.5f) * HEIGHT;
+        maxW = std::max(maxW, clip[i].w);
+    }
+
+    float area = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        const int j = (i + 1) & 3;
+        area += sx[i] * sy[j] - sx[j] * sy[i];
+    }
+    if (fabsf(area) < 1.0f) {
+        return; // edge on, or smaller than a tile
+    }
+    const float orientation = area > 0.0f ? 1.0f : -1.0f;
+
+    const float minX = std::min(std::min(sx[0], sx[1]), std::min(sx[2], sx[3]));
+    const float maxX = std::max(std::max(sx[0], sx[1]), std::max(sx[2], sx[3]));
+    const float minY = std::min(std::min(sy[0], sy[1]), std::min(sy[2], sy[3]));
+    const float maxY = std::max(std::max(sy[0], sy[1]), std::max(sy[2], sy[3]));
+    const int x0 = std::max(0, static_cast<int>(floorf(minX)));
+    const int x1 = std::min(WIDTH - 1, static_cast<int>(ceilf(maxX)) - 1);
+    const int y0 = std::max(0, static_cast<int>(floorf(minY)));
+    const int y1 = std::min(HEIGHT - 1, static_cast<int>(ceilf(maxY)) - 1);
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            // the quad is convex, so a tile is covered when all of its corners are inside
+            bool covered = true;
+            for (int corner = 0; corner < 4 && covered; corner++) {
+                const float px = static_cast<float>(x + (corner & 1));
+                const float py = static_cast<float>(y + (corner >> 1));
+                for (int i = 0; i < 4; i++) {
+                    const int j = (i + 1) & 3;
+                    const float edge =
+                        (sx[j] - sx[i]) * (py - sy[i]) - (sy[j] - sy[i]) * (px - sx[i]);
+                    if (edge * orientation < 0.0f) {
+                        covered = false;
+                        break;
+                    }
+                }
+            }
+            if (covered) {
+                float& d = depth[y * WIDTH + x];
+                d = std::min(d, maxW);
+            }
+        }
+    }
+}
+
+bool ovrCoarseOcclusionBuffer::IsOccludedInView(const int view, const Bounds3f& worldBounds)
+    const {
+    Vector4f c[8];
+    TransformCorners(worldBounds, ViewProjMatrix[view], c);
+
+    float minX = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float minY = FLT_MAX;
+    float maxY = -FLT_MAX;
+    float minW = FLT_MAX;
+    for (int i = 0; i < 8; i++) {
+        if (c[i].w < MIN_CLIP_W) {
+            return false; // the box reaches the viewer
+        }
+        const float x = (c[i].x / c[i].w * 0.5f + 0.5f) * WIDTH;
+        const float y = (c[i].y / c[i].w * 0.5f + 0.5f) * HEIGHT;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minW = std::min(minW, c[i].w);
+    }
+
+    const int x0 = std::max(0, static_cast<int>(floorf(minX)));
+    const int x1 = std::min(WIDTH - 1, static_cast<int>(floorf(maxX)));
+    const int y0 = std::max(0, static_cast<int>(floorf(minY)));
+    const int y1 = std::min(HEIGHT - 1, static_cast<int>(floorf(maxY)));
+    if (x0 > x1 || y0 > y1) {
+        return false; // off screen, that is for the frustum test to decide
+    }
+
+    const float* depth = Depth[view];
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (depth[y * WIDTH + x] >= minW) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool ovrCoarseOcclusionBuffer::IsOccluded(const Bounds3f& worldBounds) const {
+    for (int view = 0; view < NUM_VIEWS; view++) {
+        if (!IsOccludedInView(view, worldBounds)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================
+// ovrSceneBvh
+
+// Returns cleared bounds if any surface has no bounds, which keeps the node out of the tree.
+static Bounds3f NodeWorldBounds(const ModelNodeState& nodeState) {
+    Bounds3f bounds(Bounds3f::Init);
+    const Matrix4f globalTransform = nodeState.GetGlobalTransform();
+    const Model& model = *nodeState.GetNode()->model;
+    for (int i = 0; i < static_cast<int>(model.surfaces.size()); i++) {
+        const Bounds3f& localBounds = model.surfaces[i].surfaceDef.geo.localBounds;
+        if (localBounds.IsInverted()) {
+            return Bounds3f(Bounds3f::Init);
+        }
+        bounds = Bounds3f::Union(bounds, Bounds3f::Transform(globalTransform, localBounds));
+    }
+    return bounds;
+}
+
+void ovrSceneBvh::Update(const std::vector<ModelState*>& models, ovrSceneCullCounters& counters) {
+    // Anything that changes which nodes are emitted, or where they live, forces a rebuild.
+    std::vector<uintptr_t> signature;
+    for (const ModelState* state : models) {
+        signature.push_back(reinterpret_cast<uintptr_t>(state));
+        signature.push_back(reinterpret_cast<uintptr_t>(state->mf));
+        signature.push_back(reinterpret_cast<uintptr_t>(state->nodeStates.data()));
+        signature.push_back(state->nodeStates.size());
+        for (const ModelSubSceneState& subSceneState : state->subSceneStates) {
+            signature.push_back(subSceneState.visible ? 1 : 0);
+        }
+    }
+
+    if (signature != Signature) {
+        Signature.swap(signature);
+        Rebuild(models);
+        counters.rebuilt = true;
+        counters.numNodesRefit = static_cast<int>(Leaves.size());
+    } else {
+        bool refit = false;
+        for (ovrBvhModel& bvhModel : BvhModels) {
+            if (bvhModel.State->transformVersion == bvhModel.TransformVersion) {
+                continue;
+            }
+            bvhModel.TransformVersion = bvhModel.State->transformVersion;
+            for (int i = 0; i < bvhModel.NumLeaves; i++) {
+                ovrBvhLeaf& leaf = Leaves[bvhModel.FirstLeaf + i];
+                if (leaf.NodeState->transformVersion != leaf.TransformVersion) {
+                    leaf.TransformVersion = leaf.NodeState->transformVersion;
+                    leaf.WorldBounds = NodeWorldBounds(*leaf.NodeState);
+                    counters.numNodesRefit++;
+                    refit = true;
+                }
+            }
+        }
+
+        // Children always come after their parent, so a reverse walk refits bottom up.
+        if (refit) {
+            for (int n = static_cast<int>(Nodes.size()) - 1; n >= 0; n--) {
+                ovrBvhNode& node = Nodes[n];
+                if (node.Left >= 0) {
+                    node.Bounds =
+                        Bounds3f::Union(Nodes[node.Left].Bounds, Nodes[node.Left + 1].Bounds);
+                } else {
+                    node.Bounds.Clear();
+                    for (int i = 0; i < node.Count; i++) {
+                        node.Bounds = Bounds3f::Union(
+                            node.Bounds, Leaves[LeafOrder[node.First + i]].WorldBounds);
+                    }
+                }
+            }
+        }
+    }
+
+    counters.numNodesTotal = static_cast<int>(Leaves.size() + AlwaysVisible.size());
+    counters.numSurfacesTotal = NumSurfaces;
+}
+
+void ovrSceneBvh::Rebuild(const std::vector<ModelState*>& models) {
+    BvhModels.clear();
+    Leaves.clear();
+    LeafOrder.clear();
+    Nodes.clear();
+    AlwaysVisible.clear();
+    NumSurfaces = 0;
+
+    std::vector<ModelNodeState*> emitNodes;
+    for (ModelState* state : models) {
+        emitNodes.clear();
+        for (int j = 0; j < static_cast<int>(state->subSceneStates.size()); j++) {
+            const ModelSubSceneState& subSceneState = state->subSceneStates[j];
+            if (subSceneState.visible) {
+                for (int k = 0; k < static_cast<int>(subSceneState.nodeStates.size()); k++) {
+                    state->nodeStates[subSceneState.nodeStates[k]].AddNodesToEmitList(emitNodes);
+                }
+            }
+        }
+
+        ovrBvhModel bvhModel;
+        bvhModel.State = state;
+        bvhModel.TransformVersion = state->transformVersion;
+        bvhModel.FirstLeaf = static_cast<int>(Leaves.size());
+
+        for (ModelNodeState* nodeState : emitNodes) {
+            const ModelNode* node = nodeState->GetNode();
+            if (node == nullptr || node->model == nullptr || node->model->surfaces.empty()) {
+                continue;
+            }
+            const int numSurfaces = static_cast<int>(node->model->surfaces.size());
+            NumSurfaces += numSurfaces;
+
+            const Bounds3f worldBounds = NodeWorldBounds(*nodeState);
+            if (node->skinIndex >= 0 || worldBounds.IsInverted()) {
+                AlwaysVisible.push_back(nodeState);
+                continue;
+            }
+
+            ovrBvhLeaf leaf;
+            leaf.NodeState = nodeState;
+            leaf.WorldBounds = worldBounds;
+            leaf.TransformVersion = nodeState->transformVersion;
+            leaf.NumSurfaces = numSurfaces;
+            Leaves.push_back(leaf);
+        }
+
+        bvhModel.NumLeaves = static_cast<int>(Leaves.size()) - bvhModel.FirstLeaf;
+        BvhModels.push_back(bvhModel);
+    }
+
+    const int numLeaves = static_cast<int>(Leaves.size());
+    if (numLeaves == 0) {
+        return;
+    }
+    LeafOrder.resize(numLeaves);
+    for (int i = 0; i < numLeaves; i++) {
+        LeafOrder[i] = i;
+    }
+    Nodes.reserve(2 * numLeaves);
+    Nodes.push_back(ovrBvhNode());
+    BuildNode(0, 0, numLeaves);
+}
+
+void ovrSceneBvh::BuildNode(const int nodeIndex, const int first, const int count) {
+    Bounds3f bounds(Bounds3f::Init);
+    Bounds3f centers(Bounds3f::Init);
+    for (int i = 0; i < count; i++) {
+        const Bounds3f& leafBounds = Leaves[LeafOrder[first + i]].WorldBounds;
+        bounds = Bounds3f::Union(bounds, leafBounds);
+        centers.AddPoint(leafBounds.GetCenter());
+    }
+
+    Nodes[nodeIndex].Bounds = bounds;
+    Nodes[nodeIndex].First = first;
+    Nodes[nodeIndex].Count = count;
+    Nodes[nodeIndex].Left = -1;
+    if (count <= MAX_LEAF_NODES) {
+        return;
+    }
+
+    // median split along the longest axis of the leaf centers
+    const Vector3f size = centers.GetSize();
+    const int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+    const int half = count / 2;
+    std::nth_element(
+        LeafOrder.begin() + first,
+        LeafOrder.begin() + first + half,
+        LeafOrder.begin() + first + count,
+        [this, axis](const int a, const int b) {
+            return Leaves[a].WorldBounds.GetCenter()[axis] <
+                Leaves[b].WorldBounds.GetCenter()[axis];
+        });
+
+    const int left = static_cast<int>(Nodes.size());
+    Nodes[nodeIndex].Left = left;
+    Nodes.push_back(ovrBvhNode());
+    Nodes.push_back(ovrBvhNode());
+    BuildNode(left, first, half);
+    BuildNode(left + 1, first + half, count - half);
+}
+
+// Returns -1 when the box is outside the plane, 1 when it is inside, 0 when it straddles.
+static int ClassifyBox(const Bounds3f& bounds, const Vector4f& plane) {
+    const Vector3f p(
+        plane.x >= 0.0f ? bounds.b[1].x : bounds.b[0].x,
+        plane.y >= 0.0f ? bounds.b[1].y : bounds.b[0].y,
+        plane.z >= 0.0f ? bounds.b[1].z : bounds.b[0].z);
+    if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f) {
+        return -1;
+    }
+    const Vector3f n(
+        plane.x >= 0.0f ? bounds.b[0].x : bounds.b[1].x,
+        plane.y >= 0.0f ? bounds.b[0].y : bounds.b[1].y,
+        plane.z >= 0.0f ? bounds.b[0].z : bounds.b[1].z);
+    if (plane.x * n.x + plane.y * n.y + plane.z * n.z + plane.w >= 0.0f) {
+        return 1;
+    }
+    return 0;
+}
+
+// Clears the bits of planes the box is completely inside. Returns false if it is outside one.
+static bool FrustumTest(const Bounds3f& bounds, const Vector4f planes[6], int& planeMask) {
+    for (int i = 0; i < 6; i++) {
+        if ((planeMask & (1 << i)) == 0) {
+            continue;
+        }
+        const int side = ClassifyBox(bounds, planes[i]);
+        if (side < 0) {
+            return false;
+        }
+        if (side > 0) {
+            planeMask &= ~(1 << i);
+        }
+    }
+    return true;
+}
+
+void ovrSceneBvh::Cull(
+    const Matrix4f& viewProjMatrix,
+    const ovrCoarseOcclusionBuffer* occlusion,
+    std::vector<ModelNodeState*>& visibleNodes,
+    ovrSceneCullCounters& counters) const {
+    if (!Nodes.empty()) {
+        // The same -w <= xyz <= w clip volume that BoundsSortCullKey tests against.
+        const Matrix4f& m = viewProjMatrix;
+        const Vector4f row[4] = {
+            Vector4f(m.M[0][0], m.M[0][1], m.M[0][2], m.M[0][3]),
+            Vector4f(m.M[1][0], m.M[1][1], m.M[1][2], m.M[1][3]),
+            Vector4f(m.M[2][0], m.M[2][1], m.M[2][2], m.M[2][3]),
+            Vector4f(m.M[3][0], m.M[3][1], m.M[3][2], m.M[3][3])};
+        const Vector4f planes[6] = {
+            row[3] + row[0],
+            row[3] - row[0],
+            row[3] + row[1],
+            row[3] - row[1],
+            row[3] + row[2],
+            row[3] - row[2]};
+
+        CullNode(0, planes, 0x3F, occlusion, visibleNodes, counters);
+    }
+
+    for (ModelNodeState* nodeState : AlwaysVisible) {
+        visibleNodes.push_back(nodeState);
+        counters.numNodesVisible++;
+        counters.numSurfacesVisited +=
+            static_cast<int>(nodeState->GetNode()->model->surfaces.size());
+    }
+}
+
+void ovrSceneBvh::CullNode(
+    const int nodeIndex,
+    const Vector4f planes[6],
+    int planeMask,
+    const ovrCoarseOcclusionBuffer* occlusion,
+    std::vector<ModelNodeState*>& visibleNodes,
+    ovrSceneCullCounters& counters) const {
+    const ovrBvhNode& node = Nodes[nodeIndex];
+    counters.numBvhNodesVisited++;
+
+    if (!FrustumTest(node.Bounds, planes, planeMask)) {
+        counters.numNodesFrustumCulled += node.Count;
+        return;
+    }
+    if (occlusion != nullptr && occlusion->IsOccluded(node.Bounds)) {
+        counters.numNodesOcclusionCulled += node.Count;
+        return;
+    }
+
+    if (node.Left >= 0) {
+        CullNode(node.Left, planes, planeMask, occlusion, visibleNodes, counters);
+        CullNode(node.Left + 1, planes, planeMask, occlusion, visibleNodes, counters);
+        return;
+    }
+
+    for (int i = 0; i < node.Count; i++) {
+        const ovrBvhLeaf& leaf = Leaves[LeafOrder[node.First + i]];
+        if (node.Count > 1) {
+            int leafMask = planeMask;
+            if (!FrustumTest(leaf.WorldBounds, planes, leafMask)) {
+                counters.numNodesFrustumCulled++;
+                continue;
+            }
+        }
+        visibleNodes.push_back(leaf.NodeState);
+        counters.numNodesVisible++;
+        counters.numSurfacesVisited += leaf.NumSurfaces;
+    }
+}
+
+} // namespace OVRFW
@@ -0,0 +1,138 @@
+/************************************************************************************
+
+Filename    :   SceneCulling.h
+Content     :   Bounding volume hierarchy over model node world bounds, with frustum
+                and coarse occlusion culling.
+Created     :   October 2026
+Language    :   C++
+
+************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+#include "ModelFile.h"
+
+namespace OVRFW {
+
+struct ovrSceneCullCounters {
+    ovrSceneCullCounters()
+        : numBvhNodesVisited(0),
+          numNodesTotal(0),
+          numNodesVisible(0),
+          numNodesFrustumCulled(0),
+          numNodesOcclusionCulled(0),
+          numNodesRefit(0),
+          numSurfacesTotal(0),
+          numSurfacesVisited(0),
+          numSurfacesDrawn(0),
+          numTrianglesFullDetail(0),
+          numTrianglesDrawn(0),
+          numOccluders(0),
+          rebuilt(false) {}
+
+    int numBvhNodesVisited; // interior and leaf boxes tested
+    int numNodesTotal; // model nodes with surfaces
+    int numNodesVisible; // model nodes passed on to the per-surface cull
+    int numNodesFrustumCulled; // model nodes under a box outside the frustum
+    int numNodesOcclusionCulled; // model nodes under a box behind an occluder
+    int numNodesRefit; // model nodes whose world bounds were recomputed
+    int numSurfacesTotal;
+    int numSurfacesVisited; // surfaces handed on to the per-surface cull
+    int numSurfacesDrawn; // surfaces in the final list, emit surfaces included
+    int numTrianglesFullDetail; // of the final list, if every surface was at full detail
+    int numTrianglesDrawn; // of the final list, at the levels of detail picked
+    int numOccluders;
+    bool rebuilt; // the hierarchy was rebuilt this frame
+};
+
+// Low resolution depth buffers, one per eye, that only app supplied occluder boxes are
+// drawn into. Each tile holds the farthest depth of the nearest occluder face that covers
+// all of it, so a box whose nearest point is behind every tile it touches is hidden. A box
+// only counts as occluded when it is hidden from both eyes.
+class ovrCoarseOcclusionBuffer {
+   public:
+    static const int WIDTH = 64;
+    static const int HEIGHT = 32;
+    static const int NUM_VIEWS = 2;
+
+    // Clears the buffers for a new frame.
+    void Begin(const OVR::Matrix4f& leftViewProjMatrix, const OVR::Matrix4f& rightViewProjMatrix);
+    void AddOccluder(const OVR::Bounds3f& worldBounds);
+    bool IsOccluded(const OVR::Bounds3f& worldBounds) const;
+
+   private:
+    void RasterizeQuad(float* depth, const OVR::Vector4f clip[4]);
+    bool IsOccludedInView(const int view, const OVR::Bounds3f& worldBounds) const;
+
+    OVR::Matrix4f ViewProjMatrix[NUM_VIEWS];
+    float Depth[NUM_VIEWS][WIDTH * HEIGHT]; // clip w
+};
+
+// Leaves are the model nodes that have surfaces. The hierarchy is rebuilt when the set of
+// models, visible sub-scenes or node storage changes, and otherwise only refit: a leaf's
+// world bounds are recomputed when its node transform version moved, and a model whose
+// transform version did not move is skipped without looking at its nodes.
+//
+// Skinned nodes are not in the tree and are always returned, since their local bounds
+// are not updated for the animated pose.
+class ovrSceneBvh {
+   public:
+    static const int MAX_LEAF_NODES = 4;
+
+    // Rebuilds or refits for this frame's set of models. Null entries are not allowed.
+    void Update(const std::vector<ModelState*>& models, ovrSceneCullCounters& counters);
+
+    // Appends the model nodes that may be visible to visibleNodes. viewProjMatrix should
+    // cover both eyes. The occlusion buffer is optional.
+    void Cull(
+        const OVR::Matrix4f& viewProjMatrix,
+        const ovrCoarseOcclusionBuffer* occlusion,
+        std::vector<ModelNodeState*>& visibleNodes,
+        ovrSceneCullCounters& counters) const;
+
+   private:
+    struct ovrBvhLeaf {
+        ModelNodeState* NodeState;
+        OVR::Bounds3f WorldBounds;
+        uint32_t TransformVersion;
+        int NumSurfaces;
+    };
+
+    struct ovrBvhNode {
+        OVR::Bounds3f Bounds;
+        int Left; // index of the first child, the second follows it, -1 for a leaf
+        int First; // range in LeafOrder covered by this box
+        int Count;
+    };
+
+    struct ovrBvhModel {
+        ModelState* State;
+        uint32_t TransformVersion;
+        int FirstLeaf;
+        int NumLeaves;
+    };
+
+    void Rebuild(const std::vector<ModelState*>& models);
+    void BuildNode(const int nodeIndex, const int first, const int count);
+    void CullNode(
+        const int nodeIndex,
+        const OVR::Vector4f planes[6],
+        int planeMask,
+        const ovrCoarseOcclusionBuffer* occlusion,
+        std::vector<ModelNodeState*>& visibleNodes,
+        ovrSceneCullCounters& counters) const;
+
+    std::vector<uintptr_t> Signature;
+    std::vector<ovrBvhModel> BvhModels;
+    std::vector<ovrBvhLeaf> Leaves;
+    std::vector<int> LeafOrder;
+    std::vector<ovrBvhNode> Nodes;
+    std::vector<ModelNodeState*> AlwaysVisible;
+    int NumSurfaces = 0;
+};
+
+} // namespace OVRFW
@@ -28,6 +28,7 @@ Authors     :   John Carmack
 #include "SceneView.h"
 #include "ModelAnimationUtils.h"
 #include "ModelRender.h"
+#include "JobSystem.h"
 
 #include <algorithm>
 
@@ -401,8 +402,12 @@ void ModelInScene::AnimateJoints(const double timeInSeconds) {
                 ApplyAnimation(State, i);
             }
 
+            // RecalculateMatrix updates the children, so starting from the roots visits
+            // every node once.
             for (int i = 0; i < static_cast<int>(State.nodeStates.size()); i++) {
-                State.nodeStates[i].RecalculateMatrix();
+                if (State.nodeStates[i].GetNode()->parentIndex < 0) {
+                    State.nodeStates[i].RecalculateMatrix();
+                }
             }
         }
     }
@@ -412,6 +417,8 @@ void ModelInScene::AnimateJoints(const double timeInSeconds) {
 
 OvrSceneView::OvrSceneView()
     : FreeWorldModelOnChange(false),
+      HierarchicalCulling(true),
+      OcclusionCulling(false),
       LoadedPrograms(false),
       Paused(false),
       SuppressModelsWithClientId(-1),
@@ -439,6 +446,28 @@ ModelGlPrograms OvrSceneView::GetDefaultGLPrograms() {
     ModelGlPrograms programs;
 
     if (!LoadedPrograms) {
+        // Queue them all first, so any program cache compile threads work through the list
+        // while the programs are built one by one below.
+        const char* const programSources[][2] = {
+            {VertexColorVertexShaderSrc, VertexColorFragmentShaderSrc},
+            {SingleTextureVertexShaderSrc, SingleTextureFragmentShaderSrc},
+            {LightMappedVertexShaderSrc, LightMappedFragmentShaderSrc},
+            {ReflectionMappedVertexShaderSrc, ReflectionMappedFragmentShaderSrc},
+            {SimplePBRVertexShaderSrc, SimplePBRFragmentShaderSrc},
+            {SimplePBRVertexShaderSrc, BaseColorPBRFragmentShaderSrc},
+            {SimplePBRVertexShaderSrc, BaseColorEmissivePBRFragmentShaderSrc},
+            {VertexColorSkinned1VertexShaderSrc, VertexColorFragmentShaderSrc},
+            {SingleTextureSkinned1VertexShaderSrc, SingleTextureFragmentShaderSrc},
+            {LightMappedSkinned1VertexShaderSrc, LightMappedFragmentShaderSrc},
+            {ReflectionMappedSkinned1VertexShaderSrc, ReflectionMappedFragmentShaderSrc},
+            {SimplePBRSkinned1VertexShaderSrc, SimplePBRFragmentShaderSrc},
+            {SimplePBRSkinned1VertexShaderSrc, BaseColorPBRFragmentShaderSrc},
+            {SimplePBRSkinned1VertexShaderSrc, BaseColorEmissivePBRFragmentShaderSrc},
+        };
+        for (const auto& sources : programSources) {
+            OVRFW::GlProgram::Precompile(sources[0], sources[1]);
+        }
+
         ProgVertexColor = OVRFW::GlProgram::Build(
             VertexColorVertexShaderSrc, VertexColorFragmentShaderSrc, nullptr, 0);
 
@@ -817,29 +846,70 @@ void OvrSceneView::GenerateFrameSurfaceList(
         Matrix4f::Translation(0, 0, -moveBackDistance) * frameMatrices.CenterView;
 
     std::vector<ModelNodeState*> emitNodes;
-    for (int i = 0; i < static_cast<int>(Models.size()); i++) {
-        if (Models[i] != NULL) {
-            ModelState& state = Models[i]->State;
-            if (state.DontRenderForClientUid == SuppressModelsWithClientId) {
-                continue;
+    if (HierarchicalCulling) {
+        CullCounters = ovrSceneCullCounters();
+
+        std::vector<ModelState*> models;
+        for (int i = 0; i < static_cast<int>(Models.size()); i++) {
+            if (Models[i] != NULL &&
+                Models[i]->State.DontRenderForClientUid != SuppressModelsWithClientId) {
+                models.push_back(&Models[i]->State);
             }
-            for (int j = 0; j < static_cast<int>(state.subSceneStates.size()); j++) {
-                ModelSubSceneState& subSceneState = state.subSceneStates[j];
-                if (subSceneState.visible) {
-                    for (int k = 0; k < static_cast<int>(subSceneState.nodeStates.size()); k++) {
-                        state.nodeStates[subSceneState.nodeStates[k]].AddNodesToEmitList(emitNodes);
+        }
+        SceneBvh.Update(models, CullCounters);
+
+        const ovrCoarseOcclusionBuffer* occlusion = nullptr;
+        if (OcclusionCulling && !Occluders.empty()) {
+            OcclusionBuffer.Begin(
+                frameMatrices.EyeProjection[0] * frameMatrices.EyeView[0],
+                frameMatrices.EyeProjection[1] * frameMatrices.EyeView[1]);
+            for (const Bounds3f& occluder : Occluders) {
+                OcclusionBuffer.AddOccluder(occluder);
+            }
+            occlusion = &OcclusionBuffer;
+            CullCounters.numOccluders = static_cast<int>(Occluders.size());
+        }
+
+        SceneBvh.Cull(
+            symmetricEyeProjectionMatrix * centerEyeCullViewMatrix,
+            occlusion,
+            emitNodes,
+            CullCounters);
+    } else {
+        for (int i = 0; i < static_cast<int>(Models.size()); i++) {
+            if (Models[i] != NULL) {
+                ModelState& state = Models[i]->State;
+                if (state.DontRenderForClientUid == SuppressModelsWithClientId) {
+                    continue;
+                }
+                for (int j = 0; j < static_cast<int>(state.subSceneStates.size()); j++) {
+                    ModelSubSceneState& subSceneState = state.subSceneStates[j];
+                    if (subSceneState.visible) {
+                        for (int k = 0; k < static_cast<int>(subSceneState.nodeStates.size());
+                             k++) {
+                            state.nodeStates[subSceneState.nodeStates[k]].AddNodesToEmitList(
+                                emitNodes);
+                        }
                     }
                 }
             }
         }
     }
 
+    ovrModelLodCounters lodCounters;
     BuildModelSurfaceList(
         surfaceList,
         emitNodes,
         EmitSurfaces,
         centerEyeCullViewMatrix,
-        symmetricEyeProjectionMatrix);
+        symmetricEyeProjectionMatrix,
+        &lodCounters);
+
+    if (HierarchicalCulling) {
+        CullCounters.numSurfacesDrawn = static_cast<int>(surfaceList.size());
+        CullCounters.numTrianglesFullDetail = lodCounters.numTrianglesFullDetail;
+        CullCounters.numTrianglesDrawn = lodCounters.numTrianglesDrawn;
+    }
 }
 
 void OvrSceneView::SetFootPos(const Vector3f& pos, bool updateCenterEye /*= true*/) {
@@ -1087,10 +1157,20 @@ void OvrSceneView::Frame(
     //
 
     if (!Paused) {
-        for (int i = 0; i < static_cast<int>(Models.size()); i++) {
-            if (Models[i] != NULL) {
-                Models[i]->AnimateJoints(vrFrame.PredictedDisplayTime);
+        // Models only write their own state, so they can be animated in parallel.
+        auto animateModels = [&](const int /*batch*/, const int begin, const int end) {
+            for (int i = begin; i < end; i++) {
+                if (Models[i] != NULL) {
+                    Models[i]->AnimateJoints(vrFrame.PredictedDisplayTime);
+                }
             }
+        };
+        const int numModels = static_cast<int>(Models.size());
+        ovrJobSystem* jobSystem = GetJobSystem();
+        if (jobSystem != nullptr) {
+            jobSystem->ParallelFor(numModels, 1, animateModels);
+        } else {
+            animateModels(0, 0, numModels);
         }
     }
 
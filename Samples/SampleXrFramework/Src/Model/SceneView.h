@@ -29,6 +29,7 @@ Authors     :   John Carmack
 
 #include "FrameParams.h"
 #include "ModelFile.h"
+#include "SceneCulling.h"
 
 namespace OVRFW {
 
@@ -112,6 +113,36 @@ class OvrSceneView {
         return EmitSurfaces;
     }
 
+    // Model nodes are culled through a bounding volume hierarchy over their world bounds
+    // before the per-surface cull. On by default.
+    void SetHierarchicalCulling(const bool enable) {
+        HierarchicalCulling = enable;
+    }
+    bool GetHierarchicalCulling() const {
+        return HierarchicalCulling;
+    }
+
+    // Hides hierarchy boxes that are behind the occluders from both eyes. Occluders are
+    // world space boxes that must be completely solid, like walls or buildings, and stay
+    // until cleared. Only used with hierarchical culling. Off by default.
+    void SetOcclusionCulling(const bool enable) {
+        OcclusionCulling = enable;
+    }
+    bool GetOcclusionCulling() const {
+        return OcclusionCulling;
+    }
+    void AddOccluder(const OVR::Bounds3f& worldBounds) {
+        Occluders.push_back(worldBounds);
+    }
+    void ClearOccluders() {
+        Occluders.clear();
+    }
+
+    // Filled in by the last GenerateFrameSurfaceList with hierarchical culling.
+    const ovrSceneCullCounters& GetCullCounters() const {
+        return CullCounters;
+    }
+
     float GetEyeYaw() const {
         return EyeYaw;
     }
@@ -199,6 +230,14 @@ class OvrSceneView {
     // Externally generated surfaces
     std::vector<ovrDrawSurface> EmitSurfaces;
 
+    bool HierarchicalCulling;
+    bool OcclusionCulling;
+    std::vector<OVR::Bounds3f> Occluders;
+    // Updated by GenerateFrameSurfaceList
+    mutable ovrSceneBvh SceneBvh;
+    mutable ovrCoarseOcclusionBuffer OcclusionBuffer;
+    mutable ovrSceneCullCounters CullCounters;
+
     GlProgram ProgVertexColor;
     GlProgram ProgSingleTexture;
     GlProgram ProgLightMapped;
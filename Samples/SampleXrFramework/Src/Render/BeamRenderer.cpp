@@ -27,6 +27,7 @@ Authors     :   Jonathan E. Wright
 
 #include "BeamRenderer.h"
 #include "TextureAtlas.h"
+#include "GlStreamBuffer.h"
 
 #include "Misc/Log.h"
 
@@ -96,7 +97,7 @@ float ovrBeamRenderer::LIFETIME_INFINITE = FLT_MAX;
 
 //==============================
 // ovrBeamRenderer::ovrBeamRenderer
-ovrBeamRenderer::ovrBeamRenderer() : MaxBeams(0) {}
+ovrBeamRenderer::ovrBeamRenderer() : MaxBeams(0), NumIndices(0) {}
 
 //==============================
 // ovrBeamRenderer::ovrBeamRenderer
@@ -111,7 +112,7 @@ void ovrBeamRenderer::Init(const int maxBeams, const bool depthTest) {
 
     MaxBeams = maxBeams;
 
-    if (TextureProgram.VertexShader == 0 || TextureProgram.FragmentShader == 0) {
+    if (!TextureProgram.IsValid()) {
         OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             /// Fragment
@@ -121,7 +122,7 @@ void ovrBeamRenderer::Init(const int maxBeams, const bool depthTest) {
         TextureProgram =
             OVRFW::GlProgram::Build(BeamVertexSrc, TextureFragmentSrc, uniformParms, uniformCount);
     }
-    if (ParametricProgram.VertexShader == 0 || ParametricProgram.FragmentShader == 0) {
+    if (!ParametricProgram.IsValid()) {
         ParametricProgram =
             OVRFW::GlProgram::Build(BeamVertexSrc, ParametricFragmentSrc, nullptr, 0);
     }
@@ -159,6 +160,7 @@ void ovrBeamRenderer::Init(const int maxBeams, const bool depthTest) {
     gc.GpuState.blendDst = ovrGpuState::kGL_ONE;
     gc.Program = TextureProgram;
     gc.GpuState.lineWidth = 1.0f;
+    NumIndices = 0;
 }
 
 //==============================
@@ -172,6 +174,7 @@ void ovrBeamRenderer::Shutdown() {
     FreeBeams.resize(0);
     ActiveBeams.resize(0);
     BeamInfos.resize(0);
+    NumIndices = 0;
 }
 
 //==============================
@@ -343,16 +346,6 @@ void ovrBeamRenderer::FrameInternal(
     const OVRFW::ovrApplFrameIn& frame,
     const OVR::Matrix4f& centerViewMatrix,
     const class ovrTextureAtlas* atlas) {
-    /// we
-    if (atlas) {
-        Surf.geo.indexCount = 0;
-        Surf.graphicsCommand.Textures[0] = atlas->GetTexture();
-        Surf.graphicsCommand.BindUniformTextures();
-        Surf.graphicsCommand.Program = TextureProgram;
-    } else {
-        Surf.graphicsCommand.Program = ParametricProgram;
-    }
-
     VertexAttribs attr;
     attr.position.resize(ActiveBeams.size() * 4);
     attr.color.resize(ActiveBeams.size() * 4);
@@ -410,10 +403,25 @@ void ovrBeamRenderer::FrameInternal(
         quadIndex++;
     }
 
-    // Surf.graphicsCommand.GpuState.polygonMode = GL_LINE;
-    Surf.graphicsCommand.GpuState.cullEnable = false;
-    Surf.geo.indexCount = quadIndex * 6;
-    Surf.geo.Update(attr);
+    // The surface may still be drawn for an earlier frame, so it only changes along with the
+    // upload, on the thread that has the GL context.
+    NumIndices = quadIndex * 6;
+    const bool useAtlas = atlas != nullptr;
+    const GlTexture atlasTexture = useAtlas ? atlas->GetTexture() : GlTexture();
+    RunFrameGlTask(
+        [this, attr = std::move(attr), useAtlas, atlasTexture, numIndices = NumIndices]() {
+            if (useAtlas) {
+                Surf.graphicsCommand.Textures[0] = atlasTexture;
+                Surf.graphicsCommand.BindUniformTextures();
+                Surf.graphicsCommand.Program = TextureProgram;
+            } else {
+                Surf.graphicsCommand.Program = ParametricProgram;
+            }
+            // Surf.graphicsCommand.GpuState.polygonMode = GL_LINE;
+            Surf.graphicsCommand.GpuState.cullEnable = false;
+            Surf.geo.indexCount = numIndices;
+            Surf.geo.UpdateStreamed(attr);
+        });
 }
 
 //==============================
@@ -422,13 +430,13 @@ void ovrBeamRenderer::RenderEyeView(
     const Matrix4f& /*viewMatrix*/,
     const Matrix4f& /*projMatrix*/,
     std::vector<ovrDrawSurface>& surfaceList) {
-    if (Surf.geo.indexCount > 0) {
+    if (NumIndices > 0) {
         surfaceList.push_back(ovrDrawSurface(ModelMatrix, &Surf));
     }
 }
 
 void ovrBeamRenderer::Render(std::vector<ovrDrawSurface>& surfaceList) {
-    if (Surf.geo.indexCount > 0) {
+    if (NumIndices > 0) {
         surfaceList.push_back(ovrDrawSurface(ModelMatrix, &Surf));
     }
 }
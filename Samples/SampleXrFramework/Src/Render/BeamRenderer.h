@@ -57,6 +57,7 @@ class ovrBeamRenderer {
     void Init(const int maxBeams, const bool depthTest);
     void Shutdown();
 
+    // Call every frame the beams are rendered, the vertices are streamed.
     void Frame(
         const OVRFW::ovrApplFrameIn& frame,
         const OVR::Matrix4f& centerViewMatrix,
@@ -165,6 +166,7 @@ class ovrBeamRenderer {
     GlProgram TextureProgram;
     GlProgram ParametricProgram;
     OVR::Matrix4f ModelMatrix;
+    int NumIndices; // as of the last Frame(), the surface only gets it with the upload
 };
 
 } // namespace OVRFW
@@ -112,7 +112,7 @@ void ovrBillBoardRenderer::Init(const int maxBillBoards, const bool depthTest) {
 
     MaxBillBoards = maxBillBoards;
 
-    if (TextureProgram.VertexShader == 0 || TextureProgram.FragmentShader == 0) {
+    if (!TextureProgram.IsValid()) {
         OVRFW::ovrProgramParm uniformParms[] = {
             /// Vertex
             /// Fragment
@@ -122,7 +122,7 @@ void ovrBillBoardRenderer::Init(const int maxBillBoards, const bool depthTest) {
         TextureProgram = OVRFW::GlProgram::Build(
             BillBoardVertexSrc, TextureFragmentSrc, uniformParms, uniformCount);
     }
-    if (ParametricProgram.VertexShader == 0 || ParametricProgram.FragmentShader == 0) {
+    if (!ParametricProgram.IsValid()) {
         ParametricProgram =
             OVRFW::GlProgram::Build(BillBoardVertexSrc, ParametricFragmentSrc, nullptr, 0);
     }
@@ -34,6 +34,8 @@ Authors     :   Jonathan E. Wright
 #include "BitmapFont.h"
 
 #include <algorithm>
+#include <memory>
+#include <unordered_map>
 
 #include <errno.h>
 #include <math.h>
@@ -49,7 +51,11 @@ Authors     :   Jonathan E. Wright
 #include "GlProgram.h"
 #include "GlTexture.h"
 #include "GlGeometry.h"
+#include "GlStreamBuffer.h"
+#include "GlyphRasterizer.h"
+#include "DynamicTextureAtlas.h"
 
+#include "JobSystem.h"
 #include "PackageFiles.h"
 #include "OVR_FileSys.h"
 #include "OVR_Uri.h"
@@ -298,6 +304,10 @@ class FontInfoType {
     FontGlyphType const& GlyphForCharCode(uint32_t const charCode) const;
     ovrFontWeight GetFontWeight(int const index) const;
 
+    // Sets ScaleFactorX and ScaleFactorY from the size of the 'O' glyph in image pixels, so all
+    // fonts draw their 'O' at the same size.
+    void CalcScaleFactors(double const oWidth, double const oHeight);
+
     std::string FontName; // name of the font (not necessarily the file name)
     std::string CommandLine; // command line used to generate this font
     std::string ImageFileName; // the file name of the font image
@@ -331,16 +341,69 @@ const int FontInfoType::FNT_FILE_VERSION =
 // TweakScale for manual adjustment of other-language fonts
 const float FontInfoType::DEFAULT_SCALE_FACTOR = 512.0f;
 
+// The glyphs of a font loaded from a TrueType or OpenType file. A glyph goes into the font info
+// with its final metrics the first time it's looked up, so text lays out right away, and is
+// rendered on the rasterizer's worker thread. Until Update() packs it into the page it draws from
+// a blank area reserved at the page origin, so text fills in a frame or two later instead of
+// stalling. There is a single page; glyphs that no longer fit stay blank.
+class ovrTrueTypeGlyphs {
+   public:
+    static const int PAGE_SIZE = 2048;
+    static const int PIXEL_HEIGHT = 48;
+    static const int PADDING = 6;
+    // FontInfo.Glyphs is reserved to this, so references to glyphs stay valid as more are added.
+    static const int MAX_GLYPHS = 4096;
+    // CharCodeMap value for characters the font doesn't have, so it's only asked once
+    static const int32_t MISSING_GLYPH = -2;
+
+    explicit ovrTrueTypeGlyphs(FontInfoType& fontInfo)
+        : FontInfo(fontInfo), Generation(0), PageFull(false) {}
+
+    // Takes over the font file and creates the page texture.
+    bool Init(std::vector<uint8_t>& fontData, char const* name, GlTexture& texture);
+
+    void AddGlyph(uint32_t const charCode);
+    void AddText(char const* text);
+    // Uploads the glyphs the worker thread finished. With waitForAll the glyphs still pending are
+    // rendered on the calling thread first, for text that is laid out only once.
+    void Update(bool const waitForAll);
+
+    // Changes whenever glyphs are uploaded, which invalidates text laid out before.
+    int GetGeneration() const {
+        return Generation;
+    }
+
+   private:
+    void Upload(ovrGlyphBitmap const& bitmap);
+
+    FontInfoType& FontInfo;
+    ovrGlyphRasterizer Rasterizer;
+    ovrSkylinePacker Packer;
+    GlTexture Texture;
+    std::vector<uint8_t> Ready; // by glyph index
+    std::vector<int> Pending; // glyph indices queued on the worker thread
+    std::vector<ovrGlyphBitmap> Finished;
+    int Generation;
+    bool PageFull;
+};
+
 class BitmapFontLocal : public BitmapFont {
    public:
     BitmapFontLocal() : FontTexture(), ImageWidth(0), ImageHeight(0) {}
     ~BitmapFontLocal() {
+        TrueTypeGlyphs.reset();
         FreeTexture(FontTexture);
         GlProgram::Free(FontProgram);
     }
 
     virtual bool Load(ovrFileSys& fileSys, const char* uri);
 
+    virtual void UpdateGlyphs() {
+        if (TrueTypeGlyphs != nullptr) {
+            TrueTypeGlyphs->Update(false);
+        }
+    }
+
     // Calculates the native (unscaled) width of the text string. Line endings are ignored.
     virtual float CalcTextWidth(char const* text) const;
 
@@ -392,8 +455,14 @@ class BitmapFontLocal : public BitmapFont {
         fontParms_t const* fontParms = nullptr) const;
 
     FontGlyphType const& GlyphForCharCode(uint32_t const charCode) const {
+        if (TrueTypeGlyphs != nullptr) {
+            TrueTypeGlyphs->AddGlyph(charCode);
+        }
         return FontInfo.GlyphForCharCode(charCode);
     }
+    int GetGlyphGeneration() const {
+        return TrueTypeGlyphs != nullptr ? TrueTypeGlyphs->GetGeneration() : 0;
+    }
     virtual Vector2f GetScaleFactor() const {
         return Vector2f(FontInfo.ScaleFactorX, FontInfo.ScaleFactorY);
     }
@@ -428,7 +497,11 @@ class BitmapFontLocal : public BitmapFont {
 
     GlProgram FontProgram;
 
+    std::unique_ptr<ovrTrueTypeGlyphs> TrueTypeGlyphs;
+
    private:
+    bool LoadTrueType(ovrFileSys& fileSys, char const* uri);
+    void BuildFontProgram();
     bool LoadImage(ovrFileSys& fileSys, char const* uri);
     bool LoadImageFromBuffer(
         char const* imageName,
@@ -559,26 +632,33 @@ static bool CheckForFormatEscape(char const** buffer, uint32_t& color, uint32_t&
 // The vertices in a vertex block are in local space and pre-scaled.  They are transformed into
 // world space and stuffed into the VBO before rendering (once the current MVP is known).
 // The vertices can be pivoted around the Pivot point to face the camera, then an additional
-// rotation applied.
+// rotation applied. Blocks drawn from the layout cache don't own their vertices, and may
+// replace the vertex colors with a single color.
 class VertexBlockType {
    public:
     VertexBlockType()
         : Font(NULL),
           Verts(NULL),
           NumVerts(0),
+          OwnsVerts(true),
           Pivot(0.0f),
           Rotation(),
           Billboard(true),
-          TrackRoll(false) {}
+          TrackRoll(false),
+          OverrideColor(false),
+          Color(0) {}
 
     VertexBlockType(VertexBlockType const& other)
         : Font(NULL),
           Verts(NULL),
           NumVerts(0),
+          OwnsVerts(true),
           Pivot(0.0f),
           Rotation(),
           Billboard(true),
-          TrackRoll(false) {
+          TrackRoll(false),
+          OverrideColor(false),
+          Color(0) {
         Copy(other);
     }
 
@@ -591,18 +671,24 @@ class VertexBlockType {
         if (&other == this) {
             return;
         }
-        delete[] Verts;
+        if (OwnsVerts) {
+            delete[] Verts;
+        }
         Font = other.Font;
         Verts = other.Verts;
         NumVerts = other.NumVerts;
+        OwnsVerts = other.OwnsVerts;
         Pivot = other.Pivot;
         Rotation = other.Rotation;
         Billboard = other.Billboard;
         TrackRoll = other.TrackRoll;
+        OverrideColor = other.OverrideColor;
+        Color = other.Color;
 
         other.Font = NULL;
         other.Verts = NULL;
         other.NumVerts = 0;
+        other.OwnsVerts = true;
     }
 
     VertexBlockType(
@@ -614,31 +700,59 @@ class VertexBlockType {
         bool const trackRoll)
         : Font(&font),
           NumVerts(numVerts),
+          OwnsVerts(true),
           Pivot(pivot),
           Rotation(rot),
           Billboard(billboard),
-          TrackRoll(trackRoll) {
+          TrackRoll(trackRoll),
+          OverrideColor(false),
+          Color(0) {
         Verts = new fontVertex_t[numVerts];
     }
 
+    // a block drawing vertices that stay owned by the caller
+    VertexBlockType(
+        BitmapFont const& font,
+        fontVertex_t* verts,
+        int const numVerts,
+        Vector3f const& pivot,
+        bool const billboard,
+        bool const trackRoll)
+        : Font(&font),
+          Verts(verts),
+          NumVerts(numVerts),
+          OwnsVerts(false),
+          Pivot(pivot),
+          Rotation(),
+          Billboard(billboard),
+          TrackRoll(trackRoll),
+          OverrideColor(false),
+          Color(0) {}
+
     ~VertexBlockType() {
         Free();
     }
 
     void Free() {
         Font = NULL;
-        delete[] Verts;
+        if (OwnsVerts) {
+            delete[] Verts;
+        }
         Verts = NULL;
         NumVerts = 0;
+        OwnsVerts = true;
     }
 
     mutable BitmapFont const* Font; // the font used to render text into this vertex block
     mutable fontVertex_t* Verts; // the vertices
     mutable int NumVerts; // the number of vertices in the block
+    mutable bool OwnsVerts; // false when Verts belong to the layout cache
     Vector3f Pivot; // postion this vertex block can be rotated around
     Quatf Rotation; // additional rotation to apply
     bool Billboard; // true to always face the camera
     bool TrackRoll; // if true, when billboarded, roll with the camera
+    bool OverrideColor; // if true, every vertex gets Color instead of its own
+    std::uint32_t Color; // ABGR
 };
 
 // Sets up VB and VAO for font drawing
@@ -1011,6 +1125,11 @@ ovrSurfaceDef BitmapFontLocal::TextSurface(
         fp.AlignHoriz = hjust;
         fp.AlignVert = vjust;
     }
+    // the surface is kept until the text changes, so it can't wait for pending glyphs
+    if (TrueTypeGlyphs != nullptr && text != nullptr) {
+        TrueTypeGlyphs->AddText(text);
+        TrueTypeGlyphs->Update(true);
+    }
     VertexBlockType vb = DrawTextToVertexBlock(
         *this,
         fp,
@@ -1114,10 +1233,32 @@ class BitmapFontSurfaceLocal : public BitmapFontSurface {
 
     virtual void SetCullEnabled(const bool enabled);
 
+    virtual void SetLayoutCacheEnabled(const bool enabled) {
+        LayoutCacheEnabled = enabled;
+    }
+    virtual fontLayoutCacheStats_t GetLayoutCacheStats() const {
+        return LayoutCacheStats;
+    }
+
    private:
     // This limitation may not exist anymore now that ModelMatrix is no longer a member.
     BitmapFontSurfaceLocal& operator=(BitmapFontSurfaceLocal const& rhs);
 
+    // Glyph quads of a string in the local space of its vertex block.
+    struct ovrTextLayout {
+        std::vector<fontVertex_t> Verts;
+        Vector3f ToNextLine;
+        std::uint32_t Color; // ABGR the layout was built with
+        bool HasColorEscapes; // some quads aren't in Color, so it can't be recolored
+        int64_t LastUsedFrame;
+    };
+
+    // layouts not drawn for this many frames are dropped
+    static const int LAYOUT_CACHE_FRAMES = 8;
+    static const int MAX_CACHED_LAYOUTS = 256;
+
+    void UpdateLayoutCache();
+
     mutable ovrSurfaceDef FontSurfaceDef;
 
     fontVertex_t* Vertices; // vertices that are written to the VBO. Fixed size to not overflow VBO
@@ -1129,6 +1270,15 @@ class BitmapFontSurfaceLocal : public BitmapFontSurface {
 
     std::vector<VertexBlockType>
         VertexBlocks; // each pointer in the array points to an allocated block ov
+
+    // Keyed by the bytes of the font pointer, parms, normal, up and scale followed by the
+    // text. Node based, so entries don't move while vertex blocks point at them.
+    std::unordered_map<std::string, ovrTextLayout> LayoutCache;
+    std::string LayoutKey; // scratch
+    int64_t FrameIndex;
+    bool LayoutCacheEnabled;
+    fontLayoutCacheStats_t FrameLayoutStats; // counting for the current frame
+    fontLayoutCacheStats_t LayoutCacheStats; // the last finished frame
 };
 
 //==================================================================================================
@@ -1319,20 +1469,7 @@ bool FontInfoType::LoadFromBuffer(void const* buffer, size_t const bufferSize) {
     ALOG("jsonGlyphArray DONE maxCharCode =%d", maxCharCode);
 #endif
 
-    float const DEFAULT_TEXT_SCALE = 0.0025f;
-
-    double const NATURAL_WIDTH_SCALE = NaturalWidth / 4096.0;
-    double const NATURAL_HEIGHT_SCALE = NaturalHeight / 3820.0;
-    double const DEFAULT_O_WIDTH = 325.0;
-    double const DEFAULT_O_HEIGHT = 322.0;
-    double const OLD_WIDTH_FACTOR = 1.04240608;
-    float const widthScaleFactor =
-        static_cast<float>(DEFAULT_O_WIDTH / oWidth * OLD_WIDTH_FACTOR * NATURAL_WIDTH_SCALE);
-    float const heightScaleFactor =
-        static_cast<float>(DEFAULT_O_HEIGHT / oHeight * OLD_WIDTH_FACTOR * NATURAL_HEIGHT_SCALE);
-
-    ScaleFactorX = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * widthScaleFactor * TweakScale;
-    ScaleFactorY = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * heightScaleFactor * TweakScale;
+    CalcScaleFactors(oWidth, oHeight);
 
     // This is not intended for wide or ucf character sets -- depending on the size range of
     // character codes lookups may need to be changed to use a hash.
@@ -1356,6 +1493,25 @@ bool FontInfoType::LoadFromBuffer(void const* buffer, size_t const bufferSize) {
     return true;
 }
 
+//==============================
+// FontInfoType::CalcScaleFactors
+void FontInfoType::CalcScaleFactors(double const oWidth, double const oHeight) {
+    float const DEFAULT_TEXT_SCALE = 0.0025f;
+
+    double const NATURAL_WIDTH_SCALE = NaturalWidth / 4096.0;
+    double const NATURAL_HEIGHT_SCALE = NaturalHeight / 3820.0;
+    double const DEFAULT_O_WIDTH = 325.0;
+    double const DEFAULT_O_HEIGHT = 322.0;
+    double const OLD_WIDTH_FACTOR = 1.04240608;
+    float const widthScaleFactor =
+        static_cast<float>(DEFAULT_O_WIDTH / oWidth * OLD_WIDTH_FACTOR * NATURAL_WIDTH_SCALE);
+    float const heightScaleFactor =
+        static_cast<float>(DEFAULT_O_HEIGHT / oHeight * OLD_WIDTH_FACTOR * NATURAL_HEIGHT_SCALE);
+
+    ScaleFactorX = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * widthScaleFactor * TweakScale;
+    ScaleFactorY = DEFAULT_SCALE_FACTOR * DEFAULT_TEXT_SCALE * heightScaleFactor * TweakScale;
+}
+
 class ovrGlyphSort {
    public:
     void SortGlyphIndicesByCharacterCode(
@@ -1507,6 +1663,200 @@ FontGlyphType const& FontInfoType::GlyphForCharCode(uint32_t const charCode) con
     return Glyphs[glyphIndex];
 }
 
+//==================================================================================================
+// ovrTrueTypeGlyphs
+//==================================================================================================
+
+//==============================
+// ovrTrueTypeGlyphs::Init
+bool ovrTrueTypeGlyphs::Init(std::vector<uint8_t>& fontData, char const* name, GlTexture& texture) {
+    if (!Rasterizer.Init(fontData, static_cast<float>(PIXEL_HEIGHT), PADDING)) {
+        return false;
+    }
+
+    // all metrics are in page units, as they are in image units for pre-baked fonts
+    float const scale = 1.0f / PAGE_SIZE;
+    float ascent;
+    float descent;
+    float lineGap;
+    Rasterizer.GetLineMetrics(ascent, descent, lineGap);
+
+    FontInfo.FontName = name;
+    FontInfo.NaturalWidth = static_cast<float>(PAGE_SIZE);
+    FontInfo.NaturalHeight = static_cast<float>(PAGE_SIZE);
+    FontInfo.HorizontalPad = PADDING * scale;
+    FontInfo.VerticalPad = PADDING * scale;
+    FontInfo.FontHeight = (ascent - descent + lineGap) * scale;
+    FontInfo.MaxAscent = (ascent + PADDING) * scale;
+    FontInfo.MaxDescent = (PADDING - descent) * scale;
+    FontInfo.Glyphs.reserve(MAX_GLYPHS);
+    // the first unicode plane, as for pre-baked fonts
+    FontInfo.CharCodeMap.assign(0x10000, -1);
+
+    std::vector<uint8_t> clear(static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE, 0);
+    GLuint texId;
+    glGenTextures(1, &texId);
+    glBindTexture(GL_TEXTURE_2D, texId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_R8, PAGE_SIZE, PAGE_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, clear.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Texture = GlTexture(texId, GL_TEXTURE_2D, PAGE_SIZE, PAGE_SIZE);
+    texture = Texture;
+
+    // the blank area pending glyphs draw from, large enough for any of them
+    Packer.Init(PAGE_SIZE, PAGE_SIZE);
+    int blankWidth;
+    int blankHeight;
+    Rasterizer.GetMaxBitmapSize(blankWidth, blankHeight);
+    int x;
+    int y;
+    Packer.Pack(blankWidth, blankHeight, x, y);
+    OVR_ASSERT(x == 0 && y == 0);
+
+    // the 'O' sets the scale as it does for pre-baked fonts; fonts without one use the em
+    ovrGlyphMetrics o;
+    Rasterizer.GetMetrics('O', o);
+    if (o.Width == 0 || o.Height == 0) {
+        o.Width = PIXEL_HEIGHT;
+        o.Height = PIXEL_HEIGHT;
+    }
+    FontInfo.CalcScaleFactors(o.Width, o.Height);
+
+    // what FontInfoType::GlyphForCharCode() substitutes for missing characters
+    static const uint32_t fallbacks[] = {'*', '\"', '-', 0xFFFD, 0x25C6, 0xFFED};
+    for (uint32_t const charCode : fallbacks) {
+        AddGlyph(charCode);
+    }
+    return true;
+}
+
+//==============================
+// ovrTrueTypeGlyphs::AddGlyph
+void ovrTrueTypeGlyphs::AddGlyph(uint32_t const charCode) {
+    if (charCode >= FontInfo.CharCodeMap.size() || FontInfo.CharCodeMap[charCode] != -1) {
+        return;
+    }
+    if (static_cast<int>(FontInfo.Glyphs.size()) >= MAX_GLYPHS || !Rasterizer.HasGlyph(charCode)) {
+        FontInfo.CharCodeMap[charCode] = MISSING_GLYPH;
+        return;
+    }
+
+    ovrGlyphMetrics metrics;
+    Rasterizer.GetMetrics(charCode, metrics);
+
+    float const scale = 1.0f / PAGE_SIZE;
+    FontGlyphType g;
+    g.CharCode = static_cast<int32_t>(charCode);
+    g.Width = metrics.Width * scale;
+    g.Height = metrics.Height * scale;
+    g.AdvanceX = metrics.AdvanceX * scale;
+    g.AdvanceY = FontInfo.FontHeight;
+    g.BearingX = metrics.BearingX * scale;
+    g.BearingY = metrics.BearingY * scale;
+    FontInfo.MaxAscent = std::max(FontInfo.MaxAscent, g.BearingY);
+    FontInfo.MaxDescent = std::max(FontInfo.MaxDescent, g.Height - g.BearingY);
+
+    int const index = static_cast<int>(FontInfo.Glyphs.size());
+    FontInfo.Glyphs.push_back(g);
+    FontInfo.CharCodeMap[charCode] = index;
+
+    // glyphs without an outline, like spaces, have nothing to render
+    bool const hasBitmap = metrics.Width > 0 && metrics.Height > 0;
+    Ready.push_back(hasBitmap ? 0 : 1);
+    if (hasBitmap) {
+        Pending.push_back(index);
+        Rasterizer.Request(charCode);
+    }
+}
+
+//==============================
+// ovrTrueTypeGlyphs::AddText
+void ovrTrueTypeGlyphs::AddText(char const* text) {
+    char const* p = text;
+    for (uint32_t charCode = UTF8Util::DecodeNextChar(&p); charCode != '\0';
+         charCode = UTF8Util::DecodeNextChar(&p)) {
+        AddGlyph(charCode);
+    }
+}
+
+//==============================
+// ovrTrueTypeGlyphs::Update
+void ovrTrueTypeGlyphs::Update(bool const waitForAll) {
+    // glyphs rendered here while the worker thread had them queued too come back later
+    Rasterizer.GetFinished(Finished);
+    for (ovrGlyphBitmap const& bitmap : Finished) {
+        Upload(bitmap);
+    }
+    Finished.clear();
+
+    if (waitForAll) {
+        ovrGlyphBitmap bitmap;
+        for (int const index : Pending) {
+            if (!Ready[index]) {
+                Rasterizer.Rasterize(FontInfo.Glyphs[index].CharCode, bitmap);
+                Upload(bitmap);
+            }
+        }
+    }
+    Pending.erase(
+        std::remove_if(
+            Pending.begin(), Pending.end(), [this](int const index) { return Ready[index] != 0; }),
+        Pending.end());
+}
+
+//==============================
+// ovrTrueTypeGlyphs::Upload
+void ovrTrueTypeGlyphs::Upload(ovrGlyphBitmap const& bitmap) {
+    int const index = FontInfo.CharCodeMap[bitmap.CharCode];
+    if (index < 0 || Ready[index]) {
+        return;
+    }
+    Ready[index] = 1;
+    if (bitmap.Width <= 0 || bitmap.Height <= 0) {
+        return;
+    }
+
+    // a texel between glyphs keeps them out of each other's bilinear footprint
+    int x;
+    int y;
+    if (!Packer.Pack(bitmap.Width + 1, bitmap.Height + 1, x, y)) {
+        if (!PageFull) {
+            ALOGW("ovrTrueTypeGlyphs: '%s' glyph page is full", FontInfo.FontName.c_str());
+            PageFull = true;
+        }
+        return;
+    }
+
+    RunFrameGlTask([texture = Texture.texture, x, y, bitmap]() {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(
+            GL_TEXTURE_2D,
+            0,
+            x,
+            y,
+            bitmap.Width,
+            bitmap.Height,
+            GL_RED,
+            GL_UNSIGNED_BYTE,
+            bitmap.Pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    });
+
+    float const scale = 1.0f / PAGE_SIZE;
+    FontGlyphType& g = FontInfo.Glyphs[index];
+    g.X = x * scale;
+    g.Y = y * scale;
+    Generation++;
+}
+
 //==================================================================================================
 // BitmapFontLocal
 //==================================================================================================
@@ -1554,6 +1904,10 @@ bool BitmapFontLocal::Load(ovrFileSys& fileSys, char const* uri) {
         return false;
     }
 
+    if (ExtensionMatches(path, ".ttf") || ExtensionMatches(path, ".otf")) {
+        return LoadTrueType(fileSys, uri);
+    }
+
     if (!FontInfo.Load(fileSys, uri)) {
         ALOG("FontInfo.Load FAILED Uri = %s", uri);
         return false;
@@ -1581,8 +1935,45 @@ bool BitmapFontLocal::Load(ovrFileSys& fileSys, char const* uri) {
         return false;
     }
 
+    BuildFontProgram();
+
+#if defined(OVR_BUILD_DEBUG)
+    ALOG("BitmapFont for uri = %s load SUCCESS", uri);
+#endif
+
+    return true;
+}
+
+//==============================
+// BitmapFontLocal::LoadTrueType
+bool BitmapFontLocal::LoadTrueType(ovrFileSys& fileSys, char const* uri) {
+    std::vector<uint8_t> fontData;
+    if (!fileSys.ReadFile(uri, fontData)) {
+        ALOG("BitmapFontLocal::LoadTrueType: failed to read '%s'", uri);
+        return false;
+    }
+
+    TrueTypeGlyphs.reset();
+    DeleteTexture(FontTexture);
+    FontInfo = FontInfoType();
+    std::unique_ptr<ovrTrueTypeGlyphs> glyphs(new ovrTrueTypeGlyphs(FontInfo));
+    if (!glyphs->Init(fontData, ExtractFile(uri).c_str(), FontTexture)) {
+        ALOGW("BitmapFontLocal::LoadTrueType: failed to load '%s'", uri);
+        return false;
+    }
+    TrueTypeGlyphs = std::move(glyphs);
+    ImageWidth = ovrTrueTypeGlyphs::PAGE_SIZE;
+    ImageHeight = ovrTrueTypeGlyphs::PAGE_SIZE;
+
+    BuildFontProgram();
+    return true;
+}
+
+//==============================
+// BitmapFontLocal::BuildFontProgram
+void BitmapFontLocal::BuildFontProgram() {
     // create the shaders for font rendering if not already created
-    if (FontProgram.VertexShader == 0 || FontProgram.FragmentShader == 0) {
+    if (!FontProgram.IsValid()) {
         static ovrProgramParm fontUniformParms[] = {
             {"Texture0", ovrProgramParmType::TEXTURE_SAMPLED},
         };
@@ -1592,12 +1983,6 @@ bool BitmapFontLocal::Load(ovrFileSys& fileSys, char const* uri) {
             fontUniformParms,
             sizeof(fontUniformParms) / sizeof(ovrProgramParm));
     }
-
-#if defined(OVR_BUILD_DEBUG)
-    ALOG("BitmapFont for uri = %s load SUCCESS", uri);
-#endif
-
-    return true;
 }
 
 //==============================
@@ -2153,7 +2538,9 @@ BitmapFontSurfaceLocal::BitmapFontSurfaceLocal()
       MaxIndices(0),
       CurVertex(0),
       CurIndex(0),
-      Initialized(false) {}
+      Initialized(false),
+      FrameIndex(0),
+      LayoutCacheEnabled(true) {}
 
 //==============================
 // BitmapFontSurfaceLocal::~BitmapFontSurfaceLocal
@@ -2233,16 +2620,110 @@ Vector3f BitmapFontSurfaceLocal::DrawText3D(
     if (text == NULL || text[0] == '\0') {
         return Vector3f::ZERO; // nothing to do here, move along
     }
+
+    if (!LayoutCacheEnabled) {
+        Vector3f toNextLine;
+        VertexBlockType vb =
+            DrawTextToVertexBlock(font, parms, pos, normal, up, scale, color, text, &toNextLine);
+        VertexBlocks.push_back(vb);
+        return toNextLine;
+    }
+
+    // The layout doesn't depend on the position, which only becomes the block's pivot.
+    LayoutKey.clear();
+    auto appendKey = [this](void const* data, size_t const size) {
+        LayoutKey.append(static_cast<char const*>(data), size);
+    };
+    BitmapFont const* fontPtr = &font;
+    appendKey(&fontPtr, sizeof(fontPtr));
+    // glyphs of TrueType fonts move into place as they are rendered
+    int const glyphGeneration = AsLocal(font).GetGlyphGeneration();
+    appendKey(&glyphGeneration, sizeof(glyphGeneration));
+    appendKey(&parms.AlignHoriz, sizeof(parms.AlignHoriz));
+    appendKey(&parms.AlignVert, sizeof(parms.AlignVert));
+    appendKey(&parms.Billboard, sizeof(parms.Billboard));
+    appendKey(&parms.TrackRoll, sizeof(parms.TrackRoll));
+    appendKey(&parms.AlphaCenter, sizeof(parms.AlphaCenter));
+    appendKey(&parms.ColorCenter, sizeof(parms.ColorCenter));
+    appendKey(&normal, sizeof(normal));
+    appendKey(&up, sizeof(up));
+    appendKey(&scale, sizeof(scale));
+    LayoutKey.append(text);
+
+    std::uint32_t const abgr = static_cast<std::uint32_t>(ColorToABGR(color));
+    auto it = LayoutCache.find(LayoutKey);
+    if (it != LayoutCache.end() && (!it->second.HasColorEscapes || it->second.Color == abgr)) {
+        ovrTextLayout& layout = it->second;
+        layout.LastUsedFrame = FrameIndex;
+        FrameLayoutStats.Hits++;
+
+        VertexBlockType vb(
+            font,
+            layout.Verts.data(),
+            static_cast<int>(layout.Verts.size()),
+            pos,
+            parms.Billboard,
+            parms.TrackRoll);
+        if (!layout.HasColorEscapes && layout.Color != abgr) {
+            vb.OverrideColor = true;
+            vb.Color = abgr;
+        }
+        VertexBlocks.push_back(vb);
+        return layout.ToNextLine;
+    }
+    FrameLayoutStats.Misses++;
+
     Vector3f toNextLine;
     VertexBlockType vb =
         DrawTextToVertexBlock(font, parms, pos, normal, up, scale, color, text, &toNextLine);
 
+    // An entry already drawn this frame is still referenced by a vertex block, so it can only
+    // be replaced from the next frame on.
+    bool const canStore = (it == LayoutCache.end())
+        ? static_cast<int>(LayoutCache.size()) < MAX_CACHED_LAYOUTS
+        : it->second.LastUsedFrame != FrameIndex;
+    if (vb.NumVerts > 0 && canStore) {
+        ovrTextLayout& layout = (it == LayoutCache.end()) ? LayoutCache[LayoutKey] : it->second;
+        layout.Verts.assign(vb.Verts, vb.Verts + vb.NumVerts);
+        layout.ToNextLine = toNextLine;
+        layout.Color = abgr;
+        layout.HasColorEscapes = false;
+        for (fontVertex_t const& v : layout.Verts) {
+            if (*(std::uint32_t const*)(&v.rgba[0]) != abgr) {
+                layout.HasColorEscapes = true;
+                break;
+            }
+        }
+        layout.LastUsedFrame = FrameIndex;
+    }
+
     // add the new vertex block to the array of vertex blocks
     VertexBlocks.push_back(vb);
 
     return toNextLine;
 }
 
+//==============================
+// BitmapFontSurfaceLocal::UpdateLayoutCache
+// Ends the frame for the layout cache. No vertex block may point into it at this point.
+void BitmapFontSurfaceLocal::UpdateLayoutCache() {
+    FrameLayoutStats.NumLayouts = static_cast<int>(LayoutCache.size());
+    LayoutCacheStats = FrameLayoutStats;
+    FrameLayoutStats = fontLayoutCacheStats_t();
+
+    if (!LayoutCacheEnabled) {
+        LayoutCache.clear();
+    }
+    for (auto it = LayoutCache.begin(); it != LayoutCache.end();) {
+        if (FrameIndex - it->second.LastUsedFrame >= LAYOUT_CACHE_FRAMES) {
+            it = LayoutCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    FrameIndex++;
+}
+
 //==============================
 // BitmapFontSurfaceLocal::DrawText3Df
 Vector3f BitmapFontSurfaceLocal::DrawText3Df(
@@ -2327,8 +2808,6 @@ int VertexBlockSortFn(void const* a, void const* b) {
 void BitmapFontSurfaceLocal::Finish(Matrix4f const& viewMatrix) {
     // SPAM( "BitmapFontSurfaceLocal::Finish" );
 
-    FontSurfaceDef.geo.localBounds.Clear();
-
     Matrix4f invViewMatrix = viewMatrix.Inverted(); // if the view is never scaled or sheared we
                                                     // could use Transposed() here instead
     Vector3f viewPos = invViewMatrix.GetTranslation();
@@ -2346,78 +2825,125 @@ void BitmapFontSurfaceLocal::Finish(Matrix4f const& viewMatrix) {
 
     qsort(vbSort, n, sizeof(vbSort[0]), VertexBlockSortFn);
 
-    // transform the vertex blocks into the vertices array
+    // Lay the blocks out in sorted order first, so the vertices can then be transformed in
+    // parallel. Billboards too close to the view to orient are dropped here.
     CurIndex = 0;
     CurVertex = 0;
+    int firstVertex[MAX_VERTEX_BLOCKS];
+    for (int i = 0; i < n; ++i) {
+        VertexBlockType& vb = VertexBlocks[vbSort[i].VertexBlockIndex];
+        if (vb.Billboard && !vb.TrackRoll &&
+            (viewPos - vb.Pivot).Length() < MATH_FLOAT_SMALLEST_NON_DENORMAL) {
+            vb.Free();
+        }
+
+        // If you hit this assert you're likely trying to draw
+        // too much text for the current buffer size,
+        // most likely need to update the value
+        // passed to fontSurface->Init() in OvrGuiSysLocal::Init
+        //
+        // Note: Vertices is *not* a dynamic std::vector
+        // because it gets copies into GPU memory, which is reserved
+        // separately. If you decide to make this system dynamic
+        // remember to scale re-allocate the OpenGL VBOs as well
+        if (CurVertex + vb.NumVerts > MaxVertices) {
+            OVR_FAIL(
+                "Application tried to draw more text than there is buffer for. "
+                "This failure protects agains a buffer overflow");
+        }
+
+        firstVertex[i] = CurVertex;
+        CurVertex += vb.NumVerts;
+        CurIndex += (vb.NumVerts / 2) * 3;
+    }
 
     // TODO:
     // To add multiple-font-per-surface support, we need to add a 3rd component to s and t,
     // then get the font for each vertex block, and set the texture index on each vertex in
     // the third texture coordinate.
-    for (int i = 0; i < static_cast<int>(VertexBlocks.size()); ++i) {
-        VertexBlockType& vb = VertexBlocks[vbSort[i].VertexBlockIndex];
-        Matrix4f transform;
-        if (vb.Billboard) {
-            if (vb.TrackRoll) {
-                transform = invViewMatrix;
-            } else {
-                Vector3f textNormal = viewPos - vb.Pivot;
-                float const len = textNormal.Length();
-                if (len < MATH_FLOAT_SMALLEST_NON_DENORMAL) {
-                    vb.Free();
-                    continue;
+    static const int BLOCKS_PER_BATCH = 16;
+    Bounds3f batchBounds[MAX_VERTEX_BLOCKS / BLOCKS_PER_BATCH];
+    auto transformBlocks = [&](const int batch, const int begin, const int end) {
+        Bounds3f& bounds = batchBounds[batch];
+        bounds.Clear();
+        for (int i = begin; i < end; ++i) {
+            VertexBlockType& vb = VertexBlocks[vbSort[i].VertexBlockIndex];
+            if (vb.NumVerts == 0) {
+                vb.Free();
+                continue;
+            }
+            Matrix4f transform;
+            if (vb.Billboard) {
+                if (vb.TrackRoll) {
+                    transform = invViewMatrix;
+                } else {
+                    Vector3f textNormal = viewPos - vb.Pivot;
+                    textNormal *= 1.0f / textNormal.Length();
+                    transform = Matrix4f::CreateFromBasisVectors(textNormal, viewUp * -1.0f);
                 }
-                textNormal *= 1.0f / len;
-                transform = Matrix4f::CreateFromBasisVectors(textNormal, viewUp * -1.0f);
+                transform.SetTranslation(vb.Pivot);
+            } else {
+                transform.SetIdentity();
+                transform.SetTranslation(vb.Pivot);
             }
-            transform.SetTranslation(vb.Pivot);
-        } else {
-            transform.SetIdentity();
-            transform.SetTranslation(vb.Pivot);
-        }
 
-        for (int j = 0; j < vb.NumVerts; j++) {
-            fontVertex_t const& v = vb.Verts[j];
-            Vector3f const position = transform.Transform(v.xyz);
-
-            // If you hit this assert you're likely trying to draw
-            // too much text for the current buffer size,
-            // most likely need to update the value
-            // passed to fontSurface->Init() in OvrGuiSysLocal::Init
-            //
-            // Note: Vertices is *not* a dynamic std::vector
-            // because it gets copies into GPU memory, which is reserved
-            // separately. If you decide to make this system dynamic
-            // remember to scale re-allocate the OpenGL VBOs as well
-            if (CurVertex >= MaxVertices) {
-                OVR_FAIL(
-                    "Application tried to draw more text than there is buffer for. "
-                    "This failure protects agains a buffer overflow");
-            }
+            fontVertex_t* out = Vertices + firstVertex[i];
+            for (int j = 0; j < vb.NumVerts; j++) {
+                fontVertex_t const& v = vb.Verts[j];
+                Vector3f const position = transform.Transform(v.xyz);
 
-            Vertices[CurVertex].xyz = position;
-            Vertices[CurVertex].s = v.s;
-            Vertices[CurVertex].t = v.t;
-            *(std::uint32_t*)(&Vertices[CurVertex].rgba[0]) = *(std::uint32_t*)(&v.rgba[0]);
-            *(std::uint32_t*)(&Vertices[CurVertex].fontParms[0]) =
-                *(std::uint32_t*)(&v.fontParms[0]);
-            CurVertex++;
+                out[j].xyz = position;
+                out[j].s = v.s;
+                out[j].t = v.t;
+                *(std::uint32_t*)(&out[j].rgba[0]) =
+                    vb.OverrideColor ? vb.Color : *(std::uint32_t*)(&v.rgba[0]);
+                *(std::uint32_t*)(&out[j].fontParms[0]) = *(std::uint32_t*)(&v.fontParms[0]);
 
-            FontSurfaceDef.geo.localBounds.AddPoint(position);
+                bounds.AddPoint(position);
+            }
+            // free this vertex block
+            vb.Free();
         }
-        CurIndex += (vb.NumVerts / 2) * 3;
-        // free this vertex block
-        vb.Free();
+    };
+
+    const int numBatches = ovrJobSystem::GetNumBatches(n, BLOCKS_PER_BATCH);
+    ovrJobSystem* jobSystem = GetJobSystem();
+    if (jobSystem != nullptr) {
+        jobSystem->ParallelFor(n, BLOCKS_PER_BATCH, transformBlocks);
+    } else {
+        for (int b = 0; b < numBatches; ++b) {
+            transformBlocks(b, b * BLOCKS_PER_BATCH, std::min(n, (b + 1) * BLOCKS_PER_BATCH));
+        }
+    }
+    Bounds3f localBounds(Bounds3f::Init);
+    for (int b = 0; b < numBatches; ++b) {
+        localBounds = Bounds3f::Union(localBounds, batchBounds[b]);
     }
     // remove all elements from the vertex block (but don't free the memory since it's likely to be
     // needed on the next frame.
     VertexBlocks.clear();
-
-    glBindVertexArray(FontSurfaceDef.geo.vertexArrayObject);
-    glBindBuffer(GL_ARRAY_BUFFER, FontSurfaceDef.geo.vertexBuffer);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, CurVertex * sizeof(fontVertex_t), (void*)Vertices);
-    glBindVertexArray(0);
-    FontSurfaceDef.geo.indexCount = CurIndex;
+    UpdateLayoutCache();
+
+    // The surface may still be drawn for an earlier frame, so the counts change along with
+    // the upload.
+    auto upload = [this, localBounds](const fontVertex_t* vertices, const int numVertices,
+                                      const int numIndices) {
+        glBindVertexArray(FontSurfaceDef.geo.vertexArrayObject);
+        glBindBuffer(GL_ARRAY_BUFFER, FontSurfaceDef.geo.vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, numVertices * sizeof(fontVertex_t), vertices);
+        glBindVertexArray(0);
+        FontSurfaceDef.geo.indexCount = numIndices;
+        FontSurfaceDef.geo.localBounds = localBounds;
+    };
+    if (GetFrameGlTasks() == nullptr) {
+        upload(Vertices, CurVertex, CurIndex);
+        return;
+    }
+    std::vector<fontVertex_t> vertices(Vertices, Vertices + CurVertex);
+    const int numIndices = CurIndex;
+    RunFrameGlTask([upload, vertices = std::move(vertices), numIndices]() {
+        upload(vertices.data(), static_cast<int>(vertices.size()), numIndices);
+    });
 }
 
 //==============================
@@ -2425,14 +2951,20 @@ void BitmapFontSurfaceLocal::Finish(Matrix4f const& viewMatrix) {
 void BitmapFontSurfaceLocal::AppendSurfaceList(
     BitmapFont const& font,
     std::vector<ovrDrawSurface>& surfaceList) const {
-    if (FontSurfaceDef.geo.indexCount == 0) {
+    // as of the last Finish(), the surface itself may only have it once the upload ran
+    if (CurIndex == 0) {
         return;
     }
 
     ovrDrawSurface drawSurf;
 
-    FontSurfaceDef.graphicsCommand.Program = AsLocal(font).GetFontProgram();
-    FontSurfaceDef.graphicsCommand.UniformData[0].Data = (void*)&AsLocal(font).GetFontTexture();
+    // an earlier frame may still be drawn from the surface, only write it when the font changes
+    ovrGraphicsCommand& gc = FontSurfaceDef.graphicsCommand;
+    if (gc.Program.Program != AsLocal(font).GetFontProgram().Program ||
+        gc.UniformData[0].Data != &AsLocal(font).GetFontTexture()) {
+        gc.Program = AsLocal(font).GetFontProgram();
+        gc.UniformData[0].Data = (void*)&AsLocal(font).GetFontTexture();
+    }
 
     drawSurf.surface = &FontSurfaceDef;
 
@@ -68,6 +68,14 @@ struct fontParms_t {
     float ColorCenter; // below this distance, color is 0, above this color is 1
 };
 
+struct fontLayoutCacheStats_t {
+    fontLayoutCacheStats_t() : Hits(0), Misses(0), NumLayouts(0) {}
+
+    int Hits; // strings drawn from a cached layout
+    int Misses; // strings that had to be laid out
+    int NumLayouts; // layouts in the cache
+};
+
 //==============================================================
 // BitmapFont
 class BitmapFont {
@@ -75,8 +83,17 @@ class BitmapFont {
     static BitmapFont* Create();
     static void Free(BitmapFont*& font);
 
+    // Loads a pre-baked .fnt file and the image it names, or a .ttf or .otf font whose signed
+    // distance field glyphs are rendered on a worker thread as they are first used. Glyphs that
+    // are still pending draw nothing for a frame or two; text surfaces made with TextSurface()
+    // wait for theirs.
     virtual bool Load(ovrFileSys& fileSys, const char* uri) = 0;
 
+    // Uploads the glyphs the worker thread finished, for fonts loaded from a TrueType file. Call
+    // once a frame on the thread that owns the GL context, or while building a pipelined frame;
+    // OvrGuiSys::Frame() does for the default font.
+    virtual void UpdateGlyphs() = 0;
+
     // Calculates the native (unscaled) width of the text string. Line endings are ignored.
     virtual float CalcTextWidth(char const* text) const = 0;
     // Calculates the native (unscaled) width of the text string. Each '\n' will start a new line
@@ -210,6 +227,14 @@ class BitmapFontSurface {
 
     virtual void SetCullEnabled(const bool enabled) = 0;
 
+    // The glyph quads of recently drawn strings are cached by font, text, parms, orientation
+    // and scale, so drawing the same string again only transforms them, and recolors them when
+    // the text has no color escapes. On by default; disabling it empties the cache at the next
+    // Finish().
+    virtual void SetLayoutCacheEnabled(const bool enabled) = 0;
+    // Counts for the last frame passed to Finish().
+    virtual fontLayoutCacheStats_t GetLayoutCacheStats() const = 0;
+
    protected:
     virtual ~BitmapFontSurface() {}
 };
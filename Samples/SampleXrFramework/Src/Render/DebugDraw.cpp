@@ -0,0 +1,480 @@
+/************************************************************************************
+
+Filename    :   DebugDraw.cpp
+Content     :   Immediate mode debug lines, shapes and text drawn in a few batched draws.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "DebugDraw.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#include "Misc/Log.h"
+
+#include "Egl.h"
+#include "Render/BitmapFont.h"
+#include "Render/GlGeometry.h"
+
+using OVR::Bounds3f;
+using OVR::Matrix4f;
+using OVR::Posef;
+using OVR::Vector2f;
+using OVR::Vector3f;
+using OVR::Vector4f;
+
+namespace OVRFW {
+
+// The segment comes from the instance, and the index picks its end.
+static const char* DebugDrawLineVertexSrc = R"glsl(
+	attribute highp vec3 Position;		// start of the segment
+	attribute highp vec3 Normal;		// end of the segment
+	attribute lowp vec4 VertexColor;	// at the start
+	attribute lowp vec4 Tangent;		// color at the end
+	varying lowp vec4 outColor;
+	void main()
+	{
+		bool atEnd = gl_VertexID != 0;
+		gl_Position = TransformVertex( vec4( atEnd ? Normal : Position, 1.0 ) );
+		outColor = atEnd ? Tangent : VertexColor;
+	}
+)glsl";
+
+static const char* DebugDrawLineFragmentSrc = R"glsl(
+	varying lowp vec4 outColor;
+	void main()
+	{
+		gl_FragColor = outColor;
+	}
+)glsl";
+
+// Enough for a few hundred labels a frame.
+static const int MAX_TEXT_VERTICES = 16 * 1024;
+
+static uint32_t PackColor(const Vector4f& color) {
+    const auto channel = [](const float c) {
+        return static_cast<uint32_t>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+    };
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) |
+        (channel(color.w) << 24);
+}
+
+ovrDebugDraw::ovrDebugDraw()
+    : Initialized(false),
+      MaxLines(0),
+      NumLines(0),
+      NumDroppedLines(0),
+      DrawnLines(0),
+      DroppedLines(0),
+      LineBufferFramePending(false),
+      Font(nullptr) {
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        TextSurfaces[i] = nullptr;
+    }
+}
+
+ovrDebugDraw::~ovrDebugDraw() {
+    Shutdown();
+}
+
+bool ovrDebugDraw::Init(const int maxLines, BitmapFont const* font) {
+    Shutdown();
+
+    MaxLines = std::max(maxLines, 1);
+    if (!LineBuffer.Create(MaxLines * sizeof(ovrDebugLine))) {
+        return false;
+    }
+    LineBufferFramePending = false;
+    LineProgram = GlProgram::Build(DebugDrawLineVertexSrc, DebugDrawLineFragmentSrc, NULL, 0);
+
+    for (int i = 0; i < SPHERE_SEGMENTS; i++) {
+        const float angle = MATH_FLOAT_TWOPI * i / SPHERE_SEGMENTS;
+        SphereCircle[i] = Vector2f(cosf(angle), sinf(angle));
+    }
+
+    // A single two vertex line, drawn once per instance. The attributes are pointed at the
+    // line buffer every frame.
+    VertexAttribs attribs;
+    attribs.position.resize(2);
+    const std::vector<TriangleIndex> indices = {0, 1};
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        ovrSurfaceDef& surf = LineSurfaces[i];
+        surf.surfaceName = i == VARIANT_DEPTH ? "debug lines" : "debug lines no depth";
+        surf.geo.Create(attribs, indices);
+        surf.geo.primitiveType = GlGeometry::kPrimitiveTypeLines;
+        glBindVertexArray(surf.geo.vertexArrayObject);
+        for (const int location :
+             {VERTEX_ATTRIBUTE_LOCATION_POSITION,
+              VERTEX_ATTRIBUTE_LOCATION_NORMAL,
+              VERTEX_ATTRIBUTE_LOCATION_COLOR,
+              VERTEX_ATTRIBUTE_LOCATION_TANGENT}) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindVertexArray(0);
+
+        ovrGraphicsCommand& gc = surf.graphicsCommand;
+        gc.GpuState.blendEnable = ovrGpuState::BLEND_ENABLE;
+        gc.GpuState.blendSrc = ovrGpuState::kGL_SRC_ALPHA;
+        gc.GpuState.blendDst = ovrGpuState::kGL_ONE_MINUS_SRC_ALPHA;
+        gc.GpuState.depthEnable = gc.GpuState.depthMaskEnable = i == VARIANT_DEPTH;
+        gc.Program = LineProgram;
+    }
+
+    Font = font;
+    if (Font != nullptr) {
+        for (int i = 0; i < VARIANT_MAX; i++) {
+            TextSurfaces[i] = BitmapFontSurface::Create();
+            TextSurfaces[i]->Init(MAX_TEXT_VERTICES);
+        }
+    }
+
+    Initialized = true;
+    return true;
+}
+
+void ovrDebugDraw::Shutdown() {
+    if (!Initialized) {
+        return;
+    }
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        LineSurfaces[i].geo.Free();
+        Lines[i].clear();
+        BitmapFontSurface::Free(TextSurfaces[i]);
+    }
+    GlProgram::Free(LineProgram);
+    LineBuffer.Destroy();
+    LineBufferFramePending = false;
+    Font = nullptr;
+    NumLines = 0;
+    NumDroppedLines = 0;
+    Initialized = false;
+}
+
+ovrDebugDraw::ovrDebugLine* ovrDebugDraw::AddLines(const int count, const bool depthTest) {
+    if (!Initialized || count <= 0) {
+        return nullptr;
+    }
+    if (NumLines + count > MaxLines) {
+        NumDroppedLines += count;
+        return nullptr;
+    }
+    std::vector<ovrDebugLine>& lines = Lines[depthTest ? VARIANT_DEPTH : VARIANT_NO_DEPTH];
+    const size_t first = lines.size();
+    lines.resize(first + count);
+    NumLines += count;
+    return lines.data() + first;
+}
+
+void ovrDebugDraw::AddLine(
+    const Vector3f& start,
+    const Vector3f& end,
+    const Vector4f& color,
+    const bool depthTest) {
+    AddLine(start, end, color, color, depthTest);
+}
+
+void ovrDebugDraw::AddLine(
+    const Vector3f& start,
+    const Vector3f& end,
+    const Vector4f& startColor,
+    const Vector4f& endColor,
+    const bool depthTest) {
+    ovrDebugLine* line = AddLines(1, depthTest);
+    if (line != nullptr) {
+        line->Start = start;
+        line->End = end;
+        line->StartColor = PackColor(startColor);
+        line->EndColor = PackColor(endColor);
+    }
+}
+
+void ovrDebugDraw::AddLineStrip(
+    const Vector3f* points,
+    const int count,
+    const Vector4f& color,
+    const bool depthTest) {
+    // keep as much of a long strip as fits
+    const int numSegments = std::min(count - 1, MaxLines - NumLines);
+    NumDroppedLines += std::max(count - 1 - numSegments, 0);
+    ovrDebugLine* lines = AddLines(numSegments, depthTest);
+    if (lines == nullptr) {
+        return;
+    }
+    const uint32_t packed = PackColor(color);
+    for (int i = 0; i < numSegments; i++) {
+        lines[i].Start = points[i];
+        lines[i].End = points[i + 1];
+        lines[i].StartColor = packed;
+        lines[i].EndColor = packed;
+    }
+}
+
+void ovrDebugDraw::AddLineStrip(
+    const Vector3f* points,
+    const Vector4f* colors,
+    const int count,
+    const bool depthTest) {
+    const int numSegments = std::min(count - 1, MaxLines - NumLines);
+    NumDroppedLines += std::max(count - 1 - numSegments, 0);
+    ovrDebugLine* lines = AddLines(numSegments, depthTest);
+    if (lines == nullptr) {
+        return;
+    }
+    uint32_t packed = PackColor(colors[0]);
+    for (int i = 0; i < numSegments; i++) {
+        lines[i].Start = points[i];
+        lines[i].End = points[i + 1];
+        lines[i].StartColor = packed;
+        packed = PackColor(colors[i + 1]);
+        lines[i].EndColor = packed;
+    }
+}
+
+void ovrDebugDraw::AddBox(
+    const Posef& pose,
+    const Bounds3f& bounds,
+    const Vector4f& color,
+    const bool depthTest) {
+    ovrDebugLine* lines = AddLines(12, depthTest);
+    if (lines == nullptr) {
+        return;
+    }
+    // corner i takes the maxs on the axes whose bit is set
+    Vector3f corners[8];
+    for (int i = 0; i < 8; i++) {
+        const Vector3f corner(
+            bounds.b[(i >> 0) & 1].x, bounds.b[(i >> 1) & 1].y, bounds.b[(i >> 2) & 1].z);
+        corners[i] = pose.Transform(corner);
+    }
+    const uint32_t packed = PackColor(color);
+    int line = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            const int j = i | (1 << axis);
+            if (j != i) {
+                lines[line].Start = corners[i];
+                lines[line].End = corners[j];
+                lines[line].StartColor = packed;
+                lines[line].EndColor = packed;
+                line++;
+            }
+        }
+    }
+}
+
+void ovrDebugDraw::AddSphere(
+    const Vector3f& center,
+    const float radius,
+    const Vector4f& color,
+    const bool depthTest) {
+    ovrDebugLine* lines = AddLines(SPHERE_SEGMENTS * 3, depthTest);
+    if (lines == nullptr) {
+        return;
+    }
+    const uint32_t packed = PackColor(color);
+    for (int axis = 0; axis < 3; axis++) {
+        // the circle lies in the plane of the other two axes
+        const int u = (axis + 1) % 3;
+        const int v = (axis + 2) % 3;
+        for (int i = 0; i < SPHERE_SEGMENTS; i++) {
+            const Vector2f& a = SphereCircle[i];
+            const Vector2f& b = SphereCircle[(i + 1) % SPHERE_SEGMENTS];
+            ovrDebugLine& line = lines[axis * SPHERE_SEGMENTS + i];
+            line.Start = center;
+            line.Start[u] += a.x * radius;
+            line.Start[v] += a.y * radius;
+            line.End = center;
+            line.End[u] += b.x * radius;
+            line.End[v] += b.y * radius;
+            line.StartColor = packed;
+            line.EndColor = packed;
+        }
+    }
+}
+
+void ovrDebugDraw::AddAxes(const Posef& pose, const float size, const bool depthTest) {
+    ovrDebugLine* lines = AddLines(3, depthTest);
+    if (lines == nullptr) {
+        return;
+    }
+    const Vector4f colors[3] = {
+        Vector4f(1.0f, 0.0f, 0.0f, 1.0f),
+        Vector4f(0.0f, 1.0f, 0.0f, 1.0f),
+        Vector4f(0.0f, 0.0f, 1.0f, 1.0f)};
+    for (int axis = 0; axis < 3; axis++) {
+        Vector3f dir(0.0f);
+        dir[axis] = size;
+        lines[axis].Start = pose.Translation;
+        lines[axis].End = pose.Transform(dir);
+        lines[axis].StartColor = PackColor(colors[axis]);
+        lines[axis].EndColor = lines[axis].StartColor;
+    }
+}
+
+void ovrDebugDraw::AddText(
+    const Vector3f& pos,
+    const float scale,
+    const Vector4f& color,
+    const char* text,
+    const bool depthTest) {
+    if (Font == nullptr || text == nullptr) {
+        return;
+    }
+    fontParms_t parms;
+    parms.AlignHoriz = HORIZONTAL_CENTER;
+    parms.AlignVert = VERTICAL_CENTER;
+    parms.Billboard = true;
+    const int variant = depthTest ? VARIANT_DEPTH : VARIANT_NO_DEPTH;
+    TextSurfaces[variant]->DrawTextBillboarded3D(*Font, parms, pos, scale, color, text);
+}
+
+void ovrDebugDraw::AppendSurfaceList(
+    const Matrix4f& centerEyeViewMatrix,
+    std::vector<ovrDrawSurface>& surfaceList) {
+    if (!Initialized) {
+        return;
+    }
+
+    DrawnLines = 0;
+    DroppedLines = NumDroppedLines;
+    int counts[VARIANT_MAX];
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        counts[i] = static_cast<int>(Lines[i].size());
+        DrawnLines += counts[i];
+    }
+
+    // The line surfaces may still be drawn for an earlier frame, so without the GL context the
+    // lines go to the render thread, which points the surfaces at them.
+    if (GetFrameGlTasks() == nullptr) {
+        UploadLines(Lines);
+        for (int i = 0; i < VARIANT_MAX; i++) {
+            Lines[i].clear();
+        }
+    } else if (NumLines > 0) {
+        std::array<std::vector<ovrDebugLine>, VARIANT_MAX> lines;
+        for (int i = 0; i < VARIANT_MAX; i++) {
+            lines[i].swap(Lines[i]);
+        }
+        RunFrameGlTask([this, lines = std::move(lines)]() { UploadLines(lines.data()); });
+    }
+
+    // depth tested first, then everything that draws on top
+    for (int i = VARIANT_MAX - 1; i >= 0; i--) {
+        if (counts[i] > 0) {
+            surfaceList.push_back(ovrDrawSurface(&LineSurfaces[i]));
+        }
+
+        if (TextSurfaces[i] == nullptr) {
+            continue;
+        }
+        // Finish even without new text, so last frame's is not drawn again.
+        TextSurfaces[i]->Finish(centerEyeViewMatrix);
+        const size_t numSurfaces = surfaceList.size();
+        TextSurfaces[i]->AppendSurfaceList(*Font, surfaceList);
+        if (i == VARIANT_NO_DEPTH && surfaceList.size() > numSurfaces) {
+            // copied once the text surface has its upload
+            const ovrSurfaceDef* textSurface = surfaceList.back().surface;
+            RunFrameGlTask([this, textSurface]() {
+                NoDepthTextSurface = *textSurface;
+                NoDepthTextSurface.graphicsCommand.GpuState.depthEnable = false;
+            });
+            surfaceList.back().surface = &NoDepthTextSurface;
+        }
+    }
+
+    NumLines = 0;
+    NumDroppedLines = 0;
+}
+
+void ovrDebugDraw::UploadLines(const std::vector<ovrDebugLine>* lines) {
+    int numLines = 0;
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        LineSurfaces[i].geo.indexCount = 0;
+        numLines += static_cast<int>(lines[i].size());
+    }
+    if (numLines == 0) {
+        return;
+    }
+
+    // Fence the last frame's region now, as its draws have been issued by this point.
+    if (LineBufferFramePending) {
+        LineBuffer.EndFrame();
+    }
+    LineBuffer.BeginFrame();
+    LineBufferFramePending = true;
+    size_t offset = 0;
+    uint8_t* dst = static_cast<uint8_t*>(
+        LineBuffer.Map(numLines * sizeof(ovrDebugLine), sizeof(float) * 4, offset));
+    if (dst == nullptr) {
+        ALOGW("ovrDebugDraw: failed to map %d lines", numLines);
+        return;
+    }
+
+    const size_t stride = sizeof(ovrDebugLine);
+    for (int i = VARIANT_MAX - 1; i >= 0; i--) {
+        const int count = static_cast<int>(lines[i].size());
+        if (count == 0) {
+            continue;
+        }
+        memcpy(dst, lines[i].data(), count * stride);
+        dst += count * stride;
+
+        ovrSurfaceDef& surf = LineSurfaces[i];
+        glBindVertexArray(surf.geo.vertexArrayObject);
+        glBindBuffer(GL_ARRAY_BUFFER, LineBuffer.GetBuffer());
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_POSITION,
+            3,
+            GL_FLOAT,
+            false,
+            stride,
+            (void*)(offset + offsetof(ovrDebugLine, Start)));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_NORMAL,
+            3,
+            GL_FLOAT,
+            false,
+            stride,
+            (void*)(offset + offsetof(ovrDebugLine, End)));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_COLOR,
+            4,
+            GL_UNSIGNED_BYTE,
+            true,
+            stride,
+            (void*)(offset + offsetof(ovrDebugLine, StartColor)));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_TANGENT,
+            4,
+            GL_UNSIGNED_BYTE,
+            true,
+            stride,
+            (void*)(offset + offsetof(ovrDebugLine, EndColor)));
+        glBindVertexArray(0);
+        offset += count * stride;
+
+        surf.geo.indexCount = 2;
+        surf.numInstances = count;
+    }
+    LineBuffer.Unmap();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ovrDebugDraw::Clear() {
+    for (int i = 0; i < VARIANT_MAX; i++) {
+        Lines[i].clear();
+        if (TextSurfaces[i] != nullptr) {
+            // builds the text without drawing it, and the next Finish() starts over
+            TextSurfaces[i]->Finish(Matrix4f());
+        }
+    }
+    NumLines = 0;
+    NumDroppedLines = 0;
+}
+
+} // namespace OVRFW
@@ -0,0 +1,147 @@
+/************************************************************************************
+
+Filename    :   DebugDraw.h
+Content     :   Immediate mode debug lines, shapes and text drawn in a few batched draws.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+
+#include "Render/GlProgram.h"
+#include "Render/GlStreamBuffer.h"
+#include "Render/SurfaceRender.h"
+
+namespace OVRFW {
+
+class BitmapFont;
+class BitmapFontSurface;
+
+// Everything added is drawn once, by the next AppendSurfaceList(), and then dropped, so
+// callers add what they want to see every frame. Boxes, spheres and axes are all turned into
+// line segments, and each line segment is one instance of a two vertex line, so however many
+// there are, the depth tested and the always visible lines are one draw each. Text goes into
+// a BitmapFontSurface per variant, which is one draw each as well.
+//
+// The segments are written straight into a buffer of their own with a region per frame in
+// flight, so they never wait for the GPU and never share the frame stream buffer's budget.
+class ovrDebugDraw {
+   public:
+    static const int DEFAULT_MAX_LINES = 128 * 1024;
+    static const int SPHERE_SEGMENTS = 24; // per circle
+
+    ovrDebugDraw();
+    ~ovrDebugDraw();
+
+    // Requires an active GL context. maxLines is the per frame budget, counting both variants.
+    // Text is only drawn when a font is given, and the font has to outlive this.
+    bool Init(const int maxLines = DEFAULT_MAX_LINES, BitmapFont const* font = nullptr);
+    void Shutdown();
+
+    void AddLine(
+        const OVR::Vector3f& start,
+        const OVR::Vector3f& end,
+        const OVR::Vector4f& color,
+        const bool depthTest = true);
+    void AddLine(
+        const OVR::Vector3f& start,
+        const OVR::Vector3f& end,
+        const OVR::Vector4f& startColor,
+        const OVR::Vector4f& endColor,
+        const bool depthTest = true);
+    // Connects count points with count - 1 segments.
+    void AddLineStrip(
+        const OVR::Vector3f* points,
+        const int count,
+        const OVR::Vector4f& color,
+        const bool depthTest = true);
+    // With a color per point, blended along each segment.
+    void AddLineStrip(
+        const OVR::Vector3f* points,
+        const OVR::Vector4f* colors,
+        const int count,
+        const bool depthTest = true);
+
+    void AddBox(
+        const OVR::Posef& pose,
+        const OVR::Bounds3f& bounds,
+        const OVR::Vector4f& color,
+        const bool depthTest = true);
+    // The three great circles around the axes.
+    void AddSphere(
+        const OVR::Vector3f& center,
+        const float radius,
+        const OVR::Vector4f& color,
+        const bool depthTest = true);
+    // X = red, Y = green, Z = blue, each size long.
+    void AddAxes(const OVR::Posef& pose, const float size, const bool depthTest = true);
+
+    // Billboarded, centered on pos.
+    void AddText(
+        const OVR::Vector3f& pos,
+        const float scale,
+        const OVR::Vector4f& color,
+        const char* text,
+        const bool depthTest = true);
+
+    // Uploads everything added since the last call, appends up to four surfaces and starts
+    // over. Call it once a frame, on the thread with the GL context or while building a
+    // pipelined frame, which leaves the upload to the render thread.
+    void AppendSurfaceList(
+        const OVR::Matrix4f& centerEyeViewMatrix,
+        std::vector<ovrDrawSurface>& surfaceList);
+    // Drops everything added since the last AppendSurfaceList() without drawing it.
+    void Clear();
+
+    // For the last AppendSurfaceList().
+    int GetNumLines() const {
+        return DrawnLines;
+    }
+    // Segments left out because the budget was used up.
+    int GetNumDroppedLines() const {
+        return DroppedLines;
+    }
+
+   private:
+    enum ovrVariant { VARIANT_NO_DEPTH, VARIANT_DEPTH, VARIANT_MAX };
+
+    // One instance of the line surfaces.
+    struct ovrDebugLine {
+        OVR::Vector3f Start;
+        OVR::Vector3f End;
+        uint32_t StartColor; // RGBA8
+        uint32_t EndColor;
+    };
+
+    // Returns NULL, and counts the lines as dropped, when they don't fit the budget.
+    ovrDebugLine* AddLines(const int count, const bool depthTest);
+    // Writes the lines of both variants to the line buffer and points the line surfaces at
+    // them. Needs the GL context.
+    void UploadLines(const std::vector<ovrDebugLine>* lines);
+
+    bool Initialized;
+    int MaxLines;
+    int NumLines; // added since the last AppendSurfaceList(), both variants
+    int NumDroppedLines;
+    int DrawnLines; // by the last AppendSurfaceList()
+    int DroppedLines;
+    std::vector<ovrDebugLine> Lines[VARIANT_MAX];
+    OVR::Vector2f SphereCircle[SPHERE_SEGMENTS]; // cos, sin
+
+    GlStreamBuffer LineBuffer;
+    bool LineBufferFramePending; // the last frame's region still needs its fence
+    GlProgram LineProgram;
+    ovrSurfaceDef LineSurfaces[VARIANT_MAX];
+
+    BitmapFont const* Font;
+    BitmapFontSurface* TextSurfaces[VARIANT_MAX];
+    ovrSurfaceDef NoDepthTextSurface; // the font surface with the depth test turned off
+};
+
+} // namespace OVRFW
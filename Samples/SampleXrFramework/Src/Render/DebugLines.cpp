@@ -29,6 +29,7 @@ Authors     :   Jonathan E. Wright
 #include "Misc/Log.h"
 #include "GlGeometry.h"
 #include "GlProgram.h"
+#include "GlStreamBuffer.h"
 
 #include <cstdlib>
 
@@ -152,7 +153,7 @@ void OvrDebugLinesLocal::Init(float lineWidth) {
     }
 
     // this is only freed by the OS when the program exits
-    if (LineProgram.VertexShader == 0 || LineProgram.FragmentShader == 0) {
+    if (!LineProgram.IsValid()) {
         LineProgram = GlProgram::Build(DebugLineVertexSrc, DebugLineFragmentSrc, NULL, 0);
     }
 
@@ -202,8 +203,16 @@ void OvrDebugLinesLocal::AppendSurfaceList(std::vector<ovrDrawSurface>& surfaceL
         if (verts == 0) {
             continue;
         }
-        dl.Surf.geo.Update(dl.Attr);
-        dl.Surf.geo.indexCount = verts;
+        if (GetFrameGlTasks() == nullptr) {
+            dl.Surf.geo.UpdateStreamed(dl.Attr);
+            dl.Surf.geo.indexCount = verts;
+        } else {
+            // an earlier frame may still be drawn from the surface, the count goes with the upload
+            RunFrameGlTask([&dl, attr = dl.Attr, verts]() {
+                dl.Surf.geo.UpdateStreamed(attr);
+                dl.Surf.geo.indexCount = verts;
+            });
+        }
         surfaceList.push_back(dl.DrawSurf);
     }
 }
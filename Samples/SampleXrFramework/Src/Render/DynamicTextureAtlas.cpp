@@ -0,0 +1,310 @@
+/************************************************************************************
+
+Filename    :   DynamicTextureAtlas.cpp
+Content     :   Runtime packing of small RGBA images into shared texture pages.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "DynamicTextureAtlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "Misc/Log.h"
+#include "Egl.h"
+#include "GlStreamBuffer.h"
+#include "OVR_FileSys.h"
+
+using OVR::Vector4f;
+
+namespace OVRFW {
+
+//==============================================================================================
+// ovrSkylinePacker
+//==============================================================================================
+
+void ovrSkylinePacker::Init(const int width, const int height) {
+    Width = width;
+    Height = height;
+    UsedArea = 0;
+    Skyline.clear();
+    Skyline.push_back({0, 0, width});
+}
+
+int ovrSkylinePacker::FitAt(const int index, const int width, const int height) const {
+    const int x = Skyline[index].X;
+    if (x + width > Width) {
+        return -1;
+    }
+    int y = 0;
+    int widthLeft = width;
+    for (int i = index; widthLeft > 0; i++) {
+        y = std::max(y, Skyline[i].Y);
+        if (y + height > Height) {
+            return -1;
+        }
+        widthLeft -= Skyline[i].Width;
+    }
+    return y;
+}
+
+bool ovrSkylinePacker::Pack(const int width, const int height, int& x, int& y) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    int bestIndex = -1;
+    int bestTop = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (int i = 0; i < static_cast<int>(Skyline.size()); i++) {
+        const int fitY = FitAt(i, width, height);
+        if (fitY < 0) {
+            continue;
+        }
+        // lowest top first, then the narrowest segment to keep the wide ones for wide images
+        if (fitY + height < bestTop || (fitY + height == bestTop && Skyline[i].Width < bestWidth)) {
+            bestIndex = i;
+            bestTop = fitY + height;
+            bestWidth = Skyline[i].Width;
+        }
+    }
+    if (bestIndex < 0) {
+        return false;
+    }
+
+    x = Skyline[bestIndex].X;
+    y = bestTop - height;
+
+    Skyline.insert(Skyline.begin() + bestIndex, {x, bestTop, width});
+
+    // trim the segments the new one covers
+    const int right = x + width;
+    for (int i = bestIndex + 1; i < static_cast<int>(Skyline.size());) {
+        if (Skyline[i].X >= right) {
+            break;
+        }
+        const int shrink = right - Skyline[i].X;
+        if (shrink >= Skyline[i].Width) {
+            Skyline.erase(Skyline.begin() + i);
+            continue;
+        }
+        Skyline[i].X += shrink;
+        Skyline[i].Width -= shrink;
+        break;
+    }
+
+    // merge neighbours at the same height
+    for (int i = 0; i + 1 < static_cast<int>(Skyline.size());) {
+        if (Skyline[i].Y == Skyline[i + 1].Y) {
+            Skyline[i].Width += Skyline[i + 1].Width;
+            Skyline.erase(Skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+
+    UsedArea += static_cast<size_t>(width) * height;
+    return true;
+}
+
+//==============================================================================================
+// ovrDynamicTextureAtlas
+//==============================================================================================
+
+ovrDynamicTextureAtlas::ovrDynamicTextureAtlas()
+    : TextureManager(nullptr), PageSize(DEFAULT_PAGE_SIZE), Enabled(false) {}
+
+ovrDynamicTextureAtlas::~ovrDynamicTextureAtlas() {
+    assert(Pages.empty()); // call Shutdown() explicitly
+}
+
+void ovrDynamicTextureAtlas::Init(ovrTextureManager& textureManager, const int pageSize) {
+    TextureManager = &textureManager;
+    // keep every packed rectangle aligned to the padding
+    PageSize = std::max(PADDING * 4, pageSize - pageSize % PADDING);
+}
+
+void ovrDynamicTextureAtlas::Shutdown() {
+    if (TextureManager != nullptr) {
+        for (const ovrAtlasPage& page : Pages) {
+            TextureManager->FreeTexture(page.Handle);
+        }
+    }
+    Pages.clear();
+    Images.clear();
+    std::vector<uint8_t>().swap(Scratch);
+    TextureManager = nullptr;
+}
+
+bool ovrDynamicTextureAtlas::AddPage() {
+    char name[64];
+    snprintf(name, sizeof(name), "<atlas page %d>", static_cast<int>(Pages.size()));
+
+    const std::vector<uint8_t> clear(static_cast<size_t>(PageSize) * PageSize * 4, 0);
+    const textureHandle_t handle = TextureManager->LoadRGBATexture(
+        name,
+        clear.data(),
+        PageSize,
+        PageSize,
+        ovrTextureManager::FILTER_LINEAR,
+        ovrTextureManager::WRAP_CLAMP);
+    if (!handle.IsValid()) {
+        ALOGW("ovrDynamicTextureAtlas: failed to create page %d", static_cast<int>(Pages.size()));
+        return false;
+    }
+    // pages can't be reloaded, and one evicted page would take every image on it along
+    TextureManager->SetTexturePinned(handle, true);
+
+    ovrAtlasPage page;
+    page.Handle = handle;
+    page.Texture = TextureManager->GetGlTexture(handle);
+    page.Packer.Init(PageSize, PageSize);
+    page.Dirty = false;
+    Pages.push_back(page);
+    return true;
+}
+
+bool ovrDynamicTextureAtlas::AddImage(
+    char const* name,
+    const uint8_t* rgba,
+    const int width,
+    const int height,
+    ovrAtlasImage& image) {
+    if (FindImage(name, image)) {
+        return true;
+    }
+    if (TextureManager == nullptr || rgba == nullptr || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const int paddedWidth = (width + PADDING * 2 + PADDING - 1) / PADDING * PADDING;
+    const int paddedHeight = (height + PADDING * 2 + PADDING - 1) / PADDING * PADDING;
+    if (paddedWidth > PageSize / 2 || paddedHeight > PageSize / 2) {
+        return false;
+    }
+
+    int pageIndex = -1;
+    int x = 0;
+    int y = 0;
+    for (int i = 0; i < static_cast<int>(Pages.size()); i++) {
+        if (Pages[i].Packer.Pack(paddedWidth, paddedHeight, x, y)) {
+            pageIndex = i;
+            break;
+        }
+    }
+    if (pageIndex < 0) {
+        if (!AddPage()) {
+            return false;
+        }
+        pageIndex = static_cast<int>(Pages.size()) - 1;
+        if (!Pages[pageIndex].Packer.Pack(paddedWidth, paddedHeight, x, y)) {
+            return false;
+        }
+    }
+    ovrAtlasPage& page = Pages[pageIndex];
+
+    // the image with its edge texels repeated out to the padded rectangle
+    Scratch.resize(static_cast<size_t>(paddedWidth) * paddedHeight * 4);
+    for (int py = 0; py < paddedHeight; py++) {
+        const int sy = std::min(std::max(py - PADDING, 0), height - 1);
+        for (int px = 0; px < paddedWidth; px++) {
+            const int sx = std::min(std::max(px - PADDING, 0), width - 1);
+            memcpy(
+                &Scratch[(static_cast<size_t>(py) * paddedWidth + px) * 4],
+                &rgba[(static_cast<size_t>(sy) * width + sx) * 4],
+                4);
+        }
+    }
+
+    RunFrameGlTask(
+        [texture = page.Texture.texture, x, y, paddedWidth, paddedHeight, pixels = Scratch]() {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexSubImage2D(
+                GL_TEXTURE_2D,
+                0,
+                x,
+                y,
+                paddedWidth,
+                paddedHeight,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                pixels.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+        });
+    page.Dirty = true;
+
+    const float scale = 1.0f / PageSize;
+    image.Page = pageIndex;
+    image.Texture = page.Texture;
+    image.Width = width;
+    image.Height = height;
+    image.UVRect = Vector4f(
+        (x + PADDING) * scale,
+        (y + PADDING) * scale,
+        (x + PADDING + width) * scale,
+        (y + PADDING + height) * scale);
+    Images[std::string(name)] = image;
+    return true;
+}
+
+bool ovrDynamicTextureAtlas::LoadImageFile(
+    ovrFileSys& fileSys,
+    char const* uri,
+    ovrAtlasImage& image) {
+    if (FindImage(uri, image)) {
+        return true;
+    }
+    if (TextureManager == nullptr || !CanDecodeTextureFromBuffer(uri)) {
+        return false;
+    }
+
+    std::vector<uint8_t> buffer;
+    if (!fileSys.ReadFile(uri, buffer)) {
+        return false;
+    }
+    ovrDecodedTexture decoded;
+    TextureFlags_t flags(TEXTUREFLAG_NO_DEFAULT);
+    flags |= TEXTUREFLAG_NO_MIPMAPS;
+    if (!DecodeTextureFromBuffer(uri, buffer.data(), buffer.size(), flags, decoded) ||
+        decoded.IsCompressed() || decoded.GlInternalFormat != GL_RGBA8) {
+        return false;
+    }
+    return AddImage(uri, decoded.Data.data(), decoded.Width, decoded.Height, image);
+}
+
+bool ovrDynamicTextureAtlas::FindImage(char const* name, ovrAtlasImage& image) const {
+    auto it = Images.find(std::string(name));
+    if (it == Images.end()) {
+        return false;
+    }
+    image = it->second;
+    return true;
+}
+
+void ovrDynamicTextureAtlas::Flush() {
+    std::vector<unsigned int> textures;
+    for (ovrAtlasPage& page : Pages) {
+        if (page.Dirty) {
+            textures.push_back(page.Texture.texture);
+            page.Dirty = false;
+        }
+    }
+    if (textures.empty()) {
+        return;
+    }
+    RunFrameGlTask([textures = std::move(textures)]() {
+        for (const unsigned int texture : textures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MAX_MIP_LEVEL);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    });
+}
+
+} // namespace OVRFW
@@ -0,0 +1,143 @@
+/************************************************************************************
+
+Filename    :   DynamicTextureAtlas.h
+Content     :   Runtime packing of small RGBA images into shared texture pages.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "OVR_Math.h"
+
+#include "GlTexture.h"
+#include "TextureManager.h"
+
+namespace OVRFW {
+
+// Skyline bottom-left rectangle packer. The skyline is the top edge of the packed area, kept as
+// a list of horizontal segments; each rectangle goes where its top ends up lowest.
+class ovrSkylinePacker {
+   public:
+    ovrSkylinePacker() : Width(0), Height(0), UsedArea(0) {}
+
+    void Init(const int width, const int height);
+
+    // Returns false when the rectangle doesn't fit anywhere.
+    bool Pack(const int width, const int height, int& x, int& y);
+
+    int GetWidth() const {
+        return Width;
+    }
+    int GetHeight() const {
+        return Height;
+    }
+    float GetOccupancy() const {
+        return Width > 0 && Height > 0 ? static_cast<float>(UsedArea) / (Width * Height) : 0.0f;
+    }
+
+   private:
+    struct ovrSkylineNode {
+        int X;
+        int Y;
+        int Width;
+    };
+
+    // Returns the y a rectangle starting at node index would rest at, or -1 if it doesn't fit.
+    int FitAt(const int index, const int width, const int height) const;
+
+    int Width;
+    int Height;
+    size_t UsedArea;
+    std::vector<ovrSkylineNode> Skyline;
+};
+
+// Packs small RGBA images, typically UI images and icons, into a few shared pages so the
+// surfaces drawing them bind the same texture and can be sorted and batched together. Pages
+// are square, allocated on demand and registered as pinned textures with the texture manager,
+// which counts them against its memory budget. Each image is padded by repeating its edge
+// texels so bilinear filtering and the first two mip levels don't pick up its neighbours.
+// Images larger than half a page are refused, and callers should load those on their own.
+class ovrDynamicTextureAtlas {
+   public:
+    static const int DEFAULT_PAGE_SIZE = 1024;
+
+    struct ovrAtlasImage {
+        ovrAtlasImage() : Page(-1), Width(0), Height(0), UVRect(0.0f, 0.0f, 1.0f, 1.0f) {}
+
+        bool IsValid() const {
+            return Page >= 0;
+        }
+
+        int Page;
+        GlTexture Texture; // the page
+        int Width; // of the image
+        int Height;
+        OVR::Vector4f UVRect; // u0, v0, u1, v1, with v0 at the first row of the image
+    };
+
+    ovrDynamicTextureAtlas();
+    ~ovrDynamicTextureAtlas();
+
+    void Init(ovrTextureManager& textureManager, const int pageSize = DEFAULT_PAGE_SIZE);
+    void Shutdown();
+
+    // Menus only pack their images when this is set.
+    void SetEnabled(const bool enabled) {
+        Enabled = enabled;
+    }
+    bool IsEnabled() const {
+        return Enabled && TextureManager != nullptr;
+    }
+
+    // Returns the image already packed under this name, or packs a copy of the pixels.
+    bool AddImage(
+        char const* name,
+        const uint8_t* rgba,
+        const int width,
+        const int height,
+        ovrAtlasImage& image);
+    // Reads and decodes an image file, for the formats DecodeTextureFromBuffer() handles without
+    // compression.
+    bool LoadImageFile(ovrFileSys& fileSys, char const* uri, ovrAtlasImage& image);
+    bool FindImage(char const* name, ovrAtlasImage& image) const;
+
+    // Rebuilds the mip levels of the pages that changed, through RunFrameGlTask() like the
+    // image uploads. The owning texture manager calls this from Update().
+    void Flush();
+
+    int GetNumPages() const {
+        return static_cast<int>(Pages.size());
+    }
+    int GetNumImages() const {
+        return static_cast<int>(Images.size());
+    }
+
+   private:
+    // repeated edge texels around each image; also the alignment of the packed rectangles
+    static const int PADDING = 4;
+    static const int MAX_MIP_LEVEL = 2;
+
+    struct ovrAtlasPage {
+        textureHandle_t Handle;
+        GlTexture Texture;
+        ovrSkylinePacker Packer;
+        bool Dirty;
+    };
+
+    bool AddPage();
+
+    ovrTextureManager* TextureManager;
+    int PageSize;
+    bool Enabled;
+    std::vector<ovrAtlasPage> Pages;
+    std::unordered_map<std::string, ovrAtlasImage> Images;
+    std::vector<uint8_t> Scratch;
+};
+
+} // namespace OVRFW
@@ -70,4 +70,23 @@ EaseFunction_t EaseFunctions[ovrEaseFunc::MAX] = {
     EaseFunc_Alpha_InOut_Cubic,
     EaseFunc_Alpha_InOut_Quadratic};
 
+Vector4f GetEaseFactors(const ovrEaseFunc easeFunc) {
+    switch (easeFunc) {
+        case IN_OUT_LINEAR:
+            return Vector4f(0.0f, 0.0f, 1.0f, 1.0f);
+        case IN_OUT_CUBIC:
+            return Vector4f(1.0f, 1.0f, 1.0f, 1.0f);
+        case IN_OUT_QUADRIC:
+            return Vector4f(1.0f, 0.0f, 1.0f, 1.0f);
+        case ALPHA_IN_OUT_LINEAR:
+            return Vector4f(0.0f, 0.0f, 0.0f, 1.0f);
+        case ALPHA_IN_OUT_CUBIC:
+            return Vector4f(1.0f, 1.0f, 0.0f, 1.0f);
+        case ALPHA_IN_OUT_QUADRIC:
+            return Vector4f(1.0f, 0.0f, 0.0f, 1.0f);
+        default:
+            return Vector4f(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+}
+
 } // namespace OVRFW
@@ -128,4 +128,9 @@ typedef OVR::Vector4f (*EaseFunction_t)(const OVR::Vector4f& c, const float t);
 
 extern EaseFunction_t EaseFunctions[ovrEaseFunc::MAX];
 
+// The in-out curves are all 2 * t^n up to t = 0.5 and 1 - 2 * ( t - 0.5 )^n after it. For
+// evaluating them without branching, x and y are 1 when the square and cube terms are used,
+// and z and w are 1 when the color and alpha are scaled by the curve.
+OVR::Vector4f GetEaseFactors(const ovrEaseFunc easeFunc);
+
 } // namespace OVRFW
@@ -429,6 +429,20 @@ void ovrEgl_DestroyContext(ovrEgl* egl) {
     }
 }
 
+void ovrEgl_MakeCurrent(const ovrEgl* egl) {
+    if (eglMakeCurrent(egl->Display, egl->TinySurface, egl->TinySurface, egl->Context) ==
+        EGL_FALSE) {
+        ALOGE("        eglMakeCurrent() failed: %s", EglErrorString(eglGetError()));
+    }
+}
+
+void ovrEgl_ReleaseCurrent(const ovrEgl* egl) {
+    if (eglMakeCurrent(egl->Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT) ==
+        EGL_FALSE) {
+        ALOGE("        eglMakeCurrent() failed: %s", EglErrorString(eglGetError()));
+    }
+}
+
 #else
 
 void ovrEgl_CreateContext(ovrEgl* egl, const ovrEgl* shareEgl) {
@@ -439,4 +453,12 @@ void ovrEgl_DestroyContext(ovrEgl* egl) {
     ovrGl_DestroyContext_Windows();
 }
 
+void ovrEgl_MakeCurrent(const ovrEgl* egl) {
+    wglMakeCurrent(egl->hDC, egl->hGLRC);
+}
+
+void ovrEgl_ReleaseCurrent(const ovrEgl* egl) {
+    wglMakeCurrent(NULL, NULL);
+}
+
 #endif // defined(ANDROID)
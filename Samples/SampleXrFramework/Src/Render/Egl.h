@@ -156,6 +156,9 @@ void EglInitExtensions();
 void ovrEgl_Clear(ovrEgl* egl);
 void ovrEgl_CreateContext(ovrEgl* egl, const ovrEgl* shareEgl);
 void ovrEgl_DestroyContext(ovrEgl* egl);
+// Binds / unbinds the context on the calling thread
+void ovrEgl_MakeCurrent(const ovrEgl* egl);
+void ovrEgl_ReleaseCurrent(const ovrEgl* egl);
 
 #if defined(ANDROID)
 // EGL_KHR_reusable_sync
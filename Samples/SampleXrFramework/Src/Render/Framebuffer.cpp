@@ -42,6 +42,7 @@ void ovrFramebuffer_Clear(ovrFramebuffer* frameBuffer) {
     frameBuffer->Width = 0;
     frameBuffer->Height = 0;
     frameBuffer->Multisamples = 0;
+    frameBuffer->NumViews = 1;
     frameBuffer->TextureSwapChainLength = 0;
     frameBuffer->TextureSwapChainIndex = 0;
     frameBuffer->ColorSwapChain.Handle = XR_NULL_HANDLE;
@@ -50,26 +51,18 @@ void ovrFramebuffer_Clear(ovrFramebuffer* frameBuffer) {
     frameBuffer->ColorSwapChainImage = NULL;
     frameBuffer->DepthBuffers = NULL;
     frameBuffer->FrameBuffers = NULL;
+    frameBuffer->ColorTexture = 0;
+    frameBuffer->LayerFrameBuffers[0] = 0;
+    frameBuffer->LayerFrameBuffers[1] = 0;
 }
 
-bool ovrFramebuffer_Create(
+static bool ovrFramebuffer_CreateSwapChain(
     XrSession session,
     ovrFramebuffer* frameBuffer,
     const GLenum colorFormat,
     const int width,
     const int height,
-    const int multisamples) {
-    PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT =
-        (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC)EglGetExtensionProc(
-            "glRenderbufferStorageMultisampleEXT");
-    PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT =
-        (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)EglGetExtensionProc(
-            "glFramebufferTexture2DMultisampleEXT");
-
-    frameBuffer->Width = width;
-    frameBuffer->Height = height;
-    frameBuffer->Multisamples = multisamples;
-
+    const int arraySize) {
     GLenum requestedGLFormat = colorFormat;
 
     // Get the number of supported formats.
@@ -105,14 +98,20 @@ bool ovrFramebuffer_Create(
     swapChainCreateInfo.width = width;
     swapChainCreateInfo.height = height;
     swapChainCreateInfo.faceCount = 1;
-    swapChainCreateInfo.arraySize = 1;
+    swapChainCreateInfo.arraySize = arraySize;
     swapChainCreateInfo.mipCount = 1;
 
     frameBuffer->ColorSwapChain.Width = swapChainCreateInfo.width;
     frameBuffer->ColorSwapChain.Height = swapChainCreateInfo.height;
 
     // Create the swapchain.
-    OXR(xrCreateSwapchain(session, &swapChainCreateInfo, &frameBuffer->ColorSwapChain.Handle));
+    XrResult result;
+    OXR(result = xrCreateSwapchain(
+            session, &swapChainCreateInfo, &frameBuffer->ColorSwapChain.Handle));
+    if (result != XR_SUCCESS) {
+        frameBuffer->ColorSwapChain.Handle = XR_NULL_HANDLE;
+        return false;
+    }
     // Get the number of swapchain images.
     OXR(xrEnumerateSwapchainImages(
         frameBuffer->ColorSwapChain.Handle, 0, &frameBuffer->TextureSwapChainLength, NULL));
@@ -140,6 +139,72 @@ bool ovrFramebuffer_Create(
         frameBuffer->TextureSwapChainLength,
         &frameBuffer->TextureSwapChainLength,
         (XrSwapchainImageBaseHeader*)frameBuffer->ColorSwapChainImage));
+    return true;
+}
+
+// Attaches the layers of 2D array textures to the bound draw framebuffer as multiview
+// attachments, and returns its status.
+static GLenum ovrFramebuffer_AttachMultiview(
+    const GLuint depthTexture,
+    const GLuint colorTexture,
+    const int multisamples,
+    const int numViews) {
+    PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glFramebufferTextureMultiviewOVR =
+        (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)EglGetExtensionProc(
+            "glFramebufferTextureMultiviewOVR");
+    PFNGLFRAMEBUFFERTEXTUREMULTISAMPLEMULTIVIEWOVRPROC
+        glFramebufferTextureMultisampleMultiviewOVR =
+            (PFNGLFRAMEBUFFERTEXTUREMULTISAMPLEMULTIVIEWOVRPROC)EglGetExtensionProc(
+                "glFramebufferTextureMultisampleMultiviewOVR");
+    if (glFramebufferTextureMultiviewOVR == NULL) {
+        ALOGE("glFramebufferTextureMultiviewOVR not found");
+        return GL_FRAMEBUFFER_UNSUPPORTED;
+    }
+
+    if (multisamples > 1 && glFramebufferTextureMultisampleMultiviewOVR != NULL) {
+        GL(glFramebufferTextureMultisampleMultiviewOVR(
+            GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, multisamples, 0, numViews));
+        GL(glFramebufferTextureMultisampleMultiviewOVR(
+            GL_DRAW_FRAMEBUFFER,
+            GL_COLOR_ATTACHMENT0,
+            colorTexture,
+            0,
+            multisamples,
+            0,
+            numViews));
+    } else {
+        GL(glFramebufferTextureMultiviewOVR(
+            GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, 0, numViews));
+        GL(glFramebufferTextureMultiviewOVR(
+            GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0, 0, numViews));
+    }
+    GL(const GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER));
+    return status;
+}
+
+bool ovrFramebuffer_Create(
+    XrSession session,
+    ovrFramebuffer* frameBuffer,
+    const GLenum colorFormat,
+    const int width,
+    const int height,
+    const int multisamples) {
+    PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT =
+        (PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC)EglGetExtensionProc(
+            "glRenderbufferStorageMultisampleEXT");
+    PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC glFramebufferTexture2DMultisampleEXT =
+        (PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)EglGetExtensionProc(
+            "glFramebufferTexture2DMultisampleEXT");
+
+    ovrFramebuffer_Clear(frameBuffer);
+    frameBuffer->Width = width;
+    frameBuffer->Height = height;
+    frameBuffer->Multisamples = multisamples;
+    frameBuffer->NumViews = 1;
+
+    if (!ovrFramebuffer_CreateSwapChain(session, frameBuffer, colorFormat, width, height, 1)) {
+        return false;
+    }
 
     frameBuffer->DepthBuffers =
         (GLuint*)malloc(frameBuffer->TextureSwapChainLength * sizeof(GLuint));
@@ -222,10 +287,183 @@ bool ovrFramebuffer_Create(
     return true;
 }
 
+bool ovrFramebuffer_SupportsMultiview(const GLenum colorFormat, const int multisamples) {
+    const int size = 16;
+    const int numViews = 2;
+    GLuint textures[2];
+    GL(glGenTextures(2, textures));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, textures[0]));
+    GL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, size, size, numViews));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, textures[1]));
+    GL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, colorFormat, size, size, numViews));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    GLuint frameBuffer;
+    GL(glGenFramebuffers(1, &frameBuffer));
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer));
+    const GLenum status =
+        ovrFramebuffer_AttachMultiview(textures[0], textures[1], multisamples, numViews);
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    GL(glDeleteFramebuffers(1, &frameBuffer));
+    GL(glDeleteTextures(2, textures));
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        ALOGW("Multiview frame buffers are not supported: %s", GlFrameBufferStatusString(status));
+        return false;
+    }
+    return true;
+}
+
+bool ovrFramebuffer_CreateMultiview(
+    XrSession session,
+    ovrFramebuffer* frameBuffer,
+    const GLenum colorFormat,
+    const int width,
+    const int height,
+    const int multisamples) {
+    ovrFramebuffer_Clear(frameBuffer);
+    frameBuffer->Width = width;
+    frameBuffer->Height = height;
+    frameBuffer->Multisamples = multisamples;
+    frameBuffer->NumViews = 2;
+
+    if (!ovrFramebuffer_CreateSwapChain(
+            session, frameBuffer, colorFormat, width, height, frameBuffer->NumViews)) {
+        ALOGE("Failed to create the %d layer swapchain", frameBuffer->NumViews);
+        ovrFramebuffer_Destroy(frameBuffer);
+        return false;
+    }
+
+    // zeroed, so a partially created frame buffer can be destroyed
+    frameBuffer->DepthBuffers =
+        (GLuint*)calloc(frameBuffer->TextureSwapChainLength, sizeof(GLuint));
+    frameBuffer->FrameBuffers =
+        (GLuint*)calloc(frameBuffer->TextureSwapChainLength, sizeof(GLuint));
+
+    for (uint32_t i = 0; i < frameBuffer->TextureSwapChainLength; i++) {
+        const GLuint colorTexture = frameBuffer->ColorSwapChainImage[i].image;
+
+        GLenum colorTextureTarget = GL_TEXTURE_2D_ARRAY;
+        GL(glBindTexture(colorTextureTarget, colorTexture));
+        GL(glTexParameteri(colorTextureTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL(glTexParameteri(colorTextureTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL(glTexParameteri(colorTextureTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL(glTexParameteri(colorTextureTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL(glBindTexture(colorTextureTarget, 0));
+
+        // Depth has to be a texture array as well, multiview can't attach a renderbuffer.
+        GL(glGenTextures(1, &frameBuffer->DepthBuffers[i]));
+        GL(glBindTexture(GL_TEXTURE_2D_ARRAY, frameBuffer->DepthBuffers[i]));
+        GL(glTexStorage3D(
+            GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, width, height, frameBuffer->NumViews));
+        GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+        GL(glGenFramebuffers(1, &frameBuffer->FrameBuffers[i]));
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer->FrameBuffers[i]));
+        const GLenum renderFramebufferStatus = ovrFramebuffer_AttachMultiview(
+            frameBuffer->DepthBuffers[i], colorTexture, multisamples, frameBuffer->NumViews);
+        GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+        if (renderFramebufferStatus != GL_FRAMEBUFFER_COMPLETE) {
+            ALOGE(
+                "Incomplete multiview frame buffer object: %s",
+                GlFrameBufferStatusString(renderFramebufferStatus));
+            ovrFramebuffer_Destroy(frameBuffer);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ovrFramebuffer_CreateMultiviewTarget(
+    ovrFramebuffer* frameBuffer,
+    const GLenum colorFormat,
+    const int width,
+    const int height,
+    const int multisamples) {
+    ovrFramebuffer_Clear(frameBuffer);
+    frameBuffer->Width = width;
+    frameBuffer->Height = height;
+    frameBuffer->Multisamples = multisamples;
+    frameBuffer->NumViews = 2;
+    frameBuffer->TextureSwapChainLength = 1;
+    frameBuffer->DepthBuffers = (GLuint*)calloc(1, sizeof(GLuint));
+    frameBuffer->FrameBuffers = (GLuint*)calloc(1, sizeof(GLuint));
+
+    GL(glGenTextures(1, &frameBuffer->ColorTexture));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, frameBuffer->ColorTexture));
+    GL(glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, colorFormat, width, height, frameBuffer->NumViews));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL(glGenTextures(1, &frameBuffer->DepthBuffers[0]));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, frameBuffer->DepthBuffers[0]));
+    GL(glTexStorage3D(
+        GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, width, height, frameBuffer->NumViews));
+    GL(glBindTexture(GL_TEXTURE_2D_ARRAY, 0));
+
+    GL(glGenFramebuffers(1, &frameBuffer->FrameBuffers[0]));
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffer->FrameBuffers[0]));
+    const GLenum renderFramebufferStatus = ovrFramebuffer_AttachMultiview(
+        frameBuffer->DepthBuffers[0],
+        frameBuffer->ColorTexture,
+        multisamples,
+        frameBuffer->NumViews);
+    GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    if (renderFramebufferStatus != GL_FRAMEBUFFER_COMPLETE) {
+        ALOGE(
+            "Incomplete multiview frame buffer object: %s",
+            GlFrameBufferStatusString(renderFramebufferStatus));
+        ovrFramebuffer_Destroy(frameBuffer);
+        return false;
+    }
+
+    // the multisampled attachments resolve into the layers, which are blitted from there
+    GL(glGenFramebuffers(frameBuffer->NumViews, frameBuffer->LayerFrameBuffers));
+    for (int layer = 0; layer < frameBuffer->NumViews; layer++) {
+        GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer->LayerFrameBuffers[layer]));
+        GL(glFramebufferTextureLayer(
+            GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, frameBuffer->ColorTexture, 0, layer));
+    }
+    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    return true;
+}
+
+void ovrFramebuffer_BlitLayer(
+    const ovrFramebuffer* multiviewTarget,
+    const int layer,
+    ovrFramebuffer* frameBuffer) {
+    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, multiviewTarget->LayerFrameBuffers[layer]));
+    GL(glBindFramebuffer(
+        GL_DRAW_FRAMEBUFFER, frameBuffer->FrameBuffers[frameBuffer->TextureSwapChainIndex]));
+    GL(glDisable(GL_SCISSOR_TEST));
+    GL(glBlitFramebuffer(
+        0,
+        0,
+        multiviewTarget->Width,
+        multiviewTarget->Height,
+        0,
+        0,
+        frameBuffer->Width,
+        frameBuffer->Height,
+        GL_COLOR_BUFFER_BIT,
+        GL_LINEAR));
+    GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+}
+
 void ovrFramebuffer_Destroy(ovrFramebuffer* frameBuffer) {
+    if (frameBuffer->ColorTexture != 0) {
+        GL(glDeleteFramebuffers(frameBuffer->NumViews, frameBuffer->LayerFrameBuffers));
+        GL(glDeleteTextures(1, &frameBuffer->ColorTexture));
+    }
     GL(glDeleteFramebuffers(frameBuffer->TextureSwapChainLength, frameBuffer->FrameBuffers));
-    GL(glDeleteRenderbuffers(frameBuffer->TextureSwapChainLength, frameBuffer->DepthBuffers));
-    OXR(xrDestroySwapchain(frameBuffer->ColorSwapChain.Handle));
+    if (frameBuffer->NumViews > 1) {
+        GL(glDeleteTextures(frameBuffer->TextureSwapChainLength, frameBuffer->DepthBuffers));
+    } else {
+        GL(glDeleteRenderbuffers(frameBuffer->TextureSwapChainLength, frameBuffer->DepthBuffers));
+    }
+    if (frameBuffer->ColorSwapChain.Handle != XR_NULL_HANDLE) {
+        OXR(xrDestroySwapchain(frameBuffer->ColorSwapChain.Handle));
+    }
     free(frameBuffer->ColorSwapChainImage);
     free(frameBuffer->DepthBuffers);
     free(frameBuffer->FrameBuffers);
@@ -249,6 +487,10 @@ void ovrFramebuffer_Resolve(ovrFramebuffer* frameBuffer) {
 }
 
 void ovrFramebuffer_Acquire(ovrFramebuffer* frameBuffer) {
+    if (frameBuffer->ColorSwapChain.Handle == XR_NULL_HANDLE) {
+        return; // a multiview target, always image 0
+    }
+
     // Acquire the swapchain image
     XrSwapchainImageAcquireInfo acquireInfo = {XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
     OXR(xrAcquireSwapchainImage(
@@ -270,6 +512,9 @@ void ovrFramebuffer_Acquire(ovrFramebuffer* frameBuffer) {
 }
 
 void ovrFramebuffer_Release(ovrFramebuffer* frameBuffer) {
+    if (frameBuffer->ColorSwapChain.Handle == XR_NULL_HANDLE) {
+        return;
+    }
     XrSwapchainImageReleaseInfo releaseInfo = {XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
     OXR(xrReleaseSwapchainImage(frameBuffer->ColorSwapChain.Handle, &releaseInfo));
 }
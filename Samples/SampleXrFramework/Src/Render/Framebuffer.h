@@ -87,6 +87,7 @@ typedef struct ovrFramebuffer_s {
     int Width;
     int Height;
     int Multisamples;
+    int NumViews; // 2 for a layered multiview framebuffer holding both eyes
     uint32_t TextureSwapChainLength;
     uint32_t TextureSwapChainIndex;
     struct ovrSwapChain ColorSwapChain;
@@ -97,6 +98,8 @@ typedef struct ovrFramebuffer_s {
 #endif // defined(XR_USE_GRAPHICS_API_OPENGL_ES)
     GLuint* DepthBuffers;
     GLuint* FrameBuffers;
+    GLuint ColorTexture; // 2 layer color texture of a multiview target without a swapchain
+    GLuint LayerFrameBuffers[2]; // read framebuffers on each layer of ColorTexture
 } ovrFramebuffer;
 
 void ovrFramebuffer_Clear(ovrFramebuffer* frameBuffer);
@@ -107,6 +110,34 @@ bool ovrFramebuffer_Create(
     const int width,
     const int height,
     const int multisamples);
+// Creates a single framebuffer for both eyes on a 2 layer swapchain, rendered with
+// GL_OVR_multiview2. Depth is a matching 2 layer texture array. Returns false, with nothing
+// left to destroy, when the swapchain or the framebuffer can't be created.
+bool ovrFramebuffer_CreateMultiview(
+    XrSession session,
+    ovrFramebuffer* frameBuffer,
+    const GLenum colorFormat,
+    const int width,
+    const int height,
+    const int multisamples);
+// Like ovrFramebuffer_CreateMultiview(), but on a 2 layer color texture of its own instead of a
+// swapchain, for when the runtime can't create the 2 layer swapchain. Acquire and release do
+// nothing, and ovrFramebuffer_BlitLayer() copies each eye out to a swapchain.
+bool ovrFramebuffer_CreateMultiviewTarget(
+    ovrFramebuffer* frameBuffer,
+    const GLenum colorFormat,
+    const int width,
+    const int height,
+    const int multisamples);
+// Checks with small textures, before there is a session, that the driver completes
+// framebuffers like the ones ovrFramebuffer_CreateMultiview() makes.
+bool ovrFramebuffer_SupportsMultiview(const GLenum colorFormat, const int multisamples);
+// Copies a layer of a multiview target into the acquired image of a single view framebuffer,
+// which must not be multisampled.
+void ovrFramebuffer_BlitLayer(
+    const ovrFramebuffer* multiviewTarget,
+    const int layer,
+    ovrFramebuffer* frameBuffer);
 void ovrFramebuffer_Destroy(ovrFramebuffer* frameBuffer);
 void ovrFramebuffer_SetCurrent(ovrFramebuffer* frameBuffer);
 void ovrFramebuffer_SetNone();
@@ -29,6 +29,10 @@ Authors     :   John Carmack, J.M.P. van Waveren
 #include "GlProgram.h"
 #include "Misc/Log.h"
 #include "Egl.h"
+#include "GlStreamBuffer.h"
+
+#include <algorithm>
+#include <cmath>
 
 using OVR::Bounds3f;
 using OVR::Vector2f;
@@ -66,7 +70,9 @@ void PackVertexAttribute(
     const std::vector<_attrib_type_>& attrib,
     const int glLocation,
     const int glType,
-    const int glComponents) {
+    const int glComponents,
+    const size_t baseOffset = 0,
+    const bool normalized = false) {
     if (attrib.size() > 0) {
         const size_t offset = packed.size();
         const size_t size = attrib.size() * sizeof(attrib[0]);
@@ -76,13 +82,175 @@ void PackVertexAttribute(
 
         glEnableVertexAttribArray(glLocation);
         glVertexAttribPointer(
-            glLocation, glComponents, glType, false, sizeof(attrib[0]), (void*)(offset));
+            glLocation,
+            glComponents,
+            glType,
+            normalized,
+            sizeof(attrib[0]),
+            (void*)(baseOffset + offset));
     } else {
         glDisableVertexAttribArray(glLocation);
     }
 }
 
-void GlGeometry::Create(const VertexAttribs& attribs, const std::vector<TriangleIndex>& indices) {
+template <typename _component_type_, int _components_>
+struct ovrQuantizedVector {
+    _component_type_ c[_components_];
+};
+
+// Packs each float component of the attribute as convert(value).
+template <typename _component_type_, int _components_, typename _attrib_type_, typename _convert_>
+void PackQuantizedVertexAttribute(
+    std::vector<uint8_t>& packed,
+    const std::vector<_attrib_type_>& attrib,
+    const int glLocation,
+    const int glType,
+    const bool normalized,
+    const _convert_& convert) {
+    static_assert(sizeof(_attrib_type_) == sizeof(float) * _components_, "");
+    const float* values = reinterpret_cast<const float*>(attrib.data());
+    std::vector<ovrQuantizedVector<_component_type_, _components_>> quantized(attrib.size());
+    for (size_t i = 0; i < attrib.size(); ++i) {
+        for (int k = 0; k < _components_; ++k) {
+            quantized[i].c[k] = convert(values[i * _components_ + k]);
+        }
+    }
+    PackVertexAttribute(packed, quantized, glLocation, glType, _components_, 0, normalized);
+}
+
+template <typename _attrib_type_>
+static bool AllComponentsInRange(
+    const std::vector<_attrib_type_>& attrib,
+    const float low,
+    const float high) {
+    const float* values = reinterpret_cast<const float*>(attrib.data());
+    const size_t count = attrib.size() * sizeof(_attrib_type_) / sizeof(float);
+    for (size_t i = 0; i < count; ++i) {
+        if (!(values[i] >= low && values[i] <= high)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Texture coordinates go in 16 bit normalized integers when they fit, as half floats are only
+// good to a texel of a 1024 texture past 1.0. Colors that are not in [0, 1] go in half floats.
+static int GetQuantizedTexCoordType(const std::vector<OVR::Vector2f>& uv) {
+    if (AllComponentsInRange(uv, 0.0f, 1.0f)) {
+        return GL_UNSIGNED_SHORT;
+    }
+    if (AllComponentsInRange(uv, -1.0f, 1.0f)) {
+        return GL_SHORT;
+    }
+    return GL_FLOAT;
+}
+
+static int GetQuantizedColorType(const std::vector<OVR::Vector4f>& color) {
+    return AllComponentsInRange(color, 0.0f, 1.0f) ? GL_UNSIGNED_BYTE : GL_HALF_FLOAT;
+}
+
+static uint16_t FloatToHalf(const float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    const uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent <= 0) {
+        return sign; // flush denormals to zero
+    }
+    if (exponent >= 31) {
+        return sign | 0x7BFF; // clamp to the largest half
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    half += (mantissa >> 12) & 1; // round, carrying into the exponent if needed
+    return sign | static_cast<uint16_t>(std::min(half, 0x7BFFu));
+}
+
+static uint32_t PackSnorm10(const float value) {
+    const float clamped = std::max(-1.0f, std::min(1.0f, value));
+    return static_cast<uint32_t>(static_cast<int32_t>(roundf(clamped * 511.0f))) & 0x3FF;
+}
+
+static void PackUnitVectors(
+    std::vector<uint8_t>& packed,
+    const std::vector<OVR::Vector3f>& vectors,
+    const int glLocation) {
+    std::vector<uint32_t> quantized(vectors.size());
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        quantized[i] = PackSnorm10(vectors[i].x) | (PackSnorm10(vectors[i].y) << 10) |
+            (PackSnorm10(vectors[i].z) << 20);
+    }
+    PackVertexAttribute(packed, quantized, glLocation, GL_INT_2_10_10_10_REV, 4, 0, true);
+}
+
+static void PackTexCoords(
+    std::vector<uint8_t>& packed,
+    const std::vector<OVR::Vector2f>& uv,
+    const int glLocation) {
+    switch (GetQuantizedTexCoordType(uv)) {
+        case GL_UNSIGNED_SHORT:
+            PackQuantizedVertexAttribute<uint16_t, 2>(
+                packed, uv, glLocation, GL_UNSIGNED_SHORT, true, [](const float v) {
+                    return static_cast<uint16_t>(v * 65535.0f + 0.5f);
+                });
+            break;
+        case GL_SHORT:
+            PackQuantizedVertexAttribute<int16_t, 2>(
+                packed, uv, glLocation, GL_SHORT, true, [](const float v) {
+                    return static_cast<int16_t>(roundf(v * 32767.0f));
+                });
+            break;
+        default:
+            PackVertexAttribute(packed, uv, glLocation, GL_FLOAT, 2);
+            break;
+    }
+}
+
+static void PackColors(std::vector<uint8_t>& packed, const std::vector<OVR::Vector4f>& color) {
+    if (GetQuantizedColorType(color) == GL_UNSIGNED_BYTE) {
+        PackQuantizedVertexAttribute<uint8_t, 4>(
+            packed, color, VERTEX_ATTRIBUTE_LOCATION_COLOR, GL_UNSIGNED_BYTE, true, [](float v) {
+                return static_cast<uint8_t>(v * 255.0f + 0.5f);
+            });
+    } else {
+        PackQuantizedVertexAttribute<uint16_t, 4>(
+            packed, color, VERTEX_ATTRIBUTE_LOCATION_COLOR, GL_HALF_FLOAT, false, FloatToHalf);
+    }
+}
+
+size_t GlGeometry::GetVertexSize(const VertexAttribs& attribs, const VertexFormat format) {
+    const auto channelSize = [](const size_t count, const size_t size) {
+        return count > 0 ? size : 0;
+    };
+    size_t size = channelSize(attribs.position.size(), sizeof(OVR::Vector3f)) +
+        channelSize(attribs.jointIndices.size(), sizeof(OVR::Vector4i)) +
+        channelSize(attribs.jointWeights.size(), sizeof(OVR::Vector4f));
+    if (format == VERTEX_FORMAT_QUANTIZED) {
+        const auto uvSize = [](const std::vector<OVR::Vector2f>& uv) {
+            return uv.empty() ? 0 : GetQuantizedTexCoordType(uv) == GL_FLOAT ? 8 : 4;
+        };
+        size += channelSize(attribs.normal.size(), sizeof(uint32_t)) +
+            channelSize(attribs.tangent.size(), sizeof(uint32_t)) +
+            channelSize(attribs.binormal.size(), sizeof(uint32_t)) + uvSize(attribs.uv0) +
+            uvSize(attribs.uv1);
+        if (!attribs.color.empty()) {
+            size += GetQuantizedColorType(attribs.color) == GL_UNSIGNED_BYTE ? 4 : 8;
+        }
+    } else {
+        size += channelSize(attribs.normal.size(), sizeof(OVR::Vector3f)) +
+            channelSize(attribs.tangent.size(), sizeof(OVR::Vector3f)) +
+            channelSize(attribs.binormal.size(), sizeof(OVR::Vector3f)) +
+            channelSize(attribs.color.size(), sizeof(OVR::Vector4f)) +
+            channelSize(attribs.uv0.size(), sizeof(OVR::Vector2f)) +
+            channelSize(attribs.uv1.size(), sizeof(OVR::Vector2f));
+    }
+    return size;
+}
+
+void GlGeometry::Create(
+    const VertexAttribs& attribs,
+    const std::vector<TriangleIndex>& indices,
+    const VertexFormat format) {
     vertexCount = attribs.position.size();
     indexCount = indices.size();
 
@@ -127,15 +295,29 @@ void GlGeometry::Create(const VertexAttribs& attribs, const std::vector<Triangle
     std::vector<uint8_t> packed;
     PackVertexAttribute(
         packed, t ? position : attribs.position, VERTEX_ATTRIBUTE_LOCATION_POSITION, GL_FLOAT, 3);
-    PackVertexAttribute(
-        packed, t ? normal : attribs.normal, VERTEX_ATTRIBUTE_LOCATION_NORMAL, GL_FLOAT, 3);
-    PackVertexAttribute(
-        packed, t ? tangent : attribs.tangent, VERTEX_ATTRIBUTE_LOCATION_TANGENT, GL_FLOAT, 3);
-    PackVertexAttribute(
-        packed, t ? binormal : attribs.binormal, VERTEX_ATTRIBUTE_LOCATION_BINORMAL, GL_FLOAT, 3);
-    PackVertexAttribute(packed, attribs.color, VERTEX_ATTRIBUTE_LOCATION_COLOR, GL_FLOAT, 4);
-    PackVertexAttribute(packed, attribs.uv0, VERTEX_ATTRIBUTE_LOCATION_UV0, GL_FLOAT, 2);
-    PackVertexAttribute(packed, attribs.uv1, VERTEX_ATTRIBUTE_LOCATION_UV1, GL_FLOAT, 2);
+    if (format == VERTEX_FORMAT_QUANTIZED) {
+        PackUnitVectors(packed, t ? normal : attribs.normal, VERTEX_ATTRIBUTE_LOCATION_NORMAL);
+        PackUnitVectors(packed, t ? tangent : attribs.tangent, VERTEX_ATTRIBUTE_LOCATION_TANGENT);
+        PackUnitVectors(
+            packed, t ? binormal : attribs.binormal, VERTEX_ATTRIBUTE_LOCATION_BINORMAL);
+        PackColors(packed, attribs.color);
+        PackTexCoords(packed, attribs.uv0, VERTEX_ATTRIBUTE_LOCATION_UV0);
+        PackTexCoords(packed, attribs.uv1, VERTEX_ATTRIBUTE_LOCATION_UV1);
+    } else {
+        PackVertexAttribute(
+            packed, t ? normal : attribs.normal, VERTEX_ATTRIBUTE_LOCATION_NORMAL, GL_FLOAT, 3);
+        PackVertexAttribute(
+            packed, t ? tangent : attribs.tangent, VERTEX_ATTRIBUTE_LOCATION_TANGENT, GL_FLOAT, 3);
+        PackVertexAttribute(
+            packed,
+            t ? binormal : attribs.binormal,
+            VERTEX_ATTRIBUTE_LOCATION_BINORMAL,
+            GL_FLOAT,
+            3);
+        PackVertexAttribute(packed, attribs.color, VERTEX_ATTRIBUTE_LOCATION_COLOR, GL_FLOAT, 4);
+        PackVertexAttribute(packed, attribs.uv0, VERTEX_ATTRIBUTE_LOCATION_UV0, GL_FLOAT, 2);
+        PackVertexAttribute(packed, attribs.uv1, VERTEX_ATTRIBUTE_LOCATION_UV1, GL_FLOAT, 2);
+    }
     PackVertexAttribute(
         packed, attribs.jointIndices, VERTEX_ATTRIBUTE_LOCATION_JOINT_INDICES, GL_INT, 4);
     PackVertexAttribute(
@@ -170,6 +352,12 @@ void GlGeometry::Create(const VertexAttribs& attribs, const std::vector<Triangle
 }
 
 void GlGeometry::Update(const VertexAttribs& attribs, const bool updateBounds) {
+    if (GetFrameGlTasks() != nullptr) {
+        // built without the GL context, the frame's draw thread uploads it
+        RunFrameGlTask([this, attribs, updateBounds]() { Update(attribs, updateBounds); });
+        return;
+    }
+
     vertexCount = attribs.position.size();
 
     glBindVertexArray(vertexArrayObject);
@@ -199,6 +387,85 @@ void GlGeometry::Update(const VertexAttribs& attribs, const bool updateBounds) {
     }
 }
 
+void GlGeometry::UpdateStreamed(const VertexAttribs& attribs, const bool updateBounds) {
+    if (GetFrameGlTasks() != nullptr) {
+        // only the thread that draws the frame has its stream buffer
+        RunFrameGlTask([this, attribs, updateBounds]() { UpdateStreamed(attribs, updateBounds); });
+        return;
+    }
+
+    GlStreamBuffer* stream = GetFrameStreamBuffer();
+    if (stream == nullptr) {
+        Update(attribs, updateBounds);
+        return;
+    }
+
+    // Packing sets the attribute pointers as it goes, so the stream offset has to be known
+    // first. Reserve the packed size up front.
+    const size_t packedSize = attribs.position.size() * sizeof(attribs.position[0]) +
+        attribs.normal.size() * sizeof(attribs.normal[0]) +
+        attribs.tangent.size() * sizeof(attribs.tangent[0]) +
+        attribs.binormal.size() * sizeof(attribs.binormal[0]) +
+        attribs.color.size() * sizeof(attribs.color[0]) +
+        attribs.uv0.size() * sizeof(attribs.uv0[0]) + attribs.uv1.size() * sizeof(attribs.uv1[0]) +
+        attribs.jointIndices.size() * sizeof(attribs.jointIndices[0]) +
+        attribs.jointWeights.size() * sizeof(attribs.jointWeights[0]);
+    size_t baseOffset = 0;
+    void* dst = stream->Map(packedSize, sizeof(float) * 4, baseOffset);
+    if (dst == NULL) {
+        Update(attribs, updateBounds);
+        return;
+    }
+
+    vertexCount = attribs.position.size();
+
+    glBindVertexArray(vertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->GetBuffer());
+
+    std::vector<uint8_t> packed;
+    packed.reserve(packedSize);
+    PackVertexAttribute(
+        packed, attribs.position, VERTEX_ATTRIBUTE_LOCATION_POSITION, GL_FLOAT, 3, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.normal, VERTEX_ATTRIBUTE_LOCATION_NORMAL, GL_FLOAT, 3, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.tangent, VERTEX_ATTRIBUTE_LOCATION_TANGENT, GL_FLOAT, 3, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.binormal, VERTEX_ATTRIBUTE_LOCATION_BINORMAL, GL_FLOAT, 3, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.color, VERTEX_ATTRIBUTE_LOCATION_COLOR, GL_FLOAT, 4, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.uv0, VERTEX_ATTRIBUTE_LOCATION_UV0, GL_FLOAT, 2, baseOffset);
+    PackVertexAttribute(
+        packed, attribs.uv1, VERTEX_ATTRIBUTE_LOCATION_UV1, GL_FLOAT, 2, baseOffset);
+    PackVertexAttribute(
+        packed,
+        attribs.jointIndices,
+        VERTEX_ATTRIBUTE_LOCATION_JOINT_INDICES,
+        GL_INT,
+        4,
+        baseOffset);
+    PackVertexAttribute(
+        packed,
+        attribs.jointWeights,
+        VERTEX_ATTRIBUTE_LOCATION_JOINT_WEIGHTS,
+        GL_FLOAT,
+        4,
+        baseOffset);
+
+    memcpy(dst, packed.data(), packed.size());
+    stream->Unmap();
+
+    glBindVertexArray(0);
+
+    if (updateBounds) {
+        localBounds.Clear();
+        for (int i = 0; i < vertexCount; i++) {
+            localBounds.AddPoint(attribs.position[i]);
+        }
+    }
+}
+
 void GlGeometry::Free() {
     glDeleteVertexArrays(1, &vertexArrayObject);
     glDeleteBuffers(1, &indexBuffer);
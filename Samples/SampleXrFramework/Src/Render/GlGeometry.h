@@ -53,6 +53,14 @@ class GlGeometry {
     static constexpr uint32_t kPrimitiveTypeTriangles = 0x0004; /* GL_TRIANGLES */
     static constexpr uint32_t kPrimitiveTypeTriangleFan = 0x0006; /* GL_TRIANGLE_FAN */
 
+    // How Create() stores the vertices. Quantized geometry keeps positions and skinning in
+    // floats, and stores the normal, tangent and binormal as normalized 10:10:10:2 integers, the
+    // texture coordinates as unsigned normalized 16 bit integers when they are in [0, 1], as
+    // signed ones when they are in [-1, 1] and as floats otherwise, and the colors as normalized
+    // bytes when they are in [0, 1] and as half floats otherwise. The shaders see the same
+    // values either way, up to the precision.
+    enum VertexFormat { VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_QUANTIZED };
+
    public:
     GlGeometry()
         : vertexBuffer(0),
@@ -75,8 +83,17 @@ class GlGeometry {
     }
 
     // Create the VAO and vertex and index buffers from arrays of data.
-    void Create(const VertexAttribs& attribs, const std::vector<TriangleIndex>& indices);
+    void Create(
+        const VertexAttribs& attribs,
+        const std::vector<TriangleIndex>& indices,
+        const VertexFormat format = VERTEX_FORMAT_FLOAT);
+    // While a frame is built without the GL context, the upload and the fields it sets wait
+    // for the thread that draws the frame, so the geometry has to outlive the frame.
     void Update(const VertexAttribs& attribs, const bool updateBounds = true);
+    // Like Update, but writes the vertices into the frame stream buffer when there is one.
+    // The vertices are only valid for the current frame, so only use this for geometry
+    // that is rewritten every frame it is drawn.
+    void UpdateStreamed(const VertexAttribs& attribs, const bool updateBounds = true);
 
     // Free the buffers and VAO, assuming that they are strictly for this geometry.
     // We could save some overhead by packing an entire model into a single buffer, but
@@ -97,6 +114,9 @@ class GlGeometry {
 
     static unsigned IndexType; // GL_UNSIGNED_SHORT, GL_UNSIGNED_INT, etc.
 
+    // Bytes per vertex Create() uploads for these attributes in this format.
+    static size_t GetVertexSize(const VertexAttribs& attribs, const VertexFormat format);
+
     class TransformScope {
        public:
         TransformScope(const OVR::Matrix4f m, bool enableTransfom = true);
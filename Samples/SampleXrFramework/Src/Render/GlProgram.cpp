@@ -26,6 +26,7 @@ Authors     :   John Carmack
 *************************************************************************************/
 
 #include "GlProgram.h"
+#include "GlProgramCache.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -40,6 +41,7 @@ Authors     :   John Carmack
 
 namespace OVRFW {
 static bool UseMultiview = false;
+static bool UseInstanceBatching = false;
 
 GlProgram::MultiViewScope::MultiViewScope(bool enableMultView) {
     wasEnabled = UseMultiview;
@@ -67,7 +69,21 @@ static const char* VertexHeader =
   #define VIEW_ID ViewID
 #endif
 
+#ifndef ENABLE_INSTANCE_BATCHING
+ #define ENABLE_INSTANCE_BATCHING 0
+#endif
+#if ENABLE_INSTANCE_BATCHING
+#define MAX_BATCH_INSTANCES 64
+uniform highp mat4 SurfaceModelMatrix;
+uniform lowp int InstanceBatch;
+uniform InstanceMatrices
+{
+	highp mat4 ModelMatrices[MAX_BATCH_INSTANCES];
+} im;
+#define ModelMatrix (InstanceBatch != 0 ? im.ModelMatrices[gl_InstanceID] : SurfaceModelMatrix)
+#else
 uniform highp mat4 ModelMatrix;
+#endif
 
 // Use a ubo in v300 path to workaround corruption issue on Adreno 420+v300
 // when uniform array of matrices used.
@@ -110,8 +126,11 @@ static const char* FindShaderVersionEnd(const char* src) {
     return src;
 }
 
-static GLuint
-CompileShader(GLenum shaderType, const char* directives, const char* src, GLint programVersion) {
+static std::string ComposeShaderSource(
+    GLenum shaderType,
+    const char* directives,
+    const char* src,
+    GLint programVersion) {
     assert(programVersion >= 300);
 
     const char* postVersion = FindShaderVersionEnd(src);
@@ -131,6 +150,8 @@ CompileShader(GLenum shaderType, const char* directives, const char* src, GLint
     // are corrupted. Determine why.
     srcString += std::string("#define DISABLE_MULTIVIEW ") + std::to_string(UseMultiview ? 0 : 1) +
         std::string("\n");
+    srcString += std::string("#define ENABLE_INSTANCE_BATCHING ") +
+        std::to_string(UseInstanceBatching ? 1 : 0) + std::string("\n");
 
     if (shaderType == GL_VERTEX_SHADER) {
         srcString.append(VertexHeader);
@@ -139,8 +160,11 @@ CompileShader(GLenum shaderType, const char* directives, const char* src, GLint
     }
 
     srcString.append(postVersion);
+    return srcString;
+}
 
-    src = srcString.c_str();
+static GLuint CompileShader(GLenum shaderType, const std::string& srcString) {
+    const char* src = srcString.c_str();
 
     GLuint shader = glCreateShader(shaderType);
 
@@ -189,6 +213,111 @@ CompileShader(GLenum shaderType, const char* directives, const char* src, GLint
     return shader;
 }
 
+static void BindAttributeLocations(GLuint program) {
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_POSITION, "Position");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_NORMAL, "Normal");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_TANGENT, "Tangent");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_BINORMAL, "Binormal");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_COLOR, "VertexColor");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_UV0, "TexCoord");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_UV1, "TexCoord1");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_JOINT_INDICES, "JointIndices");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_JOINT_WEIGHTS, "JointWeights");
+    glBindAttribLocation(program, VERTEX_ATTRIBUTE_LOCATION_FONT_PARMS, "FontParms");
+}
+
+static void LookupUniforms(GlProgram& p, const ovrProgramParm* parms, const int numParms) {
+    //--------------------------
+    // Determine Uniform Parm Location and Binding.
+    //--------------------------
+
+    p.numTextureBindings = 0;
+    p.numUniformBufferBindings = 0;
+
+    // Globally-defined system level uniforms.
+    {
+        p.ViewID.Type = ovrProgramParmType::INT;
+        p.ViewID.Location = glGetUniformLocation(p.Program, "ViewID");
+        p.ViewID.Binding = p.ViewID.Location;
+
+        p.SceneMatrices.Type = ovrProgramParmType::BUFFER_UNIFORM;
+        p.SceneMatrices.Location = glGetUniformBlockIndex(p.Program, "SceneMatrices");
+        if (p.SceneMatrices.Location >= 0) // this won't be present for v100 shaders.
+        {
+            p.SceneMatrices.Binding = p.numUniformBufferBindings++;
+            glUniformBlockBinding(p.Program, p.SceneMatrices.Location, p.SceneMatrices.Binding);
+        }
+
+        p.ModelMatrix.Type = ovrProgramParmType::FLOAT_MATRIX4;
+        p.ModelMatrix.Location = glGetUniformLocation(p.Program, "ModelMatrix");
+        if (p.ModelMatrix.Location < 0) {
+            // built with instance batching, where ModelMatrix is a macro
+            p.ModelMatrix.Location = glGetUniformLocation(p.Program, "SurfaceModelMatrix");
+        }
+        p.ModelMatrix.Binding = p.ModelMatrix.Location;
+
+        p.InstanceMatrices.Type = ovrProgramParmType::BUFFER_UNIFORM;
+        p.InstanceMatrices.Location = glGetUniformBlockIndex(p.Program, "InstanceMatrices");
+        if (p.InstanceMatrices.Location >= 0) {
+            p.InstanceMatrices.Binding = p.numUniformBufferBindings++;
+            glUniformBlockBinding(
+                p.Program, p.InstanceMatrices.Location, p.InstanceMatrices.Binding);
+        }
+
+        p.InstanceBatch.Type = ovrProgramParmType::INT;
+        p.InstanceBatch.Location = glGetUniformLocation(p.Program, "InstanceBatch");
+        p.InstanceBatch.Binding = p.InstanceBatch.Location;
+    }
+
+    glUseProgram(p.Program);
+
+    for (int i = 0; i < numParms; ++i) {
+        OVR_ASSERT(parms[i].Type != ovrProgramParmType::MAX);
+
+        /// Trace the names of the uniform for this progam
+#if OVR_USE_UNIFORM_NAMES
+        p.UniformNames[i] = std::string(parms[i].Name);
+        ALOG(
+            "   GlProgram[ %d ]: Uniforms[%d] = `%s` %s",
+            p.Program,
+            i,
+            parms[i].Name,
+            parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED ? "Texture" : "");
+#endif /// OVR_USE_UNIFORM_NAMES
+
+        p.Uniforms[i].Type = parms[i].Type;
+        if (parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED) {
+            p.Uniforms[i].Location =
+                static_cast<int16_t>(glGetUniformLocation(p.Program, parms[i].Name));
+            p.Uniforms[i].Binding = p.numTextureBindings++;
+            glUniform1i(p.Uniforms[i].Location, p.Uniforms[i].Binding);
+        } else if (parms[i].Type == ovrProgramParmType::BUFFER_UNIFORM) {
+            p.Uniforms[i].Location = glGetUniformBlockIndex(p.Program, parms[i].Name);
+            p.Uniforms[i].Binding = p.numUniformBufferBindings++;
+            glUniformBlockBinding(p.Program, p.Uniforms[i].Location, p.Uniforms[i].Binding);
+        } else {
+            p.Uniforms[i].Location =
+                static_cast<int16_t>(glGetUniformLocation(p.Program, parms[i].Name));
+            p.Uniforms[i].Binding = p.Uniforms[i].Location;
+        }
+        if (false == (p.Uniforms[i].Location >= 0 && p.Uniforms[i].Binding >= 0)) {
+#if OVR_USE_UNIFORM_NAMES
+            p.UniformNames[i] = std::string(parms[i].Name);
+            ALOGW(
+                "   GlProgram[ %d ]: Uniforms[%d] = `%s` %s NOT BOUND / USED",
+                p.Program,
+                i,
+                parms[i].Name,
+                parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED ? "Texture" : "");
+#else
+            ALOGW("   GlProgram[ %d ]: Uniforms[%d] NOT BOUND / USED", p.Program, i);
+#endif /// OVR_USE_UNIFORM_NAMES
+        }
+    }
+
+    glUseProgram(0);
+}
+
 GlProgram GlProgram::Build(
     const char* vertexSrc,
     const char* fragmentSrc,
@@ -223,7 +352,22 @@ GlProgram GlProgram::Build(
             GLSL_PROGRAM_VERSION);
     }
 
-    p.VertexShader = CompileShader(GL_VERTEX_SHADER, vertexDirectives, vertexSrc, programVersion);
+    const std::string vertexSource =
+        ComposeShaderSource(GL_VERTEX_SHADER, vertexDirectives, vertexSrc, programVersion);
+    const std::string fragmentSource =
+        ComposeShaderSource(GL_FRAGMENT_SHADER, fragmentDirectives, fragmentSrc, programVersion);
+
+    // A cached or background compiled program comes without shader objects.
+    GlProgramCache* cache = GetProgramCache();
+    if (cache != nullptr) {
+        p.Program = cache->Acquire(vertexSource, fragmentSource);
+        if (p.Program != 0) {
+            LookupUniforms(p, parms, numParms);
+            return p;
+        }
+    }
+
+    p.VertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
     if (p.VertexShader == 0) {
         Free(p);
         ALOG(
@@ -235,8 +379,7 @@ GlProgram GlProgram::Build(
         return GlProgram();
     }
 
-    p.FragmentShader =
-        CompileShader(GL_FRAGMENT_SHADER, fragmentDirectives, fragmentSrc, programVersion);
+    p.FragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
     if (p.FragmentShader == 0) {
         Free(p);
         ALOG(
@@ -256,16 +399,10 @@ GlProgram GlProgram::Build(
     // Set attributes before linking
     //--------------------------
 
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_POSITION, "Position");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_NORMAL, "Normal");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_TANGENT, "Tangent");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_BINORMAL, "Binormal");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_COLOR, "VertexColor");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_UV0, "TexCoord");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_UV1, "TexCoord1");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_JOINT_INDICES, "JointIndices");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_JOINT_WEIGHTS, "JointWeights");
-    glBindAttribLocation(p.Program, VERTEX_ATTRIBUTE_LOCATION_FONT_PARMS, "FontParms");
+    BindAttributeLocations(p.Program);
+    if (cache != nullptr) {
+        glProgramParameteri(p.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
 
     //--------------------------
     // Link Program
@@ -286,81 +423,73 @@ GlProgram GlProgram::Build(
         return GlProgram();
     }
 
-    //--------------------------
-    // Determine Uniform Parm Location and Binding.
-    //--------------------------
-
-    p.numTextureBindings = 0;
-    p.numUniformBufferBindings = 0;
-
-    // Globally-defined system level uniforms.
-    {
-        p.ViewID.Type = ovrProgramParmType::INT;
-        p.ViewID.Location = glGetUniformLocation(p.Program, "ViewID");
-        p.ViewID.Binding = p.ViewID.Location;
+    if (cache != nullptr) {
+        cache->Store(p.Program, vertexSource, fragmentSource);
+    }
 
-        p.SceneMatrices.Type = ovrProgramParmType::BUFFER_UNIFORM;
-        p.SceneMatrices.Location = glGetUniformBlockIndex(p.Program, "SceneMatrices");
-        if (p.SceneMatrices.Location >= 0) // this won't be present for v100 shaders.
-        {
-            p.SceneMatrices.Binding = p.numUniformBufferBindings++;
-            glUniformBlockBinding(p.Program, p.SceneMatrices.Location, p.SceneMatrices.Binding);
-        }
+    LookupUniforms(p, parms, numParms);
+    return p;
+}
 
-        p.ModelMatrix.Type = ovrProgramParmType::FLOAT_MATRIX4;
-        p.ModelMatrix.Location = glGetUniformLocation(p.Program, "ModelMatrix");
-        p.ModelMatrix.Binding = p.ModelMatrix.Location;
+unsigned int GlProgram::CompileAndLink(
+    const std::string& vertexSource,
+    const std::string& fragmentSource,
+    const bool retrievable) {
+    const GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+    const GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
     }
 
-    glUseProgram(p.Program);
-
-    for (int i = 0; i < numParms; ++i) {
-        OVR_ASSERT(parms[i].Type != ovrProgramParmType::MAX);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    BindAttributeLocations(program);
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
 
-        /// Trace the names of the uniform for this progam
-#if OVR_USE_UNIFORM_NAMES
-        p.UniformNames[i] = std::string(parms[i].Name);
-        ALOG(
-            "   GlProgram[ %d ]: Uniforms[%d] = `%s` %s",
-            p.Program,
-            i,
-            parms[i].Name,
-            parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED ? "Texture" : "");
-#endif /// OVR_USE_UNIFORM_NAMES
+    // the program keeps what it needs from the shaders once linked
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
 
-        p.Uniforms[i].Type = parms[i].Type;
-        if (parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED) {
-            p.Uniforms[i].Location =
-                static_cast<int16_t>(glGetUniformLocation(p.Program, parms[i].Name));
-            p.Uniforms[i].Binding = p.numTextureBindings++;
-            glUniform1i(p.Uniforms[i].Location, p.Uniforms[i].Binding);
-        } else if (parms[i].Type == ovrProgramParmType::BUFFER_UNIFORM) {
-            p.Uniforms[i].Location = glGetUniformBlockIndex(p.Program, parms[i].Name);
-            p.Uniforms[i].Binding = p.numUniformBufferBindings++;
-            glUniformBlockBinding(p.Program, p.Uniforms[i].Location, p.Uniforms[i].Binding);
-        } else {
-            p.Uniforms[i].Location =
-                static_cast<int16_t>(glGetUniformLocation(p.Program, parms[i].Name));
-            p.Uniforms[i].Binding = p.Uniforms[i].Location;
-        }
-        if (false == (p.Uniforms[i].Location >= 0 && p.Uniforms[i].Binding >= 0)) {
-#if OVR_USE_UNIFORM_NAMES
-            p.UniformNames[i] = std::string(parms[i].Name);
-            ALOGW(
-                "   GlProgram[ %d ]: Uniforms[%d] = `%s` %s NOT BOUND / USED",
-                p.Program,
-                i,
-                parms[i].Name,
-                parms[i].Type == ovrProgramParmType::TEXTURE_SAMPLED ? "Texture" : "");
-#else
-            ALOGW("   GlProgram[ %d ]: Uniforms[%d] NOT BOUND / USED", p.Program, i);
-#endif /// OVR_USE_UNIFORM_NAMES
-        }
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_FALSE) {
+        GLchar msg[1024];
+        glGetProgramInfoLog(program, sizeof(msg), 0, msg);
+        ALOG("GlProgram: Linking program failed: %s\n", msg);
+        glDeleteProgram(program);
+        return 0;
     }
+    return program;
+}
 
-    glUseProgram(0);
+void GlProgram::Precompile(
+    const char* vertexSrc,
+    const char* fragmentSrc,
+    const int programVersion) {
+    Precompile(NULL, vertexSrc, NULL, fragmentSrc, programVersion);
+}
 
-    return p;
+void GlProgram::Precompile(
+    const char* vertexDirectives,
+    const char* vertexSrc,
+    const char* fragmentDirectives,
+    const char* fragmentSrc,
+    const int programVersion) {
+    GlProgramCache* cache = GetProgramCache();
+    if (cache == nullptr) {
+        return;
+    }
+    cache->Precompile(
+        ComposeShaderSource(GL_VERTEX_SHADER, vertexDirectives, vertexSrc, programVersion),
+        ComposeShaderSource(GL_FRAGMENT_SHADER, fragmentDirectives, fragmentSrc, programVersion));
 }
 
 void GlProgram::Free(GlProgram& prog) {
@@ -383,6 +512,10 @@ void GlProgram::SetUseMultiview(const bool useMultiview_) {
     UseMultiview = useMultiview_;
 }
 
+void GlProgram::SetUseInstanceBatching(const bool useInstanceBatching_) {
+    UseInstanceBatching = useInstanceBatching_;
+}
+
 void ovrGraphicsCommand::BindUniformTextures() {
     /// Late bind Textures to the right texture objects
     for (int i = 0; i < ovrUniform::MAX_UNIFORMS; ++i) {
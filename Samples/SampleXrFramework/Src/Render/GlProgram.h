@@ -147,9 +147,33 @@ struct GlProgram {
         const int programVersion = GLSL_PROGRAM_VERSION, // minimum requirement
         bool abortOnError = true);
 
+    // Queues the program on the program cache compile threads, so a later Build() with the
+    // same sources and settings only has to pick it up. Does nothing without a program cache.
+    static void Precompile(
+        const char* vertexSrc,
+        const char* fragmentSrc,
+        const int programVersion = GLSL_PROGRAM_VERSION);
+    static void Precompile(
+        const char* vertexDirectives,
+        const char* vertexSrc,
+        const char* fragmentDirectives,
+        const char* fragmentSrc,
+        const int programVersion = GLSL_PROGRAM_VERSION);
+
+    // Compiles and links sources that already have the version line and headers, without
+    // looking up uniforms, and deletes the shader objects. Returns 0 on failure.
+    static unsigned int CompileAndLink(
+        const std::string& vertexSource,
+        const std::string& fragmentSource,
+        const bool retrievable);
+
     static void Free(GlProgram& program);
 
     static void SetUseMultiview(const bool useMultiview_);
+    // Programs built while this is set read ModelMatrix from a per-instance ubo during
+    // instanced draws, which lets ovrSurfaceRender merge surfaces that differ only by
+    // their model matrix into one draw.
+    static void SetUseInstanceBatching(const bool useInstanceBatching_);
 
     bool IsValid() const {
         return Program != 0;
@@ -157,8 +181,11 @@ struct GlProgram {
 
     static const int MAX_VIEWS = 2;
     static const int SCENE_MATRICES_UBO_SIZE = 2 * sizeof(OVR::Matrix4f) * MAX_VIEWS;
+    static const int MAX_BATCH_INSTANCES = 64; // MAX_BATCH_INSTANCES in the vertex header
+    static const int INSTANCE_MATRICES_UBO_SIZE = sizeof(OVR::Matrix4f) * MAX_BATCH_INSTANCES;
 
     unsigned int Program;
+    // 0 for programs that came from the program cache
     unsigned int VertexShader;
     unsigned int FragmentShader;
 
@@ -170,6 +197,9 @@ struct GlProgram {
                               //   mat4 ViewMatrix[NUM_VIEWS];
                               //   mat4 ProjectionMatrix[NUM_VIEWS];
                               // } sm;
+    ovrUniform InstanceMatrices; // uniform for "InstanceMatrices" ubo, -1 unless built with
+                                 // instance batching
+    ovrUniform InstanceBatch; // uniform for "InstanceBatch", selects the ubo model matrix
 
     ovrUniform Uniforms[ovrUniform::MAX_UNIFORMS];
     int numTextureBindings;
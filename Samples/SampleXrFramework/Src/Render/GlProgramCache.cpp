@@ -0,0 +1,415 @@
+/************************************************************************************
+
+Filename    :   GlProgramCache.cpp
+Content     :   On-disk cache of linked program binaries, and threads that compile
+                programs on shared contexts ahead of GlProgram::Build.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "GlProgramCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "Misc/Log.h"
+
+#include "Egl.h"
+#include "GlProgram.h"
+
+#if defined(WIN32)
+#include <direct.h> // for _mkdir
+#else
+#include <sys/stat.h> // for mkdir
+#endif // defined(WIN32)
+
+#if defined(ANDROID)
+#include <sys/prctl.h> // for prctl( PR_SET_NAME )
+#endif // defined(ANDROID)
+
+namespace OVRFW {
+
+static GlProgramCache* ProgramCache = nullptr;
+
+GlProgramCache* GetProgramCache() {
+    return ProgramCache;
+}
+
+void SetProgramCache(GlProgramCache* programCache) {
+    ProgramCache = programCache;
+}
+
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42505647; // "GVPB"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+static const uint32_t MAX_PROGRAM_BINARY_LENGTH = 16 * 1024 * 1024;
+
+struct ovrProgramBinaryHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint64_t DriverHash;
+    uint32_t BinaryFormat;
+    uint32_t BinaryLength;
+    uint64_t Checksum; // of the binary that follows the header
+};
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+// FNV-1a
+static uint64_t HashBytes(const void* data, const size_t size, uint64_t hash) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t HashGlString(const GLenum name, const uint64_t hash) {
+    const char* str = reinterpret_cast<const char*>(glGetString(name));
+    if (str == nullptr) {
+        return hash;
+    }
+    // include the terminator so the strings can't run into each other
+    return HashBytes(str, strlen(str) + 1, hash);
+}
+
+GlProgramCache::GlProgramCache()
+    : DriverHash(0),
+      ShareEgl(nullptr),
+      Exit(false),
+      NumLoaded(0),
+      NumRejected(0),
+      NumStored(0),
+      NumCompiled(0),
+      NumPrecompiled(0) {}
+
+GlProgramCache::~GlProgramCache() {
+    StopCompileThreads();
+}
+
+void GlProgramCache::Init(const char* directory) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = HashGlString(GL_VENDOR, hash);
+    hash = HashGlString(GL_RENDERER, hash);
+    hash = HashGlString(GL_VERSION, hash);
+    hash = HashGlString(GL_SHADING_LANGUAGE_VERSION, hash);
+    DriverHash = hash;
+
+    Directory = (directory != nullptr) ? directory : "";
+    if (Directory.empty()) {
+        return;
+    }
+
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) {
+        ALOGW("GlProgramCache: driver has no program binary formats, disk cache disabled");
+        Directory.clear();
+        return;
+    }
+
+#if defined(WIN32)
+    const int r = _mkdir(Directory.c_str());
+#else
+    const int r = mkdir(Directory.c_str(), S_IRWXU);
+#endif // defined(WIN32)
+    if (r != 0 && errno != EEXIST) {
+        ALOGW("GlProgramCache: failed to create '%s', disk cache disabled", Directory.c_str());
+        Directory.clear();
+        return;
+    }
+
+    ALOG("GlProgramCache: '%s', driver hash %016llx", Directory.c_str(), (unsigned long long)hash);
+}
+
+void GlProgramCache::Shutdown() {
+    StopCompileThreads();
+    for (auto& pending : Pending) {
+        if (pending.second.Program != 0) {
+            glDeleteProgram(pending.second.Program);
+        }
+    }
+    Pending.clear();
+    Directory.clear();
+    if (ProgramCache == this) {
+        ProgramCache = nullptr;
+    }
+}
+
+void GlProgramCache::StartCompileThreads(const ovrEgl_s* shareEgl, const int numThreads) {
+#if defined(ANDROID)
+    if (!Threads.empty()) {
+        return;
+    }
+    ShareEgl = shareEgl;
+    Exit = false;
+    const int count = std::max(0, std::min(MAX_COMPILE_THREADS, numThreads));
+    for (int i = 0; i < count; i++) {
+        Threads.push_back(std::thread(&GlProgramCache::CompileThreadFunction, this, i));
+    }
+#else
+    // wgl contexts from ovrEgl_CreateContext don't share objects
+    ALOGW("GlProgramCache: compile threads are only supported with EGL");
+#endif // defined(ANDROID)
+}
+
+void GlProgramCache::StopCompileThreads() {
+    if (Threads.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Exit = true;
+    }
+    WakeCondition.notify_all();
+    for (std::thread& thread : Threads) {
+        thread.join();
+    }
+    Threads.clear();
+    ShareEgl = nullptr;
+}
+
+void GlProgramCache::Precompile(
+    const std::string& vertexSource,
+    const std::string& fragmentSource) {
+    if (Threads.empty()) {
+        return;
+    }
+    const uint64_t key = GetKey(vertexSource, fragmentSource);
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (Pending.find(key) != Pending.end()) {
+            return;
+        }
+        ovrPendingProgram& pending = Pending[key];
+        pending.VertexSource = vertexSource;
+        pending.FragmentSource = fragmentSource;
+        pending.State = COMPILE_QUEUED;
+        pending.Program = 0;
+        Queue.push_back(key);
+    }
+    WakeCondition.notify_one();
+}
+
+unsigned int GlProgramCache::Acquire(
+    const std::string& vertexSource,
+    const std::string& fragmentSource) {
+    const uint64_t key = GetKey(vertexSource, fragmentSource);
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        auto it = Pending.find(key);
+        if (it != Pending.end()) {
+            ovrPendingProgram& pending = it->second;
+            if (pending.State == COMPILE_QUEUED) {
+                // no thread got to it yet, cheaper to do it here than to wait
+                Queue.erase(std::find(Queue.begin(), Queue.end(), key));
+                Pending.erase(it);
+            } else {
+                DoneCondition.wait(lock, [&pending] { return pending.State == COMPILE_DONE; });
+                const unsigned int program = pending.Program;
+                Pending.erase(key);
+                if (program != 0) {
+                    NumPrecompiled++;
+                }
+                // a failed compile is repeated by the caller, which logs the errors
+                return program;
+            }
+        }
+    }
+    return LoadBinary(key);
+}
+
+void GlProgramCache::Store(
+    const unsigned int program,
+    const std::string& vertexSource,
+    const std::string& fragmentSource) {
+    StoreBinary(program, GetKey(vertexSource, fragmentSource));
+}
+
+GlProgramCacheCounters GlProgramCache::GetCounters() const {
+    GlProgramCacheCounters counters;
+    counters.numLoaded = NumLoaded.load();
+    counters.numRejected = NumRejected.load();
+    counters.numStored = NumStored.load();
+    counters.numCompiled = NumCompiled.load();
+    counters.numPrecompiled = NumPrecompiled.load();
+    return counters;
+}
+
+uint64_t GlProgramCache::GetKey(
+    const std::string& vertexSource,
+    const std::string& fragmentSource) {
+    uint64_t hash = HashBytes(vertexSource.c_str(), vertexSource.size() + 1, FNV_OFFSET_BASIS);
+    return HashBytes(fragmentSource.c_str(), fragmentSource.size() + 1, hash);
+}
+
+std::string GlProgramCache::GetPath(const uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return Directory + name;
+}
+
+unsigned int GlProgramCache::LoadBinary(const uint64_t key) {
+    if (!IsDiskCacheEnabled()) {
+        return 0;
+    }
+    const std::string path = GetPath(key);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return 0;
+    }
+
+    ovrProgramBinaryHeader header;
+    std::vector<uint8_t> binary;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+        header.Magic == PROGRAM_BINARY_MAGIC && header.Version == PROGRAM_BINARY_VERSION &&
+        header.Key == key && header.BinaryLength > 0 &&
+        header.BinaryLength <= MAX_PROGRAM_BINARY_LENGTH;
+    // an older driver's binary is stale rather than corrupt, but it is replaced all the same
+    valid = valid && header.DriverHash == DriverHash;
+    if (valid) {
+        binary.resize(header.BinaryLength);
+        valid = fread(binary.data(), binary.size(), 1, f) == 1 &&
+            HashBytes(binary.data(), binary.size(), FNV_OFFSET_BASIS) == header.Checksum;
+    }
+    fclose(f);
+
+    GLuint program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        glProgramBinary(
+            program,
+            static_cast<GLenum>(header.BinaryFormat),
+            binary.data(),
+            static_cast<GLsizei>(binary.size()));
+        GLint linkStatus = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+        if (linkStatus == GL_FALSE) {
+            glDeleteProgram(program);
+            program = 0;
+            valid = false;
+        }
+    }
+
+    if (!valid) {
+        ALOGW("GlProgramCache: discarding invalid program binary '%s'", path.c_str());
+        remove(path.c_str());
+        NumRejected++;
+        return 0;
+    }
+    NumLoaded++;
+    return program;
+}
+
+void GlProgramCache::StoreBinary(const unsigned int program, const uint64_t key) {
+    if (!IsDiskCacheEnabled() || program == 0) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0 || static_cast<uint32_t>(length) > MAX_PROGRAM_BINARY_LENGTH) {
+        return;
+    }
+    std::vector<uint8_t> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    binary.resize(written);
+
+    ovrProgramBinaryHeader header;
+    header.Magic = PROGRAM_BINARY_MAGIC;
+    header.Version = PROGRAM_BINARY_VERSION;
+    header.Key = key;
+    header.DriverHash = DriverHash;
+    header.BinaryFormat = static_cast<uint32_t>(format);
+    header.BinaryLength = static_cast<uint32_t>(binary.size());
+    header.Checksum = HashBytes(binary.data(), binary.size(), FNV_OFFSET_BASIS);
+
+    // written to a temporary first so an interrupted write never leaves a truncated binary
+    const std::string path = GetPath(key);
+    const std::string tempPath = path + ".tmp";
+    FILE* f = fopen(tempPath.c_str(), "wb");
+    if (f == nullptr) {
+        ALOGW("GlProgramCache: failed to open '%s'", tempPath.c_str());
+        return;
+    }
+    const bool complete = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(binary.data(), binary.size(), 1, f) == 1;
+    fclose(f);
+    if (!complete || rename(tempPath.c_str(), path.c_str()) != 0) {
+        ALOGW("GlProgramCache: failed to write '%s'", path.c_str());
+        remove(tempPath.c_str());
+        return;
+    }
+    NumStored++;
+}
+
+void GlProgramCache::CompileThreadFunction(const int threadIndex) {
+#if defined(ANDROID)
+    char threadName[16];
+    snprintf(threadName, sizeof(threadName), "OVR::Shader%d", threadIndex);
+    prctl(PR_SET_NAME, (long)threadName, 0, 0, 0);
+
+    ovrEgl egl;
+    ovrEgl_Clear(&egl);
+    ovrEgl_CreateContext(&egl, ShareEgl);
+    if (egl.Context == EGL_NO_CONTEXT) {
+        ALOGW("GlProgramCache: compile thread %d has no context", threadIndex);
+    }
+
+    for (;;) {
+        uint64_t key = 0;
+        ovrPendingProgram* pending = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(Mutex);
+            WakeCondition.wait(lock, [this] { return !Queue.empty() || Exit; });
+            if (Queue.empty()) {
+                break;
+            }
+            key = Queue.front();
+            Queue.pop_front();
+            // Acquire() leaves running entries in place, so the pointer stays valid
+            pending = &Pending[key];
+            pending->State = COMPILE_RUNNING;
+        }
+
+        GLuint program = 0;
+        if (egl.Context != EGL_NO_CONTEXT) {
+            program = LoadBinary(key);
+            if (program == 0) {
+                program = GlProgram::CompileAndLink(
+                    pending->VertexSource, pending->FragmentSource, IsDiskCacheEnabled());
+                if (program != 0) {
+                    NumCompiled++;
+                    StoreBinary(program, key);
+                }
+            }
+            // the main context may only use the program once this context is done with it
+            glFinish();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            pending->Program = program;
+            pending->State = COMPILE_DONE;
+        }
+        DoneCondition.notify_all();
+    }
+
+    // not ovrEgl_DestroyContext, which would terminate the display the main context uses
+    if (egl.Context != EGL_NO_CONTEXT) {
+        eglMakeCurrent(egl.Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroySurface(egl.Display, egl.TinySurface);
+        eglDestroyContext(egl.Display, egl.Context);
+    }
+#endif // defined(ANDROID)
+}
+
+} // namespace OVRFW
@@ -0,0 +1,127 @@
+/************************************************************************************
+
+Filename    :   GlProgramCache.h
+Content     :   On-disk cache of linked program binaries, and threads that compile
+                programs on shared contexts ahead of GlProgram::Build.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ovrEgl_s;
+
+namespace OVRFW {
+
+struct GlProgramCacheCounters {
+    GlProgramCacheCounters()
+        : numLoaded(0), numRejected(0), numStored(0), numCompiled(0), numPrecompiled(0) {}
+
+    int numLoaded; // programs created from a binary on disk
+    int numRejected; // binaries found on disk that failed validation and were deleted
+    int numStored; // binaries written to disk
+    int numCompiled; // programs compiled on the compile threads
+    int numPrecompiled; // programs Build() picked up from the compile threads
+};
+
+// Programs are keyed by a hash of the final vertex and fragment sources, so the multiview
+// and instance batching settings and the program version are part of the key. Each file
+// also records a hash of the GL vendor, renderer and version strings, and a driver update
+// invalidates the whole cache. A binary is only used when its header, payload checksum and
+// driver hash all match and the driver accepts it with a good link status; anything else is
+// deleted and compiled again.
+//
+// Precompile() queues programs for the compile threads, which load or compile them on their
+// own contexts sharing with the main one. Acquire() takes a queued program back for the
+// caller to compile itself when no thread has started on it yet, and otherwise waits for it.
+class GlProgramCache {
+   public:
+    static const int MAX_COMPILE_THREADS = 4;
+
+    GlProgramCache();
+    ~GlProgramCache();
+
+    // Requires an active GL context. An empty directory leaves the disk cache off, which
+    // still allows precompiling.
+    void Init(const char* directory);
+    // Requires the context Init() was called with. Deletes precompiled programs that were
+    // never acquired.
+    void Shutdown();
+
+    // Each thread creates a context sharing with shareEgl. Only supported with EGL.
+    void StartCompileThreads(const ovrEgl_s* shareEgl, const int numThreads = 2);
+    // Finishes the queued programs and stops the threads.
+    void StopCompileThreads();
+
+    bool IsDiskCacheEnabled() const {
+        return !Directory.empty();
+    }
+
+    // Sources as passed to the driver, with the version line and headers. Does nothing
+    // without compile threads.
+    void Precompile(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // Returns a linked program, or 0 when the caller has to compile it. The caller owns the
+    // returned program.
+    unsigned int Acquire(const std::string& vertexSource, const std::string& fragmentSource);
+
+    // Writes the binary of a program the caller compiled. The program must have been
+    // linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    void Store(
+        const unsigned int program,
+        const std::string& vertexSource,
+        const std::string& fragmentSource);
+
+    GlProgramCacheCounters GetCounters() const;
+
+   private:
+    enum ovrCompileState { COMPILE_QUEUED, COMPILE_RUNNING, COMPILE_DONE };
+
+    struct ovrPendingProgram {
+        std::string VertexSource;
+        std::string FragmentSource;
+        ovrCompileState State;
+        unsigned int Program;
+    };
+
+    static uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource);
+    std::string GetPath(const uint64_t key) const;
+    unsigned int LoadBinary(const uint64_t key);
+    void StoreBinary(const unsigned int program, const uint64_t key);
+    void CompileThreadFunction(const int threadIndex);
+
+    std::string Directory;
+    uint64_t DriverHash;
+
+    const ovrEgl_s* ShareEgl;
+    std::vector<std::thread> Threads;
+    std::mutex Mutex;
+    std::condition_variable WakeCondition;
+    std::condition_variable DoneCondition;
+    std::deque<uint64_t> Queue;
+    std::unordered_map<uint64_t, ovrPendingProgram> Pending;
+    bool Exit;
+
+    std::atomic<int> NumLoaded;
+    std::atomic<int> NumRejected;
+    std::atomic<int> NumStored;
+    std::atomic<int> NumCompiled;
+    std::atomic<int> NumPrecompiled;
+};
+
+// The cache GlProgram::Build goes through, or NULL to always compile. Set by XrApp.
+GlProgramCache* GetProgramCache();
+void SetProgramCache(GlProgramCache* programCache);
+
+} // namespace OVRFW
@@ -0,0 +1,214 @@
+/************************************************************************************
+
+Filename    :   GlStreamBuffer.cpp
+Content     :   Frame-scoped linear allocator over one large GL buffer, for vertex and
+                uniform data that is rewritten every frame.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "GlStreamBuffer.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#include "Misc/Log.h"
+
+#include "Egl.h"
+
+namespace OVRFW {
+
+static thread_local GlStreamBuffer* FrameStreamBuffer = nullptr;
+static thread_local ovrFrameGlTasks* FrameGlTasks = nullptr;
+static std::atomic<int> FrameThreadGlUserCount(0);
+
+GlStreamBuffer* GetFrameStreamBuffer() {
+    return FrameStreamBuffer;
+}
+
+void SetFrameStreamBuffer(GlStreamBuffer* streamBuffer) {
+    FrameStreamBuffer = streamBuffer;
+}
+
+void ovrFrameGlTasks::Run() {
+    for (std::function<void()>& task : Tasks) {
+        task();
+    }
+    Tasks.clear();
+}
+
+ovrFrameGlTasks* GetFrameGlTasks() {
+    return FrameGlTasks;
+}
+
+void SetFrameGlTasks(ovrFrameGlTasks* tasks) {
+    FrameGlTasks = tasks;
+}
+
+void RunFrameGlTask(std::function<void()>&& task) {
+    if (FrameGlTasks == nullptr) {
+        task();
+        return;
+    }
+    FrameGlTasks->Add(std::move(task));
+}
+
+void ovrFrameThreadGlUser::Acquire() {
+    if (!Acquired) {
+        Acquired = true;
+        FrameThreadGlUserCount++;
+    }
+}
+
+void ovrFrameThreadGlUser::Release() {
+    if (Acquired) {
+        Acquired = false;
+        FrameThreadGlUserCount--;
+    }
+}
+
+int ovrFrameThreadGlUser::GetCount() {
+    return FrameThreadGlUserCount.load();
+}
+
+GlStreamBuffer::GlStreamBuffer()
+    : Buffer(0),
+      FrameSize(0),
+      FramesInFlight(0),
+      Region(0),
+      FrameOffset(0),
+      UniformAlignment(256),
+      FrameIndex(0),
+      FrameOverflowCount(0) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        Fences[i] = nullptr;
+    }
+}
+
+bool GlStreamBuffer::Create(const size_t frameSize, const int framesInFlight) {
+    assert(Buffer == 0);
+    assert(framesInFlight > 0 && framesInFlight <= MAX_FRAMES_IN_FLIGHT);
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0) {
+        UniformAlignment = alignment;
+    }
+
+    // Keep every region start uniform aligned.
+    FrameSize = (frameSize + UniformAlignment - 1) / UniformAlignment * UniformAlignment;
+    FramesInFlight = framesInFlight;
+    Region = FramesInFlight - 1; // the first BeginFrame moves to region 0
+    FrameOffset = RegionStart();
+    FrameIndex = 0;
+
+    // GL_COPY_WRITE_BUFFER isn't used for drawing, so binding it here disturbs nothing.
+    glGenBuffers(1, &Buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, FrameSize * FramesInFlight, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return true;
+}
+
+void GlStreamBuffer::Destroy() {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (Fences[i] != nullptr) {
+            glDeleteSync(static_cast<GLsync>(Fences[i]));
+            Fences[i] = nullptr;
+        }
+    }
+    if (Buffer != 0) {
+        glDeleteBuffers(1, &Buffer);
+        Buffer = 0;
+    }
+    if (FrameStreamBuffer == this) {
+        FrameStreamBuffer = nullptr;
+    }
+}
+
+void GlStreamBuffer::BeginFrame() {
+    assert(Buffer != 0);
+
+    Region = (Region + 1) % FramesInFlight;
+    FrameOffset = RegionStart();
+    FrameOverflowCount = 0;
+    FrameIndex++;
+
+    if (Fences[Region] != nullptr) {
+        GLsync fence = static_cast<GLsync>(Fences[Region]);
+        const GLuint64 timeout = 1000000000; // 1 second
+        const GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED) {
+            ALOGW("GlStreamBuffer: frame region %d still in use", Region);
+        }
+        glDeleteSync(fence);
+        Fences[Region] = nullptr;
+    }
+}
+
+void GlStreamBuffer::EndFrame() {
+    assert(Buffer != 0);
+
+    if (Fences[Region] != nullptr) {
+        glDeleteSync(static_cast<GLsync>(Fences[Region]));
+    }
+    Fences[Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* GlStreamBuffer::Map(const size_t size, const size_t alignment, size_t& offset) {
+    assert(Buffer != 0);
+
+    if (size == 0) {
+        return NULL;
+    }
+    const size_t align = alignment > 0 ? alignment : 1;
+    const size_t start = (FrameOffset + align - 1) / align * align;
+    if (start + size > RegionStart() + FrameSize) {
+        FrameOverflowCount++;
+        return NULL;
+    }
+
+    // The fence in BeginFrame already made sure the GPU is done with this region.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+    void* data = glMapBufferRange(
+        GL_COPY_WRITE_BUFFER,
+        start,
+        size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (data == NULL) {
+        ALOGW("GlStreamBuffer: failed to map %zu bytes", size);
+        return NULL;
+    }
+
+    FrameOffset = start + size;
+    offset = start;
+    return data;
+}
+
+void GlStreamBuffer::Unmap() {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+    if (!glUnmapBuffer(GL_COPY_WRITE_BUFFER)) {
+        ALOGW("GlStreamBuffer: failed to unmap buffer");
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool GlStreamBuffer::Write(
+    const void* data,
+    const size_t size,
+    const size_t alignment,
+    size_t& offset) {
+    void* dst = Map(size, alignment, offset);
+    if (dst == NULL) {
+        return false;
+    }
+    memcpy(dst, data, size);
+    Unmap();
+    return true;
+}
+
+} // namespace OVRFW
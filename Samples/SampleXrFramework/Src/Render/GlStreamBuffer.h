@@ -0,0 +1,146 @@
+/************************************************************************************
+
+Filename    :   GlStreamBuffer.h
+Content     :   Frame-scoped linear allocator over one large GL buffer, for vertex and
+                uniform data that is rewritten every frame.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace OVRFW {
+
+// One GL buffer split into a region per frame in flight. Each frame allocates linearly from
+// its region, and the region is only reused once the fence set at the end of the frame that
+// last wrote it has signaled, so writes never need to synchronize with the GPU.
+//
+// Allocations are only valid for the frame they were made in: anything drawn from this
+// buffer has to be written again every frame.
+class GlStreamBuffer {
+   public:
+    static const int MAX_FRAMES_IN_FLIGHT = 4;
+
+    GlStreamBuffer();
+
+    // Requires an active GL context.
+    bool Create(const size_t frameSize, const int framesInFlight = 3);
+    void Destroy();
+
+    // Moves to the next frame region, waiting for the GPU to finish with it if needed.
+    void BeginFrame();
+    // Fences the current region. Call once all the frame's draws have been issued.
+    void EndFrame();
+
+    // Maps size bytes at the given alignment from the current frame. Returns NULL when the
+    // frame region is full, in which case the caller should use its own buffer. Every
+    // successful Map must be followed by Unmap before drawing.
+    void* Map(const size_t size, const size_t alignment, size_t& offset);
+    void Unmap();
+
+    // Map, copy and Unmap in one go.
+    bool Write(const void* data, const size_t size, const size_t alignment, size_t& offset);
+
+    bool IsValid() const {
+        return Buffer != 0;
+    }
+    unsigned int GetBuffer() const {
+        return Buffer;
+    }
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for allocations bound with glBindBufferRange.
+    size_t GetUniformAlignment() const {
+        return UniformAlignment;
+    }
+    // Increments every BeginFrame, lets callers tell whether an allocation is still current.
+    uint64_t GetFrameIndex() const {
+        return FrameIndex;
+    }
+    size_t GetFrameBytesUsed() const {
+        return FrameOffset - RegionStart();
+    }
+    // Allocations refused this frame because the region was full.
+    int GetFrameOverflowCount() const {
+        return FrameOverflowCount;
+    }
+
+   private:
+    size_t RegionStart() const {
+        return static_cast<size_t>(Region) * FrameSize;
+    }
+
+    uint32_t Buffer;
+    size_t FrameSize;
+    int FramesInFlight;
+    int Region;
+    size_t FrameOffset; // next free byte, absolute
+    size_t UniformAlignment;
+    uint64_t FrameIndex;
+    int FrameOverflowCount;
+    void* Fences[MAX_FRAMES_IN_FLIGHT]; // GLsync
+};
+
+// The stream buffer for the frame being built or drawn on the calling thread, or NULL when
+// there is none. Set by XrApp on the thread that owns the GL context, so in pipelined mode
+// only the render thread sees it.
+GlStreamBuffer* GetFrameStreamBuffer();
+void SetFrameStreamBuffer(GlStreamBuffer* streamBuffer);
+
+// GL work that comes up while a frame is built on a thread without the GL context. The thread
+// that draws the frame runs the tasks in order before drawing it. The render thread may still
+// be drawing an older frame from the same surfaces, so a task captures what it uploads by value
+// and also writes the ovrSurfaceDef fields that go with the upload, like index counts.
+class ovrFrameGlTasks {
+   public:
+    void Add(std::function<void()>&& task) {
+        Tasks.push_back(std::move(task));
+    }
+    // Runs the tasks and drops them.
+    void Run();
+
+   private:
+    std::vector<std::function<void()>> Tasks;
+};
+
+// The tasks of the frame being built on the calling thread, or NULL when the calling thread
+// has the GL context. XrApp sets it on the main thread in pipelined mode.
+ovrFrameGlTasks* GetFrameGlTasks();
+void SetFrameGlTasks(ovrFrameGlTasks* tasks);
+
+// Runs task now when the calling thread has the GL context, otherwise adds it to the frame's
+// tasks.
+void RunFrameGlTask(std::function<void()>&& task);
+
+// Held by the helpers that still touch GL directly while the frame is being built, on the
+// thread that runs Update() and AppPrepareFrame(): GPU particle systems, whose simulation
+// pass can't be deferred. That thread has no GL context when frames are pipelined, so XrApp
+// won't pipeline them while any helper holds one.
+class ovrFrameThreadGlUser {
+   public:
+    ovrFrameThreadGlUser() : Acquired(false) {}
+    // a copy doesn't hold the count
+    ovrFrameThreadGlUser(const ovrFrameThreadGlUser&) : Acquired(false) {}
+    ovrFrameThreadGlUser& operator=(const ovrFrameThreadGlUser&) {
+        return *this;
+    }
+    ~ovrFrameThreadGlUser() {
+        Release();
+    }
+
+    void Acquire();
+    void Release();
+
+    // Helpers currently holding one.
+    static int GetCount();
+
+   private:
+    bool Acquired;
+};
+
+} // namespace OVRFW
@@ -431,6 +431,22 @@ static int32_t GetOvrTextureSize(const eTextureFormat format, const int w, const
     return 0;
 }
 
+size_t GetTextureMemorySize(
+    const eTextureFormat format,
+    const int width,
+    const int height,
+    const int numLevels) {
+    size_t size = 0;
+    int w = width;
+    int h = height;
+    for (int i = 0; i < numLevels; i++) {
+        size += static_cast<size_t>(GetOvrTextureSize(format, w, h));
+        w = std::max(1, w >> 1);
+        h = std::max(1, h >> 1);
+    }
+    return size;
+}
+
 bool TextureFormatToGlFormat(
     const eTextureFormat format,
     const bool useSrgbFormat,
@@ -1671,6 +1687,247 @@ GlTexture LoadTextureFromBuffer(
     return texId;
 }
 
+static std::string GetLowerCaseExtension(const char* fileName) {
+    std::string ext = GetExtension(fileName);
+    auto& loc = std::use_facet<std::ctype<char>>(std::locale());
+    loc.tolower(&ext[0], &ext[0] + ext.length());
+    return ext;
+}
+
+static bool IsStbImageExtension(const std::string& ext) {
+    return ext == ".jpg" || ext == ".tga" || ext == ".png" || ext == ".bmp" || ext == ".psd" ||
+        ext == ".gif" || ext == ".hdr" || ext == ".pic";
+}
+
+bool CanDecodeTextureFromBuffer(const char* fileName) {
+    if (fileName == nullptr) {
+        return false;
+    }
+    const std::string ext = GetLowerCaseExtension(fileName);
+    return IsStbImageExtension(ext) || ext == ".ktx2";
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes.
+static void BuildRGBAMipChain(ovrDecodedTexture& decoded) {
+    int w = decoded.Width;
+    int h = decoded.Height;
+    while (w > 1 || h > 1) {
+        const ovrDecodedTexture::ovrLevel src = decoded.Levels.back();
+        ovrDecodedTexture::ovrLevel dst;
+        dst.Width = std::max(1, w >> 1);
+        dst.Height = std::max(1, h >> 1);
+        dst.Offset = decoded.Data.size();
+        dst.Size = static_cast<size_t>(dst.Width) * dst.Height * 4;
+        decoded.Data.resize(dst.Offset + dst.Size);
+
+        const uint8_t* in = decoded.Data.data() + src.Offset;
+        uint8_t* out = decoded.Data.data() + dst.Offset;
+        for (int y = 0; y < dst.Height; y++) {
+            const int y0 = std::min(y * 2, h - 1);
+            const int y1 = std::min(y * 2 + 1, h - 1);
+            for (int x = 0; x < dst.Width; x++) {
+                const int x0 = std::min(x * 2, w - 1);
+                const int x1 = std::min(x * 2 + 1, w - 1);
+                for (int c = 0; c < 4; c++) {
+                    const int sum = in[(y0 * w + x0) * 4 + c] + in[(y0 * w + x1) * 4 + c] +
+                        in[(y1 * w + x0) * 4 + c] + in[(y1 * w + x1) * 4 + c];
+                    out[(y * dst.Width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+                }
+            }
+        }
+        decoded.Levels.push_back(dst);
+        w = dst.Width;
+        h = dst.Height;
+    }
+}
+
+static bool DecodeStbImage(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize,
+    const TextureFlags_t& flags,
+    ovrDecodedTexture& decoded) {
+    int width = 0;
+    int height = 0;
+    int comp;
+    stbi_uc* image = stbi_load_from_memory(buffer, (int)bufferSize, &width, &height, &comp, 4);
+    if (image == nullptr) {
+        ALOG("%s: stbi_load_from_memory() failed!", fileName);
+        return false;
+    }
+    if (flags & TEXTUREFLAG_ALPHA_BORDER) {
+        for (int i = 0; i < width; i++) {
+            image[i * 4 + 3] = 0;
+            image[((height - 1) * width + i) * 4 + 3] = 0;
+        }
+        for (int i = 0; i < height; i++) {
+            image[i * width * 4 + 3] = 0;
+            image[(i * width + width - 1) * 4 + 3] = 0;
+        }
+    }
+
+    GLenum glFormat;
+    GLenum glInternalFormat;
+    TextureFormatToGlFormat(
+        Texture_RGBA, flags & TEXTUREFLAG_USE_SRGB, glFormat, glInternalFormat);
+    decoded.GlFormat = glFormat;
+    decoded.GlInternalFormat = glInternalFormat;
+    decoded.Width = width;
+    decoded.Height = height;
+
+    ovrDecodedTexture::ovrLevel level;
+    level.Offset = 0;
+    level.Size = static_cast<size_t>(width) * height * 4;
+    level.Width = width;
+    level.Height = height;
+    // reserve the whole chain so the data isn't moved for every level
+    decoded.Data.reserve(level.Size + level.Size / 3 + 4 * 32);
+    decoded.Data.assign(image, image + level.Size);
+    decoded.Levels.push_back(level);
+    stbi_image_free(image);
+
+    if (!(flags & TEXTUREFLAG_NO_MIPMAPS)) {
+        BuildRGBAMipChain(decoded);
+    }
+    return true;
+}
+
+// Maps the VkFormat of a KTX2 texture to one DecodeKtx2 can hand out, Texture_None if there
+// is none.
+static eTextureFormat Ktx2TextureFormat(const uint32_t vkFormat, bool& srgb) {
+    // VkFormat values, ktx.h does not include vulkan.h
+    const uint32_t VK_R8G8B8A8_UNORM = 37;
+    const uint32_t VK_R8G8B8A8_SRGB = 43;
+    const uint32_t VK_ASTC_4x4_UNORM = 157;
+    const uint32_t VK_ASTC_12x12_SRGB = 184;
+
+    srgb = false;
+    if (vkFormat == VK_R8G8B8A8_UNORM || vkFormat == VK_R8G8B8A8_SRGB) {
+        srgb = vkFormat == VK_R8G8B8A8_SRGB;
+        return Texture_RGBA;
+    } else if (vkFormat >= VK_ASTC_4x4_UNORM && vkFormat <= VK_ASTC_12x12_SRGB) {
+        // the ASTC formats come in unorm / srgb pairs, in the same block size order as ours
+        const int index = static_cast<int>(vkFormat - VK_ASTC_4x4_UNORM);
+        srgb = (index & 1) != 0;
+        return static_cast<eTextureFormat>(Texture_ASTC_Start + ((index >> 1) << 8));
+    }
+    return Texture_None;
+}
+
+static bool IsDecodableKtx2Layout(const ktxTexture* kTexture) {
+    return kTexture->classId == ktxTexture2_c && kTexture->numDimensions == 2 &&
+        !kTexture->isArray && !kTexture->isCubemap;
+}
+
+bool CanDecodeTextureFromBuffer(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize) {
+    if (!CanDecodeTextureFromBuffer(fileName) || buffer == nullptr || bufferSize < 1) {
+        return false;
+    }
+    if (GetLowerCaseExtension(fileName) != ".ktx2") {
+        return true;
+    }
+
+    // only the header and the level index are read without the image data
+    ktxTexture* kTexture;
+    if (ktxTexture_CreateFromMemory(buffer, bufferSize, KTX_TEXTURE_CREATE_NO_FLAGS, &kTexture) !=
+        KTX_SUCCESS) {
+        return false;
+    }
+    bool decodable = IsDecodableKtx2Layout(kTexture);
+    if (decodable && !ktxTexture_NeedsTranscoding(kTexture)) {
+        bool srgb;
+        const eTextureFormat format = Ktx2TextureFormat(((ktxTexture2*)kTexture)->vkFormat, srgb);
+        GLenum glFormat;
+        GLenum glInternalFormat;
+        decodable = format != Texture_None &&
+            TextureFormatToGlFormat(format, srgb, glFormat, glInternalFormat);
+    }
+    ktxTexture_Destroy(kTexture);
+    return decodable;
+}
+
+static bool DecodeKtx2(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize,
+    ovrDecodedTexture& decoded) {
+    ktxTexture* kTexture;
+    KTX_error_code result = ktxTexture_CreateFromMemory(
+        buffer, bufferSize, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
+    if (result != KTX_SUCCESS) {
+        ALOG("%s: KTX2 CreateFromMemory failed. result is %d", fileName, result);
+        return false;
+    }
+    if (!IsDecodableKtx2Layout(kTexture)) {
+        ALOG("%s: only plain 2D KTX2 textures can be decoded", fileName);
+        ktxTexture_Destroy(kTexture);
+        return false;
+    }
+    if (ktxTexture_NeedsTranscoding(kTexture)) {
+        result = ktxTexture2_TranscodeBasis(
+            (ktxTexture2*)kTexture, ktx_transcode_fmt_e::KTX_TTF_ASTC_4x4_RGBA, 0);
+        if (result != KTX_SUCCESS) {
+            ALOG("%s: Coudln't transcode ktx2 file to ASTC, ETC files not supported", fileName);
+            ktxTexture_Destroy(kTexture);
+            return false;
+        }
+    }
+
+    const uint32_t vkFormat = ((ktxTexture2*)kTexture)->vkFormat;
+    bool srgb;
+    const eTextureFormat format = Ktx2TextureFormat(vkFormat, srgb);
+    GLenum glFormat;
+    GLenum glInternalFormat;
+    if (format == Texture_None ||
+        !TextureFormatToGlFormat(format, srgb, glFormat, glInternalFormat)) {
+        ALOG("%s: KTX2 format %u can't be decoded", fileName, vkFormat);
+        ktxTexture_Destroy(kTexture);
+        return false;
+    }
+
+    decoded.GlFormat = IsCompressedFormat(format) ? 0 : glFormat;
+    decoded.GlInternalFormat = glInternalFormat;
+    decoded.Width = kTexture->baseWidth;
+    decoded.Height = kTexture->baseHeight;
+    decoded.Data.assign(
+        ktxTexture_GetData(kTexture), ktxTexture_GetData(kTexture) + kTexture->dataSize);
+    for (ktx_uint32_t i = 0; i < kTexture->numLevels; i++) {
+        ktx_size_t offset = 0;
+        ktxTexture_GetImageOffset(kTexture, i, 0, 0, &offset);
+        ovrDecodedTexture::ovrLevel level;
+        level.Offset = offset;
+        level.Size = ktxTexture_GetImageSize(kTexture, i);
+        level.Width = std::max(1, decoded.Width >> i);
+        level.Height = std::max(1, decoded.Height >> i);
+        decoded.Levels.push_back(level);
+    }
+    ktxTexture_Destroy(kTexture);
+    return true;
+}
+
+bool DecodeTextureFromBuffer(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize,
+    const TextureFlags_t& flags,
+    ovrDecodedTexture& decoded) {
+    decoded = ovrDecodedTexture();
+    if (fileName == nullptr || buffer == nullptr || bufferSize < 1) {
+        return false;
+    }
+    const std::string ext = GetLowerCaseExtension(fileName);
+    if (IsStbImageExtension(ext)) {
+        return DecodeStbImage(fileName, buffer, bufferSize, flags, decoded);
+    } else if (ext == ".ktx2") {
+        return DecodeKtx2(fileName, buffer, bufferSize, decoded);
+    }
+    ALOG("DecodeTextureFromBuffer: unsupported file extension '%s'", ext.c_str());
+    return false;
+}
+
 GlTexture LoadTextureFromOtherApplicationPackage(
     void* zipFile,
     const char* nameInZip,
@@ -158,6 +158,13 @@ bool GlFormatToTextureFormat(
 // Calculate the full mip chain levels based on width and height.
 int ComputeFullMipChainNumLevels(const int width, const int height);
 
+// Bytes of texture memory taken by numLevels mip levels, starting at width x height.
+size_t GetTextureMemorySize(
+    const eTextureFormat format,
+    const int width,
+    const int height,
+    const int numLevels);
+
 // Allocates a GPU texture and uploads the raw data.
 GlTexture LoadRGBATextureFromMemory(
     const uint8_t* texture,
@@ -229,6 +236,51 @@ inline GlTexture LoadTextureFromBuffer(
     return LoadTextureFromBuffer(fileName, buffer.data(), buffer.size(), flags, width, height);
 }
 
+// Image data decoded without touching GL, ready to be uploaded level by level.
+struct ovrDecodedTexture {
+    struct ovrLevel {
+        size_t Offset; // into Data
+        size_t Size;
+        int Width;
+        int Height;
+    };
+
+    ovrDecodedTexture() : GlInternalFormat(0), GlFormat(0), Width(0), Height(0) {}
+
+    bool IsCompressed() const {
+        return GlFormat == 0;
+    }
+
+    uint32_t GlInternalFormat;
+    uint32_t GlFormat; // with GL_UNSIGNED_BYTE, 0 for compressed formats
+    int Width;
+    int Height;
+    std::vector<uint8_t> Data;
+    std::vector<ovrLevel> Levels; // largest first
+};
+
+// True for the files DecodeTextureFromBuffer handles, going by the extension.
+bool CanDecodeTextureFromBuffer(const char* fileName);
+
+// Also looks at the header of .ktx2 files, which DecodeTextureFromBuffer rejects unless they
+// hold a single 2D image in one of the formats it handles. Thread safe.
+bool CanDecodeTextureFromBuffer(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize);
+
+// Thread safe counterpart to LoadTextureFromBuffer for the stb_image formats and .ktx2 files.
+// Basis compressed .ktx2 files are transcoded to ASTC 4x4, other .ktx2 files must hold RGBA8
+// or ASTC data. Uncompressed images get a mip chain built on the CPU, filtered in the stored
+// color space, unless TEXTUREFLAG_NO_MIPMAPS is set. Returns false on failure, without a
+// default texture.
+bool DecodeTextureFromBuffer(
+    const char* fileName,
+    const uint8_t* buffer,
+    const size_t bufferSize,
+    const TextureFlags_t& flags,
+    ovrDecodedTexture& decoded);
+
 // Returns 0 if the file is not found.
 // For a file placed in the project assets folder, nameInZip would be
 // something like "assets/cube.pvr".
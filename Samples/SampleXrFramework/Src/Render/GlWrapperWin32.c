@@ -163,8 +163,12 @@ PFNGLATTACHSHADERPROC glAttachShader;
 PFNGLLINKPROGRAMPROC glLinkProgram;
 PFNGLGETPROGRAMIVPROC glGetProgramiv;
 PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
+PFNGLGETPROGRAMBINARYPROC glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC glProgramParameteri;
 PFNGLGETATTRIBLOCATIONPROC glGetAttribLocation;
 PFNGLBINDATTRIBLOCATIONPROC glBindAttribLocation;
+PFNGLTRANSFORMFEEDBACKVARYINGSPROC glTransformFeedbackVaryings;
 PFNGLGETUNIFORMLOCATIONPROC glGetUniformLocation;
 PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndex;
 PFNGLGETPROGRAMRESOURCEINDEXPROC glGetProgramResourceIndex;
@@ -193,6 +197,9 @@ PFNGLUNIFORMMATRIX4X3FVPROC glUniformMatrix4x3fv;
 PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
 
 PFNGLDRAWELEMENTSINSTANCEDPROC glDrawElementsInstanced;
+PFNGLDRAWARRAYSINSTANCEDPROC glDrawArraysInstanced;
+PFNGLBEGINTRANSFORMFEEDBACKPROC glBeginTransformFeedback;
+PFNGLENDTRANSFORMFEEDBACKPROC glEndTransformFeedback;
 PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
 PFNGLMEMORYBARRIERPROC glMemoryBarrier;
 
@@ -316,8 +323,13 @@ void GlInitExtensions() {
     glLinkProgram = (PFNGLLINKPROGRAMPROC)GetExtension("glLinkProgram");
     glGetProgramiv = (PFNGLGETPROGRAMIVPROC)GetExtension("glGetProgramiv");
     glGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC)GetExtension("glGetProgramInfoLog");
+    glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)GetExtension("glGetProgramBinary");
+    glProgramBinary = (PFNGLPROGRAMBINARYPROC)GetExtension("glProgramBinary");
+    glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)GetExtension("glProgramParameteri");
     glGetAttribLocation = (PFNGLGETATTRIBLOCATIONPROC)GetExtension("glGetAttribLocation");
     glBindAttribLocation = (PFNGLBINDATTRIBLOCATIONPROC)GetExtension("glBindAttribLocation");
+    glTransformFeedbackVaryings =
+        (PFNGLTRANSFORMFEEDBACKVARYINGSPROC)GetExtension("glTransformFeedbackVaryings");
     glGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)GetExtension("glGetUniformLocation");
     glGetUniformBlockIndex = (PFNGLGETUNIFORMBLOCKINDEXPROC)GetExtension("glGetUniformBlockIndex");
     glProgramUniform1i = (PFNGLPROGRAMUNIFORM1IPROC)GetExtension("glProgramUniform1i");
@@ -349,6 +361,10 @@ void GlInitExtensions() {
 
     glDrawElementsInstanced =
         (PFNGLDRAWELEMENTSINSTANCEDPROC)GetExtension("glDrawElementsInstanced");
+    glDrawArraysInstanced = (PFNGLDRAWARRAYSINSTANCEDPROC)GetExtension("glDrawArraysInstanced");
+    glBeginTransformFeedback =
+        (PFNGLBEGINTRANSFORMFEEDBACKPROC)GetExtension("glBeginTransformFeedback");
+    glEndTransformFeedback = (PFNGLENDTRANSFORMFEEDBACKPROC)GetExtension("glEndTransformFeedback");
     glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)GetExtension("glDispatchCompute");
     glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)GetExtension("glMemoryBarrier");
 
@@ -0,0 +1,197 @@
+/************************************************************************************
+
+Filename    :   GlyphRasterizer.cpp
+Content     :   Signed distance field glyphs rendered from TrueType fonts at runtime.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "GlyphRasterizer.h"
+
+#include <cmath>
+
+#if defined(ANDROID)
+#include <sys/prctl.h>
+#endif
+
+#include "stb_truetype.h"
+
+#include "Misc/Log.h"
+
+namespace OVRFW {
+
+static const unsigned char SDF_ON_EDGE_VALUE = 128;
+
+ovrGlyphRasterizer::ovrGlyphRasterizer() : Scale(0.0f), Padding(0), Exit(false) {}
+
+ovrGlyphRasterizer::~ovrGlyphRasterizer() {
+    Shutdown();
+}
+
+bool ovrGlyphRasterizer::Init(
+    std::vector<uint8_t>& fontData,
+    const float pixelHeight,
+    const int padding) {
+    Shutdown();
+
+    FontData.swap(fontData);
+    FontInfo.reset(new stbtt_fontinfo());
+    const int offset = FontData.empty() ? -1 : stbtt_GetFontOffsetForIndex(FontData.data(), 0);
+    if (offset < 0 || !stbtt_InitFont(FontInfo.get(), FontData.data(), offset)) {
+        ALOGW("ovrGlyphRasterizer: not a TrueType or OpenType font");
+        FontInfo.reset();
+        std::vector<uint8_t>().swap(FontData);
+        return false;
+    }
+    Scale = stbtt_ScaleForPixelHeight(FontInfo.get(), pixelHeight);
+    Padding = padding;
+
+    Exit = false;
+    WorkerThread = std::thread(&ovrGlyphRasterizer::WorkerThreadFunction, this);
+    return true;
+}
+
+void ovrGlyphRasterizer::Shutdown() {
+    if (WorkerThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Exit = true;
+        }
+        Condition.notify_all();
+        WorkerThread.join();
+    }
+    Requests.clear();
+    Finished.clear();
+    FontInfo.reset();
+    std::vector<uint8_t>().swap(FontData);
+}
+
+bool ovrGlyphRasterizer::HasGlyph(const uint32_t charCode) const {
+    return FontInfo != nullptr && stbtt_FindGlyphIndex(FontInfo.get(), charCode) != 0;
+}
+
+void ovrGlyphRasterizer::GetMetrics(const uint32_t charCode, ovrGlyphMetrics& metrics) const {
+    metrics = ovrGlyphMetrics();
+    if (FontInfo == nullptr) {
+        return;
+    }
+    const int glyph = stbtt_FindGlyphIndex(FontInfo.get(), charCode);
+    int advance = 0;
+    int leftSideBearing = 0;
+    stbtt_GetGlyphHMetrics(FontInfo.get(), glyph, &advance, &leftSideBearing);
+    metrics.AdvanceX = advance * Scale;
+
+    // the same box stbtt_GetGlyphSDF() renders
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBox(FontInfo.get(), glyph, Scale, Scale, &x0, &y0, &x1, &y1);
+    if (x0 == x1 || y0 == y1) {
+        return;
+    }
+    metrics.Width = x1 - x0 + Padding * 2;
+    metrics.Height = y1 - y0 + Padding * 2;
+    metrics.BearingX = static_cast<float>(x0 - Padding);
+    metrics.BearingY = static_cast<float>(Padding - y0);
+}
+
+void ovrGlyphRasterizer::GetLineMetrics(float& ascent, float& descent, float& lineGap) const {
+    int a = 0;
+    int d = 0;
+    int g = 0;
+    if (FontInfo != nullptr) {
+        stbtt_GetFontVMetrics(FontInfo.get(), &a, &d, &g);
+    }
+    ascent = a * Scale;
+    descent = d * Scale;
+    lineGap = g * Scale;
+}
+
+void ovrGlyphRasterizer::GetMaxBitmapSize(int& width, int& height) const {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+    if (FontInfo != nullptr) {
+        stbtt_GetFontBoundingBox(FontInfo.get(), &x0, &y0, &x1, &y1);
+    }
+    width = static_cast<int>(std::ceil((x1 - x0) * Scale)) + 1 + Padding * 2;
+    height = static_cast<int>(std::ceil((y1 - y0) * Scale)) + 1 + Padding * 2;
+}
+
+bool ovrGlyphRasterizer::Rasterize(const uint32_t charCode, ovrGlyphBitmap& bitmap) const {
+    bitmap.CharCode = charCode;
+    bitmap.Width = 0;
+    bitmap.Height = 0;
+    bitmap.Pixels.clear();
+    if (FontInfo == nullptr || Padding <= 0) {
+        return false;
+    }
+
+    int width = 0;
+    int height = 0;
+    int xOffset = 0;
+    int yOffset = 0;
+    unsigned char* pixels = stbtt_GetGlyphSDF(
+        FontInfo.get(),
+        Scale,
+        stbtt_FindGlyphIndex(FontInfo.get(), charCode),
+        Padding,
+        SDF_ON_EDGE_VALUE,
+        static_cast<float>(SDF_ON_EDGE_VALUE) / Padding,
+        &width,
+        &height,
+        &xOffset,
+        &yOffset);
+    if (pixels == nullptr) {
+        return false;
+    }
+    bitmap.Width = width;
+    bitmap.Height = height;
+    bitmap.Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height);
+    stbtt_FreeSDF(pixels, nullptr);
+    return true;
+}
+
+void ovrGlyphRasterizer::Request(const uint32_t charCode) {
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Requests.push_back(charCode);
+    }
+    Condition.notify_one();
+}
+
+void ovrGlyphRasterizer::GetFinished(std::vector<ovrGlyphBitmap>& bitmaps) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (ovrGlyphBitmap& bitmap : Finished) {
+        bitmaps.push_back(std::move(bitmap));
+    }
+    Finished.clear();
+}
+
+void ovrGlyphRasterizer::WorkerThreadFunction() {
+#if defined(ANDROID)
+    prctl(PR_SET_NAME, (long)"OVR::Glyphs", 0, 0, 0);
+#endif // defined(ANDROID)
+
+    for (;;) {
+        uint32_t charCode = 0;
+        {
+            std::unique_lock<std::mutex> lock(Mutex);
+            Condition.wait(lock, [this] { return !Requests.empty() || Exit; });
+            if (Exit) {
+                break;
+            }
+            charCode = Requests.front();
+            Requests.pop_front();
+        }
+
+        // stb_truetype only reads the font, so this can run alongside the metric queries
+        ovrGlyphBitmap bitmap;
+        Rasterize(charCode, bitmap);
+
+        std::lock_guard<std::mutex> lock(Mutex);
+        Finished.push_back(std::move(bitmap));
+    }
+}
+
+} // namespace OVRFW
@@ -0,0 +1,86 @@
+/************************************************************************************
+
+Filename    :   GlyphRasterizer.h
+Content     :   Signed distance field glyphs rendered from TrueType fonts at runtime.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct stbtt_fontinfo;
+
+namespace OVRFW {
+
+// In pixels of the distance field bitmap, which includes the padding on every side.
+struct ovrGlyphMetrics {
+    ovrGlyphMetrics() : Width(0), Height(0), AdvanceX(0.0f), BearingX(0.0f), BearingY(0.0f) {}
+
+    int Width; // 0 for glyphs without an outline, like spaces
+    int Height;
+    float AdvanceX;
+    float BearingX; // from the pen position to the left edge of the bitmap
+    float BearingY; // from the baseline up to the top edge of the bitmap
+};
+
+struct ovrGlyphBitmap {
+    ovrGlyphBitmap() : CharCode(0), Width(0), Height(0) {}
+
+    uint32_t CharCode;
+    int Width;
+    int Height;
+    std::vector<uint8_t> Pixels; // one byte per texel, top row first, 128 on the outline
+};
+
+// Renders signed distance field glyphs from a TrueType or OpenType font with stb_truetype. Metrics
+// are cheap and computed on the calling thread. Bitmaps can be rendered right away, or queued for
+// the worker thread and collected later with GetFinished().
+class ovrGlyphRasterizer {
+   public:
+    ovrGlyphRasterizer();
+    ~ovrGlyphRasterizer();
+
+    // Takes over the font file. The distance falls to 0 over padding pixels outside the outline.
+    bool Init(std::vector<uint8_t>& fontData, const float pixelHeight, const int padding);
+    void Shutdown();
+
+    bool HasGlyph(const uint32_t charCode) const;
+    void GetMetrics(const uint32_t charCode, ovrGlyphMetrics& metrics) const;
+    // In pixels, with y up from the baseline.
+    void GetLineMetrics(float& ascent, float& descent, float& lineGap) const;
+    // The largest bitmap any glyph of the font can have.
+    void GetMaxBitmapSize(int& width, int& height) const;
+
+    // Returns false for glyphs without an outline.
+    bool Rasterize(const uint32_t charCode, ovrGlyphBitmap& bitmap) const;
+
+    void Request(const uint32_t charCode);
+    // Appends the bitmaps the worker thread finished since the last call.
+    void GetFinished(std::vector<ovrGlyphBitmap>& bitmaps);
+
+   private:
+    void WorkerThreadFunction();
+
+    std::vector<uint8_t> FontData;
+    std::unique_ptr<stbtt_fontinfo> FontInfo;
+    float Scale; // font units to pixels
+    int Padding;
+
+    std::thread WorkerThread;
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    std::deque<uint32_t> Requests;
+    std::vector<ovrGlyphBitmap> Finished;
+    bool Exit;
+};
+
+} // namespace OVRFW
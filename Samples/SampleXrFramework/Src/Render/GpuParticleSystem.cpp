@@ -0,0 +1,564 @@
+/************************************************************************************
+
+Filename    :   GpuParticleSystem.cpp
+Content     :   Particle system simulated on the GPU with transform feedback.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "GpuParticleSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "Misc/Log.h"
+#include "Egl.h"
+#include "ParticleSystem.h"
+#include "TextureAtlas.h"
+
+using OVR::Matrix4f;
+using OVR::Vector2f;
+using OVR::Vector3f;
+using OVR::Vector4f;
+
+namespace OVRFW {
+
+// Evaluates one corner of one particle's quad, with the same motion, ease curves and view
+// facing basis as ovrParticleSystem. The outputs are captured as an ovrParticleVertex.
+static const char* simulationVertexSrc = R"glsl(#version 300 es
+in vec4 PositionStart;
+in vec4 VelocityLifeTime;
+in vec4 HalfAccelerationScale;
+in vec4 Color;
+in vec4 Ease;
+in vec4 Rotation;
+in vec4 UvRect;
+uniform float Time;
+uniform vec3 ViewPosition;
+uniform vec3 ViewForward;
+out vec3 oPosition;
+out vec4 oColor;
+out vec2 oTexCoord;
+void main()
+{
+    float t = Time - PositionStart.w;
+    float lifeTime = VelocityLifeTime.w;
+
+    // x = x0 + v0 * t + 0.5f * a * t^2
+    vec3 pos = PositionStart.xyz + VelocityLifeTime.xyz * t + HalfAccelerationScale.xyz * t * t;
+    float orientation = Rotation.x + Rotation.y * t;
+
+    float u = lifeTime > 0.0 ? t / lifeTime : 0.0;
+    float v = u <= 0.5 ? u : u - 0.5;
+    float power = v * mix(1.0, v, Ease.x) * mix(1.0, v, Ease.y);
+    float ease = u <= 0.5 ? 2.0 * power : 1.0 - 2.0 * power;
+    vec4 color = Color * vec4(vec3(mix(1.0, ease, Ease.z)), mix(1.0, ease, Ease.w));
+
+    vec3 normal = ViewPosition - pos;
+    normal = dot(normal, normal) > 1e-12 ? normalize(normal) : ViewForward;
+    vec3 xBasis = cross(vec3(0.0, 1.0, 0.0), normal);
+    vec3 yBasis = vec3(0.0, 1.0, 0.0);
+    if (dot(xBasis, xBasis) > 1e-8) {
+        xBasis = normalize(xBasis);
+        yBasis = cross(normal, xBasis);
+    } else {
+        xBasis = vec3(1.0, 0.0, 0.0);
+    }
+
+    // particles that are unborn, expired or removed collapse to a point
+    float halfScale = (t < 0.0 || t > lifeTime) ? 0.0 : 0.5 * HalfAccelerationScale.w;
+    float c = cos(orientation) * halfScale;
+    float s = sin(orientation) * halfScale;
+    vec3 right = xBasis * c + yBasis * s;
+    vec3 top = yBasis * c - xBasis * s;
+
+    // top left, top right, bottom right, bottom left
+    int corner = gl_VertexID;
+    vec2 side = vec2((corner == 1 || corner == 2) ? 1.0 : -1.0, corner < 2 ? 1.0 : -1.0);
+    oPosition = pos + right * side.x + top * side.y;
+    oColor = color;
+    oTexCoord = vec2(side.x > 0.0 ? UvRect.z : UvRect.x, side.y > 0.0 ? UvRect.y : UvRect.w);
+    gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
+)glsl";
+
+// ES 3.0 won't link a program without a fragment shader, even with rasterization off.
+static const char* simulationFragmentSrc = R"glsl(#version 300 es
+precision mediump float;
+out vec4 fragColor;
+void main()
+{
+    fragColor = vec4(0.0);
+}
+)glsl";
+
+static const char* simulationAttributes[] = {
+    "PositionStart",
+    "VelocityLifeTime",
+    "HalfAccelerationScale",
+    "Color",
+    "Ease",
+    "Rotation",
+    "UvRect"};
+
+static const char* simulationVaryings[] = {"oPosition", "oColor", "oTexCoord"};
+
+// the same programs ovrParticleSystem draws with
+static const char* particleVertexSrc = R"glsl(
+attribute vec4 Position;
+attribute vec2 TexCoord;
+attribute vec4 VertexColor;
+varying highp vec2 oTexCoord;
+varying lowp vec4 oColor;
+void main()
+{
+    gl_Position = TransformVertex( Position );
+    oTexCoord = TexCoord;
+    oColor = VertexColor;
+}
+)glsl";
+
+static const char* particleFragmentSrc = R"glsl(
+uniform sampler2D Texture0;
+varying highp vec2 oTexCoord;
+varying lowp vec4 oColor;
+void main()
+{
+    gl_FragColor = oColor * texture2D( Texture0, oTexCoord );
+}
+)glsl";
+
+static const char* particleGeoFragmentSrc = R"glsl(
+precision highp float;
+
+varying highp vec2 oTexCoord;
+varying lowp vec4 oColor;
+void main()
+{
+    float dist = distance(oTexCoord, vec2(0.0f));
+    float alpha = smoothstep(0.6f, 0.35f, dist);
+    gl_FragColor = mix(vec4(0.0f), oColor, alpha);
+}
+)glsl";
+
+static GLuint CompileSimulationShader(const GLenum shaderType, const char* src) {
+    GLuint shader = glCreateShader(shaderType);
+    glShaderSource(shader, 1, &src, 0);
+    glCompileShader(shader);
+
+    GLint r;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &r);
+    if (r == GL_FALSE) {
+        GLchar msg[1024];
+        glGetShaderInfoLog(shader, sizeof(msg), 0, msg);
+        ALOGW("ovrGpuParticleSystem: compiling simulation shader failed: %s", msg);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint BuildSimulationProgram() {
+    const GLuint vertexShader = CompileSimulationShader(GL_VERTEX_SHADER, simulationVertexSrc);
+    const GLuint fragmentShader =
+        CompileSimulationShader(GL_FRAGMENT_SHADER, simulationFragmentSrc);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    for (int i = 0; i < static_cast<int>(sizeof(simulationAttributes) / sizeof(char*)); i++) {
+        glBindAttribLocation(program, i, simulationAttributes[i]);
+    }
+    glTransformFeedbackVaryings(
+        program,
+        sizeof(simulationVaryings) / sizeof(char*),
+        simulationVaryings,
+        GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_FALSE) {
+        GLchar msg[1024];
+        glGetProgramInfoLog(program, sizeof(msg), 0, msg);
+        ALOGW("ovrGpuParticleSystem: linking simulation program failed: %s", msg);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+ovrGpuParticleSystem::ovrGpuParticleSystem()
+    : NextParticle(0),
+      DirtyBegin(0),
+      DirtyEnd(0),
+      TimeBase(-1.0),
+      LastExpireTime(0.0),
+      HasLiveParticles(false),
+      Atlas(nullptr),
+      ParticleBuffer(0),
+      SimulationVertexArray(0),
+      SimulationProgram(0),
+      TimeUniform(-1),
+      ViewPositionUniform(-1),
+      ViewForwardUniform(-1) {}
+
+ovrGpuParticleSystem::~ovrGpuParticleSystem() {
+    Shutdown();
+}
+
+void ovrGpuParticleSystem::Init(
+    const size_t maxParticles,
+    const ovrTextureAtlas* atlas,
+    const ovrGpuState& gpuState) {
+    // this can be called multiple times
+    Shutdown();
+
+    SimulationProgram = BuildSimulationProgram();
+    if (SimulationProgram == 0) {
+        return;
+    }
+    TimeUniform = glGetUniformLocation(SimulationProgram, "Time");
+    ViewPositionUniform = glGetUniformLocation(SimulationProgram, "ViewPosition");
+    ViewForwardUniform = glGetUniformLocation(SimulationProgram, "ViewForward");
+
+    // every record starts out zeroed, and so dead: a zero life time has always expired
+    Particles.assign(maxParticles, ovrGpuParticle());
+    NextParticle = 0;
+    DirtyBegin = 0;
+    DirtyEnd = 0;
+    TimeBase = -1.0;
+    LastExpireTime = 0.0;
+    HasLiveParticles = false;
+    Atlas = atlas;
+
+    glGenBuffers(1, &ParticleBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, ParticleBuffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        Particles.size() * sizeof(ovrGpuParticle),
+        Particles.data(),
+        GL_DYNAMIC_DRAW);
+
+    // one instance per particle, the pointers are set per surface each frame
+    glGenVertexArrays(1, &SimulationVertexArray);
+    glBindVertexArray(SimulationVertexArray);
+    for (int i = 0; i < NUM_PARTICLE_ATTRIBUTES; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    {
+        OVRFW::ovrProgramParm uniformParms[] = {
+            /// Vertex
+            /// Fragment
+            {"Texture0", OVRFW::ovrProgramParmType::TEXTURE_SAMPLED},
+        };
+        const int uniformCount = sizeof(uniformParms) / sizeof(OVRFW::ovrProgramParm);
+        Program = OVRFW::GlProgram::Build(
+            particleVertexSrc,
+            atlas != nullptr ? particleFragmentSrc : particleGeoFragmentSrc,
+            uniformParms,
+            uniformCount);
+    }
+
+    // The simulation pass writes straight into the vertex buffers of the surfaces, which
+    // are created at full size and never touched by the CPU again.
+    const int numParticles = static_cast<int>(maxParticles);
+    const int numSurfaces =
+        (numParticles + MAX_PARTICLES_PER_SURFACE - 1) / MAX_PARTICLES_PER_SURFACE;
+    Surfaces.resize(numSurfaces);
+    for (int s = 0; s < numSurfaces; s++) {
+        const int count =
+            std::min(numParticles - s * MAX_PARTICLES_PER_SURFACE, MAX_PARTICLES_PER_SURFACE);
+
+        VertexAttribs attr;
+        attr.position.resize(count * 4);
+        attr.color.resize(count * 4);
+        attr.uv0.resize(count * 4);
+
+        std::vector<TriangleIndex> indices(count * 6);
+        for (int i = 0; i < count; ++i) {
+            indices[i * 6 + 0] = static_cast<uint16_t>(i * 4 + 0);
+            indices[i * 6 + 1] = static_cast<uint16_t>(i * 4 + 3);
+            indices[i * 6 + 2] = static_cast<uint16_t>(i * 4 + 1);
+            indices[i * 6 + 3] = static_cast<uint16_t>(i * 4 + 1);
+            indices[i * 6 + 4] = static_cast<uint16_t>(i * 4 + 3);
+            indices[i * 6 + 5] = static_cast<uint16_t>(i * 4 + 2);
+        }
+
+        ovrSurfaceDef& surfaceDef = Surfaces[s];
+        surfaceDef.geo.Create(attr, indices);
+
+        // the packed attributes are the same size as an interleaved ovrParticleVertex
+        const GLsizei stride = sizeof(ovrParticleVertex);
+        glBindVertexArray(surfaceDef.geo.vertexArrayObject);
+        glBindBuffer(GL_ARRAY_BUFFER, surfaceDef.geo.vertexBuffer);
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_POSITION,
+            3,
+            GL_FLOAT,
+            false,
+            stride,
+            (void*)offsetof(ovrParticleVertex, Position));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_COLOR,
+            4,
+            GL_FLOAT,
+            false,
+            stride,
+            (void*)offsetof(ovrParticleVertex, Color));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_UV0,
+            2,
+            GL_FLOAT,
+            false,
+            stride,
+            (void*)offsetof(ovrParticleVertex, Uv));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        surfaceDef.surfaceName = "gpu_particles";
+        if (atlas != nullptr) {
+            surfaceDef.surfaceName += std::string("_") + atlas->GetTextureName();
+            surfaceDef.graphicsCommand.Textures[0] = atlas->GetTexture();
+        }
+        surfaceDef.graphicsCommand.Program = Program;
+        surfaceDef.graphicsCommand.BindUniformTextures();
+        surfaceDef.graphicsCommand.GpuState = gpuState;
+    }
+    FrameThreadGlUser.Acquire();
+}
+
+void ovrGpuParticleSystem::Shutdown() {
+    for (ovrSurfaceDef& surfaceDef : Surfaces) {
+        surfaceDef.geo.Free();
+    }
+    Surfaces.clear();
+    if (Program.Program != 0) {
+        OVRFW::GlProgram::Free(Program);
+    }
+    if (SimulationProgram != 0) {
+        glDeleteProgram(SimulationProgram);
+        SimulationProgram = 0;
+    }
+    if (SimulationVertexArray != 0) {
+        glDeleteVertexArrays(1, &SimulationVertexArray);
+        SimulationVertexArray = 0;
+    }
+    if (ParticleBuffer != 0) {
+        glDeleteBuffers(1, &ParticleBuffer);
+        ParticleBuffer = 0;
+    }
+    Particles.clear();
+    HasLiveParticles = false;
+    Atlas = nullptr;
+    FrameThreadGlUser.Release();
+}
+
+void ovrGpuParticleSystem::Frame(
+    const OVRFW::ovrApplFrameIn& frame,
+    const Matrix4f& centerEyeViewMatrix) {
+    HasLiveParticles = SimulationProgram != 0 && frame.PredictedDisplayTime <= LastExpireTime;
+    if (!HasLiveParticles) {
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, ParticleBuffer);
+    if (DirtyBegin < DirtyEnd) {
+        glBufferSubData(
+            GL_ARRAY_BUFFER,
+            DirtyBegin * sizeof(ovrGpuParticle),
+            (DirtyEnd - DirtyBegin) * sizeof(ovrGpuParticle),
+            &Particles[DirtyBegin]);
+        DirtyBegin = 0;
+        DirtyEnd = 0;
+    }
+
+    const Matrix4f& m = centerEyeViewMatrix;
+    const Vector3f viewPos = m.Inverted().GetTranslation();
+    const Vector3f viewForward = Vector3f(-m.M[2][0], -m.M[2][1], -m.M[2][2]).Normalized();
+
+    glUseProgram(SimulationProgram);
+    glUniform1f(TimeUniform, static_cast<float>(frame.PredictedDisplayTime - TimeBase));
+    glUniform3f(ViewPositionUniform, viewPos.x, viewPos.y, viewPos.z);
+    glUniform3f(ViewForwardUniform, viewForward.x, viewForward.y, viewForward.z);
+    glBindVertexArray(SimulationVertexArray);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    // ES 3.0 has no base instance, so each surface's block of particles is selected by
+    // offsetting the instance attributes.
+    for (int s = 0; s < static_cast<int>(Surfaces.size()); s++) {
+        const int first = s * MAX_PARTICLES_PER_SURFACE;
+        const int count = Surfaces[s].geo.vertexCount / 4;
+        for (int i = 0; i < NUM_PARTICLE_ATTRIBUTES; i++) {
+            glVertexAttribPointer(
+                i,
+                4,
+                GL_FLOAT,
+                false,
+                sizeof(ovrGpuParticle),
+                (void*)(first * sizeof(ovrGpuParticle) + i * sizeof(Vector4f)));
+        }
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, Surfaces[s].geo.vertexBuffer);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArraysInstanced(GL_POINTS, 0, 4, count);
+        glEndTransformFeedback();
+    }
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
+
+void ovrGpuParticleSystem::RenderEyeView(
+    Matrix4f const& viewMatrix,
+    Matrix4f const& projectionMatrix,
+    std::vector<ovrDrawSurface>& surfaceList) const {
+    if (!HasLiveParticles) {
+        return;
+    }
+    for (const ovrSurfaceDef& surfaceDef : Surfaces) {
+        ovrDrawSurface surf;
+        surf.modelMatrix = ModelMatrix;
+        surf.surface = &surfaceDef;
+        surfaceList.push_back(surf);
+    }
+}
+
+ovrGpuParticleSystem::handle_t ovrGpuParticleSystem::AddParticle(
+    const OVRFW::ovrApplFrameIn& frame,
+    const Vector3f& initialPosition,
+    const float initialOrientation,
+    const Vector3f& initialVelocity,
+    const Vector3f& acceleration,
+    const Vector4f& initialColor,
+    const ovrEaseFunc easeFunc,
+    const float rotationRate,
+    const float scale,
+    const float lifeTime,
+    const uint16_t spriteIndex) {
+    if (Particles.empty()) {
+        return handle_t();
+    }
+
+    const int index = NextParticle;
+    NextParticle = (NextParticle + 1) % static_cast<int>(Particles.size());
+
+    SetParticle(
+        index,
+        frame,
+        initialPosition,
+        initialOrientation,
+        initialVelocity,
+        acceleration,
+        initialColor,
+        easeFunc,
+        rotationRate,
+        scale,
+        lifeTime,
+        spriteIndex);
+    return handle_t(index);
+}
+
+void ovrGpuParticleSystem::UpdateParticle(
+    const OVRFW::ovrApplFrameIn& frame,
+    const handle_t handle,
+    const Vector3f& position,
+    const float orientation,
+    const Vector3f& velocity,
+    const Vector3f& acceleration,
+    const Vector4f& color,
+    const ovrEaseFunc easeFunc,
+    const float rotationRate,
+    const float scale,
+    const float lifeTime,
+    const uint16_t spriteIndex) {
+    if (!handle.IsValid() || (size_t)handle.Get() >= Particles.size()) {
+        assert(handle.IsValid() && (size_t)handle.Get() < Particles.size());
+        return;
+    }
+    SetParticle(
+        handle.Get(),
+        frame,
+        position,
+        orientation,
+        velocity,
+        acceleration,
+        color,
+        easeFunc,
+        rotationRate,
+        scale,
+        lifeTime,
+        spriteIndex);
+}
+
+void ovrGpuParticleSystem::RemoveParticle(const handle_t handle) {
+    if (!handle.IsValid() || (size_t)handle.Get() >= Particles.size()) {
+        return;
+    }
+    const int index = handle.Get();
+    Particles[index].VelocityLifeTime.w = -1.0f;
+    DirtyBegin = DirtyBegin < DirtyEnd ? std::min(DirtyBegin, index) : index;
+    DirtyEnd = std::max(DirtyEnd, index + 1);
+}
+
+void ovrGpuParticleSystem::SetParticle(
+    const int index,
+    const OVRFW::ovrApplFrameIn& frame,
+    const Vector3f& position,
+    const float orientation,
+    const Vector3f& velocity,
+    const Vector3f& acceleration,
+    const Vector4f& color,
+    const ovrEaseFunc easeFunc,
+    const float rotationRate,
+    const float scale,
+    const float lifeTime,
+    const uint16_t spriteIndex) {
+    if (TimeBase < 0.0) {
+        TimeBase = frame.PredictedDisplayTime;
+    }
+    LastExpireTime = std::max(LastExpireTime, frame.PredictedDisplayTime + lifeTime);
+
+    Vector4f uvRect(-1.0f, -1.0f, 1.0f, 1.0f);
+    if (Atlas != nullptr) {
+        const ovrTextureAtlas::ovrSpriteDef& sd = Atlas->GetSpriteDef(spriteIndex);
+        uvRect = Vector4f(sd.uvMins.x, sd.uvMins.y, sd.uvMaxs.x, sd.uvMaxs.y);
+    }
+
+    ovrGpuParticle& p = Particles[index];
+    p.PositionStart = Vector4f(
+        position.x,
+        position.y,
+        position.z,
+        static_cast<float>(frame.PredictedDisplayTime - TimeBase));
+    p.VelocityLifeTime = Vector4f(velocity.x, velocity.y, velocity.z, lifeTime);
+    p.HalfAccelerationScale =
+        Vector4f(acceleration.x * 0.5f, acceleration.y * 0.5f, acceleration.z * 0.5f, scale);
+    p.Color = color;
+    p.Ease = GetEaseFactors(easeFunc);
+    p.Rotation = Vector4f(orientation, rotationRate, 0.0f, 0.0f);
+    p.UvRect = uvRect;
+
+    DirtyBegin = DirtyBegin < DirtyEnd ? std::min(DirtyBegin, index) : index;
+    DirtyEnd = std::max(DirtyEnd, index + 1);
+}
+
+} // namespace OVRFW
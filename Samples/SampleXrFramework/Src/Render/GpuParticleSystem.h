@@ -0,0 +1,152 @@
+/************************************************************************************
+
+Filename    :   GpuParticleSystem.h
+Content     :   Particle system simulated on the GPU with transform feedback.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+#include "OVR_TypesafeNumber.h"
+
+#include "FrameParams.h"
+#include "Render/GlGeometry.h"
+#include "Render/GlProgram.h"
+#include "Render/GlStreamBuffer.h"
+#include "Render/SurfaceRender.h"
+
+#include "EaseFunctions.h"
+
+namespace OVRFW {
+
+class ovrTextureAtlas;
+
+// The ovrParticleSystem interface for effects too large to rebuild on the CPU every frame.
+// Each particle's parameters go into a GPU buffer when it's added or updated, and every frame
+// a transform feedback pass evaluates the motion, rotation and ease curves of all of them and
+// writes the quads the particle surfaces draw, so nothing is read back. The CPU only uploads
+// the particles that changed, which keeps its cost independent of the particle count; the GPU
+// cost follows the maximum count.
+//
+// Particles are allocated from a ring, and when it's full adding one replaces the oldest.
+// Handles aren't invalidated by that, so only keep them for as long as the particle lives.
+// Particles are not sorted, so this suits additive or otherwise order independent blending.
+class ovrGpuParticleSystem {
+   public:
+    enum ovrParticleIndex { INVALID_PARTICLE_INDEX = -1 };
+
+    typedef OVR::TypesafeNumberT<int32_t, ovrParticleIndex, INVALID_PARTICLE_INDEX> handle_t;
+
+    ovrGpuParticleSystem();
+    ~ovrGpuParticleSystem();
+
+    // Requires an active OpenGL ES 3.0 context. The atlas is only used to look up the sprite
+    // UVs of particles as they are added.
+    void Init(
+        const size_t maxParticles,
+        const ovrTextureAtlas* atlas,
+        const ovrGpuState& gpuState);
+    void Shutdown();
+
+    // Uploads the changed particles and runs the simulation pass. Requires an active GL
+    // context; call it every frame the particles are rendered.
+    void Frame(const OVRFW::ovrApplFrameIn& frame, const OVR::Matrix4f& centerEyeViewMatrix);
+
+    void RenderEyeView(
+        OVR::Matrix4f const& viewMatrix,
+        OVR::Matrix4f const& projectionMatrix,
+        std::vector<ovrDrawSurface>& surfaceList) const;
+
+    handle_t AddParticle(
+        const OVRFW::ovrApplFrameIn& frame,
+        const OVR::Vector3f& initialPosition,
+        const float initialOrientation,
+        const OVR::Vector3f& initialVelocity,
+        const OVR::Vector3f& acceleration,
+        const OVR::Vector4f& initialColor,
+        const ovrEaseFunc easeFunc,
+        const float rotationRate,
+        const float scale,
+        const float lifeTime,
+        const uint16_t spriteIndex);
+
+    void UpdateParticle(
+        const OVRFW::ovrApplFrameIn& frame,
+        const handle_t handle,
+        const OVR::Vector3f& position,
+        const float orientation,
+        const OVR::Vector3f& velocity,
+        const OVR::Vector3f& acceleration,
+        const OVR::Vector4f& color,
+        const ovrEaseFunc easeFunc,
+        const float rotationRate,
+        const float scale,
+        const float lifeTime,
+        const uint16_t spriteIndex);
+
+    void RemoveParticle(const handle_t handle);
+
+    int GetMaxParticles() const {
+        return static_cast<int>(Particles.size());
+    }
+
+   private:
+    // 16-bit indices limit each draw to this many particles.
+    static const int MAX_PARTICLES_PER_SURFACE = GlGeometry::MAX_GEOMETRY_VERTICES / 4;
+
+    // One instance of the simulation pass. Each member is a vec4 attribute of the
+    // simulation shader, in this order.
+    struct ovrGpuParticle {
+        OVR::Vector4f PositionStart; // initial position, start time relative to TimeBase
+        OVR::Vector4f VelocityLifeTime; // negative life time for removed particles
+        OVR::Vector4f HalfAccelerationScale;
+        OVR::Vector4f Color;
+        OVR::Vector4f Ease; // GetEaseFactors()
+        OVR::Vector4f Rotation; // initial orientation, rotation rate
+        OVR::Vector4f UvRect; // u0, v0, u1, v1
+    };
+    static const int NUM_PARTICLE_ATTRIBUTES = sizeof(ovrGpuParticle) / sizeof(OVR::Vector4f);
+
+    void SetParticle(
+        const int index,
+        const OVRFW::ovrApplFrameIn& frame,
+        const OVR::Vector3f& position,
+        const float orientation,
+        const OVR::Vector3f& velocity,
+        const OVR::Vector3f& acceleration,
+        const OVR::Vector4f& color,
+        const ovrEaseFunc easeFunc,
+        const float rotationRate,
+        const float scale,
+        const float lifeTime,
+        const uint16_t spriteIndex);
+
+    std::vector<ovrGpuParticle> Particles; // copy of the particle buffer
+    int NextParticle; // ring position
+    int DirtyBegin; // range of Particles changed since the last upload
+    int DirtyEnd;
+    double TimeBase; // display time the start times are relative to, so they fit a float
+    double LastExpireTime; // no particle is alive past this display time
+    bool HasLiveParticles;
+    const ovrTextureAtlas* Atlas;
+
+    unsigned int ParticleBuffer;
+    unsigned int SimulationVertexArray;
+    unsigned int SimulationProgram;
+    int TimeUniform;
+    int ViewPositionUniform;
+    int ViewForwardUniform;
+
+    GlProgram Program;
+    std::vector<ovrSurfaceDef> Surfaces;
+    OVR::Matrix4f ModelMatrix;
+    ovrFrameThreadGlUser FrameThreadGlUser; // Frame() uploads and runs the simulation pass
+};
+
+} // namespace OVRFW
@@ -0,0 +1,323 @@
+/************************************************************************************
+
+Filename    :   MeshOptimizer.cpp
+Content     :   Triangle and vertex reordering for the post-transform cache, overdraw
+                and vertex fetch.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+using OVR::Vector3f;
+
+namespace OVRFW {
+
+// FIFO post-transform cache, by the time each vertex last went in.
+class ovrVertexCacheSim {
+   public:
+    ovrVertexCacheSim(const size_t vertexCount, const int cacheSize)
+        : Stamps(vertexCount, 0), Size(cacheSize), Time(cacheSize + 1) {}
+
+    // Returns 1 if the vertex had to be transformed.
+    int Use(const uint32_t v) {
+        if (Time - Stamps[v] <= Size) {
+            return 0;
+        }
+        Stamps[v] = Time++;
+        return 1;
+    }
+
+    void Flush() {
+        Time += Size;
+    }
+
+   private:
+    std::vector<uint32_t> Stamps;
+    uint32_t Size;
+    uint32_t Time;
+};
+
+template <typename _index_type_>
+float ComputeAcmr(
+    const std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    const int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return 0.0f;
+    }
+    ovrVertexCacheSim cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        misses += cache.Use(indices[i]);
+    }
+    return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
+
+template <typename _index_type_>
+void OptimizeVertexCache(
+    std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    std::vector<uint32_t>* clusters,
+    const int cacheSize) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (clusters != nullptr) {
+        clusters->clear();
+    }
+    if (triangleCount == 0 || vertexCount == 0) {
+        return;
+    }
+
+    // triangles around each vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+        live[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < triangleCount * 3; ++i) {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<uint32_t> stamps(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnds; // recently used vertices, to pick up where a fan stopped
+    std::vector<uint32_t> candidates;
+    std::vector<_index_type_> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t cursor = 0; // for when nothing recently used has live triangles left
+    int64_t fanning = 0;
+    if (clusters != nullptr) {
+        clusters->push_back(0);
+    }
+    while (fanning >= 0) {
+        const uint32_t f = static_cast<uint32_t>(fanning);
+        candidates.clear();
+        for (uint32_t a = offsets[f]; a < offsets[f + 1]; ++a) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t] != 0) {
+                continue;
+            }
+            emitted[t] = 1;
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = indices[t * 3 + k];
+                output.push_back(static_cast<_index_type_>(v));
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - stamps[v] > static_cast<uint32_t>(cacheSize)) {
+                    stamps[v] = time++;
+                }
+            }
+        }
+
+        // Fan next around the candidate that has been in the cache longest while its
+        // remaining triangles will not push it out.
+        fanning = -1;
+        int bestPriority = -1;
+        for (const uint32_t v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (time - stamps[v] + 2 * live[v] <= static_cast<uint32_t>(cacheSize)) {
+                priority = static_cast<int>(time - stamps[v]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0) {
+            continue;
+        }
+
+        // dead end
+        while (!deadEnds.empty() && fanning < 0) {
+            const uint32_t d = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[d] > 0) {
+                fanning = d;
+            }
+        }
+        while (cursor < vertexCount && fanning < 0) {
+            if (live[cursor] > 0) {
+                fanning = cursor;
+            }
+            cursor++;
+        }
+        if (fanning >= 0 && clusters != nullptr) {
+            clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+        }
+    }
+
+    if (clusters != nullptr && clusters->size() > 1 && clusters->back() == triangleCount) {
+        clusters->pop_back();
+    }
+    indices.swap(output);
+}
+
+template <typename _index_type_>
+void OptimizeOverdraw(
+    std::vector<_index_type_>& indices,
+    const std::vector<Vector3f>& positions,
+    const std::vector<uint32_t>& clusters,
+    const float threshold,
+    const int cacheSize) {
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    // Split wherever the triangles so far, starting from a cold cache, are close enough to
+    // the cache efficiency of the whole cluster.
+    ovrVertexCacheSim cache(positions.size(), cacheSize);
+    std::vector<uint32_t> starts;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const uint32_t start = clusters[c];
+        const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        if (start >= end) {
+            continue;
+        }
+        cache.Flush();
+        uint32_t clusterMisses = 0;
+        for (uint32_t i = start * 3; i < end * 3; ++i) {
+            clusterMisses += cache.Use(indices[i]);
+        }
+        const float maxAcmr =
+            threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        starts.push_back(start);
+        cache.Flush();
+        uint32_t misses = 0;
+        uint32_t splitStart = start;
+        for (uint32_t t = start; t + 1 < end; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                misses += cache.Use(indices[t * 3 + k]);
+            }
+            if (static_cast<float>(misses) <= maxAcmr * static_cast<float>(t + 1 - splitStart)) {
+                splitStart = t + 1;
+                starts.push_back(splitStart);
+                cache.Flush();
+                misses = 0;
+            }
+        }
+    }
+
+    struct ovrCluster {
+        uint32_t start;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<ovrCluster> sorted(starts.size());
+    std::vector<Vector3f> centroids(starts.size());
+    std::vector<Vector3f> normals(starts.size());
+    Vector3f meshCentroid(0.0f);
+    for (size_t c = 0; c < starts.size(); ++c) {
+        sorted[c].start = starts[c];
+        sorted[c].end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+        Vector3f centroid(0.0f);
+        Vector3f normal(0.0f);
+        for (uint32_t t = sorted[c].start; t < sorted[c].end; ++t) {
+            const Vector3f& p0 = positions[indices[t * 3 + 0]];
+            const Vector3f& p1 = positions[indices[t * 3 + 1]];
+            const Vector3f& p2 = positions[indices[t * 3 + 2]];
+            centroid += (p0 + p1 + p2) * (1.0f / 3.0f);
+            normal += (p1 - p0).Cross(p2 - p0); // area weighted
+        }
+        meshCentroid += centroid;
+        centroids[c] = centroid / static_cast<float>(sorted[c].end - sorted[c].start);
+        normals[c] = normal;
+    }
+    meshCentroid /= static_cast<float>(triangleCount);
+    for (size_t c = 0; c < sorted.size(); ++c) {
+        const float length = normals[c].Length();
+        sorted[c].sortKey =
+            length > 0.0f ? (centroids[c] - meshCentroid).Dot(normals[c]) / length : 0.0f;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const ovrCluster& a, const ovrCluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<_index_type_> output;
+    output.reserve(triangleCount * 3);
+    for (const ovrCluster& c : sorted) {
+        output.insert(output.end(), indices.begin() + c.start * 3, indices.begin() + c.end * 3);
+    }
+    indices.swap(output);
+}
+
+template <typename _index_type_>
+void OptimizeVertexFetch(
+    std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    std::vector<uint32_t>& order) {
+    order.clear();
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    for (_index_type_& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(order.size());
+            order.push_back(index);
+        }
+        index = static_cast<_index_type_>(remap[index]);
+    }
+}
+
+template <typename _attrib_type_>
+static void RemapChannel(std::vector<_attrib_type_>& channel, const std::vector<uint32_t>& order) {
+    if (channel.empty()) {
+        return;
+    }
+    std::vector<_attrib_type_> remapped(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        remapped[i] = channel[order[i]];
+    }
+    channel.swap(remapped);
+}
+
+void RemapVertexAttribs(VertexAttribs& attribs, const std::vector<uint32_t>& order) {
+    RemapChannel(attribs.position, order);
+    RemapChannel(attribs.normal, order);
+    RemapChannel(attribs.tangent, order);
+    RemapChannel(attribs.binormal, order);
+    RemapChannel(attribs.color, order);
+    RemapChannel(attribs.uv0, order);
+    RemapChannel(attribs.uv1, order);
+    RemapChannel(attribs.jointIndices, order);
+    RemapChannel(attribs.jointWeights, order);
+}
+
+template float ComputeAcmr(const std::vector<uint16_t>&, const size_t, const int);
+template float ComputeAcmr(const std::vector<uint32_t>&, const size_t, const int);
+template void
+OptimizeVertexCache(std::vector<uint16_t>&, const size_t, std::vector<uint32_t>*, const int);
+template void
+OptimizeVertexCache(std::vector<uint32_t>&, const size_t, std::vector<uint32_t>*, const int);
+template void OptimizeOverdraw(
+    std::vector<uint16_t>&,
+    const std::vector<Vector3f>&,
+    const std::vector<uint32_t>&,
+    const float,
+    const int);
+template void OptimizeOverdraw(
+    std::vector<uint32_t>&,
+    const std::vector<Vector3f>&,
+    const std::vector<uint32_t>&,
+    const float,
+    const int);
+template void OptimizeVertexFetch(std::vector<uint16_t>&, const size_t, std::vector<uint32_t>&);
+template void OptimizeVertexFetch(std::vector<uint32_t>&, const size_t, std::vector<uint32_t>&);
+
+} // namespace OVRFW
@@ -0,0 +1,68 @@
+/************************************************************************************
+
+Filename    :   MeshOptimizer.h
+Content     :   Triangle and vertex reordering for the post-transform cache, overdraw
+                and vertex fetch.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+#include "GlGeometry.h"
+
+namespace OVRFW {
+
+// Post-transform cache entries the orderings are made for. Mobile GPUs keep somewhere between
+// 8 and 32 transformed vertices around, and optimizing for 16 does well across that range.
+static constexpr int VERTEX_CACHE_SIZE = 16;
+
+// The indices are a triangle list, as TriangleIndex or uint32_t.
+
+// Average number of vertices transformed per triangle with a FIFO cache: 3 for no reuse,
+// about 0.5 for a well ordered regular grid.
+template <typename _index_type_>
+float ComputeAcmr(
+    const std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    const int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the triangles for the post-transform cache with Tipsify (Sander, Nehab and
+// Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"), which fans
+// around one vertex at a time. When clusters is given, it gets the index of the first triangle
+// after each point where the cache goes cold, starting with 0, for OptimizeOverdraw().
+template <typename _index_type_>
+void OptimizeVertexCache(
+    std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    std::vector<uint32_t>* clusters = nullptr,
+    const int cacheSize = VERTEX_CACHE_SIZE);
+
+// Splits the clusters from OptimizeVertexCache() further wherever that costs the cache less
+// than threshold times the ACMR of the cluster, and draws the clusters facing away from the
+// center of the mesh first, as they are the most likely to hide the others.
+template <typename _index_type_>
+void OptimizeOverdraw(
+    std::vector<_index_type_>& indices,
+    const std::vector<OVR::Vector3f>& positions,
+    const std::vector<uint32_t>& clusters,
+    const float threshold = 1.05f,
+    const int cacheSize = VERTEX_CACHE_SIZE);
+
+// Renumbers the vertices in the order the indices first use them, leaving out the ones they
+// don't use, and sets order to the old vertex of each new one for RemapVertexAttribs().
+template <typename _index_type_>
+void OptimizeVertexFetch(
+    std::vector<_index_type_>& indices,
+    const size_t vertexCount,
+    std::vector<uint32_t>& order);
+
+// Keeps attribute order[i] of every channel that has data as attribute i.
+void RemapVertexAttribs(VertexAttribs& attribs, const std::vector<uint32_t>& order);
+
+} // namespace OVRFW
@@ -30,8 +30,24 @@ Authors     :   Jonathan E. Wright
 #include "TextureAtlas.h"
 #include "Render/GeometryBuilder.h"
 #include "Render/GlGeometry.h"
+#include "Render/GlStreamBuffer.h"
+#include "Misc/Log.h"
+#include "Egl.h"
+#include "System.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OVR_PARTICLE_SIMD_NEON
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OVR_PARTICLE_SIMD_SSE
+#endif
 
 using OVR::Matrix4f;
 using OVR::Posef;
@@ -46,6 +62,121 @@ inline Vector3f GetViewMatrixForward(Matrix4f const& m) {
 
 namespace OVRFW {
 
+//==============================================================
+// four-wide float operations for the particle integration
+
+static const int SIMD_WIDTH = 4;
+
+#if defined(OVR_PARTICLE_SIMD_NEON)
+
+static const char* SIMD_NAME = "NEON";
+
+typedef float32x4_t simd4f;
+
+inline simd4f Load4(const float* p) {
+    return vld1q_f32(p);
+}
+inline void Store4(float* p, const simd4f a) {
+    vst1q_f32(p, a);
+}
+inline simd4f Splat4(const float f) {
+    return vdupq_n_f32(f);
+}
+inline simd4f Add4(const simd4f a, const simd4f b) {
+    return vaddq_f32(a, b);
+}
+inline simd4f Sub4(const simd4f a, const simd4f b) {
+    return vsubq_f32(a, b);
+}
+inline simd4f Mul4(const simd4f a, const simd4f b) {
+    return vmulq_f32(a, b);
+}
+// a * b + c
+inline simd4f MulAdd4(const simd4f a, const simd4f b, const simd4f c) {
+    return vmlaq_f32(c, a, b);
+}
+// a <= b ? x : y
+inline simd4f SelectLessEqual4(const simd4f a, const simd4f b, const simd4f x, const simd4f y) {
+    return vbslq_f32(vcleq_f32(a, b), x, y);
+}
+
+#elif defined(OVR_PARTICLE_SIMD_SSE)
+
+static const char* SIMD_NAME = "SSE";
+
+typedef __m128 simd4f;
+
+inline simd4f Load4(const float* p) {
+    return _mm_loadu_ps(p);
+}
+inline void Store4(float* p, const simd4f a) {
+    _mm_storeu_ps(p, a);
+}
+inline simd4f Splat4(const float f) {
+    return _mm_set1_ps(f);
+}
+inline simd4f Add4(const simd4f a, const simd4f b) {
+    return _mm_add_ps(a, b);
+}
+inline simd4f Sub4(const simd4f a, const simd4f b) {
+    return _mm_sub_ps(a, b);
+}
+inline simd4f Mul4(const simd4f a, const simd4f b) {
+    return _mm_mul_ps(a, b);
+}
+// a * b + c
+inline simd4f MulAdd4(const simd4f a, const simd4f b, const simd4f c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+// a <= b ? x : y
+inline simd4f SelectLessEqual4(const simd4f a, const simd4f b, const simd4f x, const simd4f y) {
+    const __m128 mask = _mm_cmple_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+
+#else
+
+static const char* SIMD_NAME = "scalar";
+
+struct simd4f {
+    float v[4];
+};
+
+inline simd4f Load4(const float* p) {
+    return {{p[0], p[1], p[2], p[3]}};
+}
+inline void Store4(float* p, const simd4f a) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = a.v[i];
+    }
+}
+inline simd4f Splat4(const float f) {
+    return {{f, f, f, f}};
+}
+inline simd4f Add4(const simd4f a, const simd4f b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+inline simd4f Sub4(const simd4f a, const simd4f b) {
+    return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+}
+inline simd4f Mul4(const simd4f a, const simd4f b) {
+    return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+// a * b + c
+inline simd4f MulAdd4(const simd4f a, const simd4f b, const simd4f c) {
+    return Add4(Mul4(a, b), c);
+}
+// a <= b ? x : y
+inline simd4f SelectLessEqual4(const simd4f a, const simd4f b, const simd4f x, const simd4f y) {
+    simd4f r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = a.v[i] <= b.v[i] ? x.v[i] : y.v[i];
+    }
+    return r;
+}
+
+#endif
+
 static const char* particleVertexSrc = R"glsl(
 attribute vec4 Position;
 attribute vec2 TexCoord;
@@ -91,7 +222,12 @@ static Vector3f quadVertPos[4] = {
 
 static Vector2f quadUVs[4] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
 
-ovrParticleSystem::ovrParticleSystem() : maxParticles_(0) {}
+ovrParticleSystem::ovrParticleSystem()
+    : maxParticles_(0),
+      numActive_(0),
+      storage_(STORAGE_SOA),
+      NumDrawnSurfaces(0),
+      SortParticles(false) {}
 
 ovrParticleSystem::~ovrParticleSystem() {
     Shutdown();
@@ -101,19 +237,16 @@ void ovrParticleSystem::Init(
     const size_t maxParticles,
     const ovrTextureAtlas* atlas,
     const ovrGpuState& gpuState,
-    bool const sortParticles) {
+    bool const sortParticles,
+    const ovrParticleStorage storage) {
     // this can be called multiple times
     Shutdown();
 
-    maxParticles_ = maxParticles;
-
     // free any existing particles
-    particles_.reserve(maxParticles);
-    freeParticles_.reserve(maxParticles);
-    activeParticles_.reserve(maxParticles);
+    AllocateStorage(maxParticles, storage);
 
     // create the geometry
-    CreateGeometry(maxParticles);
+    CreateGeometry(static_cast<int>(maxParticles));
 
     {
         OVRFW::ovrProgramParm uniformParms[] = {
@@ -125,27 +258,68 @@ void ovrParticleSystem::Init(
         if (atlas != nullptr) {
             Program = OVRFW::GlProgram::Build(
                 particleVertexSrc, particleFragmentSrc, uniformParms, uniformCount);
-            SurfaceDef.surfaceName = std::string("particles_") + atlas->GetTextureName();
-            SurfaceDef.graphicsCommand.Textures[0] = atlas->GetTexture();
         } else {
             Program = OVRFW::GlProgram::Build(
                 particleVertexSrc, particleGeoFragmentSrc, uniformParms, uniformCount);
         }
     }
 
-    SurfaceDef.graphicsCommand.Program = Program;
-    SurfaceDef.graphicsCommand.BindUniformTextures();
-
-    SurfaceDef.graphicsCommand.GpuState = gpuState;
+    for (ovrSurfaceDef& surfaceDef : Surfaces) {
+        if (atlas != nullptr) {
+            surfaceDef.surfaceName = std::string("particles_") + atlas->GetTextureName();
+            surfaceDef.graphicsCommand.Textures[0] = atlas->GetTexture();
+        }
+        surfaceDef.graphicsCommand.Program = Program;
+        surfaceDef.graphicsCommand.BindUniformTextures();
+        surfaceDef.graphicsCommand.GpuState = gpuState;
+    }
 
     SortParticles = sortParticles;
+}
 
-    derived_.reserve(maxParticles);
-    sortIndices_.reserve(maxParticles);
-    attr_.position.reserve(maxParticles * 4);
-    attr_.color.reserve(maxParticles * 4);
-    attr_.uv0.reserve(maxParticles * 4);
-    packedAttr_.reserve(maxParticles * 12 * 16 * 8);
+void ovrParticleSystem::AllocateStorage(
+    const size_t maxParticles,
+    const ovrParticleStorage storage) {
+    maxParticles_ = maxParticles;
+    numActive_ = 0;
+    storage_ = storage;
+
+    // only the chosen layout gets memory
+    const size_t soaSize = storage == STORAGE_SOA ? maxParticles : 0;
+    const size_t aosSize = storage == STORAGE_AOS ? maxParticles : 0;
+    particles_.resize(aosSize);
+    derivedAos_.resize(aosSize);
+    particles_.shrink_to_fit();
+    derivedAos_.shrink_to_fit();
+
+    // padded to whole SIMD blocks, the lanes past the last particle are computed and ignored
+    const size_t paddedSize = (soaSize + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    for (std::vector<float>& stream : streams_) {
+        stream.assign(paddedSize, 0.0f);
+        stream.shrink_to_fit();
+    }
+    for (std::vector<float>& stream : derived_) {
+        stream.assign(paddedSize, 0.0f);
+        stream.shrink_to_fit();
+    }
+    startTime_.assign(soaSize, 0.0);
+    lifeTime_.assign(soaSize, 0.0f);
+    spriteIndex_.assign(soaSize, 0);
+    startTime_.shrink_to_fit();
+    lifeTime_.shrink_to_fit();
+    spriteIndex_.shrink_to_fit();
+    slotHandles_.assign(maxParticles, handle_t());
+    handleSlots_.assign(maxParticles, -1);
+    sortKeys_.resize(maxParticles);
+    drawOrder_.resize(maxParticles);
+    sortScratch_.resize(maxParticles);
+
+    // handles are handed out in increasing order until they start being reused
+    freeParticles_.clear();
+    freeParticles_.reserve(maxParticles);
+    for (size_t i = maxParticles; i > 0; i--) {
+        freeParticles_.push_back(handle_t(static_cast<int32_t>(i - 1)));
+    }
 }
 
 ovrGpuState ovrParticleSystem::GetDefaultGpuState() {
@@ -159,136 +333,428 @@ ovrGpuState ovrParticleSystem::GetDefaultGpuState() {
     return s;
 }
 
-int ParticleSortFn(void const* a, void const* b) {
-    if (static_cast<const particleSort_t*>(b)->DistanceSq <
-        static_cast<const particleSort_t*>(a)->DistanceSq) {
-        return -1;
+void ovrParticleSystem::Simulate(const double displayTime, const Vector3f& viewPos) {
+    // free expired particles, and store the age of the rest for the vectorized pass
+    float* age = derived_[DERIVED_AGE].data();
+    for (int i = 0; i < numActive_;) {
+        const double t = displayTime - startTime_[i];
+        if (t > lifeTime_[i]) {
+            // the last particle moves into this slot, so don't skip it
+            RemoveSlot(i);
+            continue;
+        }
+        age[i] = static_cast<float>(t);
+        i++;
     }
-    return 1;
-}
-
-void ovrParticleSystem::Frame(
-    const OVRFW::ovrApplFrameIn& frame,
-    const ovrTextureAtlas* atlas,
-    const Matrix4f& centerEyeViewMatrix) {
-    // OVR_PERF_TIMER( ovrParticleSystem_Frame );
 
-    if (activeParticles_.empty()) {
-        return;
+    const float* s[STREAM_MAX];
+    for (int i = 0; i < STREAM_MAX; i++) {
+        s[i] = streams_[i].data();
+    }
+    float* derived[DERIVED_MAX];
+    for (int i = 0; i < DERIVED_MAX; i++) {
+        derived[i] = derived_[i].data();
     }
 
-    // update particles
-    Matrix4f invViewMatrix = centerEyeViewMatrix.Inverted();
-    Vector3f viewPos = invViewMatrix.GetTranslation();
+    const simd4f one = Splat4(1.0f);
+    const simd4f two = Splat4(2.0f);
+    const simd4f half = Splat4(0.5f);
+    const simd4f viewX = Splat4(viewPos.x);
+    const simd4f viewY = Splat4(viewPos.y);
+    const simd4f viewZ = Splat4(viewPos.z);
+
+    for (int i = 0; i < numActive_; i += SIMD_WIDTH) {
+        const simd4f t = Load4(age + i);
+        const simd4f tSq = Mul4(t, t);
 
-    int activeCount = 0;
-
-    // update existing particles and its vertices, deriving the current state of each particle based
-    // on it's current age store the derived state of each particle in the derived array. Also, make
-    // another array that is just the index of each particle and its distance to the view position.
-    // This array will be sorted by distance and then used to index into the derived array the
-    // vertices are transformed.
-
-    std::vector<particleDerived_t>& derived = derived_;
-    std::vector<particleSort_t>& sortIndices = sortIndices_;
-    derived.resize(activeParticles_.size());
-    sortIndices.resize(activeParticles_.size());
-
-    for (size_t i = 0; i < activeParticles_.size(); ++i) {
-        const handle_t handle = activeParticles_[i];
-        ovrParticle& p = particles_[handle.Get()];
-
-        if (frame.PredictedDisplayTime - p.StartTime > p.LifeTime) {
-            // free expired particle
-            p.StartTime = -1.0; // mark as unused
-            freeParticles_.push_back(handle);
-            // Swap this slot with the last item, order doesn't matter
-            activeParticles_.at(i) = activeParticles_.back();
-            activeParticles_.pop_back();
-            i--; // last particle was moved into current slot, so don't skip it
+        // x = x0 + v0 * t + 0.5f * a * t^2
+        const simd4f x = MulAdd4(
+            Load4(s[STREAM_HALF_ACCELERATION_X] + i),
+            tSq,
+            MulAdd4(Load4(s[STREAM_VELOCITY_X] + i), t, Load4(s[STREAM_POSITION_X] + i)));
+        const simd4f y = MulAdd4(
+            Load4(s[STREAM_HALF_ACCELERATION_Y] + i),
+            tSq,
+            MulAdd4(Load4(s[STREAM_VELOCITY_Y] + i), t, Load4(s[STREAM_POSITION_Y] + i)));
+        const simd4f z = MulAdd4(
+            Load4(s[STREAM_HALF_ACCELERATION_Z] + i),
+            tSq,
+            MulAdd4(Load4(s[STREAM_VELOCITY_Z] + i), t, Load4(s[STREAM_POSITION_Z] + i)));
+        Store4(derived[DERIVED_POSITION_X] + i, x);
+        Store4(derived[DERIVED_POSITION_Y] + i, y);
+        Store4(derived[DERIVED_POSITION_Z] + i, z);
+
+        Store4(
+            derived[DERIVED_ORIENTATION] + i,
+            MulAdd4(Load4(s[STREAM_ROTATION_RATE] + i), t, Load4(s[STREAM_ORIENTATION] + i)));
+
+        // the in-out ease curves, see GetEaseFactors()
+        const simd4f u = Mul4(t, Load4(s[STREAM_INV_LIFE_TIME] + i));
+        const simd4f v = SelectLessEqual4(u, half, u, Sub4(u, half));
+        const simd4f vMinusOne = Sub4(v, one);
+        const simd4f power = Mul4(
+            Mul4(v, MulAdd4(Load4(s[STREAM_EASE_SQUARE] + i), vMinusOne, one)),
+            MulAdd4(Load4(s[STREAM_EASE_CUBE] + i), vMinusOne, one));
+        const simd4f ease =
+            SelectLessEqual4(u, half, Mul4(two, power), Sub4(one, Mul4(two, power)));
+        const simd4f easeMinusOne = Sub4(ease, one);
+        const simd4f colorScale = MulAdd4(Load4(s[STREAM_EASE_COLOR] + i), easeMinusOne, one);
+        const simd4f alphaScale = MulAdd4(Load4(s[STREAM_EASE_ALPHA] + i), easeMinusOne, one);
+        Store4(derived[DERIVED_COLOR_R] + i, Mul4(Load4(s[STREAM_COLOR_R] + i), colorScale));
+        Store4(derived[DERIVED_COLOR_G] + i, Mul4(Load4(s[STREAM_COLOR_G] + i), colorScale));
+        Store4(derived[DERIVED_COLOR_B] + i, Mul4(Load4(s[STREAM_COLOR_B] + i), colorScale));
+        Store4(derived[DERIVED_COLOR_A] + i, Mul4(Load4(s[STREAM_COLOR_A] + i), alphaScale));
+
+        const simd4f dx = Sub4(x, viewX);
+        const simd4f dy = Sub4(y, viewY);
+        const simd4f dz = Sub4(z, viewZ);
+        Store4(derived[DERIVED_DISTANCE_SQ] + i, MulAdd4(dz, dz, MulAdd4(dy, dy, Mul4(dx, dx))));
+    }
+}
+
+void ovrParticleSystem::SimulateAos(const double displayTime, const Vector3f& viewPos) {
+    for (int i = 0; i < numActive_;) {
+        const ovrParticle& p = particles_[i];
+        if (displayTime - p.StartTime > p.LifeTime) {
+            // the last particle moves into this slot, so don't skip it
+            RemoveSlot(i);
             continue;
         }
 
-        float t = static_cast<float>(frame.PredictedDisplayTime - p.StartTime);
-        float tSq = t * t;
+        const float t = static_cast<float>(displayTime - p.StartTime);
+        const float tSq = t * t;
 
-        particleDerived_t& d = derived[activeCount];
+        ovrParticleDerived& d = derivedAos_[i];
         // x = x0 + v0 * t + 0.5f * a * t^2
         d.Pos = p.InitialPosition + p.InitialVelocity * t + p.HalfAcceleration * tSq;
         d.Orientation = (p.RotationRate * t) + p.InitialOrientation;
-
         d.Color = EaseFunctions[p.EaseFunc](p.InitialColor, t / p.LifeTime);
-
         d.Scale = p.InitialScale;
         d.SpriteIndex = p.SpriteIndex;
+        d.DistanceSq = (d.Pos - viewPos).LengthSq();
+        i++;
+    }
+}
 
-        particleSort_t& ps = sortIndices[activeCount];
-        ps.ActiveIndex = activeCount;
-        ps.DistanceSq =
-            (d.Pos - viewPos).LengthSq(); // Dot( centerEyeViewMatrix.GetZBasis() );//.LengthSq();
+// The top 16 bits of a positive float sort like the float and keep 7 bits of mantissa,
+// which is plenty for blending order. Inverted so the farthest particle comes first.
+static inline uint16_t DistanceSortKey(const float distanceSq) {
+    uint32_t bits;
+    memcpy(&bits, &distanceSq, sizeof(bits));
+    return static_cast<uint16_t>(0xFFFF - (bits >> 16));
+}
 
-        activeCount++;
+void ovrParticleSystem::Sort() {
+    const int count = numActive_;
+    for (int i = 0; i < count; i++) {
+        drawOrder_[i] = static_cast<uint32_t>(i);
+    }
+    if (!SortParticles) {
+        return;
     }
 
-    assert(activeParticles_.size() == (size_t)activeCount);
+    if (storage_ == STORAGE_AOS) {
+        for (int i = 0; i < count; i++) {
+            sortKeys_[i] = DistanceSortKey(derivedAos_[i].DistanceSq);
+        }
+    } else {
+        const float* distanceSq = derived_[DERIVED_DISTANCE_SQ].data();
+        for (int i = 0; i < count; i++) {
+            sortKeys_[i] = DistanceSortKey(distanceSq[i]);
+        }
+    }
+    uint16_t keyOr = 0;
+    uint16_t keyAnd = 0xFFFF;
+    for (int i = 0; i < count; i++) {
+        keyOr |= sortKeys_[i];
+        keyAnd &= sortKeys_[i];
+    }
 
-    if (activeCount > 0) {
-        // sort by distance to view pos
-        if (SortParticles) {
-            qsort(&sortIndices[0], activeCount, sizeof(sortIndices[0]), ParticleSortFn);
+    // LSD radix sort, 8 bits per pass. Bytes that are the same in every key are skipped.
+    for (int shift = 0; shift < 16; shift += 8) {
+        if ((((keyOr ^ keyAnd) >> shift) & 0xFF) == 0) {
+            continue;
+        }
+        int offsets[256] = {};
+        for (int i = 0; i < count; i++) {
+            offsets[(sortKeys_[drawOrder_[i]] >> shift) & 0xFF]++;
+        }
+        int total = 0;
+        for (int& offset : offsets) {
+            const int n = offset;
+            offset = total;
+            total += n;
         }
+        for (int i = 0; i < count; i++) {
+            const uint32_t index = drawOrder_[i];
+            sortScratch_[offsets[(sortKeys_[index] >> shift) & 0xFF]++] = index;
+        }
+        drawOrder_.swap(sortScratch_);
+    }
+}
 
-        attr_.position.resize(activeCount * 4);
-        attr_.color.resize(activeCount * 4);
-        attr_.uv0.resize(activeCount * 4);
-
-        // transform vertices for each particle quad
-        for (int i = 0; i < activeCount; ++i) {
-            particleSort_t const& si = sortIndices[i];
-            particleDerived_t const& p = derived[si.ActiveIndex];
-
-            // transform vertices on the CPU
-            Matrix4f rotMatrix = Matrix4f::RotationZ(p.Orientation);
-            // This always aligns the particle to the direction of the particle to the view
-            // position. This looks a little better but is more expensive and only really makes a
-            // difference for large particles.
-            Vector3f normal = (viewPos - p.Pos).Normalized();
-            if (normal.LengthSq() < 0.999f) {
-                normal = GetViewMatrixForward(centerEyeViewMatrix);
-            }
-            Matrix4f particleTransform =
-                Matrix4f::CreateFromBasisVectors(normal, Vector3f(0.0f, 1.0f, 0.0f));
-            particleTransform.SetTranslation(p.Pos);
-
-            for (int v = 0; v < 4; ++v) {
-                attr_.position[i * 4 + v] =
-                    particleTransform.Transform(rotMatrix.Transform(quadVertPos[v] * p.Scale));
-                attr_.color[i * 4 + v] = p.Color;
-            }
+// Writes one camera facing quad. Vertices are written in order and never read back, since
+// they may be going straight to write-combined GL memory.
+static inline void EmitQuad(
+    ovrParticleVertex* v,
+    const Vector3f& pos,
+    const Vector4f& color,
+    const float orientation,
+    const float scale,
+    const Vector2f& uvMins,
+    const Vector2f& uvMaxs,
+    const Vector3f& viewPos,
+    const Vector3f& viewForward) {
+    const Vector3f up(0.0f, 1.0f, 0.0f);
+
+    // This always aligns the particle to the direction of the particle to the view
+    // position. This looks a little better but is more expensive and only really makes a
+    // difference for large particles.
+    Vector3f normal = (viewPos - pos).Normalized();
+    if (normal.LengthSq() < 0.999f) {
+        normal = viewForward;
+    }
+    // the basis of Matrix4f::CreateFromBasisVectors( normal, up ), which is the identity
+    // when the normal is parallel to up
+    Vector3f xBasis = up.Cross(normal);
+    Vector3f yBasis;
+    if (xBasis.LengthSq() > 1e-8f) {
+        xBasis.Normalize();
+        yBasis = normal.Cross(xBasis);
+    } else {
+        xBasis = Vector3f(1.0f, 0.0f, 0.0f);
+        yBasis = Vector3f(0.0f, 1.0f, 0.0f);
+    }
 
+    // the quad corners are ( +/-0.5, +/-0.5 ) rolled by the orientation and scaled, so
+    // each one is the position plus or minus two shared edge vectors
+    const float halfScale = 0.5f * scale;
+    const float c = cosf(orientation) * halfScale;
+    const float s = sinf(orientation) * halfScale;
+    const Vector3f right = xBasis * c + yBasis * s;
+    const Vector3f top = yBasis * c - xBasis * s;
+
+    v[0].Position = pos - right + top;
+    v[0].Color = color;
+    v[0].Uv = Vector2f(uvMins.x, uvMins.y);
+    v[1].Position = pos + right + top;
+    v[1].Color = color;
+    v[1].Uv = Vector2f(uvMaxs.x, uvMins.y);
+    v[2].Position = pos + right - top;
+    v[2].Color = color;
+    v[2].Uv = Vector2f(uvMaxs.x, uvMaxs.y);
+    v[3].Position = pos - right - top;
+    v[3].Color = color;
+    v[3].Uv = Vector2f(uvMins.x, uvMaxs.y);
+}
+
+void ovrParticleSystem::EmitVertices(
+    ovrParticleVertex* vertices,
+    const int first,
+    const int count,
+    const ovrTextureAtlas* atlas,
+    const Vector3f& viewPos,
+    const Vector3f& viewForward) const {
+    Vector2f uvMins(-1.0f, -1.0f);
+    Vector2f uvMaxs(1.0f, 1.0f);
+    ovrParticleVertex* v = vertices;
+
+    if (storage_ == STORAGE_AOS) {
+        for (int k = first; k < first + count; k++) {
+            const ovrParticleDerived& d = derivedAos_[drawOrder_[k]];
             if (atlas != nullptr) {
                 // set UVs of this sprite in the atlas
-                const ovrTextureAtlas::ovrSpriteDef& sd = atlas->GetSpriteDef(p.SpriteIndex);
-                attr_.uv0[i * 4 + 0] = Vector2f(sd.uvMins.x, sd.uvMins.y);
-                attr_.uv0[i * 4 + 1] = Vector2f(sd.uvMaxs.x, sd.uvMins.y);
-                attr_.uv0[i * 4 + 2] = Vector2f(sd.uvMaxs.x, sd.uvMaxs.y);
-                attr_.uv0[i * 4 + 3] = Vector2f(sd.uvMins.x, sd.uvMaxs.y);
-            } else {
-                attr_.uv0[i * 4 + 0] = Vector2f(-1, -1);
-                attr_.uv0[i * 4 + 1] = Vector2f(1, -1);
-                attr_.uv0[i * 4 + 2] = Vector2f(1, 1);
-                attr_.uv0[i * 4 + 3] = Vector2f(-1, 1);
+                const ovrTextureAtlas::ovrSpriteDef& sd = atlas->GetSpriteDef(d.SpriteIndex);
+                uvMins = sd.uvMins;
+                uvMaxs = sd.uvMaxs;
             }
+            EmitQuad(
+                v, d.Pos, d.Color, d.Orientation, d.Scale, uvMins, uvMaxs, viewPos, viewForward);
+            v += 4;
         }
+        return;
     }
 
-    // update the geometry with new vertex attributes
-    SurfaceDef.geo.Update(attr_);
+    const float* posX = derived_[DERIVED_POSITION_X].data();
+    const float* posY = derived_[DERIVED_POSITION_Y].data();
+    const float* posZ = derived_[DERIVED_POSITION_Z].data();
+    const float* colorR = derived_[DERIVED_COLOR_R].data();
+    const float* colorG = derived_[DERIVED_COLOR_G].data();
+    const float* colorB = derived_[DERIVED_COLOR_B].data();
+    const float* colorA = derived_[DERIVED_COLOR_A].data();
+    const float* orientation = derived_[DERIVED_ORIENTATION].data();
+    const float* scale = streams_[STREAM_SCALE].data();
+    for (int k = first; k < first + count; k++) {
+        const uint32_t i = drawOrder_[k];
+        if (atlas != nullptr) {
+            // set UVs of this sprite in the atlas
+            const ovrTextureAtlas::ovrSpriteDef& sd = atlas->GetSpriteDef(spriteIndex_[i]);
+            uvMins = sd.uvMins;
+            uvMaxs = sd.uvMaxs;
+        }
+        EmitQuad(
+            v,
+            Vector3f(posX[i], posY[i], posZ[i]),
+            Vector4f(colorR[i], colorG[i], colorB[i], colorA[i]),
+            orientation[i],
+            scale[i],
+            uvMins,
+            uvMaxs,
+            viewPos,
+            viewForward);
+        v += 4;
+    }
+}
+
+void ovrParticleSystem::Frame(
+    const OVRFW::ovrApplFrameIn& frame,
+    const ovrTextureAtlas* atlas,
+    const Matrix4f& centerEyeViewMatrix) {
+    // OVR_PERF_TIMER( ovrParticleSystem_Frame );
+
+    if (numActive_ == 0) {
+        NumDrawnSurfaces = 0;
+        return;
+    }
+
+    // update particles
+    Matrix4f invViewMatrix = centerEyeViewMatrix.Inverted();
+    Vector3f viewPos = invViewMatrix.GetTranslation();
+    const Vector3f viewForward = GetViewMatrixForward(centerEyeViewMatrix);
+
+    const double simulateStart = GetTimeInSeconds();
+    if (storage_ == STORAGE_AOS) {
+        SimulateAos(frame.PredictedDisplayTime, viewPos);
+    } else {
+        Simulate(frame.PredictedDisplayTime, viewPos);
+    }
+    const double sortStart = GetTimeInSeconds();
+    Sort();
+    const double emitStart = GetTimeInSeconds();
+
+    // The surfaces may still be drawn for an earlier frame, so without the GL context the
+    // quads are emitted here and the render thread copies them in.
+    const int numActive = numActive_;
+    NumDrawnSurfaces = (numActive + MAX_PARTICLES_PER_SURFACE - 1) / MAX_PARTICLES_PER_SURFACE;
+    if (GetFrameGlTasks() != nullptr) {
+        std::vector<ovrParticleVertex> emitted(static_cast<size_t>(numActive) * 4);
+        EmitVertices(emitted.data(), 0, numActive, atlas, viewPos, viewForward);
+        RunFrameGlTask([this, numActive, emitted = std::move(emitted)]() {
+            UploadSurfaces(numActive, [&emitted](void* vertices, const int first, const int count) {
+                memcpy(vertices, &emitted[first * 4], count * 4 * sizeof(ovrParticleVertex));
+            });
+        });
+    } else {
+        UploadSurfaces(numActive, [&](void* vertices, const int first, const int count) {
+            EmitVertices(
+                static_cast<ovrParticleVertex*>(vertices),
+                first,
+                count,
+                atlas,
+                viewPos,
+                viewForward);
+        });
+    }
+
+    const double emitEnd = GetTimeInSeconds();
+    FrameStats.NumParticles = numActive_;
+    FrameStats.SimulateMs = static_cast<float>((sortStart - simulateStart) * 1000.0);
+    FrameStats.SortMs = static_cast<float>((emitStart - sortStart) * 1000.0);
+    FrameStats.EmitMs = static_cast<float>((emitEnd - emitStart) * 1000.0);
+}
+
+void ovrParticleSystem::UploadSurfaces(
+    const int numActive,
+    const std::function<void(void* vertices, const int first, const int count)>& emit) {
+    // Write each surface's quads straight into the frame stream buffer when they fit in what
+    // is left of it, and otherwise into the surface's own vertex buffer, orphaning the
+    // previous contents.
+    const size_t vertexSize = sizeof(ovrParticleVertex);
+    GlStreamBuffer* stream = GetFrameStreamBuffer();
+
+    for (int c = 0; c < static_cast<int>(Surfaces.size()); c++) {
+        GlGeometry& geo = Surfaces[c].geo;
+        const int first = c * MAX_PARTICLES_PER_SURFACE;
+        const int count = std::min(std::max(numActive - first, 0), MAX_PARTICLES_PER_SURFACE);
+        geo.vertexCount = count * 4;
+        geo.indexCount = count * 6;
+        if (count == 0) {
+            continue;
+        }
+
+        const size_t size = count * 4 * vertexSize;
+        uint32_t buffer = 0;
+        size_t offset = 0;
+        void* vertices = nullptr;
+        if (stream != nullptr) {
+            vertices = stream->Map(size, sizeof(float) * 4, offset);
+        }
+        const bool streamed = vertices != nullptr;
+        if (streamed) {
+            buffer = stream->GetBuffer();
+        } else {
+            buffer = geo.vertexBuffer;
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(
+                GL_ARRAY_BUFFER,
+                MAX_PARTICLES_PER_SURFACE * 4 * vertexSize,
+                nullptr,
+                GL_DYNAMIC_DRAW);
+            vertices = glMapBufferRange(
+                GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (vertices == nullptr) {
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                geo.vertexCount = 0;
+                geo.indexCount = 0;
+                continue;
+            }
+        }
+
+        emit(vertices, first, count);
+
+        if (streamed) {
+            stream->Unmap();
+        } else {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+
+        glBindVertexArray(geo.vertexArrayObject);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_POSITION,
+            3,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            (void*)(offset + offsetof(ovrParticleVertex, Position)));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_COLOR,
+            4,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            (void*)(offset + offsetof(ovrParticleVertex, Color)));
+        glVertexAttribPointer(
+            VERTEX_ATTRIBUTE_LOCATION_UV0,
+            2,
+            GL_FLOAT,
+            false,
+            vertexSize,
+            (void*)(offset + offsetof(ovrParticleVertex, Uv)));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 }
 
 void ovrParticleSystem::Shutdown() {
-    SurfaceDef.geo.Free();
-    OVRFW::GlProgram::Free(Program);
+    for (ovrSurfaceDef& surfaceDef : Surfaces) {
+        surfaceDef.geo.Free();
+    }
+    Surfaces.clear();
+    if (Program.Program != 0) {
+        OVRFW::GlProgram::Free(Program);
+    }
+    NumDrawnSurfaces = 0;
 }
 
 void ovrParticleSystem::RenderEyeView(
@@ -299,15 +765,17 @@ void ovrParticleSystem::RenderEyeView(
     // OVR_UNUSED( projectionMatrix );
 
     // Don't even add a surface if not needed
-    if (activeParticles_.empty()) {
+    if (numActive_ == 0) {
         return;
     }
 
-    // add a surface
-    ovrDrawSurface surf;
-    surf.modelMatrix = ModelMatrix;
-    surf.surface = &SurfaceDef;
-    surfaceList.push_back(surf);
+    // add a surface per block of particles, in draw order
+    for (int c = 0; c < NumDrawnSurfaces && c < static_cast<int>(Surfaces.size()); c++) {
+        ovrDrawSurface surf;
+        surf.modelMatrix = ModelMatrix;
+        surf.surface = &Surfaces[c];
+        surfaceList.push_back(surf);
+    }
 }
 
 ovrParticleSystem::handle_t ovrParticleSystem::AddParticle(
@@ -322,37 +790,32 @@ ovrParticleSystem::handle_t ovrParticleSystem::AddParticle(
     const float scale,
     const float lifeTime,
     const uint16_t spriteIndex) {
-    ovrParticle* p;
-
-    handle_t particleHandle;
-    if (!freeParticles_.empty()) {
-        particleHandle = handle_t(freeParticles_[freeParticles_.size() - 1]);
-        freeParticles_.pop_back();
-        activeParticles_.push_back(particleHandle);
-        assert(particleHandle.IsValid());
-        assert((size_t)particleHandle.Get() < particles_.size());
-        p = &particles_[particleHandle.Get()];
-    } else {
-        if (particles_.size() >= maxParticles_) {
-            return handle_t(); // adding more would overflow the VAO
-        }
-        particleHandle = handle_t(particles_.size());
-        particles_.emplace_back();
-        activeParticles_.push_back(particleHandle);
-        p = &particles_[particles_.size() - 1];
-    }
-
-    p->StartTime = frame.PredictedDisplayTime;
-    p->LifeTime = lifeTime;
-    p->InitialPosition = initialPosition;
-    p->InitialOrientation = initialOrientation;
-    p->InitialVelocity = initialVelocity;
-    p->HalfAcceleration = acceleration * 0.5f;
-    p->InitialColor = initialColor;
-    p->EaseFunc = easeFunc;
-    p->RotationRate = rotationRate;
-    p->InitialScale = scale;
-    p->SpriteIndex = spriteIndex;
+    if (freeParticles_.empty()) {
+        return handle_t(); // adding more would overflow the VAO
+    }
+
+    const handle_t particleHandle = freeParticles_.back();
+    freeParticles_.pop_back();
+    assert(particleHandle.IsValid());
+    assert((size_t)particleHandle.Get() < handleSlots_.size());
+
+    const int slot = numActive_++;
+    slotHandles_[slot] = particleHandle;
+    handleSlots_[particleHandle.Get()] = slot;
+
+    SetParticle(
+        slot,
+        frame,
+        initialPosition,
+        initialOrientation,
+        initialVelocity,
+        acceleration,
+        initialColor,
+        easeFunc,
+        rotationRate,
+        scale,
+        lifeTime,
+        spriteIndex);
 
     return particleHandle;
 }
@@ -370,52 +833,150 @@ void ovrParticleSystem::UpdateParticle(
     const float scale,
     const float lifeTime,
     const uint16_t spriteIndex) {
-    if (!handle.IsValid() || (size_t)handle.Get() >= particles_.size()) {
-        assert(handle.IsValid() && (size_t)handle.Get() < particles_.size());
+    if (!handle.IsValid() || (size_t)handle.Get() >= handleSlots_.size()) {
+        assert(handle.IsValid() && (size_t)handle.Get() < handleSlots_.size());
         return;
     }
-    ovrParticle& p = particles_[handle.Get()];
-    p.InitialPosition = position;
-    p.InitialOrientation = orientation;
-    p.InitialVelocity = velocity;
-    p.HalfAcceleration = acceleration * 0.5f;
-    p.InitialColor = color;
-    p.EaseFunc = easeFunc;
-    p.RotationRate = rotationRate;
-    p.InitialScale = scale;
-    p.SpriteIndex = spriteIndex;
-    p.StartTime = frame.PredictedDisplayTime;
-    p.LifeTime = lifeTime;
+    const int slot = handleSlots_[handle.Get()];
+    if (slot < 0) {
+        return; // already expired
+    }
+    SetParticle(
+        slot,
+        frame,
+        position,
+        orientation,
+        velocity,
+        acceleration,
+        color,
+        easeFunc,
+        rotationRate,
+        scale,
+        lifeTime,
+        spriteIndex);
 }
 
 void ovrParticleSystem::RemoveParticle(const handle_t handle) {
-    if (!handle.IsValid() || (size_t)handle.Get() >= particles_.size()) {
+    if (!handle.IsValid() || (size_t)handle.Get() >= handleSlots_.size()) {
+        return;
+    }
+    const int slot = handleSlots_[handle.Get()];
+    if (slot < 0) {
         return;
     }
     // particle will get removed in the next update
-    particles_[handle.Get()].StartTime = -1.0; // mark as unused
-    particles_[handle.Get()].LifeTime = 0.0;
+    if (storage_ == STORAGE_AOS) {
+        particles_[slot].StartTime = -1.0; // mark as unused
+        particles_[slot].LifeTime = 0.0f;
+    } else {
+        startTime_[slot] = -1.0;
+        lifeTime_[slot] = 0.0f;
+    }
+}
+
+void ovrParticleSystem::SetParticle(
+    const int slot,
+    const OVRFW::ovrApplFrameIn& frame,
+    const Vector3f& position,
+    const float orientation,
+    const Vector3f& velocity,
+    const Vector3f& acceleration,
+    const Vector4f& color,
+    const ovrEaseFunc easeFunc,
+    const float rotationRate,
+    const float scale,
+    const float lifeTime,
+    const uint16_t spriteIndex) {
+    if (storage_ == STORAGE_AOS) {
+        ovrParticle& p = particles_[slot];
+        p.StartTime = frame.PredictedDisplayTime;
+        p.LifeTime = lifeTime;
+        p.InitialPosition = position;
+        p.InitialOrientation = orientation;
+        p.InitialVelocity = velocity;
+        p.HalfAcceleration = acceleration * 0.5f;
+        p.InitialColor = color;
+        p.EaseFunc = easeFunc;
+        p.RotationRate = rotationRate;
+        p.InitialScale = scale;
+        p.SpriteIndex = spriteIndex;
+        return;
+    }
+
+    startTime_[slot] = frame.PredictedDisplayTime;
+    lifeTime_[slot] = lifeTime;
+    spriteIndex_[slot] = spriteIndex;
+
+    streams_[STREAM_POSITION_X][slot] = position.x;
+    streams_[STREAM_POSITION_Y][slot] = position.y;
+    streams_[STREAM_POSITION_Z][slot] = position.z;
+    streams_[STREAM_VELOCITY_X][slot] = velocity.x;
+    streams_[STREAM_VELOCITY_Y][slot] = velocity.y;
+    streams_[STREAM_VELOCITY_Z][slot] = velocity.z;
+    streams_[STREAM_HALF_ACCELERATION_X][slot] = acceleration.x * 0.5f;
+    streams_[STREAM_HALF_ACCELERATION_Y][slot] = acceleration.y * 0.5f;
+    streams_[STREAM_HALF_ACCELERATION_Z][slot] = acceleration.z * 0.5f;
+    streams_[STREAM_COLOR_R][slot] = color.x;
+    streams_[STREAM_COLOR_G][slot] = color.y;
+    streams_[STREAM_COLOR_B][slot] = color.z;
+    streams_[STREAM_COLOR_A][slot] = color.w;
+    streams_[STREAM_ORIENTATION][slot] = orientation;
+    streams_[STREAM_ROTATION_RATE][slot] = rotationRate;
+    streams_[STREAM_SCALE][slot] = scale;
+    streams_[STREAM_INV_LIFE_TIME][slot] = lifeTime > 0.0f ? 1.0f / lifeTime : 0.0f;
+
+    const Vector4f ease = GetEaseFactors(easeFunc);
+    streams_[STREAM_EASE_SQUARE][slot] = ease.x;
+    streams_[STREAM_EASE_CUBE][slot] = ease.y;
+    streams_[STREAM_EASE_COLOR][slot] = ease.z;
+    streams_[STREAM_EASE_ALPHA][slot] = ease.w;
+}
+
+void ovrParticleSystem::RemoveSlot(const int slot) {
+    const handle_t handle = slotHandles_[slot];
+    handleSlots_[handle.Get()] = -1;
+    freeParticles_.push_back(handle);
+
+    // Swap the last particle into this slot, order doesn't matter
+    const int last = --numActive_;
+    if (slot != last) {
+        if (storage_ == STORAGE_AOS) {
+            particles_[slot] = particles_[last];
+        } else {
+            for (std::vector<float>& stream : streams_) {
+                stream[slot] = stream[last];
+            }
+            startTime_[slot] = startTime_[last];
+            lifeTime_[slot] = lifeTime_[last];
+            spriteIndex_[slot] = spriteIndex_[last];
+        }
+        slotHandles_[slot] = slotHandles_[last];
+        handleSlots_[slotHandles_[slot].Get()] = slot;
+    }
 }
 
 void ovrParticleSystem::CreateGeometry(const int maxParticles) {
-    SurfaceDef.geo.Free();
+    for (ovrSurfaceDef& surfaceDef : Surfaces) {
+        surfaceDef.geo.Free();
+    }
+    Surfaces.clear();
 
+    // Every surface has room for a full block, so the quads can go to any of them. The
+    // vertex buffers are only used when the frame stream buffer is unavailable or full.
     VertexAttribs attr;
-    const int numVerts = maxParticles * 4;
+    const int numVerts = MAX_PARTICLES_PER_SURFACE * 4;
 
     attr.position.resize(numVerts);
-    attr.normal.resize(numVerts);
     attr.color.resize(numVerts);
     attr.uv0.resize(numVerts);
 
     std::vector<TriangleIndex> indices;
-    const int numIndices = maxParticles * 6;
+    const int numIndices = MAX_PARTICLES_PER_SURFACE * 6;
     indices.resize(numIndices);
 
-    for (int i = 0; i < maxParticles; ++i) {
+    for (int i = 0; i < MAX_PARTICLES_PER_SURFACE; ++i) {
         for (int v = 0; v < 4; v++) {
             attr.position[i * 4 + v] = quadVertPos[v];
-            attr.normal[i * 4 + v] = {0.0f, 0.0f, 1.0f};
             attr.color[i * 4 + v] = {1.0f, 0.0f, 1.0f, 1.0f};
             attr.uv0[i * 4 + v] = quadUVs[v];
         }
@@ -428,7 +989,85 @@ void ovrParticleSystem::CreateGeometry(const int maxParticles) {
         indices[i * 6 + 5] = static_cast<uint16_t>(i * 4 + 2);
     }
 
-    SurfaceDef.geo.Create(attr, indices);
+    const int numSurfaces = (maxParticles + MAX_PARTICLES_PER_SURFACE - 1) /
+        MAX_PARTICLES_PER_SURFACE;
+    Surfaces.resize(numSurfaces);
+    for (ovrSurfaceDef& surfaceDef : Surfaces) {
+        surfaceDef.geo.Create(attr, indices);
+        surfaceDef.geo.vertexCount = 0;
+        surfaceDef.geo.indexCount = 0;
+    }
+}
+
+void ovrParticleSystem::RunBenchmark(const int numFrames) {
+    static const int particleCounts[] = {10000, 50000, 100000};
+    static const ovrParticleStorage storages[] = {STORAGE_AOS, STORAGE_SOA};
+
+    for (const int numParticles : particleCounts) {
+        for (const ovrParticleStorage storage : storages) {
+            ovrParticleSystem ps;
+            ps.AllocateStorage(numParticles, storage);
+            ps.SortParticles = true;
+
+            // a fixed pseudo-random spread so the sort has real work to do
+            uint32_t seed = 0x1234567;
+            auto random = [&seed]() {
+                seed = seed * 1664525u + 1013904223u;
+                return static_cast<float>(seed >> 8) * (1.0f / 16777216.0f);
+            };
+
+            OVRFW::ovrApplFrameIn frame;
+            for (int i = 0; i < numParticles; i++) {
+                ps.AddParticle(
+                    frame,
+                    Vector3f(random() * 10.0f - 5.0f, random() * 3.0f, random() * -10.0f),
+                    random() * MATH_FLOAT_TWOPI,
+                    Vector3f(random() - 0.5f, random(), random() - 0.5f),
+                    Vector3f(0.0f, -0.5f, 0.0f),
+                    Vector4f(random(), random(), random(), 1.0f),
+                    static_cast<ovrEaseFunc>(i % MAX),
+                    random() - 0.5f,
+                    0.02f + random() * 0.05f,
+                    1000.0f, // nothing expires during the run
+                    0);
+            }
+
+            std::vector<ovrParticleVertex> vertices(numParticles * 4);
+            const Vector3f viewPos(0.0f, 1.6f, 0.0f);
+            const Vector3f viewForward(0.0f, 0.0f, -1.0f);
+            double simulateTime = 0.0;
+            double sortTime = 0.0;
+            double emitTime = 0.0;
+            for (int f = 0; f < numFrames; f++) {
+                frame.PredictedDisplayTime = f / 72.0;
+                const double simulateStart = GetTimeInSeconds();
+                if (storage == STORAGE_AOS) {
+                    ps.SimulateAos(frame.PredictedDisplayTime, viewPos);
+                } else {
+                    ps.Simulate(frame.PredictedDisplayTime, viewPos);
+                }
+                const double sortStart = GetTimeInSeconds();
+                ps.Sort();
+                const double emitStart = GetTimeInSeconds();
+                ps.EmitVertices(vertices.data(), 0, ps.numActive_, nullptr, viewPos, viewForward);
+                const double emitEnd = GetTimeInSeconds();
+                simulateTime += sortStart - simulateStart;
+                sortTime += emitStart - sortStart;
+                emitTime += emitEnd - emitStart;
+            }
+
+            const double scale = 1000.0 / std::max(numFrames, 1);
+            ALOG(
+                "ovrParticleSystem benchmark (%s): %d particles, simulate %.3f ms, sort %.3f ms, "
+                "emit %.3f ms, total %.3f ms per frame",
+                storage == STORAGE_AOS ? "AoS" : SIMD_NAME,
+                numParticles,
+                simulateTime * scale,
+                sortTime * scale,
+                emitTime * scale,
+                (simulateTime + sortTime + emitTime) * scale);
+        }
+    }
 }
 
 } // namespace OVRFW
@@ -39,6 +39,7 @@ Authors     :   Jonathan E. Wright
 #include "EaseFunctions.h"
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
 
@@ -46,17 +47,20 @@ namespace OVRFW {
 
 class ovrTextureAtlas;
 
-struct particleDerived_t {
-    OVR::Vector3f Pos;
-    OVR::Vector4f Color;
-    float Orientation; // roll angle in radians
-    float Scale;
-    uint16_t SpriteIndex;
+// CPU cost of the last Frame(), in milliseconds.
+struct ovrParticleFrameStats {
+    ovrParticleFrameStats() : NumParticles(0), SimulateMs(0.0f), SortMs(0.0f), EmitMs(0.0f) {}
+
+    int NumParticles;
+    float SimulateMs; // expiry, integration and easing
+    float SortMs;
+    float EmitMs; // building the quads straight into the vertex buffers
 };
 
-struct particleSort_t {
-    int ActiveIndex;
-    float DistanceSq;
+struct ovrParticleVertex {
+    OVR::Vector3f Position;
+    OVR::Vector4f Color;
+    OVR::Vector2f Uv;
 };
 
 //==============================================================
@@ -67,6 +71,11 @@ class ovrParticleSystem {
 
     typedef OVR::TypesafeNumberT<int32_t, ovrParticleIndex, INVALID_PARTICLE_INDEX> handle_t;
 
+    // How the particle state is laid out. STORAGE_SOA keeps one array per component and
+    // updates four particles at a time. STORAGE_AOS keeps a struct per particle and updates
+    // them one by one, with the ease functions called through EaseFunctions.
+    enum ovrParticleStorage { STORAGE_SOA, STORAGE_AOS };
+
     ovrParticleSystem();
     virtual ~ovrParticleSystem();
 
@@ -75,8 +84,15 @@ class ovrParticleSystem {
         size_t maxParticles,
         const ovrTextureAtlas* atlas,
         const ovrGpuState& gpuState,
-        bool const sortParticles);
+        bool const sortParticles,
+        const ovrParticleStorage storage = STORAGE_SOA);
 
+    // Vertices go to the frame stream buffer when a surface's worth of them fits in what is
+    // left of it, and otherwise into that surface's own vertex buffer, orphaning its previous
+    // contents. At 144 bytes per particle, the default 1 MB frame region holds about 7000,
+    // so larger systems mostly take the second path. Call this every frame the particles
+    // are rendered. While a pipelined frame is built, the quads are emitted into system
+    // memory and copied there by the render thread instead.
     void Frame(
         const OVRFW::ovrApplFrameIn& frame,
         const ovrTextureAtlas* textureAtlas,
@@ -120,13 +136,50 @@ class ovrParticleSystem {
 
     static ovrGpuState GetDefaultGpuState();
 
+    const ovrParticleFrameStats& GetFrameStats() const {
+        return FrameStats;
+    }
+
+    // Logs the CPU cost of a sorted Frame() at 10k, 50k and 100k particles, for both storage
+    // layouts. The vertices go to system memory instead of GL buffers, so this doesn't need
+    // a GL context.
+    static void RunBenchmark(const int numFrames = 100);
+
    private:
-    void CreateGeometry(const int maxParticles);
+    // 16-bit indices limit each draw to this many particles, so larger systems are split
+    // into several surfaces drawn back to back.
+    static const int MAX_PARTICLES_PER_SURFACE = GlGeometry::MAX_GEOMETRY_VERTICES / 4;
 
-    int GetMaxParticles() const {
-        return SurfaceDef.geo.vertexCount / 4;
-    }
+    // Per-particle float state, one array per component. Active particles are packed into the
+    // first numActive_ slots so the integration runs over whole SIMD blocks, and removing a
+    // particle moves the last one into its slot.
+    enum ovrParticleStream {
+        STREAM_POSITION_X,
+        STREAM_POSITION_Y,
+        STREAM_POSITION_Z,
+        STREAM_VELOCITY_X,
+        STREAM_VELOCITY_Y,
+        STREAM_VELOCITY_Z,
+        STREAM_HALF_ACCELERATION_X,
+        STREAM_HALF_ACCELERATION_Y,
+        STREAM_HALF_ACCELERATION_Z,
+        STREAM_COLOR_R,
+        STREAM_COLOR_G,
+        STREAM_COLOR_B,
+        STREAM_COLOR_A,
+        STREAM_ORIENTATION,
+        STREAM_ROTATION_RATE,
+        STREAM_SCALE,
+        STREAM_INV_LIFE_TIME,
+        // the ease function as 0 / 1 factors, so every particle runs the same instructions
+        STREAM_EASE_SQUARE,
+        STREAM_EASE_CUBE,
+        STREAM_EASE_COLOR,
+        STREAM_EASE_ALPHA,
+        STREAM_MAX
+    };
 
+    // STORAGE_AOS state of one particle.
     class ovrParticle {
        public:
         // empty constructor so we don't pay the price for double initialization
@@ -145,18 +198,92 @@ class ovrParticleSystem {
         ovrEaseFunc EaseFunc; // parametric function used to compute alpha
     };
 
+    // STORAGE_AOS state derived every frame, indexed by slot.
+    struct ovrParticleDerived {
+        OVR::Vector3f Pos;
+        OVR::Vector4f Color;
+        float Orientation; // roll angle in radians
+        float Scale;
+        float DistanceSq;
+        uint16_t SpriteIndex;
+    };
+
+    // STORAGE_SOA state derived from the streams every frame, indexed by slot.
+    enum ovrDerivedStream {
+        DERIVED_AGE,
+        DERIVED_POSITION_X,
+        DERIVED_POSITION_Y,
+        DERIVED_POSITION_Z,
+        DERIVED_COLOR_R,
+        DERIVED_COLOR_G,
+        DERIVED_COLOR_B,
+        DERIVED_COLOR_A,
+        DERIVED_ORIENTATION,
+        DERIVED_DISTANCE_SQ,
+        DERIVED_MAX
+    };
+
+    void AllocateStorage(const size_t maxParticles, const ovrParticleStorage storage);
+    void CreateGeometry(const int maxParticles);
+    void SetParticle(
+        const int slot,
+        const OVRFW::ovrApplFrameIn& frame,
+        const OVR::Vector3f& position,
+        const float orientation,
+        const OVR::Vector3f& velocity,
+        const OVR::Vector3f& acceleration,
+        const OVR::Vector4f& color,
+        const ovrEaseFunc easeFunc,
+        const float rotationRate,
+        const float scale,
+        const float lifeTime,
+        const uint16_t spriteIndex);
+    void RemoveSlot(const int slot);
+    // Points the surfaces at the quads of numActive particles, which emit writes to mapped
+    // vertex memory for the draw positions [first, first + count). Needs the GL context.
+    void UploadSurfaces(
+        const int numActive,
+        const std::function<void(void* vertices, const int first, const int count)>& emit);
+
+    // Frees expired particles and writes the derived state of the rest.
+    void Simulate(const double displayTime, const OVR::Vector3f& viewPos);
+    void SimulateAos(const double displayTime, const OVR::Vector3f& viewPos);
+    // Fills drawOrder_ back to front, or in slot order when sorting is off.
+    void Sort();
+    // Writes the quads of the particles at draw positions [first, first + count).
+    void EmitVertices(
+        ovrParticleVertex* vertices,
+        const int first,
+        const int count,
+        const ovrTextureAtlas* atlas,
+        const OVR::Vector3f& viewPos,
+        const OVR::Vector3f& viewForward) const;
+
     size_t maxParticles_; // maximum allowd particles
-    std::vector<ovrParticle> particles_; // all active particles
+    int numActive_;
+    ovrParticleStorage storage_;
+    // STORAGE_AOS
+    std::vector<ovrParticle> particles_;
+    std::vector<ovrParticleDerived> derivedAos_;
+    // STORAGE_SOA
+    std::vector<float> streams_[STREAM_MAX];
+    std::vector<float> derived_[DERIVED_MAX];
+    std::vector<double> startTime_; // per slot, time the particle was created
+    std::vector<float> lifeTime_;
+    std::vector<uint16_t> spriteIndex_;
+    // both
+    std::vector<handle_t> slotHandles_; // handle of the particle in each slot
+    std::vector<int32_t> handleSlots_; // slot of each handle, -1 when the handle is free
     std::vector<handle_t> freeParticles_; // indices of free particles
-    std::vector<handle_t> activeParticles_; // indices of active particles
-    std::vector<particleDerived_t> derived_;
-    std::vector<particleSort_t> sortIndices_;
-    std::vector<uint8_t> packedAttr_;
-    OVRFW::VertexAttribs attr_;
+    std::vector<uint16_t> sortKeys_;
+    std::vector<uint32_t> drawOrder_;
+    std::vector<uint32_t> sortScratch_;
     GlProgram Program;
-    ovrSurfaceDef SurfaceDef;
+    std::vector<ovrSurfaceDef> Surfaces;
+    int NumDrawnSurfaces; // as of the last Frame(), the surfaces only get theirs with the upload
     OVR::Matrix4f ModelMatrix;
     bool SortParticles;
+    ovrParticleFrameStats FrameStats;
 };
 
 } // namespace OVRFW
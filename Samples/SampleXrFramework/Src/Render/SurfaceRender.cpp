@@ -35,8 +35,11 @@ Authors     :   John Carmack
 #include "GlTexture.h"
 #include "GlProgram.h"
 #include "GlBuffer.h"
+#include "GlStreamBuffer.h"
+#include "TextureManager.h"
 
 #include <algorithm>
+#include <cstring>
 
 using OVR::Bounds3f;
 using OVR::Matrix4f;
@@ -136,7 +139,108 @@ ChangeGpuState(const ovrGpuState oldState, const ovrGpuState newState, bool forc
     // extend as needed
 }
 
-ovrSurfaceRender::ovrSurfaceRender() : CurrentSceneMatricesIdx(0) {}
+// Sort key layout, most significant first:
+//   63..62  pass: opaque surfaces first, blended surfaces after them
+//   61..46  program
+//   45..38  depth / cull render state
+//   37..26  first sampled texture
+//   25..16  geometry, so repeated meshes end up next to each other for instance batching
+//   15..0   view depth, front to back
+// Blended surfaces keep their list order, so their key is the pass and the list index.
+static const int SORT_PASS_SHIFT = 62;
+static const int SORT_PROGRAM_SHIFT = 46;
+static const int SORT_STATE_SHIFT = 38;
+static const int SORT_TEXTURE_SHIFT = 26;
+static const int SORT_GEOMETRY_SHIFT = 16;
+static const int SORT_DEPTH_SHIFT = 0;
+
+static uint64_t GpuStateSortBits(const ovrGpuState& state) {
+    // GL_NEVER .. GL_ALWAYS only differ in the low 3 bits
+    return (state.depthEnable ? 1 : 0) | (state.depthMaskEnable ? 2 : 0) |
+        (state.cullEnable ? 4 : 0) | (state.polygonOffsetEnable ? 8 : 0) |
+        (state.frontFace == GL_CW ? 16 : 0) | ((state.depthFunc & 7) << 5);
+}
+
+static uint64_t SurfaceSortKey(
+    const ovrDrawSurface& drawSurface,
+    const Matrix4f& viewMatrix,
+    const uint32_t listIndex) {
+    const ovrGraphicsCommand& cmd = drawSurface.surface->graphicsCommand;
+    if (cmd.GpuState.blendEnable != ovrGpuState::BLEND_DISABLE) {
+        return (1ull << SORT_PASS_SHIFT) | listIndex;
+    }
+
+    uint64_t texture = 0;
+    for (int i = 0; i < ovrUniform::MAX_UNIFORMS; ++i) {
+        const ovrProgramParmType type = cmd.Program.Uniforms[i].Type;
+        if (type == ovrProgramParmType::MAX) {
+            break;
+        }
+        if (type == ovrProgramParmType::TEXTURE_SAMPLED && cmd.UniformData[i].Data != NULL) {
+            texture = static_cast<const GlTexture*>(cmd.UniformData[i].Data)->texture;
+            break;
+        }
+    }
+
+    // Distance along the view direction; the top bits of a positive float sort like the float.
+    const Matrix4f& m = drawSurface.modelMatrix;
+    const float viewZ = viewMatrix.M[2][0] * m.M[0][3] + viewMatrix.M[2][1] * m.M[1][3] +
+        viewMatrix.M[2][2] * m.M[2][3] + viewMatrix.M[2][3];
+    const float distance = std::max(-viewZ, 0.0f);
+    uint32_t distanceBits;
+    memcpy(&distanceBits, &distance, sizeof(distanceBits));
+
+    return ((uint64_t)(cmd.Program.Program & 0xFFFF) << SORT_PROGRAM_SHIFT) |
+        ((GpuStateSortBits(cmd.GpuState) & 0xFF) << SORT_STATE_SHIFT) |
+        ((texture & 0xFFF) << SORT_TEXTURE_SHIFT) |
+        ((uint64_t)(drawSurface.surface->geo.vertexArrayObject & 0x3FF) << SORT_GEOMETRY_SHIFT) |
+        ((uint64_t)(distanceBits >> 16) << SORT_DEPTH_SHIFT);
+}
+
+// True when b can be drawn as another instance of a.
+static bool CanBatchSurfaces(const ovrSurfaceDef& a, const ovrSurfaceDef& b) {
+    if (&a == &b) {
+        return true;
+    }
+    const ovrGraphicsCommand& ca = a.graphicsCommand;
+    const ovrGraphicsCommand& cb = b.graphicsCommand;
+    if (b.numInstances > 1 || a.geo.vertexArrayObject != b.geo.vertexArrayObject ||
+        a.geo.indexCount != b.geo.indexCount || a.geo.primitiveType != b.geo.primitiveType ||
+        ca.Program.Program != cb.Program.Program) {
+        return false;
+    }
+    const ovrGpuState& sa = ca.GpuState;
+    const ovrGpuState& sb = cb.GpuState;
+    if (sa.blendEnable != sb.blendEnable || sa.blendSrc != sb.blendSrc ||
+        sa.blendDst != sb.blendDst || sa.blendSrcAlpha != sb.blendSrcAlpha ||
+        sa.blendDstAlpha != sb.blendDstAlpha || sa.blendMode != sb.blendMode ||
+        sa.blendModeAlpha != sb.blendModeAlpha || sa.depthFunc != sb.depthFunc ||
+        sa.frontFace != sb.frontFace || sa.depthEnable != sb.depthEnable ||
+        sa.depthMaskEnable != sb.depthMaskEnable ||
+        sa.polygonOffsetEnable != sb.polygonOffsetEnable || sa.cullEnable != sb.cullEnable ||
+        sa.lineWidth != sb.lineWidth || sa.polygonMode != sb.polygonMode ||
+        sa.depthRange[0] != sb.depthRange[0] || sa.depthRange[1] != sb.depthRange[1]) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (sa.colorMaskEnable[i] != sb.colorMaskEnable[i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < ovrUniform::MAX_UNIFORMS; ++i) {
+        if (ca.Program.Uniforms[i].Type == ovrProgramParmType::MAX) {
+            break;
+        }
+        if (ca.UniformData[i].Data != cb.UniformData[i].Data ||
+            ca.UniformData[i].Count != cb.UniformData[i].Count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ovrSurfaceRender::ovrSurfaceRender()
+    : CurrentSceneMatricesIdx(0), CurrentInstanceMatricesIdx(0), SortSurfaces(false) {}
 
 ovrSurfaceRender::~ovrSurfaceRender() {}
 
@@ -146,12 +250,21 @@ void ovrSurfaceRender::Init() {
     }
 
     CurrentSceneMatricesIdx = 0;
+
+    for (int i = 0; i < MAX_INSTANCE_UBOS; i++) {
+        InstanceMatrices[i].Create(
+            GLBUFFER_TYPE_UNIFORM, GlProgram::INSTANCE_MATRICES_UBO_SIZE, NULL);
+    }
+    CurrentInstanceMatricesIdx = 0;
 }
 
 void ovrSurfaceRender::Shutdown() {
     for (int i = 0; i < MAX_SCENEMATRICES_UBOS; i++) {
         SceneMatrices[i].Destroy();
     }
+    for (int i = 0; i < MAX_INSTANCE_UBOS; i++) {
+        InstanceMatrices[i].Destroy();
+    }
 }
 
 int ovrSurfaceRender::UpdateSceneMatrices(
@@ -213,6 +326,46 @@ int ovrSurfaceRender::UpdateSceneMatrices(
     return CurrentSceneMatricesIdx;
 }
 
+void ovrSurfaceRender::SortSurfaceList(
+    const std::vector<ovrDrawSurface>& surfaceList,
+    const Matrix4f& viewMatrix) {
+    const uint32_t numSurfaces = static_cast<uint32_t>(surfaceList.size());
+    SortItems.resize(numSurfaces);
+    SortScratch.resize(numSurfaces);
+
+    uint64_t keyOr = 0;
+    uint64_t keyAnd = ~0ull;
+    for (uint32_t i = 0; i < numSurfaces; ++i) {
+        SortItems[i].Key = SurfaceSortKey(surfaceList[i], viewMatrix, i);
+        SortItems[i].Index = i;
+        keyOr |= SortItems[i].Key;
+        keyAnd &= SortItems[i].Key;
+    }
+
+    // LSD radix sort, 8 bits per pass. Stable, so equal keys stay in list order. Bytes that
+    // are the same in every key are skipped, which is most of them for a typical scene.
+    const uint64_t varyingBits = keyOr ^ keyAnd;
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varyingBits >> shift) & 0xFF) == 0) {
+            continue;
+        }
+        uint32_t offsets[256] = {};
+        for (const ovrSortItem& item : SortItems) {
+            offsets[(item.Key >> shift) & 0xFF]++;
+        }
+        uint32_t total = 0;
+        for (int b = 0; b < 256; ++b) {
+            const uint32_t count = offsets[b];
+            offsets[b] = total;
+            total += count;
+        }
+        for (const ovrSortItem& item : SortItems) {
+            SortScratch[offsets[(item.Key >> shift) & 0xFF]++] = item;
+        }
+        SortItems.swap(SortScratch);
+    }
+}
+
 // Renders a list of pointers to models in order.
 ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
     const std::vector<ovrDrawSurface>& surfaceList,
@@ -226,48 +379,207 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
     ChangeGpuState(currentGpuState, currentGpuState, true /* force */);
 
     // TODO: These should be range checked containers.
-    GLuint currentBuffers[ovrUniform::MAX_UNIFORMS] = {};
+    // The SceneMatrices and InstanceMatrices ubos take bindings on top of the per-program
+    // uniform buffers.
+    GLuint currentBuffers[ovrUniform::MAX_UNIFORMS + 2] = {};
+    size_t currentBufferOffsets[ovrUniform::MAX_UNIFORMS + 2] = {};
+    // bindings that hold a whole InstanceMatrices block
+    bool currentInstanceBuffers[ovrUniform::MAX_UNIFORMS + 2] = {};
     GLuint currentTextures[ovrUniform::MAX_UNIFORMS] = {};
     GLuint currentProgramObject = 0;
 
-    const int sceneMatricesIdx =
-        UpdateSceneMatrices(&viewMatrix, &projectionMatrix, GlProgram::MAX_VIEWS /* num eyes */);
+    // Uniform values are program state, so these only hold for currentProgramObject.
+    // Surface data doesn't change while the list is drawn, so an unchanged pointer means
+    // an unchanged value.
+    const void* currentUniformData[ovrUniform::MAX_UNIFORMS] = {};
+    int currentUniformCount[ovrUniform::MAX_UNIFORMS] = {};
+    Matrix4f currentModelMatrix;
+    bool modelMatrixBound = false;
+    int currentInstanceBatch = -1;
 
     // counters
     ovrDrawCounters counters;
 
+    // Binds a ubo range unless the binding already holds it. A size of 0 binds the whole buffer.
+    auto bindUniformBuffer =
+        [&](const int binding, const GLuint buffer, const size_t offset, const size_t size) {
+            if (currentBuffers[binding] == buffer && currentBufferOffsets[binding] == offset) {
+                counters.numSkippedBufferBinds++;
+                return;
+            }
+            counters.numBufferBinds++;
+            currentBuffers[binding] = buffer;
+            currentBufferOffsets[binding] = offset;
+            currentInstanceBuffers[binding] = false;
+            if (size > 0) {
+                GL(glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size));
+            } else {
+                GL(glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer));
+            }
+        };
+
+    // Per-frame matrices come from the frame stream buffer when there is one, otherwise from
+    // the ubo rings.
+    GlStreamBuffer* stream = GetFrameStreamBuffer();
+
+    // feeds the least recently used eviction
+    ovrTextureManager* residency = GetResidencyTextureManager();
+
+    GLuint sceneMatricesBuffer = 0;
+    size_t sceneMatricesOffset = 0;
+    size_t sceneMatricesSize = 0;
+    void* streamedSceneMatrices = stream != nullptr
+        ? stream->Map(
+              GlProgram::SCENE_MATRICES_UBO_SIZE,
+              stream->GetUniformAlignment(),
+              sceneMatricesOffset)
+        : NULL;
+    if (streamedSceneMatrices != NULL) {
+        // same layout as UpdateSceneMatrices: all the view matrices, then the projections
+        Matrix4f* matrices = static_cast<Matrix4f*>(streamedSceneMatrices);
+        for (int i = 0; i < GlProgram::MAX_VIEWS; i++) {
+            matrices[i] = (&viewMatrix)[i].Transposed();
+            matrices[GlProgram::MAX_VIEWS + i] = (&projectionMatrix)[i].Transposed();
+        }
+        stream->Unmap();
+        sceneMatricesBuffer = stream->GetBuffer();
+        sceneMatricesSize = GlProgram::SCENE_MATRICES_UBO_SIZE;
+    } else {
+        const int sceneMatricesIdx = UpdateSceneMatrices(
+            &viewMatrix, &projectionMatrix, GlProgram::MAX_VIEWS /* num eyes */);
+        sceneMatricesBuffer = SceneMatrices[sceneMatricesIdx].GetBuffer();
+    }
+
+    const int numSurfaces = static_cast<int>(surfaceList.size());
+    if (SortSurfaces) {
+        SortSurfaceList(surfaceList, viewMatrix);
+        counters.numSortedSurfaces = numSurfaces;
+    }
+
+    auto surfaceAt = [&](const int index) -> const ovrDrawSurface& {
+        return surfaceList[SortSurfaces ? SortItems[index].Index : index];
+    };
+
     // Loop through all the surfaces
-    for (const ovrDrawSurface& drawSurface : surfaceList) {
+    for (int surfaceIndex = 0; surfaceIndex < numSurfaces;) {
+        const ovrDrawSurface& drawSurface = surfaceAt(surfaceIndex);
         const ovrSurfaceDef& surfaceDef = *drawSurface.surface;
         const ovrGraphicsCommand& cmd = surfaceDef.graphicsCommand;
 
+        // Gather the following surfaces that only differ by model matrix.
+        int batchCount = 1;
+        if (cmd.Program.IsValid() && cmd.Program.InstanceMatrices.Location >= 0 &&
+            surfaceDef.numInstances <= 1) {
+            while (surfaceIndex + batchCount < numSurfaces &&
+                   batchCount < GlProgram::MAX_BATCH_INSTANCES &&
+                   CanBatchSurfaces(surfaceDef, *surfaceAt(surfaceIndex + batchCount).surface)) {
+                batchCount++;
+            }
+        }
+
         if (cmd.Program.IsValid()) {
             ChangeGpuState(currentGpuState, cmd.GpuState);
             currentGpuState = cmd.GpuState;
             GLCheckErrorsWithTitle(surfaceDef.surfaceName.c_str());
 
             // update the program object
+            bool programChanged = false;
             if (cmd.Program.Program != currentProgramObject) {
                 counters.numProgramBinds++;
 
                 currentProgramObject = cmd.Program.Program;
                 GL(glUseProgram(cmd.Program.Program));
+
+                programChanged = true;
+                modelMatrixBound = false;
+                currentInstanceBatch = -1;
+                for (int i = 0; i < ovrUniform::MAX_UNIFORMS; ++i) {
+                    currentUniformData[i] = NULL;
+                }
             }
 
             // Update globally defined system level uniforms.
             {
-                if (cmd.Program.ViewID.Location >= 0) // not defined when multiview enabled
-                {
+                // not defined when multiview enabled
+                if (programChanged && cmd.Program.ViewID.Location >= 0) {
                     GL(glUniform1i(cmd.Program.ViewID.Location, eye));
                 }
-                GL(glUniformMatrix4fv(
-                    cmd.Program.ModelMatrix.Location, 1, GL_TRUE, drawSurface.modelMatrix.M[0]));
+                const int instanceBatch = batchCount > 1 ? 1 : 0;
+                if (cmd.Program.InstanceBatch.Location >= 0 &&
+                    currentInstanceBatch != instanceBatch) {
+                    currentInstanceBatch = instanceBatch;
+                    GL(glUniform1i(cmd.Program.InstanceBatch.Location, instanceBatch));
+                }
+                if (batchCount == 1 && cmd.Program.InstanceMatrices.Location >= 0 &&
+                    !currentInstanceBuffers[cmd.Program.InstanceMatrices.Binding]) {
+                    // The block is declared whether or not the draw reads it, and an active
+                    // block has to be backed by a buffer at least its size. Any will do when
+                    // InstanceBatch is 0.
+                    const int binding = cmd.Program.InstanceMatrices.Binding;
+                    bindUniformBuffer(binding, InstanceMatrices[0].GetBuffer(), 0, 0);
+                    currentInstanceBuffers[binding] = true;
+                }
+                if (batchCount > 1) {
+                    // Transpose like the scene matrices, std140 matrices are column major.
+                    // The bound range has to cover the whole block, even if it's partly used.
+                    const int binding = cmd.Program.InstanceMatrices.Binding;
+                    size_t instanceOffset = 0;
+                    void* streamed = stream != nullptr
+                        ? stream->Map(
+                              GlProgram::INSTANCE_MATRICES_UBO_SIZE,
+                              stream->GetUniformAlignment(),
+                              instanceOffset)
+                        : NULL;
+                    if (streamed != NULL) {
+                        Matrix4f* instanceMatrices = static_cast<Matrix4f*>(streamed);
+                        for (int b = 0; b < batchCount; ++b) {
+                            instanceMatrices[b] =
+                                surfaceAt(surfaceIndex + b).modelMatrix.Transposed();
+                        }
+                        stream->Unmap();
+                        bindUniformBuffer(
+                            binding,
+                            stream->GetBuffer(),
+                            instanceOffset,
+                            GlProgram::INSTANCE_MATRICES_UBO_SIZE);
+                        currentInstanceBuffers[binding] = true;
+                    } else {
+                        Matrix4f instanceMatrices[GlProgram::MAX_BATCH_INSTANCES];
+                        for (int b = 0; b < batchCount; ++b) {
+                            instanceMatrices[b] =
+                                surfaceAt(surfaceIndex + b).modelMatrix.Transposed();
+                        }
+                        CurrentInstanceMatricesIdx =
+                            (CurrentInstanceMatricesIdx + 1) % MAX_INSTANCE_UBOS;
+                        const GlBuffer& instanceBuffer =
+                            InstanceMatrices[CurrentInstanceMatricesIdx];
+                        instanceBuffer.Update(batchCount * sizeof(Matrix4f), instanceMatrices);
+                        bindUniformBuffer(binding, instanceBuffer.GetBuffer(), 0, 0);
+                        currentInstanceBuffers[binding] = true;
+                    }
+
+                    counters.numInstanceBatches++;
+                    counters.numBatchedSurfaces += batchCount;
+                } else if (
+                    !modelMatrixBound || !(currentModelMatrix == drawSurface.modelMatrix)) {
+                    counters.numParameterUpdates++;
+                    currentModelMatrix = drawSurface.modelMatrix;
+                    modelMatrixBound = true;
+                    GL(glUniformMatrix4fv(
+                        cmd.Program.ModelMatrix.Location,
+                        1,
+                        GL_TRUE,
+                        drawSurface.modelMatrix.M[0]));
+                } else {
+                    counters.numSkippedParameterUpdates++;
+                }
 
                 if (cmd.Program.SceneMatrices.Location >= 0) {
-                    GL(glBindBufferBase(
-                        GL_UNIFORM_BUFFER,
+                    bindUniformBuffer(
                         cmd.Program.SceneMatrices.Binding,
-                        SceneMatrices[sceneMatricesIdx].GetBuffer()));
+                        sceneMatricesBuffer,
+                        sceneMatricesOffset,
+                        sceneMatricesSize);
                 }
             }
 
@@ -275,10 +587,25 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
             bool uniformsDone = false;
             {
                 for (int i = 0; i < ovrUniform::MAX_UNIFORMS && !uniformsDone; ++i) {
-                    counters.numParameterUpdates++;
                     const int parmLocation = cmd.Program.Uniforms[i].Location;
+                    const ovrProgramParmType parmType = cmd.Program.Uniforms[i].Type;
+
+                    // Skip values already set on this program. Textures and buffers are
+                    // bindings rather than program state and are tracked below.
+                    if (parmType != ovrProgramParmType::TEXTURE_SAMPLED &&
+                        parmType != ovrProgramParmType::BUFFER_UNIFORM &&
+                        parmType != ovrProgramParmType::MAX && cmd.UniformData[i].Data != NULL) {
+                        if (currentUniformData[i] == cmd.UniformData[i].Data &&
+                            currentUniformCount[i] == cmd.UniformData[i].Count) {
+                            counters.numSkippedParameterUpdates++;
+                            continue;
+                        }
+                        counters.numParameterUpdates++;
+                        currentUniformData[i] = cmd.UniformData[i].Data;
+                        currentUniformCount[i] = cmd.UniformData[i].Count;
+                    }
 
-                    switch (cmd.Program.Uniforms[i].Type) {
+                    switch (parmType) {
                         case ovrProgramParmType::INT: {
                             if (parmLocation >= 0 && cmd.UniformData[i].Data != NULL) {
                                 GL(glUniform1iv(
@@ -382,6 +709,11 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
                                     GL(glBindTexture(
                                         texture.target ? texture.target : GL_TEXTURE_2D,
                                         texture.texture));
+                                    if (residency != nullptr) {
+                                        residency->NoteTextureUsed(texture.texture);
+                                    }
+                                } else {
+                                    counters.numSkippedTextureBinds++;
                                 }
                             }
                         } break;
@@ -390,12 +722,7 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
                             if (parmBinding >= 0 && cmd.UniformData[i].Data != NULL) {
                                 const GlBuffer& buffer =
                                     *static_cast<GlBuffer*>(cmd.UniformData[i].Data);
-                                if (currentBuffers[parmBinding] != buffer.GetBuffer()) {
-                                    counters.numBufferBinds++;
-                                    currentBuffers[parmBinding] = buffer.GetBuffer();
-                                    GL(glBindBufferBase(
-                                        GL_UNIFORM_BUFFER, parmBinding, buffer.GetBuffer()));
-                                }
+                                bindUniformBuffer(parmBinding, buffer.GetBuffer(), 0, 0);
                             }
                         } break;
                         case ovrProgramParmType::MAX:
@@ -427,13 +754,14 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
         {
             GL(glBindVertexArray(surfaceDef.geo.vertexArrayObject));
 
-            if (surfaceDef.numInstances > 1) {
+            const int numInstances = batchCount > 1 ? batchCount : surfaceDef.numInstances;
+            if (numInstances > 1) {
                 GL(glDrawElementsInstanced(
                     surfaceDef.geo.primitiveType,
                     surfaceDef.geo.indexCount,
                     surfaceDef.geo.IndexType,
                     NULL,
-                    surfaceDef.numInstances));
+                    numInstances));
             } else {
                 GL(glDrawElements(
                     surfaceDef.geo.primitiveType,
@@ -444,6 +772,8 @@ ovrDrawCounters ovrSurfaceRender::RenderSurfaceList(
         }
 
         GLCheckErrorsWithTitle(surfaceDef.surfaceName.c_str());
+
+        surfaceIndex += batchCount;
     }
 
     // set the gpu state back to the default
@@ -68,7 +68,13 @@ struct ovrDrawCounters {
           numProgramBinds(0),
           numParameterUpdates(0),
           numTextureBinds(0),
-          numBufferBinds(0) {}
+          numBufferBinds(0),
+          numSkippedParameterUpdates(0),
+          numSkippedTextureBinds(0),
+          numSkippedBufferBinds(0),
+          numSortedSurfaces(0),
+          numInstanceBatches(0),
+          numBatchedSurfaces(0) {}
 
     int numElements;
     int numDrawCalls;
@@ -76,6 +82,16 @@ struct ovrDrawCounters {
     int numParameterUpdates; // MVP, etc
     int numTextureBinds;
     int numBufferBinds;
+
+    // Updates left out because the value was already bound.
+    int numSkippedParameterUpdates;
+    int numSkippedTextureBinds;
+    int numSkippedBufferBinds;
+    int numSortedSurfaces; // 0 unless sorted submission is enabled
+
+    // Runs of surfaces merged into one instanced draw, and the surfaces they held.
+    int numInstanceBatches;
+    int numBatchedSurfaces;
 };
 
 struct ovrDrawSurface {
@@ -104,15 +120,37 @@ class ovrSurfaceRender {
     void Init();
     void Shutdown();
 
-    // Draws a list of surfaces in order.
-    // Any sorting or culling should be performed before calling.
+    // Draws a list of surfaces in order, or in state order when sorted submission is enabled.
+    // Any culling should be performed before calling.
+    // Consecutive surfaces that share geometry, program, state and uniform data are drawn
+    // as one instanced draw when their program was built with instance batching.
     ovrDrawCounters RenderSurfaceList(
         const std::vector<ovrDrawSurface>& surfaceList,
         const OVR::Matrix4f& viewMatrix,
         const OVR::Matrix4f& projectionMatrix,
         const int eye);
 
+    // When enabled, RenderSurfaceList draws opaque surfaces grouped by program, render state
+    // and texture, front to back within a group, followed by the blended surfaces in list
+    // order.
+    void SetSortSurfaces(const bool sortSurfaces) {
+        SortSurfaces = sortSurfaces;
+    }
+    bool GetSortSurfaces() const {
+        return SortSurfaces;
+    }
+
    private:
+    struct ovrSortItem {
+        uint64_t Key;
+        uint32_t Index;
+    };
+
+    // Fills SortItems with the draw order of surfaceList.
+    void SortSurfaceList(
+        const std::vector<ovrDrawSurface>& surfaceList,
+        const OVR::Matrix4f& viewMatrix);
+
     // Returns the index of the updated SceneMatrices UBO.
     int UpdateSceneMatrices(
         const OVR::Matrix4f* viewMatrix,
@@ -130,6 +168,16 @@ class ovrSurfaceRender {
 
     OVR::Matrix4f CachedViewMatrix[GlProgram::MAX_VIEWS];
     OVR::Matrix4f CachedProjectionMatrix[GlProgram::MAX_VIEWS];
+
+    // Per-instance model matrices for batched draws, same ring scheme as SceneMatrices.
+    // Both rings are only used when there is no frame stream buffer.
+    static const int MAX_INSTANCE_UBOS = 32;
+    int CurrentInstanceMatricesIdx;
+    GlBuffer InstanceMatrices[MAX_INSTANCE_UBOS];
+
+    bool SortSurfaces;
+    std::vector<ovrSortItem> SortItems;
+    std::vector<ovrSortItem> SortScratch;
 };
 
 // Set this true for log spew from BuildDrawSurfaceList and RenderSurfaceList.
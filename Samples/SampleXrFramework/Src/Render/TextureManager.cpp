@@ -26,14 +26,30 @@ Authors     :   Jonathan E. Wright
 *************************************************************************************/
 
 #include "TextureManager.h"
+#include "DynamicTextureAtlas.h"
 
 #include "Misc/Log.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
 #include "OVR_FileSys.h"
+#include "OVR_Std.h"
 #include "PackageFiles.h"
+#include "Egl.h"
+#include "GlStreamBuffer.h"
+
+#if defined(ANDROID)
+#include <sys/prctl.h> // for prctl( PR_SET_NAME )
+#endif // defined(ANDROID)
 
 namespace OVRFW {
 
@@ -44,7 +60,8 @@ namespace OVRFW {
 //==============================
 // ovrManagedTexture::Free
 void ovrManagedTexture::Free() {
-    FreeTexture(Texture);
+    // an earlier frame may still be drawn with it
+    RunFrameGlTask([texture = Texture]() { FreeTexture(texture); });
     Source = TEXTURE_SOURCE_MAX;
     Uri = "";
     IconId = -1;
@@ -90,8 +107,39 @@ class ovrTextureManagerImpl : public ovrTextureManager {
         ovrTextureFilter const filterType = FILTER_DEFAULT,
         ovrTextureWrap const wrapType = WRAP_DEFAULT) OVR_OVERRIDE;
 
+    virtual textureHandle_t LoadTextureAsync(
+        ovrFileSys& fileSys,
+        char const* uri,
+        ovrTextureFilter const filterType = FILTER_DEFAULT,
+        ovrTextureWrap const wrapType = WRAP_DEFAULT) OVR_OVERRIDE;
+    virtual textureHandle_t LoadTextureAsync(
+        char const* uri,
+        void const* buffer,
+        size_t const bufferSize,
+        ovrTextureFilter const filterType = FILTER_DEFAULT,
+        ovrTextureWrap const wrapType = WRAP_DEFAULT) OVR_OVERRIDE;
+
+    virtual void Update() OVR_OVERRIDE;
+    virtual void SetUploadBudget(size_t const bytesPerFrame) OVR_OVERRIDE;
+
+    virtual bool IsTextureLoaded(textureHandle_t const handle) const OVR_OVERRIDE;
+    virtual int GetNumPendingLoads() const OVR_OVERRIDE;
+
+    virtual void SetMemoryBudget(size_t const bytes) OVR_OVERRIDE;
+    virtual size_t GetResidentMemory() const OVR_OVERRIDE;
+    virtual size_t GetTextureMemory(textureHandle_t const handle) const OVR_OVERRIDE;
+
+    virtual void SetTexturePinned(textureHandle_t const handle, bool const pinned) OVR_OVERRIDE;
+    virtual bool IsTextureResident(textureHandle_t const handle) const OVR_OVERRIDE;
+
+    virtual void NoteTextureUsed(unsigned const texture) OVR_OVERRIDE;
+
     virtual void FreeTexture(textureHandle_t const handle) OVR_OVERRIDE;
 
+    virtual ovrDynamicTextureAtlas& GetAtlas() OVR_OVERRIDE {
+        return Atlas;
+    }
+
     virtual ovrManagedTexture GetTexture(textureHandle_t const handle) const OVR_OVERRIDE;
     virtual GlTexture GetGlTexture(textureHandle_t const handle) const OVR_OVERRIDE;
 
@@ -101,10 +149,100 @@ class ovrTextureManagerImpl : public ovrTextureManager {
     virtual void PrintStats() const OVR_OVERRIDE;
 
    private:
+    static const int NUM_DECODE_THREADS = 2;
+    static const size_t DEFAULT_UPLOAD_BUDGET = 4 * 1024 * 1024;
+    // Textures used in the last few frames may still be read by the GPU, and evicting them
+    // would only bring them straight back. Use is stamped when Update() takes it from the
+    // renderer, so the age counts from the first Update() after the draw.
+    static const int64_t MIN_EVICTION_AGE = 3;
+
+    // An asynchronous load, owned by the decode queues until decoded and by the main thread
+    // after that.
+    struct ovrTextureLoad {
+        ovrTextureLoad()
+            : Index(-1),
+              Filter(FILTER_DEFAULT),
+              Wrap(WRAP_DEFAULT),
+              Failed(false),
+              NextLevel(-1),
+              Cancelled(false) {}
+
+        int Index;
+        std::string Uri;
+        TextureFlags_t Flags;
+        ovrTextureFilter Filter;
+        ovrTextureWrap Wrap;
+        std::vector<uint8_t> Buffer; // file contents, released once decoded
+        ovrDecodedTexture Decoded;
+        bool Failed;
+        int NextLevel; // next level to upload, counting down to 0
+        std::atomic<bool> Cancelled;
+    };
+
+    // A level Update() took from a load, at its offset in the frame's upload buffer. Keeps the
+    // decoded data alive until the upload ran.
+    struct ovrLevelUpload {
+        std::shared_ptr<ovrTextureLoad> Load;
+        unsigned int Texture;
+        int Level;
+        size_t BufferOffset;
+    };
+
+    // Residency of the texture at the same index in Textures.
+    struct ovrTextureResidency {
+        ovrTextureResidency()
+            : FileSys(nullptr),
+              Filter(FILTER_DEFAULT),
+              Wrap(WRAP_DEFAULT),
+              Size(0),
+              LastUsedFrame(0),
+              Pinned(false),
+              Evicted(false),
+              ReloadQueued(false) {}
+
+        ovrFileSys* FileSys; // to read the uri again after an eviction, NULL if not evictable
+        ovrTextureFilter Filter;
+        ovrTextureWrap Wrap;
+        size_t Size; // bytes of texture memory
+        int64_t LastUsedFrame;
+        bool Pinned;
+        bool Evicted;
+        bool ReloadQueued;
+    };
+
     std::vector<ovrManagedTexture> Textures;
+    std::vector<ovrTextureResidency> Residency;
     std::vector<int> FreeTextures;
     bool Initialized;
     std::unordered_map<std::string, int> UriHash;
+    std::unordered_map<unsigned, int> TextureIndices; // GL texture name to index
+
+    size_t MemoryBudget;
+    size_t ResidentMemory;
+    int64_t FrameIndex;
+    std::vector<int> ReloadQueue;
+    std::vector<int> EvictionCandidates;
+
+    // GL names NoteTextureUsed() saw since the last Update(). The renderer may report from
+    // another thread, so everything else about residency is only touched by Update().
+    std::mutex UsageMutex;
+    std::vector<unsigned> UsedTextures;
+    std::vector<unsigned> UsedTexturesScratch;
+
+    ovrDynamicTextureAtlas Atlas;
+
+    // texture index to the load that will replace its placeholder
+    std::unordered_map<int, std::shared_ptr<ovrTextureLoad>> PendingLoads;
+    std::deque<std::shared_ptr<ovrTextureLoad>> UploadQueue;
+    size_t UploadBudget;
+    unsigned int UploadBuffer;
+
+    std::vector<std::thread> DecodeThreads;
+    std::mutex DecodeMutex;
+    std::condition_variable DecodeCondition;
+    std::deque<std::shared_ptr<ovrTextureLoad>> DecodeQueue;
+    std::deque<std::shared_ptr<ovrTextureLoad>> DecodedLoads;
+    bool DecodeExit;
 
     mutable int NumUriLoads;
     mutable int NumActualUriLoads;
@@ -114,6 +252,11 @@ class ovrTextureManagerImpl : public ovrTextureManager {
     mutable int NumStringCompares;
     mutable int NumSearches;
     mutable int NumCompares;
+    int NumAsyncLoads;
+    int NumUploadedLevels;
+    size_t NumUploadedBytes;
+    int NumEvictions;
+    int NumReloads;
 
    private:
     ovrTextureManagerImpl();
@@ -124,6 +267,37 @@ class ovrTextureManagerImpl : public ovrTextureManager {
     int IndexForHandle(textureHandle_t const handle) const;
     textureHandle_t AllocTexture();
 
+    textureHandle_t QueueLoad(
+        ovrFileSys* fileSys,
+        char const* uri,
+        std::vector<uint8_t>& buffer,
+        ovrTextureFilter const filterType,
+        ovrTextureWrap const wrapType);
+    void QueueDecode(
+        const int idx,
+        char const* uri,
+        std::vector<uint8_t>& buffer,
+        ovrTextureFilter const filterType,
+        ovrTextureWrap const wrapType);
+    void UploadLevels(const size_t bufferSize, const std::vector<ovrLevelUpload>& uploads);
+    void UploadLevel(const ovrLevelUpload& upload);
+    void FinishLoad(ovrTextureLoad& load);
+    void StartDecodeThreads();
+    void StopDecodeThreads();
+    void DecodeThreadFunction(const int threadIndex);
+
+    void SetResidency(
+        const int idx,
+        const size_t size,
+        ovrFileSys* fileSys,
+        ovrTextureFilter const filterType,
+        ovrTextureWrap const wrapType);
+    void SetResidentSize(const int idx, const size_t size);
+    void ApplyTextureUsage();
+    void ReloadTextures();
+    void EvictTextures();
+    void EvictTexture(const int idx);
+
     static void SetTextureWrapping(GlTexture& tex, ovrTextureWrap const wrapType);
     static void SetTextureFiltering(GlTexture& tex, ovrTextureFilter const filterType);
 };
@@ -132,6 +306,12 @@ class ovrTextureManagerImpl : public ovrTextureManager {
 // ovrTextureManagerImpl::
 ovrTextureManagerImpl::ovrTextureManagerImpl()
     : Initialized(false),
+      MemoryBudget(0),
+      ResidentMemory(0),
+      FrameIndex(0),
+      UploadBudget(DEFAULT_UPLOAD_BUDGET),
+      UploadBuffer(0),
+      DecodeExit(false),
       NumUriLoads(0),
       NumActualUriLoads(0),
       NumBufferLoads(0),
@@ -139,7 +319,12 @@ ovrTextureManagerImpl::ovrTextureManagerImpl()
       NumStringSearches(0),
       NumStringCompares(0),
       NumSearches(0),
-      NumCompares(0) {}
+      NumCompares(0),
+      NumAsyncLoads(0),
+      NumUploadedLevels(0),
+      NumUploadedBytes(0),
+      NumEvictions(0),
+      NumReloads(0) {}
 
 //==============================
 // ovrTextureManagerImpl::
@@ -151,12 +336,24 @@ ovrTextureManagerImpl::~ovrTextureManagerImpl() {
 // ovrTextureManagerImpl::
 void ovrTextureManagerImpl::Init() {
     UriHash.reserve(512);
+    Atlas.Init(*this);
     Initialized = true;
 }
 
 //==============================
 // ovrTextureManagerImpl::
 void ovrTextureManagerImpl::Shutdown() {
+    Atlas.Shutdown();
+    StopDecodeThreads();
+    DecodeQueue.clear();
+    DecodedLoads.clear();
+    UploadQueue.clear();
+    PendingLoads.clear();
+    if (UploadBuffer != 0) {
+        glDeleteBuffers(1, &UploadBuffer);
+        UploadBuffer = 0;
+    }
+
     for (auto& texture : Textures) {
         if (texture.IsValid()) {
             texture.Free();
@@ -164,8 +361,20 @@ void ovrTextureManagerImpl::Shutdown() {
     }
 
     Textures.resize(0);
+    Residency.resize(0);
     FreeTextures.resize(0);
     UriHash.clear();
+    TextureIndices.clear();
+    ReloadQueue.clear();
+    ResidentMemory = 0;
+
+    if (GetResidencyTextureManager() == this) {
+        SetResidencyTextureManager(nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(UsageMutex);
+        UsedTextures.clear();
+    }
 
     Initialized = false;
 }
@@ -222,6 +431,31 @@ void ovrTextureManagerImpl::SetTextureFiltering(GlTexture& tex, ovrTextureFilter
     }
 }
 
+//==============================
+// EstimateTextureMemory
+// Synchronous loads don't report the format they picked, so this goes by the file type: the
+// stb_image formats load as RGBA8 with a full mip chain, and the compressed containers are
+// counted at 8 bits per texel, with a full mip chain except for .astc files.
+static size_t EstimateTextureMemory(char const* uri, GlTexture const& tex) {
+    const char* ext = strrchr(uri, '.');
+    const bool isAstc = ext != nullptr && OVR::OVR_stricmp(ext, ".astc") == 0;
+    const bool isContainer = ext != nullptr &&
+        (OVR::OVR_stricmp(ext, ".ktx") == 0 || OVR::OVR_stricmp(ext, ".ktx2") == 0 ||
+         OVR::OVR_stricmp(ext, ".pvr") == 0);
+
+    int numLevels = 1;
+    if (!isAstc) {
+        for (int w = tex.Width, h = tex.Height; w > 1 || h > 1; w >>= 1, h >>= 1) {
+            numLevels++;
+        }
+    }
+    return GetTextureMemorySize(
+        isAstc || isContainer ? Texture_ETC2_RGBA : Texture_RGBA,
+        tex.Width,
+        tex.Height,
+        numLevels);
+}
+
 //==============================
 // ovrTextureManagerImpl::LoadTexture
 textureHandle_t ovrTextureManagerImpl::LoadTexture(
@@ -238,13 +472,19 @@ textureHandle_t ovrTextureManagerImpl::LoadTexture(
         return Textures[idx].GetHandle();
     }
 
+    // read here rather than through LoadTextureFromUri to see whether the decoder can reload it
+    std::vector<uint8_t> buffer;
+    GlTexture tex;
     int w;
     int h;
-    GlTexture tex = LoadTextureFromUri(fileSys, uri, TextureFlags_t(TEXTUREFLAG_NO_DEFAULT), w, h);
+    if (fileSys.ReadFile(uri, buffer)) {
+        tex = LoadTextureFromBuffer(uri, buffer, TextureFlags_t(TEXTUREFLAG_NO_DEFAULT), w, h);
+    }
     if (!tex.IsValid()) {
         ALOG("LoadTextureFromUri( '%s' ) failed!", uri);
         return textureHandle_t();
     }
+    const bool reloadable = CanDecodeTextureFromBuffer(uri, buffer.data(), buffer.size());
 
     textureHandle_t handle = AllocTexture();
     if (handle.IsValid()) {
@@ -254,6 +494,13 @@ textureHandle_t ovrTextureManagerImpl::LoadTexture(
         idx = IndexForHandle(handle);
         Textures[idx] = ovrManagedTexture(handle, uri, tex);
         UriHash[std::string(uri)] = idx;
+        // only the decoder's formats can be reloaded into the same texture name
+        SetResidency(
+            idx,
+            EstimateTextureMemory(uri, tex),
+            reloadable ? &fileSys : nullptr,
+            filterType,
+            wrapType);
 
         NumActualUriLoads++;
     }
@@ -310,6 +557,7 @@ textureHandle_t ovrTextureManagerImpl::LoadTexture(
             /// OVR_PERF_TIMER( LoadTexture_FromBuffer_Hash );
             UriHash[std::string(uri)] = idx;
         }
+        SetResidency(idx, EstimateTextureMemory(uri, tex), nullptr, filterType, wrapType);
 
         NumActualBufferLoads++;
     }
@@ -364,6 +612,12 @@ textureHandle_t ovrTextureManagerImpl::LoadRGBATexture(
             /// OVR_PERF_TIMER( LoadRGBATexture_uri_Hash );
             UriHash[std::string(uri)] = idx;
         }
+        SetResidency(
+            idx,
+            GetTextureMemorySize(Texture_RGBA, imageWidth, imageHeight, 1),
+            nullptr,
+            filterType,
+            wrapType);
         NumActualBufferLoads++;
     }
     return handle;
@@ -409,12 +663,587 @@ textureHandle_t ovrTextureManagerImpl::LoadRGBATexture(
 
         idx = IndexForHandle(handle);
         Textures[idx] = ovrManagedTexture(handle, iconId, tex);
+        SetResidency(
+            idx,
+            GetTextureMemorySize(Texture_RGBA, imageWidth, imageHeight, 1),
+            nullptr,
+            filterType,
+            wrapType);
 
         NumActualBufferLoads++;
     }
     return handle;
 }
 
+//==============================
+// ovrTextureManagerImpl::LoadTextureAsync
+textureHandle_t ovrTextureManagerImpl::LoadTextureAsync(
+    ovrFileSys& fileSys,
+    char const* uri,
+    ovrTextureFilter const filterType,
+    ovrTextureWrap const wrapType) {
+    if (!CanDecodeTextureFromBuffer(uri)) {
+        return LoadTexture(fileSys, uri, filterType, wrapType);
+    }
+
+    NumUriLoads++;
+
+    int idx = FindTextureIndex(uri);
+    if (idx >= 0) {
+        return Textures[idx].GetHandle();
+    }
+
+    std::vector<uint8_t> buffer;
+    if (!fileSys.ReadFile(uri, buffer)) {
+        ALOG("LoadTextureAsync( '%s' ) failed to read the file!", uri);
+        return textureHandle_t();
+    }
+    // .ktx2 files the decoder rejects would keep the placeholder forever
+    if (!CanDecodeTextureFromBuffer(uri, buffer.data(), buffer.size())) {
+        NumUriLoads--;
+        return LoadTexture(fileSys, uri, filterType, wrapType);
+    }
+    return QueueLoad(&fileSys, uri, buffer, filterType, wrapType);
+}
+
+//==============================
+// ovrTextureManagerImpl::LoadTextureAsync
+textureHandle_t ovrTextureManagerImpl::LoadTextureAsync(
+    char const* uri,
+    void const* buffer,
+    size_t const bufferSize,
+    ovrTextureFilter const filterType,
+    ovrTextureWrap const wrapType) {
+    if (!CanDecodeTextureFromBuffer(uri, static_cast<uint8_t const*>(buffer), bufferSize)) {
+        return LoadTexture(uri, buffer, bufferSize, filterType, wrapType);
+    }
+
+    NumBufferLoads++;
+
+    int idx = FindTextureIndex(uri);
+    if (idx >= 0) {
+        return Textures[idx].GetHandle();
+    }
+
+    std::vector<uint8_t> copy(
+        static_cast<uint8_t const*>(buffer), static_cast<uint8_t const*>(buffer) + bufferSize);
+    return QueueLoad(nullptr, uri, copy, filterType, wrapType);
+}
+
+//==============================
+// ovrTextureManagerImpl::QueueLoad
+textureHandle_t ovrTextureManagerImpl::QueueLoad(
+    ovrFileSys* fileSys,
+    char const* uri,
+    std::vector<uint8_t>& buffer,
+    ovrTextureFilter const filterType,
+    ovrTextureWrap const wrapType) {
+    textureHandle_t handle = AllocTexture();
+    if (!handle.IsValid()) {
+        return handle;
+    }
+
+    // The placeholder already uses the texture name the image will be uploaded to.
+    static const uint8_t placeholder[4] = {0, 0, 0, 0};
+    GlTexture tex = LoadRGBATextureFromMemory(placeholder, 1, 1, false);
+    MakeTextureLinear(tex);
+
+    const int idx = IndexForHandle(handle);
+    Textures[idx] = ovrManagedTexture(handle, uri, tex);
+    UriHash[std::string(uri)] = idx;
+    SetResidency(idx, GetTextureMemorySize(Texture_RGBA, 1, 1, 1), fileSys, filterType, wrapType);
+
+    QueueDecode(idx, uri, buffer, filterType, wrapType);
+
+    NumAsyncLoads++;
+    return handle;
+}
+
+//==============================
+// ovrTextureManagerImpl::QueueDecode
+void ovrTextureManagerImpl::QueueDecode(
+    const int idx,
+    char const* uri,
+    std::vector<uint8_t>& buffer,
+    ovrTextureFilter const filterType,
+    ovrTextureWrap const wrapType) {
+    std::shared_ptr<ovrTextureLoad> load = std::make_shared<ovrTextureLoad>();
+    load->Index = idx;
+    load->Uri = uri;
+    load->Flags = TextureFlags_t(TEXTUREFLAG_NO_DEFAULT);
+    load->Filter = filterType;
+    load->Wrap = wrapType;
+    load->Buffer.swap(buffer);
+    PendingLoads[idx] = load;
+
+    StartDecodeThreads();
+    {
+        std::lock_guard<std::mutex> lock(DecodeMutex);
+        DecodeQueue.push_back(load);
+    }
+    DecodeCondition.notify_one();
+}
+
+//==============================
+// ovrTextureManagerImpl::Update
+void ovrTextureManagerImpl::Update() {
+    FrameIndex++;
+
+    ApplyTextureUsage();
+    ReloadTextures();
+
+    {
+        std::lock_guard<std::mutex> lock(DecodeMutex);
+        while (!DecodedLoads.empty()) {
+            UploadQueue.push_back(DecodedLoads.front());
+            DecodedLoads.pop_front();
+        }
+    }
+
+    // This frame's levels are packed into a freshly orphaned pixel buffer, so the copies never
+    // wait on uploads still in flight and the texture calls return without touching the data.
+    // The GL work waits for the thread drawing the frame, the bookkeeping is done here.
+    std::vector<ovrLevelUpload> uploads;
+    size_t bufferSize = 0;
+    size_t bufferOffset = 0;
+    while (!UploadQueue.empty()) {
+        std::shared_ptr<ovrTextureLoad> load = UploadQueue.front();
+        if (load->Cancelled) {
+            UploadQueue.pop_front();
+            continue;
+        }
+        if (load->Failed) {
+            ALOG("LoadTextureAsync( '%s' ) failed!", load->Uri.c_str());
+            // don't retry a reload on every use
+            Residency[load->Index].FileSys = nullptr;
+            PendingLoads.erase(load->Index);
+            UploadQueue.pop_front();
+            continue;
+        }
+
+        const size_t levelSize = load->Decoded.Levels[load->NextLevel].Size;
+        if (bufferSize == 0) {
+            bufferSize = std::max(UploadBudget, levelSize);
+        } else if (bufferOffset + levelSize > bufferSize) {
+            break;
+        }
+
+        ovrLevelUpload upload;
+        upload.Load = load;
+        upload.Texture = Textures[load->Index].GetTexture().texture;
+        upload.Level = load->NextLevel;
+        upload.BufferOffset = bufferOffset;
+        uploads.push_back(upload);
+        bufferOffset = (bufferOffset + levelSize + 15) & ~static_cast<size_t>(15);
+        load->NextLevel--;
+        NumUploadedLevels++;
+        NumUploadedBytes += levelSize;
+
+        if (load->NextLevel < 0) {
+            FinishLoad(*load);
+            PendingLoads.erase(load->Index);
+            UploadQueue.pop_front();
+        }
+    }
+
+    if (!uploads.empty()) {
+        RunFrameGlTask([this, bufferSize, uploads = std::move(uploads)]() {
+            UploadLevels(bufferSize, uploads);
+        });
+    }
+
+    Atlas.Flush();
+
+    // take what the renderer reported while the uploads ran as well
+    ApplyTextureUsage();
+    EvictTextures();
+}
+
+//==============================
+// ovrTextureManagerImpl::UploadLevels
+// Runs where the GL context is. The upload buffer is only touched here and in Shutdown().
+void ovrTextureManagerImpl::UploadLevels(
+    const size_t bufferSize,
+    const std::vector<ovrLevelUpload>& uploads) {
+    if (UploadBuffer == 0) {
+        glGenBuffers(1, &UploadBuffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, UploadBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+
+    for (const ovrLevelUpload& upload : uploads) {
+        UploadLevel(upload);
+        if (upload.Level == 0) {
+            const ovrTextureLoad& load = *upload.Load;
+            GlTexture tex(upload.Texture, GL_TEXTURE_2D, load.Decoded.Width, load.Decoded.Height);
+
+            // same defaults as a synchronous load
+            glBindTexture(GL_TEXTURE_2D, tex.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            SetTextureWrapping(tex, load.Wrap);
+            SetTextureFiltering(tex, load.Filter);
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+//==============================
+// ovrTextureManagerImpl::UploadLevel
+void ovrTextureManagerImpl::UploadLevel(const ovrLevelUpload& upload) {
+    const ovrTextureLoad& load = *upload.Load;
+    const ovrDecodedTexture& decoded = load.Decoded;
+    const int numLevels = static_cast<int>(decoded.Levels.size());
+    const int levelIndex = upload.Level;
+    const ovrDecodedTexture::ovrLevel& level = decoded.Levels[levelIndex];
+
+    void* dst = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        upload.BufferOffset,
+        level.Size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst == nullptr) {
+        ALOGW("LoadTextureAsync( '%s' ): failed to map the upload buffer", load.Uri.c_str());
+        return;
+    }
+    memcpy(dst, decoded.Data.data() + level.Offset, level.Size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    const void* offset = reinterpret_cast<const void*>(upload.BufferOffset);
+    glBindTexture(GL_TEXTURE_2D, upload.Texture);
+    if (levelIndex == numLevels - 1) {
+        // Sampling only ever covers the levels uploaded so far. The placeholder stays in
+        // level 0 until the last upload replaces it.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+        glTexParameteri(
+            GL_TEXTURE_2D,
+            GL_TEXTURE_MIN_FILTER,
+            numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    }
+    if (decoded.IsCompressed()) {
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D,
+            levelIndex,
+            decoded.GlInternalFormat,
+            level.Width,
+            level.Height,
+            0,
+            static_cast<GLsizei>(level.Size),
+            offset);
+    } else {
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            levelIndex,
+            decoded.GlInternalFormat,
+            level.Width,
+            level.Height,
+            0,
+            decoded.GlFormat,
+            GL_UNSIGNED_BYTE,
+            offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levelIndex);
+}
+
+//==============================
+// ovrTextureManagerImpl::FinishLoad
+// The decoded data goes with the last upload, which sets the sampling as well.
+void ovrTextureManagerImpl::FinishLoad(ovrTextureLoad& load) {
+    ovrManagedTexture& managed = Textures[load.Index];
+    GlTexture tex(
+        managed.GetTexture().texture, GL_TEXTURE_2D, load.Decoded.Width, load.Decoded.Height);
+    managed = ovrManagedTexture(managed.GetHandle(), load.Uri.c_str(), tex);
+
+    size_t size = 0;
+    for (const ovrDecodedTexture::ovrLevel& level : load.Decoded.Levels) {
+        size += level.Size;
+    }
+    SetResidentSize(load.Index, size);
+    Residency[load.Index].Evicted = false;
+}
+
+//==============================
+// ovrTextureManagerImpl::SetResidency
+void ovrTextureManagerImpl::SetResidency(
+    const int idx,
+    const size_t size,
+    ovrFileSys* fileSys,
+    ovrTextureFilter const filterType,
+    ovrTextureWrap const wrapType) {
+    ovrTextureResidency& residency = Residency[idx];
+    ResidentMemory -= residency.Size;
+    residency = ovrTextureResidency();
+    residency.FileSys = fileSys;
+    residency.Filter = filterType;
+    residency.Wrap = wrapType;
+    residency.Size = size;
+    residency.LastUsedFrame = FrameIndex;
+    ResidentMemory += size;
+
+    // Eviction redefines the levels, which textures allocated with glTexStorage don't allow.
+    // Asked here, where the texture is created, as eviction may run without the GL context.
+    if (fileSys != nullptr) {
+        const GlTexture& tex = Textures[idx].GetTexture();
+        GLint immutable = GL_FALSE;
+        if (tex.target == GL_TEXTURE_2D) {
+            glBindTexture(GL_TEXTURE_2D, tex.texture);
+            glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        if (tex.target != GL_TEXTURE_2D || immutable != GL_FALSE) {
+            residency.FileSys = nullptr;
+        }
+    }
+
+    TextureIndices[Textures[idx].GetTexture().texture] = idx;
+}
+
+//==============================
+// ovrTextureManagerImpl::SetResidentSize
+void ovrTextureManagerImpl::SetResidentSize(const int idx, const size_t size) {
+    ResidentMemory = ResidentMemory - Residency[idx].Size + size;
+    Residency[idx].Size = size;
+}
+
+//==============================
+// ovrTextureManagerImpl::ApplyTextureUsage
+// Takes what the renderer reported and marks those textures used this frame.
+void ovrTextureManagerImpl::ApplyTextureUsage() {
+    UsedTexturesScratch.clear();
+    {
+        std::lock_guard<std::mutex> lock(UsageMutex);
+        UsedTexturesScratch.swap(UsedTextures);
+    }
+    for (const unsigned texture : UsedTexturesScratch) {
+        auto it = TextureIndices.find(texture);
+        if (it == TextureIndices.end()) {
+            continue;
+        }
+        ovrTextureResidency& residency = Residency[it->second];
+        residency.LastUsedFrame = FrameIndex;
+        if (residency.Evicted && !residency.ReloadQueued) {
+            residency.ReloadQueued = true;
+            ReloadQueue.push_back(it->second);
+        }
+    }
+}
+
+//==============================
+// ovrTextureManagerImpl::ReloadTextures
+void ovrTextureManagerImpl::ReloadTextures() {
+    for (const int idx : ReloadQueue) {
+        ovrTextureResidency& residency = Residency[idx];
+        residency.ReloadQueued = false;
+        if (!residency.Evicted || residency.FileSys == nullptr ||
+            PendingLoads.find(idx) != PendingLoads.end()) {
+            continue;
+        }
+
+        const std::string uri = Textures[idx].GetUri();
+        std::vector<uint8_t> buffer;
+        if (!residency.FileSys->ReadFile(uri.c_str(), buffer)) {
+            ALOG("Reloading '%s' failed to read the file!", uri.c_str());
+            residency.FileSys = nullptr;
+            continue;
+        }
+        QueueDecode(idx, uri.c_str(), buffer, residency.Filter, residency.Wrap);
+        NumReloads++;
+    }
+    ReloadQueue.clear();
+}
+
+//==============================
+// ovrTextureManagerImpl::EvictTextures
+// Only reads LastUsedFrame as ApplyTextureUsage() left it, the renderer never writes it.
+void ovrTextureManagerImpl::EvictTextures() {
+    if (MemoryBudget == 0 || ResidentMemory <= MemoryBudget) {
+        return;
+    }
+
+    EvictionCandidates.clear();
+    for (int i = 0; i < static_cast<int>(Textures.size()); i++) {
+        const ovrTextureResidency& residency = Residency[i];
+        if (residency.FileSys == nullptr || residency.Pinned || residency.Evicted ||
+            !Textures[i].IsValid() || residency.LastUsedFrame + MIN_EVICTION_AGE > FrameIndex ||
+            PendingLoads.find(i) != PendingLoads.end()) {
+            continue;
+        }
+        EvictionCandidates.push_back(i);
+    }
+
+    // least recently used first, the larger one first between textures last used together
+    std::sort(
+        EvictionCandidates.begin(), EvictionCandidates.end(), [this](const int a, const int b) {
+            if (Residency[a].LastUsedFrame != Residency[b].LastUsedFrame) {
+                return Residency[a].LastUsedFrame < Residency[b].LastUsedFrame;
+            }
+            return Residency[a].Size > Residency[b].Size;
+        });
+
+    for (const int idx : EvictionCandidates) {
+        if (ResidentMemory <= MemoryBudget) {
+            break;
+        }
+        EvictTexture(idx);
+    }
+}
+
+//==============================
+// ovrTextureManagerImpl::EvictTexture
+// Only textures SetResidency() found can be redefined get here.
+void ovrTextureManagerImpl::EvictTexture(const int idx) {
+    // Zero sized levels release their storage. The texture name and the size GlTexture copies
+    // carry stay the same.
+    RunFrameGlTask([tex = Textures[idx].GetTexture()]() {
+        glBindTexture(GL_TEXTURE_2D, tex.texture);
+        int level = 1;
+        for (int w = tex.Width >> 1, h = tex.Height >> 1; w > 0 || h > 0; w >>= 1, h >>= 1) {
+            glTexImage2D(
+                GL_TEXTURE_2D, level++, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+        static const uint8_t placeholder[4] = {0, 0, 0, 0};
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    });
+
+    SetResidentSize(idx, GetTextureMemorySize(Texture_RGBA, 1, 1, 1));
+    Residency[idx].Evicted = true;
+    NumEvictions++;
+}
+
+//==============================
+// ovrTextureManagerImpl::SetMemoryBudget
+void ovrTextureManagerImpl::SetMemoryBudget(size_t const bytes) {
+    MemoryBudget = bytes;
+}
+
+//==============================
+// ovrTextureManagerImpl::GetResidentMemory
+size_t ovrTextureManagerImpl::GetResidentMemory() const {
+    return ResidentMemory;
+}
+
+//==============================
+// ovrTextureManagerImpl::GetTextureMemory
+size_t ovrTextureManagerImpl::GetTextureMemory(textureHandle_t const handle) const {
+    const int idx = IndexForHandle(handle);
+    return idx >= 0 ? Residency[idx].Size : 0;
+}
+
+//==============================
+// ovrTextureManagerImpl::SetTexturePinned
+void ovrTextureManagerImpl::SetTexturePinned(textureHandle_t const handle, bool const pinned) {
+    const int idx = IndexForHandle(handle);
+    if (idx >= 0) {
+        Residency[idx].Pinned = pinned;
+    }
+}
+
+//==============================
+// ovrTextureManagerImpl::IsTextureResident
+bool ovrTextureManagerImpl::IsTextureResident(textureHandle_t const handle) const {
+    const int idx = IndexForHandle(handle);
+    return idx >= 0 && !Residency[idx].Evicted;
+}
+
+//==============================
+// ovrTextureManagerImpl::NoteTextureUsed
+void ovrTextureManagerImpl::NoteTextureUsed(unsigned const texture) {
+    // looked up, and any reload queued, on the next Update() rather than in the middle of
+    // drawing
+    std::lock_guard<std::mutex> lock(UsageMutex);
+    UsedTextures.push_back(texture);
+}
+
+//==============================
+// ovrTextureManagerImpl::SetUploadBudget
+void ovrTextureManagerImpl::SetUploadBudget(size_t const bytesPerFrame) {
+    UploadBudget = bytesPerFrame;
+}
+
+//==============================
+// ovrTextureManagerImpl::IsTextureLoaded
+bool ovrTextureManagerImpl::IsTextureLoaded(textureHandle_t const handle) const {
+    const int idx = IndexForHandle(handle);
+    return idx >= 0 && PendingLoads.find(idx) == PendingLoads.end();
+}
+
+//==============================
+// ovrTextureManagerImpl::GetNumPendingLoads
+int ovrTextureManagerImpl::GetNumPendingLoads() const {
+    return static_cast<int>(PendingLoads.size());
+}
+
+//==============================
+// ovrTextureManagerImpl::StartDecodeThreads
+void ovrTextureManagerImpl::StartDecodeThreads() {
+    if (!DecodeThreads.empty()) {
+        return;
+    }
+    DecodeExit = false;
+    for (int i = 0; i < NUM_DECODE_THREADS; i++) {
+        DecodeThreads.push_back(
+            std::thread(&ovrTextureManagerImpl::DecodeThreadFunction, this, i));
+    }
+}
+
+//==============================
+// ovrTextureManagerImpl::StopDecodeThreads
+void ovrTextureManagerImpl::StopDecodeThreads() {
+    if (DecodeThreads.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(DecodeMutex);
+        DecodeExit = true;
+    }
+    DecodeCondition.notify_all();
+    for (std::thread& thread : DecodeThreads) {
+        thread.join();
+    }
+    DecodeThreads.clear();
+}
+
+//==============================
+// ovrTextureManagerImpl::DecodeThreadFunction
+void ovrTextureManagerImpl::DecodeThreadFunction(const int threadIndex) {
+#if defined(ANDROID)
+    char threadName[16];
+    snprintf(threadName, sizeof(threadName), "OVR::TexDecode%d", threadIndex);
+    prctl(PR_SET_NAME, (long)threadName, 0, 0, 0);
+#endif // defined(ANDROID)
+
+    for (;;) {
+        std::shared_ptr<ovrTextureLoad> load;
+        {
+            std::unique_lock<std::mutex> lock(DecodeMutex);
+            DecodeCondition.wait(lock, [this] { return !DecodeQueue.empty() || DecodeExit; });
+            if (DecodeExit) {
+                break;
+            }
+            load = DecodeQueue.front();
+            DecodeQueue.pop_front();
+        }
+
+        if (!load->Cancelled) {
+            load->Failed = !DecodeTextureFromBuffer(
+                load->Uri.c_str(), load->Buffer.data(), load->Buffer.size(), load->Flags,
+                load->Decoded);
+            load->NextLevel = static_cast<int>(load->Decoded.Levels.size()) - 1;
+            load->Failed = load->Failed || load->NextLevel < 0;
+        }
+        std::vector<uint8_t>().swap(load->Buffer);
+
+        std::lock_guard<std::mutex> lock(DecodeMutex);
+        DecodedLoads.push_back(load);
+    }
+}
+
 //==============================
 // ovrTextureManagerImpl::GetTexture
 ovrManagedTexture ovrTextureManagerImpl::GetTexture(textureHandle_t const handle) const {
@@ -440,7 +1269,15 @@ GlTexture ovrTextureManagerImpl::GetGlTexture(textureHandle_t const handle) cons
 void ovrTextureManagerImpl::FreeTexture(textureHandle_t const handle) {
     int idx = IndexForHandle(handle);
     if (idx >= 0) {
-        if (Textures[idx].GetUri().empty()) {
+        auto pending = PendingLoads.find(idx);
+        if (pending != PendingLoads.end()) {
+            pending->second->Cancelled = true;
+            PendingLoads.erase(pending);
+        }
+        ResidentMemory -= Residency[idx].Size;
+        Residency[idx] = ovrTextureResidency();
+        TextureIndices.erase(Textures[idx].GetTexture().texture);
+        if (!Textures[idx].GetUri().empty()) {
             UriHash.erase(Textures[idx].GetUri());
         }
         Textures[idx].Free();
@@ -515,6 +1352,7 @@ textureHandle_t ovrTextureManagerImpl::AllocTexture() {
 
     int idx = static_cast<int>(Textures.size());
     Textures.push_back(ovrManagedTexture());
+    Residency.push_back(ovrTextureResidency());
 
     return textureHandle_t(idx);
 }
@@ -552,6 +1390,30 @@ void ovrTextureManagerImpl::PrintStats() const {
 
     ALOG("NumSearches: %i", NumSearches);
     ALOG("NumCompares: %i", NumCompares);
+
+    ALOG("NumAsyncLoads:     %i", NumAsyncLoads);
+    ALOG("NumPendingLoads:   %i", static_cast<int>(PendingLoads.size()));
+    ALOG("NumUploadedLevels: %i", NumUploadedLevels);
+    ALOG("NumUploadedBytes:  %zu", NumUploadedBytes);
+
+    ALOG("ResidentMemory: %zu", ResidentMemory);
+    ALOG("MemoryBudget:   %zu", MemoryBudget);
+    ALOG("NumEvictions:   %i", NumEvictions);
+    ALOG("NumReloads:     %i", NumReloads);
+}
+
+//==============================================================================================
+// residency
+//==============================================================================================
+
+static ovrTextureManager* ResidencyTextureManager = nullptr;
+
+ovrTextureManager* GetResidencyTextureManager() {
+    return ResidencyTextureManager;
+}
+
+void SetResidencyTextureManager(ovrTextureManager* textureManager) {
+    ResidencyTextureManager = textureManager;
 }
 
 //==============================================================================================
@@ -34,6 +34,8 @@ Authors     :   Jonathan E. Wright
 
 namespace OVRFW {
 
+class ovrDynamicTextureAtlas;
+
 enum ovrTextureHandle { INVALID_TEXTURE_HANDLE = -1 };
 
 typedef OVR::TypesafeNumberT<int, ovrTextureHandle, INVALID_TEXTURE_HANDLE> textureHandle_t;
@@ -127,8 +129,64 @@ class ovrTextureManager {
         ovrTextureFilter const filterType = FILTER_DEFAULT,
         ovrTextureWrap const wrapType = WRAP_DEFAULT) = 0;
 
+    // Returns a handle right away, whose texture holds a 1x1 transparent placeholder until the
+    // file has been decoded on a worker thread and uploaded by Update(). The GL texture name
+    // doesn't change, so a GlTexture copied out early shows the image once it is in, although
+    // the size it carries stays 1x1. The file itself is read on the calling thread. Formats
+    // DecodeTextureFromBuffer() doesn't handle are loaded synchronously instead.
+    virtual textureHandle_t LoadTextureAsync(
+        class ovrFileSys& fileSys,
+        char const* uri,
+        ovrTextureFilter const filterType = FILTER_DEFAULT,
+        ovrTextureWrap const wrapType = WRAP_DEFAULT) = 0;
+    // The buffer is copied, the caller keeps ownership.
+    virtual textureHandle_t LoadTextureAsync(
+        char const* uri,
+        void const* buffer,
+        size_t const bufferSize,
+        ovrTextureFilter const filterType = FILTER_DEFAULT,
+        ovrTextureWrap const wrapType = WRAP_DEFAULT) = 0;
+
+    // Uploads decoded textures through a pixel buffer, up to the upload budget each call but
+    // always at least one mip level. Levels go from the smallest up, so a large texture
+    // sharpens over a few frames instead of stalling one. Call once a frame on the thread
+    // that owns the GL context, or while building a pipelined frame, which hands the GL work
+    // to the render thread; OvrGuiSys::Frame() does for the GUI texture manager.
+    virtual void Update() = 0;
+    virtual void SetUploadBudget(size_t const bytesPerFrame) = 0;
+
+    // False while an asynchronous load is still decoding or uploading. A load that failed
+    // counts as loaded and keeps the placeholder.
+    virtual bool IsTextureLoaded(textureHandle_t const handle) const = 0;
+    virtual int GetNumPendingLoads() const = 0;
+
+    // Texture memory the manager may keep resident, 0 for no limit. Sizes are computed from the
+    // format, dimensions and mip levels of each texture; textures loaded synchronously from a
+    // compressed container are estimated at 8 bits per texel. Over budget, Update() evicts the
+    // least recently used textures that can be read again from their uri, replacing their
+    // contents with a 1x1 transparent texel but keeping the GL texture name. Using an evicted
+    // texture queues it for an asynchronous reload into the same name, so holders of its
+    // GlTexture never see it change.
+    virtual void SetMemoryBudget(size_t const bytes) = 0;
+    virtual size_t GetResidentMemory() const = 0;
+    virtual size_t GetTextureMemory(textureHandle_t const handle) const = 0;
+
+    // Pinned textures are never evicted.
+    virtual void SetTexturePinned(textureHandle_t const handle, bool const pinned) = 0;
+    // False while the texture is evicted, or while its reload is still pending.
+    virtual bool IsTextureResident(textureHandle_t const handle) const = 0;
+
+    // Marks the texture with this GL name as used in the current frame. Called by the surface
+    // renderer for every texture it binds, through GetResidencyTextureManager(). Safe to call
+    // from the render thread while Update() runs, the use is applied by the next Update().
+    virtual void NoteTextureUsed(unsigned const texture) = 0;
+
     virtual void FreeTexture(textureHandle_t const handle) = 0;
 
+    // Shared pages small images can be packed into, disabled until the application enables it.
+    // Its pages are textures of this manager, and Update() rebuilds their mip levels.
+    virtual ovrDynamicTextureAtlas& GetAtlas() = 0;
+
     virtual ovrManagedTexture GetTexture(textureHandle_t const handle) const = 0;
     virtual GlTexture GetGlTexture(textureHandle_t const handle) const = 0;
 
@@ -138,4 +196,9 @@ class ovrTextureManager {
     virtual void PrintStats() const = 0;
 };
 
+// The texture manager the surface renderer reports texture use to, or NULL. Set by OvrGuiSys
+// for its texture manager.
+ovrTextureManager* GetResidencyTextureManager();
+void SetResidencyTextureManager(ovrTextureManager* textureManager);
+
 } // namespace OVRFW
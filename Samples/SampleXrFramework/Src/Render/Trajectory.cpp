@@ -0,0 +1,247 @@
+/************************************************************************************
+
+Filename    :   Trajectory.cpp
+Content     :   Recorded paths kept in contiguous arrays, drawn with screen space LOD.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Render/DebugDraw.h"
+
+using OVR::Bounds3f;
+using OVR::Matrix4f;
+using OVR::Vector3f;
+using OVR::Vector4f;
+
+namespace OVRFW {
+
+static float DistanceToSegment(const Vector3f& p, const Vector3f& a, const Vector3f& b) {
+    const Vector3f ab = b - a;
+    const float lengthSq = ab.LengthSq();
+    const float t = lengthSq > 0.0f ? std::min(std::max((p - a).Dot(ab) / lengthSq, 0.0f), 1.0f)
+                                    : 0.0f;
+    return (p - (a + ab * t)).Length();
+}
+
+static float DistanceToBounds(const Vector3f& p, const Bounds3f& bounds) {
+    Vector3f d;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float below = bounds.b[0][axis] - p[axis];
+        const float above = p[axis] - bounds.b[1][axis];
+        d[axis] = std::max(std::max(below, above), 0.0f);
+    }
+    return d.Length();
+}
+
+//==============================================================
+// ovrTrajectory
+
+void ovrTrajectory::AddPoint(
+    const Vector3f& position,
+    const double timeInSeconds,
+    const bool newStrip,
+    const float minDistance) {
+    const bool startsStrip = newStrip || Positions.empty();
+    float speed = 0.0f;
+    if (!startsStrip) {
+        const float distance = (position - Positions.back()).Length();
+        if (distance < minDistance) {
+            return;
+        }
+        const double dt = timeInSeconds - Times.back();
+        speed = dt > 0.0 ? static_cast<float>(distance / dt) : 0.0f;
+    }
+
+    Positions.push_back(position);
+    Times.push_back(timeInSeconds);
+    Speeds.push_back(speed);
+    StripStarts.push_back(startsStrip ? 1 : 0);
+
+    // a chunk is simplified once the first point of the next one exists
+    while ((NumSealedChunks + 1) * CHUNK_SIZE < GetNumPoints()) {
+        SealChunk(NumSealedChunks);
+        NumSealedChunks++;
+    }
+}
+
+void ovrTrajectory::Clear() {
+    Positions.clear();
+    Times.clear();
+    Speeds.clear();
+    StripStarts.clear();
+    Chunks.clear();
+    NumSealedChunks = 0;
+}
+
+void ovrTrajectory::SealChunk(const int chunk) {
+    const int first = chunk * CHUNK_SIZE;
+    const int last = first + CHUNK_SIZE; // the first point of the next chunk
+
+    // The ends of the chunk and of each strip in it are always kept, and the strips are
+    // simplified separately.
+    Errors.assign(CHUNK_SIZE + 1, 0.0f);
+    Errors[0] = FLT_MAX;
+    Errors[CHUNK_SIZE] = FLT_MAX;
+    // a strip starting at the first point of the next chunk ends at the last point of this one
+    for (int i = first + 1; i <= last; ++i) {
+        if (StripStarts[i] != 0) {
+            Errors[i - 1 - first] = FLT_MAX;
+            Errors[i - first] = FLT_MAX;
+        }
+    }
+
+    struct ovrSpan {
+        int A;
+        int B;
+        float MaxError;
+    };
+    ovrSpan stack[CHUNK_SIZE + 1];
+    int a = first;
+    for (int b = first + 1; b <= last; ++b) {
+        if (Errors[b - first] != FLT_MAX) {
+            continue;
+        }
+        int stackSize = 0;
+        stack[stackSize++] = {a, b, FLT_MAX};
+        while (stackSize > 0) {
+            const ovrSpan span = stack[--stackSize];
+            if (span.B - span.A < 2) {
+                continue;
+            }
+            int split = span.A + 1;
+            float splitDistance = -1.0f;
+            const Vector3f& start = Positions[span.A];
+            const Vector3f& end = Positions[span.B];
+            for (int i = span.A + 1; i < span.B; ++i) {
+                const float d = DistanceToSegment(Positions[i], start, end);
+                if (d > splitDistance) {
+                    splitDistance = d;
+                    split = i;
+                }
+            }
+            // capped so a point never outlives the one that split its span
+            const float error = std::min(splitDistance, span.MaxError);
+            Errors[split - first] = error;
+            stack[stackSize++] = {span.A, split, error};
+            stack[stackSize++] = {split, span.B, error};
+        }
+        a = b;
+    }
+
+    if (static_cast<int>(Chunks.size()) <= chunk) {
+        Chunks.resize(chunk + 1);
+    }
+    ovrChunk& c = Chunks[chunk];
+    c.Bounds.Clear();
+    for (int i = first; i <= last; ++i) {
+        c.Bounds.AddPoint(Positions[i]);
+    }
+    // the last point belongs to the next chunk
+    c.Order.resize(CHUNK_SIZE);
+    for (int i = 0; i < CHUNK_SIZE; ++i) {
+        c.Order[i] = static_cast<uint16_t>(i);
+    }
+    std::stable_sort(c.Order.begin(), c.Order.end(), [this](uint16_t x, uint16_t y) {
+        return Errors[x] > Errors[y];
+    });
+    c.SortedErrors.resize(CHUNK_SIZE);
+    for (int i = 0; i < CHUNK_SIZE; ++i) {
+        c.SortedErrors[i] = Errors[c.Order[i]];
+    }
+}
+
+void ovrTrajectory::SelectLod(
+    const Vector3f& eyePosition,
+    const float errorPerMeter,
+    std::vector<int>& indices) const {
+    for (int chunk = 0; chunk < NumSealedChunks; ++chunk) {
+        const ovrChunk& c = Chunks[chunk];
+        // the nearest point of the chunk needs the most detail, so use it for all of them
+        const float threshold = DistanceToBounds(eyePosition, c.Bounds) * errorPerMeter;
+        const int count = static_cast<int>(
+            std::upper_bound(
+                c.SortedErrors.begin(),
+                c.SortedErrors.end(),
+                threshold,
+                [](const float t, const float error) { return error <= t; }) -
+            c.SortedErrors.begin());
+
+        Selected.assign(c.Order.begin(), c.Order.begin() + count);
+        std::sort(Selected.begin(), Selected.end());
+        const int first = chunk * CHUNK_SIZE;
+        for (const int i : Selected) {
+            indices.push_back(first + i);
+        }
+    }
+    for (int i = NumSealedChunks * CHUNK_SIZE; i < GetNumPoints(); ++i) {
+        indices.push_back(i);
+    }
+}
+
+//==============================================================
+// ovrTrajectoryView
+
+ovrTrajectoryView::ovrTrajectoryView()
+    : ErrorPerMeter(0.0f), MaxSpeed(2.0f), NumDrawnPoints(0), NumRecordedPoints(0) {
+    SetMaxScreenError(1.5f);
+}
+
+void ovrTrajectoryView::SetMaxScreenError(const float pixels, const float pixelsPerRadian) {
+    ErrorPerMeter = tanf(pixels / pixelsPerRadian);
+}
+
+void ovrTrajectoryView::SetMaxSpeed(const float metersPerSecond) {
+    MaxSpeed = std::max(metersPerSecond, 0.001f);
+}
+
+void ovrTrajectoryView::ResetStats() {
+    NumDrawnPoints = 0;
+    NumRecordedPoints = 0;
+}
+
+Vector4f ovrTrajectoryView::SpeedColor(const float speed) const {
+    static const Vector4f slow(0.2f, 0.4f, 1.0f, 1.0f);
+    static const Vector4f medium(0.2f, 1.0f, 0.2f, 1.0f);
+    static const Vector4f fast(1.0f, 0.2f, 0.2f, 1.0f);
+    const float t = std::min(speed / MaxSpeed, 1.0f) * 2.0f;
+    return t < 1.0f ? slow.Lerp(medium, t) : medium.Lerp(fast, t - 1.0f);
+}
+
+void ovrTrajectoryView::Draw(
+    const ovrTrajectory& trajectory,
+    const Matrix4f& centerEyeViewMatrix,
+    ovrDebugDraw& debugDraw) {
+    const Vector3f eyePosition = centerEyeViewMatrix.Inverted().GetTranslation();
+    Indices.clear();
+    trajectory.SelectLod(eyePosition, ErrorPerMeter, Indices);
+    NumRecordedPoints += trajectory.GetNumPoints();
+    NumDrawnPoints += static_cast<int>(Indices.size());
+
+    const Vector3f* positions = trajectory.GetPositions();
+    const float* speeds = trajectory.GetSpeeds();
+    const auto flush = [this, &debugDraw]() {
+        if (StripPoints.size() > 1) {
+            debugDraw.AddLineStrip(
+                StripPoints.data(), StripColors.data(), static_cast<int>(StripPoints.size()));
+        }
+        StripPoints.clear();
+        StripColors.clear();
+    };
+    for (const int i : Indices) {
+        if (trajectory.IsStripStart(i)) {
+            flush();
+        }
+        StripPoints.push_back(positions[i]);
+        StripColors.push_back(SpeedColor(speeds[i]));
+    }
+    flush();
+}
+
+} // namespace OVRFW
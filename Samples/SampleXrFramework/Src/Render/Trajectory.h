@@ -0,0 +1,119 @@
+/************************************************************************************
+
+Filename    :   Trajectory.h
+Content     :   Recorded paths kept in contiguous arrays, drawn with screen space LOD.
+Created     :   October 2026
+Language    :   C++
+
+*************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "OVR_Math.h"
+
+namespace OVRFW {
+
+class ovrDebugDraw;
+
+// A path that only grows, stored as plain arrays so long recordings can be walked without a
+// call per point. Every CHUNK_SIZE points, the chunk is simplified once with Douglas-Peucker:
+// each point gets the distance from the chord it was split off at, capped by the distance of
+// the point that split the chord it lies on, so dropping the points below any error keeps a
+// consistent simplification. Picking a level of detail is then a binary search per chunk.
+// The points after the last full chunk are always drawn.
+class ovrTrajectory {
+   public:
+    static const int CHUNK_SIZE = 256;
+
+    ovrTrajectory() : NumSealedChunks(0) {}
+
+    // Points closer than minDistance to the last one are skipped. A new strip leaves a gap
+    // after the last point, e.g. where tracking was lost.
+    void AddPoint(
+        const OVR::Vector3f& position,
+        const double timeInSeconds,
+        const bool newStrip = false,
+        const float minDistance = 0.001f);
+    void Clear();
+
+    int GetNumPoints() const {
+        return static_cast<int>(Positions.size());
+    }
+    const OVR::Vector3f* GetPositions() const {
+        return Positions.data();
+    }
+    // From the previous point, 0 for the first point of a strip. In meters per second.
+    const float* GetSpeeds() const {
+        return Speeds.data();
+    }
+    bool IsStripStart(const int index) const {
+        return StripStarts[index] != 0;
+    }
+
+    // Appends the indices of the points to draw, in order, so that no dropped point is further
+    // than errorPerMeter times its distance to the eye from the simplified path.
+    void SelectLod(
+        const OVR::Vector3f& eyePosition,
+        const float errorPerMeter,
+        std::vector<int>& indices) const;
+
+   private:
+    struct ovrChunk {
+        OVR::Bounds3f Bounds;
+        std::vector<float> SortedErrors; // largest first
+        std::vector<uint16_t> Order; // of the points in the chunk, by SortedErrors
+    };
+
+    void SealChunk(const int chunk);
+
+    std::vector<OVR::Vector3f> Positions;
+    std::vector<double> Times;
+    std::vector<float> Speeds;
+    std::vector<uint8_t> StripStarts;
+    std::vector<ovrChunk> Chunks;
+    int NumSealedChunks;
+    std::vector<float> Errors; // scratch for SealChunk()
+    mutable std::vector<int> Selected; // scratch for SelectLod()
+};
+
+// Draws trajectories as line strips colored by speed, from blue when still through green to
+// red at the maximum speed, with the level of detail picked for a screen space error.
+class ovrTrajectoryView {
+   public:
+    ovrTrajectoryView();
+
+    // Quest class displays have about 1000 pixels per radian at the center.
+    void SetMaxScreenError(const float pixels, const float pixelsPerRadian = 1000.0f);
+    void SetMaxSpeed(const float metersPerSecond);
+
+    // Adds the trajectory to the debug draw, depth tested.
+    void Draw(
+        const ovrTrajectory& trajectory,
+        const OVR::Matrix4f& centerEyeViewMatrix,
+        ovrDebugDraw& debugDraw);
+
+    // Points drawn and points recorded over the Draw() calls since the last ResetStats().
+    int GetNumDrawnPoints() const {
+        return NumDrawnPoints;
+    }
+    int GetNumRecordedPoints() const {
+        return NumRecordedPoints;
+    }
+    void ResetStats();
+
+   private:
+    OVR::Vector4f SpeedColor(const float speed) const;
+
+    float ErrorPerMeter;
+    float MaxSpeed;
+    int NumDrawnPoints;
+    int NumRecordedPoints;
+    std::vector<int> Indices;
+    std::vector<OVR::Vector3f> StripPoints;
+    std::vector<OVR::Vector4f> StripColors;
+};
+
+} // namespace OVRFW
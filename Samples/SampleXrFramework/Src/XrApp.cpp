@@ -195,6 +195,11 @@ void XrApp::HandleSessionStateChanges(XrSessionState state) {
 #endif // defined(ANDROID)
         assert(SessionActive);
 
+        // every begun frame has to be ended before the session is
+        if (PipelinedRendering && RenderThread.joinable()) {
+            WaitForRenderIdle();
+        }
+
         OXR(xrEndSession(Session));
         SessionActive = false;
     }
@@ -368,14 +373,143 @@ bool XrApp::ActionPoseIsActive(XrAction action, XrPath subactionPath) {
     return state.isActive != XR_FALSE;
 }
 
+XrTime XrApp::GetCurrentXrTime() const {
+#if defined(XR_USE_TIMESPEC)
+    if (ConvertTimespecTimeToTimeKHR != nullptr) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        XrTime xrTime = 0;
+        XrResult result;
+        OXR(result = ConvertTimespecTimeToTimeKHR(Instance, &now, &xrTime));
+        if (result == XR_SUCCESS) {
+            return xrTime;
+        }
+    }
+#endif // defined(XR_USE_TIMESPEC)
+    return 0;
+}
+
 XrApp::LocVel XrApp::GetSpaceLocVel(XrSpace space, XrTime time) {
     XrApp::LocVel lv = {{XR_TYPE_SPACE_LOCATION}, {XR_TYPE_SPACE_VELOCITY}};
-    lv.loc.next = &lv.vel;
-    OXR(xrLocateSpace(space, CurrentSpace, time, &lv.loc));
-    lv.loc.next = NULL; // pointer no longer valid or necessary
+    LocateSpaces(CurrentSpace, time, 1, &space, &lv.loc, &lv.vel);
     return lv;
 }
 
+void XrApp::LocateSpaces(
+    XrSpace baseSpace,
+    XrTime time,
+    uint32_t count,
+    const XrSpace* spaces,
+    XrSpaceLocation* locations,
+    XrSpaceVelocity* velocities) {
+    const bool cacheable = (time != 0 && time == SpaceLocationCacheTime);
+
+    // Work in chunks so the scratch arrays can live on the stack.
+    static const uint32_t MAX_BATCH = MAX_CACHED_SPACE_LOCATIONS;
+    for (uint32_t first = 0; first < count; first += MAX_BATCH) {
+        const uint32_t batchCount = std::min(count - first, MAX_BATCH);
+
+        XrSpace missSpaces[MAX_BATCH];
+        uint32_t missIndices[MAX_BATCH];
+        uint32_t missCount = 0;
+        for (uint32_t i = first; i < first + batchCount; i++) {
+            bool found = false;
+            if (cacheable) {
+                for (int c = 0; c < SpaceLocationCacheCount; c++) {
+                    const CachedSpaceLocation& cached = SpaceLocationCache[c];
+                    if (cached.Space == spaces[i] && cached.BaseSpace == baseSpace) {
+                        locations[i].locationFlags = cached.Location.locationFlags;
+                        locations[i].pose = cached.Location.pose;
+                        if (velocities != nullptr) {
+                            velocities[i].velocityFlags = cached.Velocity.velocityFlags;
+                            velocities[i].linearVelocity = cached.Velocity.linearVelocity;
+                            velocities[i].angularVelocity = cached.Velocity.angularVelocity;
+                        }
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (!found) {
+                missSpaces[missCount] = spaces[i];
+                missIndices[missCount] = i;
+                missCount++;
+            }
+        }
+        if (missCount == 0) {
+            continue;
+        }
+
+        // Always ask for velocities so the cache can serve either kind of query.
+        XrSpaceLocation missLocations[MAX_BATCH];
+        XrSpaceVelocity missVelocities[MAX_BATCH];
+        bool located = false;
+#if defined(XR_KHR_locate_spaces)
+        if (LocateSpacesKHR != nullptr) {
+            XrSpaceLocationDataKHR locationData[MAX_BATCH];
+            XrSpaceVelocityDataKHR velocityData[MAX_BATCH];
+
+            XrSpaceVelocitiesKHR spaceVelocities = {XR_TYPE_SPACE_VELOCITIES_KHR};
+            spaceVelocities.velocityCount = missCount;
+            spaceVelocities.velocities = velocityData;
+
+            XrSpaceLocationsKHR spaceLocations = {XR_TYPE_SPACE_LOCATIONS_KHR};
+            spaceLocations.next = &spaceVelocities;
+            spaceLocations.locationCount = missCount;
+            spaceLocations.locations = locationData;
+
+            XrSpacesLocateInfoKHR locateInfo = {XR_TYPE_SPACES_LOCATE_INFO_KHR};
+            locateInfo.baseSpace = baseSpace;
+            locateInfo.time = time;
+            locateInfo.spaceCount = missCount;
+            locateInfo.spaces = missSpaces;
+
+            XrResult result;
+            OXR(result = LocateSpacesKHR(Session, &locateInfo, &spaceLocations));
+            if (XR_SUCCEEDED(result)) {
+                for (uint32_t m = 0; m < missCount; m++) {
+                    missLocations[m] = {XR_TYPE_SPACE_LOCATION};
+                    missLocations[m].locationFlags = locationData[m].locationFlags;
+                    missLocations[m].pose = locationData[m].pose;
+                    missVelocities[m] = {XR_TYPE_SPACE_VELOCITY};
+                    missVelocities[m].velocityFlags = velocityData[m].velocityFlags;
+                    missVelocities[m].linearVelocity = velocityData[m].linearVelocity;
+                    missVelocities[m].angularVelocity = velocityData[m].angularVelocity;
+                }
+                located = true;
+            }
+        }
+#endif // defined(XR_KHR_locate_spaces)
+        if (!located) {
+            for (uint32_t m = 0; m < missCount; m++) {
+                missLocations[m] = {XR_TYPE_SPACE_LOCATION};
+                missVelocities[m] = {XR_TYPE_SPACE_VELOCITY};
+                missLocations[m].next = &missVelocities[m];
+                OXR(xrLocateSpace(missSpaces[m], baseSpace, time, &missLocations[m]));
+                missLocations[m].next = NULL; // pointer no longer valid or necessary
+            }
+        }
+
+        for (uint32_t m = 0; m < missCount; m++) {
+            const uint32_t i = missIndices[m];
+            locations[i].locationFlags = missLocations[m].locationFlags;
+            locations[i].pose = missLocations[m].pose;
+            if (velocities != nullptr) {
+                velocities[i].velocityFlags = missVelocities[m].velocityFlags;
+                velocities[i].linearVelocity = missVelocities[m].linearVelocity;
+                velocities[i].angularVelocity = missVelocities[m].angularVelocity;
+            }
+            if (cacheable && SpaceLocationCacheCount < MAX_CACHED_SPACE_LOCATIONS) {
+                CachedSpaceLocation& cached = SpaceLocationCache[SpaceLocationCacheCount++];
+                cached.Space = missSpaces[m];
+                cached.BaseSpace = baseSpace;
+                cached.Location = missLocations[m];
+                cached.Velocity = missVelocities[m];
+            }
+        }
+    }
+}
+
 // Returns a list of OpenXr extensions needed for this app
 std::vector<const char*> XrApp::GetExtensions() {
     std::vector<const char*> extensions = {
@@ -389,6 +523,12 @@ std::vector<const char*> XrApp::GetExtensions() {
         XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME,
         XR_KHR_ANDROID_THREAD_SETTINGS_EXTENSION_NAME,
 #endif // defined(XR_USE_PLATFORM_ANDROID)
+#if defined(XR_USE_TIMESPEC)
+        XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME,
+#endif // defined(XR_USE_TIMESPEC)
+#if defined(XR_KHR_locate_spaces)
+        XR_KHR_LOCATE_SPACES_EXTENSION_NAME,
+#endif // defined(XR_KHR_locate_spaces)
         XR_KHR_COMPOSITION_LAYER_CUBE_EXTENSION_NAME,
         XR_KHR_COMPOSITION_LAYER_CYLINDER_EXTENSION_NAME};
     return extensions;
@@ -697,6 +837,24 @@ bool XrApp::Init(const xrJava& context) {
         XR_VERSION_MINOR(instanceInfo.runtimeVersion),
         XR_VERSION_PATCH(instanceInfo.runtimeVersion));
 
+#if defined(XR_USE_TIMESPEC)
+    // Optional: only resolves when the runtime exposed XR_KHR_convert_timespec_time
+    if (XR_FAILED(xrGetInstanceProcAddr(
+            Instance,
+            "xrConvertTimespecTimeToTimeKHR",
+            (PFN_xrVoidFunction*)(&ConvertTimespecTimeToTimeKHR)))) {
+        ConvertTimespecTimeToTimeKHR = nullptr;
+    }
+#endif // defined(XR_USE_TIMESPEC)
+
+#if defined(XR_KHR_locate_spaces)
+    // Optional: LocateSpaces() falls back to xrLocateSpace when this is missing
+    if (XR_FAILED(xrGetInstanceProcAddr(
+            Instance, "xrLocateSpacesKHR", (PFN_xrVoidFunction*)(&LocateSpacesKHR)))) {
+        LocateSpacesKHR = nullptr;
+    }
+#endif // defined(XR_KHR_locate_spaces)
+
     XrSystemGetInfo systemGetInfo = {XR_TYPE_SYSTEM_GET_INFO};
     systemGetInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
 
@@ -770,6 +928,23 @@ bool XrApp::Init(const xrJava& context) {
     }
     EglInitExtensions();
 
+    // Decide on multiview before any program is compiled, the vertex header depends on it.
+    MultiviewActive = MultiviewRendering && glExtensions.multi_view &&
+        ovrFramebuffer_SupportsMultiview(GL_SRGB8_ALPHA8, NUM_MULTI_SAMPLES);
+    if (MultiviewRendering && !MultiviewActive) {
+        ALOGW("GL_OVR_multiview2 not available, rendering one pass per eye");
+    }
+    GlProgram::SetUseMultiview(MultiviewActive);
+    GlProgram::SetUseInstanceBatching(InstanceBatching);
+
+    if (ProgramBinaryCache) {
+        ProgramCache.Init(ProgramCacheDirectory.c_str());
+#if defined(ANDROID)
+        ProgramCache.StartCompileThreads(&Egl);
+#endif // defined(ANDROID)
+        SetProgramCache(&ProgramCache);
+    }
+
     CpuLevel = CPU_LEVEL;
     GpuLevel = GPU_LEVEL;
 #if defined(ANDROID)
@@ -854,6 +1029,35 @@ bool XrApp::Init(const xrJava& context) {
             NULL,
             2,
             handSubactionPaths);
+
+        // Everything SyncActionSets reads, fetched once per frame
+        for (int hand = 0; hand < 2; hand++) {
+            const XrPath path = handSubactionPaths[hand];
+            BaseActionSlots.AimPose[hand] =
+                ActionSnapshot.Add(AimPoseAction, XR_ACTION_TYPE_POSE_INPUT, path);
+            BaseActionSlots.GripPose[hand] =
+                ActionSnapshot.Add(GripPoseAction, XR_ACTION_TYPE_POSE_INPUT, path);
+            BaseActionSlots.IndexTrigger[hand] =
+                ActionSnapshot.Add(IndexTriggerAction, XR_ACTION_TYPE_FLOAT_INPUT, path);
+            BaseActionSlots.GripTrigger[hand] =
+                ActionSnapshot.Add(GripTriggerAction, XR_ACTION_TYPE_FLOAT_INPUT, path);
+            BaseActionSlots.Joystick[hand] =
+                ActionSnapshot.Add(JoystickAction, XR_ACTION_TYPE_VECTOR2F_INPUT, path);
+            BaseActionSlots.ThumbstickClick[hand] =
+                ActionSnapshot.Add(thumbstickClickAction, XR_ACTION_TYPE_BOOLEAN_INPUT, path);
+        }
+        BaseActionSlots.ButtonA = ActionSnapshot.Add(ButtonAAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ButtonB = ActionSnapshot.Add(ButtonBAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ButtonX = ActionSnapshot.Add(ButtonXAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ButtonY = ActionSnapshot.Add(ButtonYAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ButtonMenu =
+            ActionSnapshot.Add(ButtonMenuAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ThumbStickTouch =
+            ActionSnapshot.Add(ThumbStickTouchAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.ThumbRestTouch =
+            ActionSnapshot.Add(ThumbRestTouchAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
+        BaseActionSlots.TriggerTouch =
+            ActionSnapshot.Add(TriggerTouchAction, XR_ACTION_TYPE_BOOLEAN_INPUT);
     }
 
     /// Interaction profile can be overridden
@@ -878,8 +1082,20 @@ bool XrApp::Init(const xrJava& context) {
         }
     }
     SurfaceRender.Init();
-
-    return AppInit(&context);
+    FrameStreamBuffer.Create(FRAME_STREAM_BUFFER_SIZE);
+
+    const bool appInitialized = AppInit(&context);
+    // Programs built from here on are loaded or compiled by the caller, the compile
+    // threads only help with startup.
+    ProgramCache.StopCompileThreads();
+    if (!appInitialized) {
+        return false;
+    }
+    if (ParallelSurfaceGeneration) {
+        JobSystem.Init();
+        SetJobSystem(&JobSystem);
+    }
+    return true;
 }
 
 bool XrApp::InitSession() {
@@ -1048,14 +1264,37 @@ bool XrApp::InitSession() {
     }
 
     // Create the frame buffers.
-    for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
-        ovrFramebuffer_Create(
-            Session,
-            &FrameBuffer[eye],
-            GL_SRGB8_ALPHA8,
-            ViewConfigurationView[0].recommendedImageRectWidth * FramebufferResolutionScaleFactor,
-            ViewConfigurationView[0].recommendedImageRectHeight * FramebufferResolutionScaleFactor,
-            NUM_MULTI_SAMPLES);
+    const int fbWidth =
+        ViewConfigurationView[0].recommendedImageRectWidth * FramebufferResolutionScaleFactor;
+    const int fbHeight =
+        ViewConfigurationView[0].recommendedImageRectHeight * FramebufferResolutionScaleFactor;
+    if (MultiviewActive) {
+        // One layered framebuffer holds both eyes.
+        NumFramebuffers = 1;
+        if (!ovrFramebuffer_CreateMultiview(
+                Session, &FrameBuffer[0], GL_SRGB8_ALPHA8, fbWidth, fbHeight, NUM_MULTI_SAMPLES)) {
+            // Only the swapchain is left to fail here, the driver side was checked in Init().
+            // The programs AppInit() built are multiview ones, so keep rendering both eyes in
+            // one pass, into textures of our own, and copy each eye to a swapchain of its own.
+            ALOGE("Failed to create the multiview swapchain, copying the eyes out of a target");
+            if (!ovrFramebuffer_CreateMultiviewTarget(
+                    &MultiviewTarget, GL_SRGB8_ALPHA8, fbWidth, fbHeight, NUM_MULTI_SAMPLES)) {
+                ALOGE_FAIL("Failed to create the multiview target");
+            }
+            MultiviewCopy = true;
+            for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
+                // already resolved, and a blit can't write to a multisampled framebuffer
+                ovrFramebuffer_Create(
+                    Session, &FrameBuffer[eye], GL_SRGB8_ALPHA8, fbWidth, fbHeight, 1);
+            }
+        }
+    }
+    if (!MultiviewActive) {
+        NumFramebuffers = MAX_NUM_EYES;
+        for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
+            ovrFramebuffer_Create(
+                Session, &FrameBuffer[eye], GL_SRGB8_ALPHA8, fbWidth, fbHeight, NUM_MULTI_SAMPLES);
+        }
     }
 
     // xrAttachSessionActionSets can only be called once, so skip it if the application
@@ -1069,10 +1308,19 @@ bool XrApp::InitSession() {
 }
 
 void XrApp::EndSession() {
-    for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
-        ovrFramebuffer_Destroy(&FrameBuffer[eye]);
+    if (MultiviewCopy) {
+        ovrFramebuffer_Destroy(&MultiviewTarget);
+        ovrFramebuffer_Destroy(&FrameBuffer[1]);
+        MultiviewCopy = false;
+    }
+    for (int i = 0; i < NumFramebuffers; i++) {
+        ovrFramebuffer_Destroy(&FrameBuffer[i]);
     }
 
+    // cached locations refer to the spaces destroyed below
+    SpaceLocationCacheCount = 0;
+    SpaceLocationCacheTime = 0;
+
     OXR(xrDestroySpace(HeadSpace));
     OXR(xrDestroySpace(LocalSpace));
     // StageSpace is optional.
@@ -1093,6 +1341,11 @@ void XrApp::DestroyInstance() {
 // Called one time when the applicatoin process exits
 void XrApp::Shutdown(const xrJava& context) {
     AppShutdown(&context);
+    SetJobSystem(nullptr);
+    JobSystem.Shutdown();
+    SetProgramCache(nullptr);
+    ProgramCache.Shutdown();
+    FrameStreamBuffer.Destroy();
     DestroyInstance();
     Clear();
 }
@@ -1105,6 +1358,8 @@ void XrApp::Clear() {
     ShouldExit = false;
     Focused = false;
     SkipInputHandling = false;
+    PosePredictionAnalysis = false;
+    PosePredictionAnalyzer.Clear();
 
     Instance = XR_NULL_HANDLE;
     Session = XR_NULL_HANDLE;
@@ -1147,7 +1402,20 @@ void XrApp::Clear() {
     LeftControllerGripSpace = XR_NULL_HANDLE;
     RightControllerGripSpace = XR_NULL_HANDLE;
     LastFrameAllButtons = 0u;
+    ActionSnapshot.Clear();
+    BaseActionSlots = {};
+    for (int bit = 0; bit < ovrApplFrameIn::kNumButtonBits; bit++) {
+        ButtonDownTime[bit] = 0;
+    }
     LastFrameAllTouches = 0u;
+#if defined(XR_USE_TIMESPEC)
+    ConvertTimespecTimeToTimeKHR = nullptr;
+#endif // defined(XR_USE_TIMESPEC)
+#if defined(XR_KHR_locate_spaces)
+    LocateSpacesKHR = nullptr;
+#endif // defined(XR_KHR_locate_spaces)
+    SpaceLocationCacheCount = 0;
+    SpaceLocationCacheTime = 0;
 }
 
 // Internal Input
@@ -1166,26 +1434,35 @@ void XrApp::SyncActionSets(ovrApplFrameIn& in) {
     syncInfo.activeActionSets = &activeActionSet;
     OXR(xrSyncActions(Session, &syncInfo));
 
-    // query input action states
-    XrActionStateGetInfo getInfo = {XR_TYPE_ACTION_STATE_GET_INFO};
-    getInfo.subactionPath = XR_NULL_PATH;
+    // query all input action states at once
+    ActionSnapshot.Update(Session, in.PredictedDisplayTimeNs);
 
-    XrAction controller[] = {AimPoseAction, GripPoseAction, AimPoseAction, GripPoseAction};
-    XrPath subactionPath[] = {LeftHandPath, LeftHandPath, RightHandPath, RightHandPath};
+    const int controllerPoseSlot[] = {
+        BaseActionSlots.AimPose[0],
+        BaseActionSlots.GripPose[0],
+        BaseActionSlots.AimPose[1],
+        BaseActionSlots.GripPose[1]};
     XrSpace controllerSpace[] = {
         LeftControllerAimSpace,
         LeftControllerGripSpace,
         RightControllerAimSpace,
         RightControllerGripSpace,
     };
+    // Already located by MainLoop for this frame, so this is served from the cache.
+    XrSpaceLocation controllerLocation[4] = {
+        {XR_TYPE_SPACE_LOCATION},
+        {XR_TYPE_SPACE_LOCATION},
+        {XR_TYPE_SPACE_LOCATION},
+        {XR_TYPE_SPACE_LOCATION}};
+    LocateSpaces(
+        CurrentSpace, in.PredictedDisplayTimeNs, 4, controllerSpace, controllerLocation);
     bool ControllerPoseActive[] = {false, false, false, false};
     XrPosef ControllerPose[] = {{}, {}, {}, {}};
     for (int i = 0; i < 4; i++) {
-        if (ActionPoseIsActive(controller[i], subactionPath[i])) {
-            LocVel lv = GetSpaceLocVel(controllerSpace[i], ToXrTime(in.PredictedDisplayTime));
+        if (ActionSnapshot.IsActive(controllerPoseSlot[i])) {
             ControllerPoseActive[i] =
-                (lv.loc.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0;
-            ControllerPose[i] = lv.loc.pose;
+                (controllerLocation[i].locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0;
+            ControllerPose[i] = controllerLocation[i].pose;
         } else {
             ControllerPoseActive[i] = false;
             XrPosef_CreateIdentity(&ControllerPose[i]);
@@ -1205,7 +1482,7 @@ void XrApp::SyncActionSets(ovrApplFrameIn& in) {
 
     /// Update pose
     XrSpaceLocation loc = {XR_TYPE_SPACE_LOCATION};
-    OXR(xrLocateSpace(HeadSpace, CurrentSpace, ToXrTime(in.PredictedDisplayTime), &loc));
+    LocateSpaces(CurrentSpace, in.PredictedDisplayTimeNs, 1, &HeadSpace, &loc);
     in.HeadPose = FromXrPosef(loc.pose);
     /// grip & point space
     in.LeftRemotePointPose = FromXrPosef(ControllerPose[0]);
@@ -1215,24 +1492,22 @@ void XrApp::SyncActionSets(ovrApplFrameIn& in) {
     in.LeftRemoteTracked = ControllerPoseActive[1];
     in.RightRemoteTracked = ControllerPoseActive[3];
 
-    in.LeftRemoteIndexTrigger = GetActionStateFloat(IndexTriggerAction, LeftHandPath).currentState;
-    in.RightRemoteIndexTrigger =
-        GetActionStateFloat(IndexTriggerAction, RightHandPath).currentState;
-    in.LeftRemoteGripTrigger = GetActionStateFloat(GripTriggerAction, LeftHandPath).currentState;
-    in.RightRemoteGripTrigger = GetActionStateFloat(GripTriggerAction, RightHandPath).currentState;
+    in.LeftRemoteIndexTrigger = ActionSnapshot.GetFloat(BaseActionSlots.IndexTrigger[0]);
+    in.RightRemoteIndexTrigger = ActionSnapshot.GetFloat(BaseActionSlots.IndexTrigger[1]);
+    in.LeftRemoteGripTrigger = ActionSnapshot.GetFloat(BaseActionSlots.GripTrigger[0]);
+    in.RightRemoteGripTrigger = ActionSnapshot.GetFloat(BaseActionSlots.GripTrigger[1]);
     in.LeftRemoteJoystick =
-        FromXrVector2f(GetActionStateVector2(JoystickAction, LeftHandPath).currentState);
+        FromXrVector2f(ActionSnapshot.GetVector2(BaseActionSlots.Joystick[0]));
     in.RightRemoteJoystick =
-        FromXrVector2f(GetActionStateVector2(JoystickAction, RightHandPath).currentState);
+        FromXrVector2f(ActionSnapshot.GetVector2(BaseActionSlots.Joystick[1]));
 
-    bool aPressed = GetActionStateBoolean(ButtonAAction).currentState;
-    bool bPressed = GetActionStateBoolean(ButtonBAction).currentState;
-    bool xPressed = GetActionStateBoolean(ButtonXAction).currentState;
-    bool yPressed = GetActionStateBoolean(ButtonYAction).currentState;
-    bool menuPressed = GetActionStateBoolean(ButtonMenuAction).currentState;
-    bool leftThumbPressed = GetActionStateBoolean(thumbstickClickAction, LeftHandPath).currentState;
-    bool rightThumbPressed =
-        GetActionStateBoolean(thumbstickClickAction, RightHandPath).currentState;
+    bool aPressed = ActionSnapshot.IsDown(BaseActionSlots.ButtonA);
+    bool bPressed = ActionSnapshot.IsDown(BaseActionSlots.ButtonB);
+    bool xPressed = ActionSnapshot.IsDown(BaseActionSlots.ButtonX);
+    bool yPressed = ActionSnapshot.IsDown(BaseActionSlots.ButtonY);
+    bool menuPressed = ActionSnapshot.IsDown(BaseActionSlots.ButtonMenu);
+    bool leftThumbPressed = ActionSnapshot.IsDown(BaseActionSlots.ThumbstickClick[0]);
+    bool rightThumbPressed = ActionSnapshot.IsDown(BaseActionSlots.ThumbstickClick[1]);
 
     in.LastFrameAllButtons = LastFrameAllButtons;
     in.AllButtons = 0u;
@@ -1276,9 +1551,9 @@ void XrApp::SyncActionSets(ovrApplFrameIn& in) {
     in.LastFrameAllTouches = LastFrameAllTouches;
     in.AllTouches = 0u;
 
-    const bool thumbstickTouched = GetActionStateBoolean(ThumbStickTouchAction).currentState;
-    const bool thumbrestTouched = GetActionStateBoolean(ThumbRestTouchAction).currentState;
-    const bool triggerTouched = GetActionStateBoolean(TriggerTouchAction).currentState;
+    const bool thumbstickTouched = ActionSnapshot.IsDown(BaseActionSlots.ThumbStickTouch);
+    const bool thumbrestTouched = ActionSnapshot.IsDown(BaseActionSlots.ThumbRestTouch);
+    const bool triggerTouched = ActionSnapshot.IsDown(BaseActionSlots.TriggerTouch);
 
     if (thumbstickTouched) {
         in.AllTouches |= ovrApplFrameIn::kTouchJoystick;
@@ -1292,6 +1567,20 @@ void XrApp::SyncActionSets(ovrApplFrameIn& in) {
 
     LastFrameAllTouches = in.AllTouches;
 
+    /// hold durations, buttons and touches share one bit space
+    const uint32_t allBits = in.AllButtons | in.AllTouches;
+    for (int bit = 0; bit < ovrApplFrameIn::kNumButtonBits; bit++) {
+        if ((allBits & (1u << bit)) == 0) {
+            ButtonDownTime[bit] = 0;
+            in.ButtonHeldSeconds[bit] = 0.0f;
+            continue;
+        }
+        if (ButtonDownTime[bit] == 0) {
+            ButtonDownTime[bit] = in.PredictedDisplayTimeNs;
+        }
+        in.ButtonHeldSeconds[bit] = FromXrTime(in.PredictedDisplayTimeNs - ButtonDownTime[bit]);
+    }
+
     /*
         /// timing
         double RealTimeInSeconds = 0.0;
@@ -1315,6 +1604,28 @@ void XrApp::HandleInput(ovrApplFrameIn& in) {
 
 // Called once per frame to allow the application to render eye buffers.
 void XrApp::AppRenderFrame(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out) {
+    // In pipelined mode the main thread already built the surface list.
+    if (!PipelinedRendering) {
+        AppPrepareFrame(in, out);
+    }
+
+    // With multiview there is a single framebuffer and pass; the SceneMatrices UBO already
+    // holds both eyes and the shaders index it with gl_ViewID_OVR.
+    for (int eye = 0; eye < NumFramebuffers; eye++) {
+        ovrFramebuffer* frameBuffer = GetFrameBuffer(eye);
+        ovrFramebuffer_Acquire(frameBuffer);
+        ovrFramebuffer_SetCurrent(frameBuffer);
+
+        AppEyeGLStateSetup(in, frameBuffer, eye);
+        AppRenderEye(in, out, eye);
+
+        ovrFramebuffer_Resolve(frameBuffer);
+        ovrFramebuffer_Release(frameBuffer);
+    }
+    ovrFramebuffer_SetNone();
+}
+
+void XrApp::AppPrepareFrame(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out) {
     Scene.SetFreeMove(FreeMove);
     /// create a local copy
     OVRFW::ovrApplFrameIn localIn = in;
@@ -1329,19 +1640,6 @@ void XrApp::AppRenderFrame(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOu
     if (ShouldRender) {
         Render(in, out);
     }
-
-    for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
-        ovrFramebuffer* frameBuffer = &FrameBuffer[eye];
-        ovrFramebuffer_Acquire(frameBuffer);
-        ovrFramebuffer_SetCurrent(frameBuffer);
-
-        AppEyeGLStateSetup(in, frameBuffer, eye);
-        AppRenderEye(in, out, eye);
-
-        ovrFramebuffer_Resolve(frameBuffer);
-        ovrFramebuffer_Release(frameBuffer);
-    }
-    ovrFramebuffer_SetNone();
 }
 
 void XrApp::AppRenderEye(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out, int eye) {
@@ -1469,6 +1767,18 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
 
     InitSession();
 
+    // The main thread has no GL context once the render thread takes it.
+    if (PipelinedRendering && ovrFrameThreadGlUser::GetCount() > 0) {
+        ALOGW(
+            "PipelinedRendering disabled: %d GPU particle systems run GL from the main thread",
+            ovrFrameThreadGlUser::GetCount());
+        PipelinedRendering = false;
+    }
+    if (PipelinedRendering) {
+        ALOG("PipelinedRendering enabled");
+        StartRenderThread();
+    }
+
     bool stageBoundsDirty = true;
     int frameCount = -1;
 
@@ -1487,6 +1797,16 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
             continue;
         }
 
+        // A GPU particle system created after the render thread started already missed the
+        // context in Init(), but at least its passes from here on go through.
+        if (PipelinedRendering && ovrFrameThreadGlUser::GetCount() > 0) {
+            ALOGE(
+                "PipelinedRendering stopped: a GPU particle system was created after the "
+                "session began");
+            StopRenderThread();
+            PipelinedRendering = false;
+        }
+
         if (stageBoundsDirty) {
             XrExtent2Df stageBounds = {};
             XrResult result;
@@ -1501,7 +1821,12 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
 
         PreWaitFrame(waitFrameInfo);
 
-        XrFrameState frameState = {XR_TYPE_FRAME_STATE};
+        // In pipelined mode this blocks until the render thread is done with an older frame.
+        const int frameSlot = PipelinedRendering ? AcquireFrameSlot() : 0;
+        ovrFrameSlot& frame = FrameSlots[frameSlot];
+
+        frame.FrameState = {XR_TYPE_FRAME_STATE};
+        XrFrameState& frameState = frame.FrameState;
 
         OXR(xrWaitFrame(Session, &waitFrameInfo, &frameState));
 
@@ -1509,14 +1834,42 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
         // the new eye images will be displayed. The number of frames predicted ahead
         // depends on the pipeline depth of the engine and the synthesis rate.
         // The better the prediction, the less black will be pulled in at the edges.
-        XrFrameBeginInfo beginFrameDesc = {XR_TYPE_FRAME_BEGIN_INFO};
-        OXR(xrBeginFrame(Session, &beginFrameDesc));
+        // In pipelined mode the render thread begins the frame.
+        if (!PipelinedRendering) {
+            XrFrameBeginInfo beginFrameDesc = {XR_TYPE_FRAME_BEGIN_INFO};
+            OXR(xrBeginFrame(Session, &beginFrameDesc));
+
+            // Everything Update() and the renderers stream this frame goes in a fresh region.
+            FrameStreamBuffer.BeginFrame();
+            SetFrameStreamBuffer(&FrameStreamBuffer);
+        }
         ShouldRender = frameState.shouldRender;
 
-        XrSpaceLocation loc = {XR_TYPE_SPACE_LOCATION};
-        OXR(xrLocateSpace(HeadSpace, CurrentSpace, frameState.predictedDisplayTime, &loc));
-        XrPosef xfStageFromHead = loc.pose;
-        OXR(xrLocateSpace(HeadSpace, LocalSpace, frameState.predictedDisplayTime, &loc));
+        // Start a new frame of cached space locations, and fill it with everything the
+        // framework needs this frame in a single batch.
+        SpaceLocationCacheCount = 0;
+        SpaceLocationCacheTime = frameState.predictedDisplayTime;
+        const XrSpace frameSpaces[] = {
+            HeadSpace,
+            LeftControllerAimSpace,
+            LeftControllerGripSpace,
+            RightControllerAimSpace,
+            RightControllerGripSpace,
+        };
+        XrSpaceLocation frameLocations[5] = {
+            {XR_TYPE_SPACE_LOCATION},
+            {XR_TYPE_SPACE_LOCATION},
+            {XR_TYPE_SPACE_LOCATION},
+            {XR_TYPE_SPACE_LOCATION},
+            {XR_TYPE_SPACE_LOCATION}};
+        LocateSpaces(
+            CurrentSpace,
+            frameState.predictedDisplayTime,
+            SkipInputHandling ? 1 : 5,
+            frameSpaces,
+            frameLocations);
+        XrPosef xfStageFromHead = frameLocations[0].pose;
+        const XrSpaceLocationFlags headLocationFlags = frameLocations[0].locationFlags;
 
         XrViewState viewState = {XR_TYPE_VIEW_STATE};
 
@@ -1535,33 +1888,42 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
             &viewState,
             projectionCapacityInput,
             &projectionCountOutput,
-            Projections));
-
-        OVRFW::ovrApplFrameIn in = {};
-        OVRFW::ovrRendererOutput out = {};
+            frame.Projections));
+
+        // reuse the slot's surface list storage
+        frame.In = {};
+        frame.Out.FrameMatrices = {};
+        frame.Out.Surfaces.clear();
+        OVRFW::ovrApplFrameIn& in = frame.In;
+        OVRFW::ovrRendererOutput& out = frame.Out;
         in.FrameIndex = frameCount;
 
         /// time accounting
         in.PredictedDisplayTime = FromXrTime(frameState.predictedDisplayTime);
+        in.PredictedDisplayTimeNs = frameState.predictedDisplayTime;
         if (PrevDisplayTime > 0) {
             in.DeltaSeconds = FromXrTime(frameState.predictedDisplayTime - PrevDisplayTime);
         }
         PrevDisplayTime = frameState.predictedDisplayTime;
 
         for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
-            XrPosef xfHeadFromEye = Projections[eye].pose;
+            XrPosef xfHeadFromEye = frame.Projections[eye].pose;
             XrPosef xfStageFromEye{};
             XrPosef_Multiply(&xfStageFromEye, &xfStageFromHead, &xfHeadFromEye);
-            XrPosef_Invert(&ViewTransform[eye], &xfStageFromEye);
+            XrPosef_Invert(&frame.ViewTransform[eye], &xfStageFromEye);
             XrMatrix4x4f viewMat{};
-            XrMatrix4x4f_CreateFromRigidTransform(&viewMat, &ViewTransform[eye]);
-            const XrFovf fov = Projections[eye].fov;
+            XrMatrix4x4f_CreateFromRigidTransform(&viewMat, &frame.ViewTransform[eye]);
+            const XrFovf fov = frame.Projections[eye].fov;
             XrMatrix4x4f projMat;
             XrMatrix4x4f_CreateProjectionFov(&projMat, GRAPHICS_OPENGL_ES, fov, 0.1f, 0.0f);
             out.FrameMatrices.EyeView[eye] = FromXrMatrix4x4f(viewMat);
             out.FrameMatrices.EyeProjection[eye] = FromXrMatrix4x4f(projMat);
             in.Eye[eye].ViewMatrix = out.FrameMatrices.EyeView[eye];
             in.Eye[eye].ProjectionMatrix = out.FrameMatrices.EyeProjection[eye];
+            if (!PipelinedRendering) {
+                Projections[eye] = frame.Projections[eye];
+                ViewTransform[eye] = frame.ViewTransform[eye];
+            }
         }
 
         XrPosef centerView;
@@ -1570,39 +1932,211 @@ void XrApp::MainLoop(MainLoopContext& loopContext) {
         XrMatrix4x4f_CreateFromRigidTransform(&viewMat, &centerView);
         out.FrameMatrices.CenterView = FromXrMatrix4x4f(viewMat);
 
+        // Whatever Update() and AppPrepareFrame() need from GL waits for the render thread.
+        if (PipelinedRendering) {
+            SetFrameGlTasks(&frame.GlTasks);
+        }
+
         // Input
         HandleInput(in);
 
-        LayerCount = 0;
-        memset(Layers, 0, sizeof(xrCompositorLayerUnion) * MAX_NUM_LAYERS);
+        if (PosePredictionAnalysis) {
+            XrPosef poses[ovrPosePredictionAnalyzer::TRACKED_MAX] = {
+                xfStageFromHead, ToXrPosef(in.LeftRemotePose), ToXrPosef(in.RightRemotePose)};
+            const bool valid[ovrPosePredictionAnalyzer::TRACKED_MAX] = {
+                (headLocationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0,
+                !SkipInputHandling && in.LeftRemoteTracked,
+                !SkipInputHandling && in.RightRemoteTracked};
+            PosePredictionAnalyzer.AddPrediction(
+                frameCount, frameState.predictedDisplayTime, poses, valid);
+
+            // Without a runtime clock, assume the frame was predicted two periods ahead.
+            XrTime now = GetCurrentXrTime();
+            if (now == 0) {
+                now = frameState.predictedDisplayTime - 2 * frameState.predictedDisplayPeriod;
+            }
+            const XrSpace spaces[ovrPosePredictionAnalyzer::TRACKED_MAX] = {
+                HeadSpace, LeftControllerGripSpace, RightControllerGripSpace};
+            // Give the runtime one display period to fold in the tracking samples.
+            PosePredictionAnalyzer.Resolve(
+                CurrentSpace,
+                spaces,
+                now,
+                frameState.predictedDisplayPeriod,
+                [this](
+                    XrSpace baseSpace,
+                    XrTime time,
+                    uint32_t count,
+                    const XrSpace* locateSpaces,
+                    XrSpaceLocation* locations) {
+                    LocateSpaces(baseSpace, time, count, locateSpaces, locations);
+                });
+        }
 
-        // allow apps to submit a layer before the world view projection layer (uncommon)
-        PreProjectionAddLayer(Layers, LayerCount);
+        if (PipelinedRendering) {
+            // Build the surface list here, the render thread only records and submits it.
+            AppPrepareFrame(in, out);
+            SetFrameGlTasks(nullptr);
+            QueueFrameSlot(frameSlot);
+        } else {
+            SubmitFrame(frame);
+        }
+    }
 
-        // Render the world-view layer (projection)
-        AppRenderFrame(in, out);
-        ProjectionAddLayer(Layers, LayerCount);
+    if (PipelinedRendering) {
+        StopRenderThread();
+    }
 
-        // allow apps to submit a layer after the world view projection layer (uncommon)
-        PostProjectionAddLayer(Layers, LayerCount);
+    EndSession();
+    Shutdown(loopContext.GetJavaContext());
+}
 
-        // Compose the layers for this frame.
-        const XrCompositionLayerBaseHeader* layers[MAX_NUM_LAYERS] = {};
-        for (int i = 0; i < LayerCount; i++) {
-            layers[i] = (const XrCompositionLayerBaseHeader*)&Layers[i];
+// Renders the frame's projection layer and hands all layers to the compositor.
+// Runs on the render thread in pipelined mode.
+void XrApp::SubmitFrame(ovrFrameSlot& frame) {
+    if (PipelinedRendering) {
+        XrFrameBeginInfo beginFrameDesc = {XR_TYPE_FRAME_BEGIN_INFO};
+        OXR(xrBeginFrame(Session, &beginFrameDesc));
+
+        // ProjectionAddLayer reads these, the main thread is already filling in the next frame
+        for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
+            Projections[eye] = frame.Projections[eye];
+            ViewTransform[eye] = frame.ViewTransform[eye];
         }
 
-        XrFrameEndInfo endFrameInfo = {XR_TYPE_FRAME_END_INFO};
-        endFrameInfo.displayTime = frameState.predictedDisplayTime;
-        endFrameInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
-        endFrameInfo.layerCount = LayerCount;
-        endFrameInfo.layers = layers;
+        // only the renderers stream from here, the frame was built without a GL context
+        FrameStreamBuffer.BeginFrame();
+        SetFrameStreamBuffer(&FrameStreamBuffer);
 
-        OXR(xrEndFrame(Session, &endFrameInfo));
+        // the uploads the frame was built with, ahead of anything drawing from them
+        frame.GlTasks.Run();
     }
 
-    EndSession();
-    Shutdown(loopContext.GetJavaContext());
+    LayerCount = 0;
+    memset(Layers, 0, sizeof(xrCompositorLayerUnion) * MAX_NUM_LAYERS);
+
+    // allow apps to submit a layer before the world view projection layer (uncommon)
+    PreProjectionAddLayer(Layers, LayerCount);
+
+    // Render the world-view layer (projection)
+    AppRenderFrame(frame.In, frame.Out);
+    if (MultiviewCopy) {
+        for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
+            ovrFramebuffer_Acquire(&FrameBuffer[eye]);
+            ovrFramebuffer_BlitLayer(&MultiviewTarget, eye, &FrameBuffer[eye]);
+            ovrFramebuffer_Release(&FrameBuffer[eye]);
+        }
+        ovrFramebuffer_SetNone();
+    }
+    ProjectionAddLayer(Layers, LayerCount);
+
+    // allow apps to submit a layer after the world view projection layer (uncommon)
+    PostProjectionAddLayer(Layers, LayerCount);
+
+    // Compose the layers for this frame.
+    const XrCompositionLayerBaseHeader* layers[MAX_NUM_LAYERS] = {};
+    for (int i = 0; i < LayerCount; i++) {
+        layers[i] = (const XrCompositionLayerBaseHeader*)&Layers[i];
+    }
+
+    XrFrameEndInfo endFrameInfo = {XR_TYPE_FRAME_END_INFO};
+    endFrameInfo.displayTime = frame.FrameState.predictedDisplayTime;
+    endFrameInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+    endFrameInfo.layerCount = LayerCount;
+    endFrameInfo.layers = layers;
+
+    OXR(xrEndFrame(Session, &endFrameInfo));
+
+    SetFrameStreamBuffer(nullptr);
+    FrameStreamBuffer.EndFrame();
+}
+
+void XrApp::StartRenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(FrameSlotMutex);
+        FreeFrameSlots.clear();
+        QueuedFrameSlots.clear();
+        for (int i = 0; i < NUM_FRAME_SLOTS; i++) {
+            FreeFrameSlots.push_back(i);
+        }
+        RenderThreadRunning = false;
+        RenderThreadExit = false;
+    }
+
+    // The render thread owns the GL context from here on.
+    ovrEgl_ReleaseCurrent(&Egl);
+    RenderThread = std::thread(&XrApp::RenderThreadFunction, this);
+
+    // RenderThreadTid has to be known before the session begins
+    std::unique_lock<std::mutex> lock(FrameSlotMutex);
+    FrameSlotCondition.wait(lock, [this] { return RenderThreadRunning; });
+}
+
+void XrApp::StopRenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(FrameSlotMutex);
+        RenderThreadExit = true;
+    }
+    FrameSlotCondition.notify_all();
+    RenderThread.join();
+
+    ovrEgl_MakeCurrent(&Egl);
+}
+
+void XrApp::RenderThreadFunction() {
+#if defined(ANDROID)
+    prctl(PR_SET_NAME, (long)"OVR::Render", 0, 0, 0);
+    RenderThreadTid = gettid();
+#endif // defined(ANDROID)
+    ovrEgl_MakeCurrent(&Egl);
+
+    std::unique_lock<std::mutex> lock(FrameSlotMutex);
+    RenderThreadRunning = true;
+    FrameSlotCondition.notify_all();
+
+    for (;;) {
+        // drain queued frames before honoring an exit request
+        FrameSlotCondition.wait(
+            lock, [this] { return !QueuedFrameSlots.empty() || RenderThreadExit; });
+        if (QueuedFrameSlots.empty()) {
+            break;
+        }
+        const int frameSlot = QueuedFrameSlots.front();
+        QueuedFrameSlots.pop_front();
+
+        lock.unlock();
+        SubmitFrame(FrameSlots[frameSlot]);
+        lock.lock();
+
+        FreeFrameSlots.push_back(frameSlot);
+        FrameSlotCondition.notify_all();
+    }
+
+    RenderThreadRunning = false;
+    lock.unlock();
+    ovrEgl_ReleaseCurrent(&Egl);
+}
+
+int XrApp::AcquireFrameSlot() {
+    std::unique_lock<std::mutex> lock(FrameSlotMutex);
+    FrameSlotCondition.wait(lock, [this] { return !FreeFrameSlots.empty(); });
+    const int frameSlot = FreeFrameSlots.front();
+    FreeFrameSlots.pop_front();
+    return frameSlot;
+}
+
+void XrApp::QueueFrameSlot(const int frameSlot) {
+    {
+        std::lock_guard<std::mutex> lock(FrameSlotMutex);
+        QueuedFrameSlots.push_back(frameSlot);
+    }
+    FrameSlotCondition.notify_all();
+}
+
+void XrApp::WaitForRenderIdle() {
+    std::unique_lock<std::mutex> lock(FrameSlotMutex);
+    FrameSlotCondition.wait(
+        lock, [this] { return FreeFrameSlots.size() == (size_t)NUM_FRAME_SLOTS; });
 }
 
 void XrApp::ProjectionAddLayer(xrCompositorLayerUnion* layers, int& layerCount) {
@@ -1617,7 +2151,9 @@ void XrApp::ProjectionAddLayer(xrCompositorLayerUnion* layers, int& layerCount)
     projection_layer.views = ProjectionLayerElements;
 
     for (int eye = 0; eye < MAX_NUM_EYES; eye++) {
-        ovrFramebuffer* frameBuffer = &FrameBuffer[eye];
+        // a multiview framebuffer has one swapchain with a layer per eye
+        const bool layered = MultiviewActive && !MultiviewCopy;
+        ovrFramebuffer* frameBuffer = &FrameBuffer[layered ? 0 : eye];
         memset(&ProjectionLayerElements[eye], 0, sizeof(XrCompositionLayerProjectionView));
         ProjectionLayerElements[eye].type = XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW;
         XrPosef_Invert(&ProjectionLayerElements[eye].pose, &ViewTransform[eye]);
@@ -1630,7 +2166,7 @@ void XrApp::ProjectionAddLayer(xrCompositorLayerUnion* layers, int& layerCount)
             frameBuffer->ColorSwapChain.Width;
         ProjectionLayerElements[eye].subImage.imageRect.extent.height =
             frameBuffer->ColorSwapChain.Height;
-        ProjectionLayerElements[eye].subImage.imageArrayIndex = 0;
+        ProjectionLayerElements[eye].subImage.imageArrayIndex = layered ? eye : 0;
     }
 
     layers[layerCount++].Projection = projection_layer;
@@ -1657,6 +2193,10 @@ void XrApp::Run(struct android_app* app) {
     Context.Env = Env;
     Context.ActivityObject = app->activity->clazz;
 
+    if (ProgramCacheDirectory.empty() && app->activity->internalDataPath != nullptr) {
+        ProgramCacheDirectory = std::string(app->activity->internalDataPath) + "/program_cache";
+    }
+
     app->userData = this;
     app->onAppCmd = app_handle_cmd;
 
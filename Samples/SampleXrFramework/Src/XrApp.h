@@ -16,6 +16,9 @@ Language    :   c++
 #include <unordered_map>
 #include <mutex>
 #include <memory>
+#include <thread>
+#include <condition_variable>
+#include <deque>
 
 #include "OVR_Math.h"
 
@@ -76,6 +79,7 @@ typedef void(GL_APIENTRY* PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)(
 #if defined(ANDROID)
 #define XR_USE_GRAPHICS_API_OPENGL_ES 1
 #define XR_USE_PLATFORM_ANDROID 1
+#define XR_USE_TIMESPEC 1
 #elif defined(WIN32)
 #include <unknwn.h>
 #define XR_USE_GRAPHICS_API_OPENGL 1
@@ -86,9 +90,14 @@ typedef void(GL_APIENTRY* PFNGLFRAMEBUFFERTEXTURE2DMULTISAMPLEEXTPROC)(
 #include <meta_openxr_preview/openxr_oculus_helpers.h>
 #include <openxr/openxr_platform.h>
 
+#include "Input/ActionStateSnapshot.h"
+#include "Input/PosePredictionAnalyzer.h"
 #include "Model/SceneView.h"
 #include "Render/Framebuffer.h"
 #include "Render/SurfaceRender.h"
+#include "Render/GlStreamBuffer.h"
+#include "Render/GlProgramCache.h"
+#include "JobSystem.h"
 
 std::string OXR_ResultToString(XrInstance instance, XrResult result);
 void OXR_CheckErrors(XrInstance instance, XrResult result, const char* function, bool failOnError);
@@ -328,6 +337,18 @@ class XrApp {
         RunWhilePaused = b;
     }
 
+    // Returns the current runtime time (the clock XrFrameState::predictedDisplayTime is
+    // expressed in), or 0 when the runtime does not expose XR_KHR_convert_timespec_time.
+    XrTime GetCurrentXrTime() const;
+
+    // Prediction error collected while PosePredictionAnalysis is enabled.
+    bool IsPosePredictionAnalysisEnabled() const {
+        return PosePredictionAnalysis;
+    }
+    const ovrPosePredictionAnalyzer& GetPosePredictionAnalyzer() const {
+        return PosePredictionAnalyzer;
+    }
+
 #if defined(ANDROID)
     void HandleAndroidCmd(struct android_app* app, int32_t cmd);
 #endif // defined(ANDROID)
@@ -352,8 +373,11 @@ class XrApp {
     int GetNumFramebuffers() const {
         return NumFramebuffers;
     }
+    bool IsMultiviewActive() const {
+        return MultiviewActive;
+    }
     ovrFramebuffer* GetFrameBuffer(int eye) {
-        return &FrameBuffer[eye];
+        return MultiviewCopy ? &MultiviewTarget : &FrameBuffer[eye];
     }
 
     std::vector<XrExtensionProperties> GetXrExtensionProperties() const;
@@ -396,6 +420,9 @@ class XrApp {
     virtual void AppGainedFocus();
     // Called once per frame to allow the application to render eye buffers.
     virtual void AppRenderFrame(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out);
+    // Runs the scene and Render() to build out.Surfaces. Called from AppRenderFrame(), or
+    // on the main thread ahead of it when PipelinedRendering is set.
+    virtual void AppPrepareFrame(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out);
     // Called once per eye each frame for default renderer
     virtual void
     AppRenderEye(const OVRFW::ovrApplFrameIn& in, OVRFW::ovrRendererOutput& out, int eye);
@@ -494,11 +521,28 @@ class XrApp {
         XrAction action,
         XrPath subactionPath = XR_NULL_PATH);
     bool ActionPoseIsActive(XrAction action, XrPath subactionPath);
+    // Action states read once per frame in SyncActionSets. Apps can Add() their own actions
+    // after creating them; apps with SkipInputHandling must call Update() themselves.
+    ovrActionStateSnapshot& GetActionSnapshot() {
+        return ActionSnapshot;
+    }
     struct LocVel {
         XrSpaceLocation loc;
         XrSpaceVelocity vel;
     };
     XrApp::LocVel GetSpaceLocVel(XrSpace space, XrTime time);
+    // Locates count spaces relative to baseSpace at time. This is a single xrLocateSpacesKHR
+    // call when the runtime supports XR_KHR_locate_spaces, and one xrLocateSpace per space
+    // otherwise. Results at the current frame's predicted display time are cached until the
+    // next frame, so repeated queries for the same space and base space are free.
+    // velocities may be null. Main thread only.
+    void LocateSpaces(
+        XrSpace baseSpace,
+        XrTime time,
+        uint32_t count,
+        const XrSpace* spaces,
+        XrSpaceLocation* locations,
+        XrSpaceVelocity* velocities = nullptr);
 
     /// XR Input state overrides
     virtual void AttachActionSets();
@@ -549,6 +593,25 @@ class XrApp {
     // Internal Render
     void RenderFrame(const ovrApplFrameIn& in, ovrRendererOutput& out);
 
+    // Everything a frame hands from the simulation stage to the render stage
+    struct ovrFrameSlot {
+        XrFrameState FrameState = {XR_TYPE_FRAME_STATE};
+        XrView Projections[MAX_NUM_EYES] = {{XR_TYPE_VIEW}, {XR_TYPE_VIEW}};
+        XrPosef ViewTransform[MAX_NUM_EYES];
+        ovrApplFrameIn In;
+        ovrRendererOutput Out;
+        ovrFrameGlTasks GlTasks; // run by SubmitFrame() in pipelined mode
+    };
+    void SubmitFrame(ovrFrameSlot& frame);
+
+    // Pipelined rendering
+    void StartRenderThread();
+    void StopRenderThread();
+    void RenderThreadFunction();
+    int AcquireFrameSlot();
+    void QueueFrameSlot(const int frameSlot);
+    void WaitForRenderIdle();
+
    public:
     OVR::Vector4f BackgroundColor;
     bool FreeMove{false};
@@ -584,6 +647,52 @@ class XrApp {
     // allocated by the framework.
     float FramebufferResolutionScaleFactor{1.0f};
 
+    // An app can set this in AppInit() to have the framework re-locate the head and
+    // grip spaces once each frame's predicted display time has passed, and accumulate
+    // the difference against the predicted poses. Costs one extra space location batch
+    // per frame.
+    bool PosePredictionAnalysis = false;
+
+    // An app can set this in AppInit() to pipeline frames across two threads. The main
+    // thread waits for frame N+1, syncs input, runs Update() and AppPrepareFrame() while a
+    // render thread, which owns the GL context, runs AppRenderFrame() and submits frame N.
+    // Update(), Render() and AppPrepareFrame() then run without a GL context, and anything
+    // the surfaces reference must stay unchanged until the frame has been submitted. The
+    // framework's helpers hand their per-frame uploads to the render thread through the
+    // frame's ovrFrameGlTasks, but GL objects, like menus, textures or models, still have to
+    // be created and freed in AppInit(), SessionInit() and SessionEnd(). GPU particle
+    // systems can't defer their simulation pass, so frames are not pipelined while any
+    // exist when the session starts.
+    bool PipelinedRendering = false;
+
+    // An app can set this in its constructor to render both eyes in a single pass with
+    // GL_OVR_multiview2, into one framebuffer backed by a 2 layer swapchain. Programs are
+    // compiled during Init(), so it has no effect when set from AppInit(). Falls back to
+    // one pass per eye when the extension is missing or the driver can't complete a
+    // multiview framebuffer; IsMultiviewActive() tells which. In the rare case that only the
+    // 2 layer swapchain fails, it still renders in one pass, into a target of its own that
+    // each eye is then copied out of, so the programs built in AppInit() stay valid.
+    bool MultiviewRendering = false;
+
+    // An app can set this in its constructor to build programs with instance batching, so
+    // the surface renderer draws consecutive surfaces that differ only by model matrix as a
+    // single instanced draw. Like MultiviewRendering, it must be set before Init().
+    bool InstanceBatching = false;
+
+    // An app can set this in AppInit() to start a pool of worker threads on the big cores
+    // and split the per-frame model animation and culling, and the GUI and font transforms,
+    // across it. The surface lists come out the same as without it.
+    bool ParallelSurfaceGeneration = false;
+
+    // An app can set this in its constructor to keep linked program binaries in
+    // ProgramCacheDirectory and skip compiling on later launches. On Android the scene's
+    // default programs are also compiled on background threads with shared contexts during
+    // Init(). The directory defaults to program_cache in the app's internal data path on
+    // Android; the disk cache stays off while it is empty.
+    bool ProgramBinaryCache = false;
+    std::string ProgramCacheDirectory;
+    ovrPosePredictionAnalyzer PosePredictionAnalyzer;
+
     XrVersion OpenXRVersion = XR_API_VERSION_1_0;
     XrInstance Instance = XR_NULL_HANDLE;
     XrSession Session = XR_NULL_HANDLE;
@@ -625,13 +734,59 @@ class XrApp {
     XrSpace RightControllerGripSpace = XR_NULL_HANDLE;
     uint32_t LastFrameAllButtons = 0u;
     uint32_t LastFrameAllTouches = 0u;
+    XrTime ButtonDownTime[ovrApplFrameIn::kNumButtonBits] = {};
+
+    ovrActionStateSnapshot ActionSnapshot;
+    // Indices into ActionSnapshot for the actions above; per hand ones are [left, right]
+    struct {
+        int AimPose[2];
+        int GripPose[2];
+        int IndexTrigger[2];
+        int GripTrigger[2];
+        int Joystick[2];
+        int ThumbstickClick[2];
+        int ButtonA;
+        int ButtonB;
+        int ButtonX;
+        int ButtonY;
+        int ButtonMenu;
+        int ThumbStickTouch;
+        int ThumbRestTouch;
+        int TriggerTouch;
+    } BaseActionSlots = {};
 
     OVRFW::ovrSurfaceRender SurfaceRender;
+    // Per-frame vertex and uniform data for the dynamic renderers and SurfaceRender.
+    // Only bound in serial mode, the main thread has no GL context when pipelined.
+    static const size_t FRAME_STREAM_BUFFER_SIZE = 1024 * 1024;
+    OVRFW::GlStreamBuffer FrameStreamBuffer;
+    // Started after AppInit() when ParallelSurfaceGeneration is set.
+    OVRFW::ovrJobSystem JobSystem;
+    // Set up before any program is built when ProgramBinaryCache is set.
+    OVRFW::GlProgramCache ProgramCache;
     OVRFW::OvrSceneView Scene;
     std::unique_ptr<OVRFW::ovrFileSys> FileSys;
     std::unique_ptr<OVRFW::ModelFile> SceneModel;
 
    private:
+#if defined(XR_USE_TIMESPEC)
+    PFN_xrConvertTimespecTimeToTimeKHR ConvertTimespecTimeToTimeKHR = nullptr;
+#endif // defined(XR_USE_TIMESPEC)
+#if defined(XR_KHR_locate_spaces)
+    PFN_xrLocateSpacesKHR LocateSpacesKHR = nullptr;
+#endif // defined(XR_KHR_locate_spaces)
+
+    // Space locations at SpaceLocationCacheTime, reset every frame.
+    static const int MAX_CACHED_SPACE_LOCATIONS = 32;
+    struct CachedSpaceLocation {
+        XrSpace Space;
+        XrSpace BaseSpace;
+        XrSpaceLocation Location;
+        XrSpaceVelocity Velocity;
+    };
+    CachedSpaceLocation SpaceLocationCache[MAX_CACHED_SPACE_LOCATIONS];
+    int SpaceLocationCacheCount = 0;
+    XrTime SpaceLocationCacheTime = 0;
     XrTime PrevDisplayTime = 0.0;
     int SwapInterval;
     int CpuLevel = CPU_LEVEL;
@@ -644,9 +799,25 @@ class XrApp {
 
     ovrFramebuffer FrameBuffer[MAX_NUM_EYES];
     int NumFramebuffers = MAX_NUM_EYES;
+    bool MultiviewActive = false;
+    // rendering into MultiviewTarget and blitting the eyes to FrameBuffer, without a 2 layer
+    // swapchain
+    ovrFramebuffer MultiviewTarget;
+    bool MultiviewCopy = false;
     bool IsAppFocused = false;
     bool RunWhilePaused = false;
     bool ShouldRender = true;
+
+    // one frame simulating, one queued, one rendering
+    static const int NUM_FRAME_SLOTS = 3;
+    ovrFrameSlot FrameSlots[NUM_FRAME_SLOTS];
+    std::thread RenderThread;
+    std::mutex FrameSlotMutex;
+    std::condition_variable FrameSlotCondition;
+    std::deque<int> FreeFrameSlots;
+    std::deque<int> QueuedFrameSlots;
+    bool RenderThreadRunning = false;
+    bool RenderThreadExit = false;
 };
 
 } // namespace OVRFW
@@ -11,7 +11,17 @@ namespace VRTelemetry {
 
         // Método principal: convierte datos específicos del SDK a formato genérico
         // Cada SDK implementará este método de forma diferente
-        virtual VRFrameData convertToGeneric(double timestamp) = 0;
+        // captureTimeNs es el reloj monotono (steadyClockNs) en el momento de la captura
+        virtual VRFrameData convertToGeneric(double timestamp, int64_t captureTimeNs) = 0;
+
+        // Muestra simultanea del reloj monotono, del reloj del runtime y del reloj de pared
+        virtual VRClockSample sampleClocks() = 0;
+
+        // Estadísticas de error de predicción de poses, si el SDK las calcula.
+        // Devuelve false si el análisis no está disponible o no está activo
+        virtual bool getPredictionStats(VRPredictionStats& /*stats*/) const {
+            return false;
+        }
 
         // Información del adapter
         virtual std::string getAdapterName() const = 0;
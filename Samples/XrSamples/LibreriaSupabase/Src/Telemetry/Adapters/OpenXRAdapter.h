@@ -9,9 +9,37 @@ namespace VRTelemetry {
     class OpenXRAdapter : public InterfaceDataAdapter {
     private:
         const OVRFW::ovrApplFrameIn* currentFrame;
+        const OVRFW::XrApp* app;
+
+        static void convertError(const OVRFW::ovrPosePredictionAnalyzer::ovrPredictionError& error,
+                                 OVRFW::ovrPosePredictionAnalyzer::ovrTrackedSpace space,
+                                 VRTrackedError& out) {
+            out.valid = error.Valid[space];
+            out.positionErrorMm = error.PositionError[space];
+            out.angularErrorDeg = error.AngularError[space];
+        }
+
+        static void convertHistogram(const OVRFW::ovrErrorHistogram& histogram, VRHistogram& out) {
+            out.bucketSize = histogram.GetBucketSize();
+            out.buckets.resize(OVRFW::ovrErrorHistogram::NUM_BUCKETS);
+            for (int i = 0; i < OVRFW::ovrErrorHistogram::NUM_BUCKETS; ++i) {
+                out.buckets[i] = histogram.GetBucket(i);
+            }
+            out.count = histogram.GetCount();
+            out.mean = histogram.GetMean();
+            out.max = histogram.GetMax();
+            out.p50 = histogram.Percentile(0.50f);
+            out.p95 = histogram.Percentile(0.95f);
+            out.p99 = histogram.Percentile(0.99f);
+        }
 
     public:
-        OpenXRAdapter() : currentFrame(nullptr) {}
+        OpenXRAdapter() : currentFrame(nullptr), app(nullptr) {}
+
+        // App de la que se lee el reloj del runtime (XrTime) para la correlacion de relojes
+        void setApp(const OVRFW::XrApp* xrApp) {
+            app = xrApp;
+        }
 
         // Actualizar con el frame actual de OpenXR
         void updateFrame(const OVRFW::ovrApplFrameIn& frame) {
@@ -19,14 +47,18 @@ namespace VRTelemetry {
         }
 
         // Implementación del método virtual: convertir OpenXR → genérico
-        VRFrameData convertToGeneric(double timestamp) override {
+        VRFrameData convertToGeneric(double timestamp, int64_t captureTimeNs) override {
             VRFrameData data;
             data.timestamp = timestamp;
+            data.captureTimeNs = captureTimeNs;
 
             if (!currentFrame) {
                 return data; // Retorna datos vacíos si no hay frame
             }
 
+            // Tiempo exacto que usó el runtime para predecir las poses de este frame
+            data.predictedDisplayTimeNs = currentFrame->PredictedDisplayTimeNs;
+
             // Convertir headset
             data.headPose.x = currentFrame->HeadPose.Translation.x;
             data.headPose.y = currentFrame->HeadPose.Translation.y;
@@ -66,9 +98,49 @@ namespace VRTelemetry {
             data.inputState.buttonA = currentFrame->Clicked(OVRFW::ovrApplFrameIn::kButtonA);
             // Fácil agregar más botones aquí en el futuro
 
+            // Último error de predicción resuelto (de un frame anterior, ya pasado)
+            if (app && app->IsPosePredictionAnalysisEnabled()) {
+                const auto& error = app->GetPosePredictionAnalyzer().GetLastError();
+                data.predictionError.displayTimeNs = error.DisplayTime;
+                convertError(error, OVRFW::ovrPosePredictionAnalyzer::TRACKED_HEAD,
+                             data.predictionError.head);
+                convertError(error, OVRFW::ovrPosePredictionAnalyzer::TRACKED_LEFT_GRIP,
+                             data.predictionError.left);
+                convertError(error, OVRFW::ovrPosePredictionAnalyzer::TRACKED_RIGHT_GRIP,
+                             data.predictionError.right);
+            }
+
             return data;
         }
 
+        VRClockSample sampleClocks() override {
+            VRClockSample sample;
+            // Se lee el reloj monotono antes y después del XrTime y se usa el punto medio
+            // para acotar el error de la correlación a la mitad de la duración de la llamada
+            const int64_t steadyBefore = steadyClockNs();
+            sample.runtimeNs = app ? app->GetCurrentXrTime() : 0;
+            const int64_t steadyAfter = steadyClockNs();
+            sample.wallNs = wallClockNs();
+            sample.steadyNs = steadyBefore + (steadyAfter - steadyBefore) / 2;
+            return sample;
+        }
+
+        bool getPredictionStats(VRPredictionStats& stats) const override {
+            if (!app || !app->IsPosePredictionAnalysisEnabled()) {
+                return false;
+            }
+            const auto& analyzer = app->GetPosePredictionAnalyzer();
+            using Tracked = OVRFW::ovrPosePredictionAnalyzer;
+            convertHistogram(analyzer.GetPositionHistogram(Tracked::TRACKED_HEAD), stats.headPosition);
+            convertHistogram(analyzer.GetAngularHistogram(Tracked::TRACKED_HEAD), stats.headAngular);
+            convertHistogram(analyzer.GetPositionHistogram(Tracked::TRACKED_LEFT_GRIP), stats.leftPosition);
+            convertHistogram(analyzer.GetAngularHistogram(Tracked::TRACKED_LEFT_GRIP), stats.leftAngular);
+            convertHistogram(analyzer.GetPositionHistogram(Tracked::TRACKED_RIGHT_GRIP), stats.rightPosition);
+            convertHistogram(analyzer.GetAngularHistogram(Tracked::TRACKED_RIGHT_GRIP), stats.rightAngular);
+            stats.droppedFrames = analyzer.GetDroppedCount();
+            return true;
+        }
+
         // Información del adapter
         std::string getAdapterName() const override {
             return "OpenXR Adapter";
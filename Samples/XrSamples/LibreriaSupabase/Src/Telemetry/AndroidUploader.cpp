@@ -38,13 +38,14 @@ namespace VRTelemetry {
         return true;
     }
 
-    bool AndroidUploader::createSession(const std::string& deviceInfo) {
+    bool AndroidUploader::createSession(const std::string& deviceInfo,
+                                        const std::vector<VRClockSample>& clockTable) {
         if (!isInitialized) {
             ALOG("AndroidUploader not initialized");
             return false;
         }
 
-        std::string jsonData = createSessionJson();
+        std::string jsonData = createSessionJson(clockTable);
         std::string url = config.supabaseUrl + "/rest/v1/vr_sessions";
 
         bool success = makeHttpRequest(url, "POST", jsonData);
@@ -99,7 +100,7 @@ namespace VRTelemetry {
         return oss.str();
     }
 
-    std::string AndroidUploader::createSessionJson() {
+    std::string AndroidUploader::createSessionJson(const std::vector<VRClockSample>& clockTable) {
         auto now = std::chrono::system_clock::now();
         auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
 
@@ -107,7 +108,15 @@ namespace VRTelemetry {
         oss << "{"
              << "\"session_id\":\"" << sessionId << "\","
              << "\"device_info\":\"Meta Quest - LibreriaSupabase\","
-             << "\"start_time\":" << timestamp
+             << "\"start_time\":" << timestamp << ","
+             << "\"clock_correlation\":[";
+        for (size_t i = 0; i < clockTable.size(); ++i) {
+            oss << clockTable[i].toJSON();
+            if (i < clockTable.size() - 1) {
+                oss << ",";
+            }
+        }
+        oss << "]"
              << "}";
         return oss.str();
     }
@@ -121,6 +130,8 @@ namespace VRTelemetry {
             json << "{"
                  << "\"session_id\":\"" << sessionId << "\","
                  << "\"timestamp\":" << frame.timestamp << ","
+                 << "\"predicted_display_time_ns\":" << frame.predictedDisplayTimeNs << ","
+                 << "\"capture_time_ns\":" << frame.captureTimeNs << ","
                  << "\"frame_data\":\"" << escapeJsonString(frame.toCSV()) << "\","
                  << "\"head_pos_x\":" << frame.headPose.x << ","
                  << "\"head_pos_y\":" << frame.headPose.y << ","
@@ -18,7 +18,7 @@ namespace VRTelemetry {
 
         // Metodos privados
         std::string generateSessionId();
-        std::string createSessionJson();
+        std::string createSessionJson(const std::vector<VRClockSample>& clockTable);
         std::string createFrameDataJson(const std::vector<FrameData>& frameData);
         std::string escapeJsonString(const std::string& input);
         bool makeHttpRequest(const std::string& url, const std::string& method, const std::string& jsonData);
@@ -32,7 +32,8 @@ namespace VRTelemetry {
 
         // Implementacion de ITelemetryUploader
         bool initialize(const TelemetryConfig& cfg) override;
-        bool createSession(const std::string& deviceInfo) override;
+        bool createSession(const std::string& deviceInfo,
+                           const std::vector<VRClockSample>& clockTable) override;
         bool uploadFrameData(const std::vector<FrameData>& frames, const std::string& filename) override;
         void shutdown() override;
         std::string getSessionId() const override;
@@ -6,7 +6,8 @@
 namespace VRTelemetry {
 
     TelemetryManager::TelemetryManager()
-            : currentFileIndex(0), frameCount(0), isInitialized(false) {
+            : sourceAdapter(nullptr), startTimeNs(0), currentFileIndex(0), frameCount(0),
+              isInitialized(false) {
         frameBuffer.reserve(5400); // Reservar memoria para eficiencia
     }
 
@@ -15,7 +16,8 @@ namespace VRTelemetry {
     }
 
     bool TelemetryManager::initialize(std::unique_ptr<ITelemetryUploader> uploaderImpl,
-                                      const TelemetryConfig& cfg) {
+                                      const TelemetryConfig& cfg,
+                                      InterfaceDataAdapter* adapter) {
         if (isInitialized) {
             ALOG("TelemetryManager already initialized");
             return true;
@@ -23,6 +25,7 @@ namespace VRTelemetry {
 
         config = cfg;
         uploader = std::move(uploaderImpl);
+        sourceAdapter = adapter;
 
         if (!uploader) {
             ALOG("Error: No uploader provided");
@@ -37,10 +40,15 @@ namespace VRTelemetry {
 
         // Generar nombre base y crear sesión
         baseFilename = generateBaseFilename();
-        startTime = std::chrono::high_resolution_clock::now();
+        startTimeNs = steadyClockNs();
+
+        // Primera muestra de la tabla de correlación de relojes (cabecera de la sesión)
+        clockTable.clear();
+        sampleClocks();
+        saveSessionHeader();
 
         if (config.enableCloudUpload) {
-            if (!uploader->createSession("Meta Quest - LibreriaSupabase App")) {
+            if (!uploader->createSession("Meta Quest - LibreriaSupabase App", clockTable)) {
                 ALOG("Warning: Failed to create cloud session, continuing with local only");
             }
         }
@@ -57,6 +65,10 @@ namespace VRTelemetry {
 
         ALOG("Shutting down TelemetryManager...");
 
+        // Muestra final para poder estimar la deriva de relojes durante toda la sesión
+        sampleClocks();
+        saveSessionHeader();
+
         // Guardar datos restantes
         if (!frameBuffer.empty()) {
             saveBufferToFile();
@@ -85,6 +97,8 @@ namespace VRTelemetry {
 
         // Si el buffer está lleno, procesarlo
         if (frameBuffer.size() >= config.maxFramesPerFile) {
+            sampleClocks();
+            saveSessionHeader();
             saveBufferToFile();
 
             if (config.enableCloudUpload) {
@@ -138,13 +152,17 @@ namespace VRTelemetry {
 
         if (file.is_open()) {
             // Escribir cabecera CSV
-            file << "timestamp,head_pos_x,head_pos_y,head_pos_z,"
+            file << "timestamp,predicted_display_time_ns,capture_time_ns,head_pos_x,head_pos_y,head_pos_z,"
                  << "head_rot_x,head_rot_y,head_rot_z,head_rot_w,"
                  << "left_tracked,left_pos_x,left_pos_y,left_pos_z,"
                  << "left_rot_x,left_rot_y,left_rot_z,left_rot_w,left_trigger,"
                  << "right_tracked,right_pos_x,right_pos_y,right_pos_z,"
                  << "right_rot_x,right_rot_y,right_rot_z,right_rot_w,right_trigger,"
-                 << "button_a\n";
+                 << "button_a,"
+                 << "pred_display_time_ns,"
+                 << "head_pred_valid,head_pred_pos_err_mm,head_pred_rot_err_deg,"
+                 << "left_pred_valid,left_pred_pos_err_mm,left_pred_rot_err_deg,"
+                 << "right_pred_valid,right_pred_pos_err_mm,right_pred_rot_err_deg\n";
 
             // Escribir datos
             for (const auto& frame : frameBuffer) {
@@ -158,6 +176,49 @@ namespace VRTelemetry {
         }
     }
 
+    void TelemetryManager::sampleClocks() {
+        if (sourceAdapter) {
+            clockTable.push_back(sourceAdapter->sampleClocks());
+        } else {
+            // Sin adapter solo se pueden correlacionar el reloj monótono y el de pared
+            VRClockSample sample;
+            sample.steadyNs = steadyClockNs();
+            sample.wallNs = wallClockNs();
+            clockTable.push_back(sample);
+        }
+    }
+
+    void TelemetryManager::saveSessionHeader() {
+        if (!config.enableLocalBackup) return;
+
+        std::string filename = baseFilename + "_session.json";
+        std::ofstream file(filename);
+
+        if (file.is_open()) {
+            file << "{"
+                 << "\"session_id\":\"" << getSessionId() << "\","
+                 << "\"start_time_ns\":" << startTimeNs << ","
+                 << "\"clock_correlation\":[";
+            for (size_t i = 0; i < clockTable.size(); ++i) {
+                file << clockTable[i].toJSON();
+                if (i < clockTable.size() - 1) {
+                    file << ",";
+                }
+            }
+            file << "]";
+
+            // Histogramas de error de predicción acumulados hasta ahora
+            VRPredictionStats predictionStats;
+            if (sourceAdapter && sourceAdapter->getPredictionStats(predictionStats)) {
+                file << ",\"pose_prediction\":" << predictionStats.toJSON();
+            }
+            file << "}\n";
+            file.close();
+        } else {
+            ALOG("Error: Could not open file %s for writing", filename.c_str());
+        }
+    }
+
     void TelemetryManager::uploadBufferToCloud() {
         if (frameBuffer.empty() || !uploader) return;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "TelemetryTypes.h"
+#include "Adapters/InterfaceDataAdapter.h"
 #include <vector>
 #include <memory>
 #include <fstream>
@@ -14,7 +15,12 @@ namespace VRTelemetry {
         std::vector<FrameData> frameBuffer;
         TelemetryConfig config;
 
-        std::chrono::high_resolution_clock::time_point startTime;
+        // Fuente de la correlación de relojes y de las estadísticas de predicción
+        // (no es propiedad del manager)
+        InterfaceDataAdapter* sourceAdapter;
+        std::vector<VRClockSample> clockTable;
+
+        int64_t startTimeNs;
         int currentFileIndex;
         int frameCount;
         std::string baseFilename;
@@ -25,6 +31,8 @@ namespace VRTelemetry {
         std::string getCurrentFilename() const;
         void saveBufferToFile();
         void uploadBufferToCloud();
+        void sampleClocks();
+        void saveSessionHeader();
 
     public:
         TelemetryManager();
@@ -32,7 +40,8 @@ namespace VRTelemetry {
 
         // Configuración
         bool initialize(std::unique_ptr<ITelemetryUploader> uploaderImpl,
-                        const TelemetryConfig& cfg = TelemetryConfig{});
+                        const TelemetryConfig& cfg = TelemetryConfig{},
+                        InterfaceDataAdapter* adapter = nullptr);
         void shutdown();
 
         // NUEVO: Grabación con datos genéricos (independiente de OpenXR)
@@ -42,6 +51,8 @@ namespace VRTelemetry {
         // Información del estado
         int getTotalFrames() const { return frameCount; }
         int getCurrentFileIndex() const { return currentFileIndex; }
+        int64_t getStartTimeNs() const { return startTimeNs; }
+        const std::vector<VRClockSample>& getClockTable() const { return clockTable; }
         std::string getSessionId() const;
         bool isReady() const { return isInitialized && uploader != nullptr; }
 
@@ -19,12 +19,14 @@ namespace VRTelemetry {
         bool enableCloudUpload = true;
     };
 
-    // Interface para uploaders (sin cambios)
+    // Interface para uploaders
     class ITelemetryUploader {
     public:
         virtual ~ITelemetryUploader() = default;
         virtual bool initialize(const TelemetryConfig& config) = 0;
-        virtual bool createSession(const std::string& deviceInfo) = 0;
+        // clockTable: correlacion inicial de relojes que se guarda en la cabecera de la sesion
+        virtual bool createSession(const std::string& deviceInfo,
+                                   const std::vector<VRClockSample>& clockTable) = 0;
         virtual bool uploadFrameData(const std::vector<FrameData>& frames, const std::string& filename) = 0;
         virtual void shutdown() = 0;
         virtual std::string getSessionId() const = 0;
@@ -3,9 +3,44 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <vector>
 
 namespace VRTelemetry {
 
+    // Reloj monotono (steady) en nanosegundos enteros, usado para el tiempo de captura
+    inline int64_t steadyClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Reloj de pared (UTC) en nanosegundos desde epoch Unix
+    inline int64_t wallClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Muestra de correlacion entre relojes: el mismo instante visto por el reloj monotono,
+    // por el reloj del runtime VR (XrTime en OpenXR) y por el reloj de pared.
+    // Con varias muestras se puede convertir cualquier tiempo del runtime a hora de pared
+    // y estimar la deriva entre relojes.
+    struct VRClockSample {
+        int64_t steadyNs;
+        int64_t runtimeNs; // 0 si el runtime no permite consultar su reloj
+        int64_t wallNs;
+
+        VRClockSample() : steadyNs(0), runtimeNs(0), wallNs(0) {}
+
+        std::string toJSON() const {
+            std::ostringstream oss;
+            oss << "{\"steady_ns\":" << steadyNs
+                << ",\"runtime_ns\":" << runtimeNs
+                << ",\"wall_ns\":" << wallNs << "}";
+            return oss.str();
+        }
+    };
+
     // Pose 3D genérica (posición + rotación)
     struct VRPose {
         // Posición
@@ -38,21 +73,104 @@ namespace VRTelemetry {
         VRInputState() : buttonA(false), buttonB(false), menuButton(false) {}
     };
 
+    // Error de predicción de un elemento rastreado: diferencia entre la pose predicha
+    // y la pose que el runtime reporta para el mismo instante una vez que ya pasó
+    struct VRTrackedError {
+        bool valid;
+        float positionErrorMm;
+        float angularErrorDeg;
+
+        VRTrackedError() : valid(false), positionErrorMm(0.0f), angularErrorDeg(0.0f) {}
+    };
+
+    // Último error de predicción resuelto. Corresponde a un frame anterior al que se
+    // graba (displayTimeNs indica a cuál), 0 si todavía no se resolvió ninguno
+    struct VRPredictionError {
+        int64_t displayTimeNs;
+        VRTrackedError head;
+        VRTrackedError left;
+        VRTrackedError right;
+
+        VRPredictionError() : displayTimeNs(0) {}
+    };
+
+    // Histograma de errores con cubetas de ancho fijo (la última incluye el desborde)
+    struct VRHistogram {
+        float bucketSize;
+        std::vector<uint32_t> buckets;
+        uint32_t count;
+        float mean, max;
+        float p50, p95, p99;
+
+        VRHistogram() : bucketSize(0.0f), count(0), mean(0.0f), max(0.0f),
+                        p50(0.0f), p95(0.0f), p99(0.0f) {}
+
+        std::string toJSON() const {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3)
+                << "{\"bucket_size\":" << bucketSize
+                << ",\"count\":" << count
+                << ",\"mean\":" << mean
+                << ",\"max\":" << max
+                << ",\"p50\":" << p50
+                << ",\"p95\":" << p95
+                << ",\"p99\":" << p99
+                << ",\"buckets\":[";
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                oss << buckets[i];
+                if (i < buckets.size() - 1) {
+                    oss << ",";
+                }
+            }
+            oss << "]}";
+            return oss.str();
+        }
+    };
+
+    // Estadísticas acumuladas de error de predicción durante la sesión
+    // Posición en milímetros, rotación en grados
+    struct VRPredictionStats {
+        VRHistogram headPosition, headAngular;
+        VRHistogram leftPosition, leftAngular;
+        VRHistogram rightPosition, rightAngular;
+        int droppedFrames; // predicciones descartadas sin poder resolverse
+
+        VRPredictionStats() : droppedFrames(0) {}
+
+        std::string toJSON() const {
+            std::ostringstream oss;
+            oss << "{\"position_unit\":\"mm\",\"angular_unit\":\"deg\","
+                << "\"dropped_frames\":" << droppedFrames << ","
+                << "\"head\":{\"position\":" << headPosition.toJSON()
+                << ",\"angular\":" << headAngular.toJSON() << "},"
+                << "\"left\":{\"position\":" << leftPosition.toJSON()
+                << ",\"angular\":" << leftAngular.toJSON() << "},"
+                << "\"right\":{\"position\":" << rightPosition.toJSON()
+                << ",\"angular\":" << rightAngular.toJSON() << "}}";
+            return oss.str();
+        }
+    };
+
     // Datos completos de un frame VR (100% independiente de cualquier SDK)
     struct VRFrameData {
-        double timestamp;
+        double timestamp;               // segundos desde el inicio de la grabacion
+        int64_t predictedDisplayTimeNs; // tiempo de display predicho por el runtime (XrTime)
+        int64_t captureTimeNs;          // reloj monotono en el momento de la captura
         VRPose headPose;
         VRController leftController;
         VRController rightController;
         VRInputState inputState;
+        VRPredictionError predictionError;
 
-        VRFrameData() : timestamp(0.0) {}
+        VRFrameData() : timestamp(0.0), predictedDisplayTimeNs(0), captureTimeNs(0) {}
 
         // Convertir a CSV (igual que antes, pero con datos genéricos)
         std::string toCSV() const {
             std::ostringstream oss;
             oss << std::fixed << std::setprecision(6)
                 << timestamp << ","
+                << predictedDisplayTimeNs << ","
+                << captureTimeNs << ","
                 << headPose.x << "," << headPose.y << "," << headPose.z << ","
                 << headPose.qx << "," << headPose.qy << "," << headPose.qz << "," << headPose.qw << ","
                 << (leftController.isTracked ? "1" : "0") << ","
@@ -63,7 +181,14 @@ namespace VRTelemetry {
                 << rightController.pose.x << "," << rightController.pose.y << "," << rightController.pose.z << ","
                 << rightController.pose.qx << "," << rightController.pose.qy << "," << rightController.pose.qz << "," << rightController.pose.qw << ","
                 << rightController.triggerValue << ","
-                << (inputState.buttonA ? "1" : "0");
+                << (inputState.buttonA ? "1" : "0") << ","
+                << predictionError.displayTimeNs << ","
+                << (predictionError.head.valid ? "1" : "0") << ","
+                << predictionError.head.positionErrorMm << "," << predictionError.head.angularErrorDeg << ","
+                << (predictionError.left.valid ? "1" : "0") << ","
+                << predictionError.left.positionErrorMm << "," << predictionError.left.angularErrorDeg << ","
+                << (predictionError.right.valid ? "1" : "0") << ","
+                << predictionError.right.positionErrorMm << "," << predictionError.right.angularErrorDeg;
             return oss.str();
         }
 
@@ -73,6 +198,8 @@ namespace VRTelemetry {
             oss << std::fixed << std::setprecision(6);
             oss << "{"
                 << "\"timestamp\":" << timestamp << ","
+                << "\"predicted_display_time_ns\":" << predictedDisplayTimeNs << ","
+                << "\"capture_time_ns\":" << captureTimeNs << ","
                 << "\"head\":{\"pos\":[" << headPose.x << "," << headPose.y << "," << headPose.z << "],"
                 << "\"rot\":[" << headPose.qx << "," << headPose.qy << "," << headPose.qz << "," << headPose.qw << "]},"
                 << "\"left\":{\"tracked\":" << (leftController.isTracked ? "true" : "false") << ","
@@ -83,7 +210,14 @@ namespace VRTelemetry {
                 << "\"pos\":[" << rightController.pose.x << "," << rightController.pose.y << "," << rightController.pose.z << "],"
                 << "\"rot\":[" << rightController.pose.qx << "," << rightController.pose.qy << "," << rightController.pose.qz << "," << rightController.pose.qw << "],"
                 << "\"trigger\":" << rightController.triggerValue << "},"
-                << "\"buttons\":{\"a\":" << (inputState.buttonA ? "true" : "false") << "}"
+                << "\"buttons\":{\"a\":" << (inputState.buttonA ? "true" : "false") << "},"
+                << "\"prediction_error\":{\"display_time_ns\":" << predictionError.displayTimeNs << ","
+                << "\"head\":[" << (predictionError.head.valid ? "true" : "false") << ","
+                << predictionError.head.positionErrorMm << "," << predictionError.head.angularErrorDeg << "],"
+                << "\"left\":[" << (predictionError.left.valid ? "true" : "false") << ","
+                << predictionError.left.positionErrorMm << "," << predictionError.left.angularErrorDeg << "],"
+                << "\"right\":[" << (predictionError.right.valid ? "true" : "false") << ","
+                << predictionError.right.positionErrorMm << "," << predictionError.right.angularErrorDeg << "]}"
                 << "}";
             return oss.str();
         }
@@ -0,0 +1,63 @@
+#include "TrajectoryVisualizer.h"
+
+namespace VRTelemetry {
+
+    TrajectoryVisualizer::TrajectoryVisualizer()
+            : leftWasTracked(false), rightWasTracked(false), visible(true),
+              isInitialized(false) {}
+
+    bool TrajectoryVisualizer::initialize(float maxSpeed) {
+        // Una sesión larga son decenas de miles de puntos por trayectoria, pero con la
+        // decimación solo se dibujan unos pocos miles de segmentos
+        if (!debugDraw.Init(32 * 1024)) {
+            return false;
+        }
+        view.SetMaxSpeed(maxSpeed);
+        isInitialized = true;
+        return true;
+    }
+
+    void TrajectoryVisualizer::shutdown() {
+        debugDraw.Shutdown();
+        isInitialized = false;
+    }
+
+    void TrajectoryVisualizer::addFrame(const VRFrameData& frame) {
+        headTrajectory.AddPoint(toVector(frame.headPose), frame.timestamp);
+
+        // Si un control pierde el tracking se corta la línea en vez de unir los extremos
+        if (frame.leftController.isTracked) {
+            leftTrajectory.AddPoint(toVector(frame.leftController.pose), frame.timestamp,
+                                    !leftWasTracked);
+        }
+        leftWasTracked = frame.leftController.isTracked;
+
+        if (frame.rightController.isTracked) {
+            rightTrajectory.AddPoint(toVector(frame.rightController.pose), frame.timestamp,
+                                     !rightWasTracked);
+        }
+        rightWasTracked = frame.rightController.isTracked;
+    }
+
+    void TrajectoryVisualizer::clear() {
+        headTrajectory.Clear();
+        leftTrajectory.Clear();
+        rightTrajectory.Clear();
+        leftWasTracked = false;
+        rightWasTracked = false;
+    }
+
+    void TrajectoryVisualizer::render(const OVR::Matrix4f& centerEyeViewMatrix,
+                                      std::vector<OVRFW::ovrDrawSurface>& surfaces) {
+        if (!isInitialized) return;
+
+        view.ResetStats();
+        if (visible) {
+            view.Draw(headTrajectory, centerEyeViewMatrix, debugDraw);
+            view.Draw(leftTrajectory, centerEyeViewMatrix, debugDraw);
+            view.Draw(rightTrajectory, centerEyeViewMatrix, debugDraw);
+        }
+        debugDraw.AppendSurfaceList(centerEyeViewMatrix, surfaces);
+    }
+
+} // namespace VRTelemetry
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "OVR_Math.h"
+#include "Render/DebugDraw.h"
+#include "Render/SurfaceRender.h"
+#include "Render/Trajectory.h"
+#include "Telemetry/VRTypes.h"
+
+namespace VRTelemetry {
+
+    // Vista en el visor de las trayectorias grabadas de la cabeza y de los controles.
+    // Recibe los mismos frames que se graban en la telemetría y guarda toda la sesión
+    // (el buffer de telemetría se vacía cada vez que se escribe un archivo).
+    // Las trayectorias se dibujan con nivel de detalle según el error en pantalla y
+    // coloreadas por velocidad: azul quieto, verde, rojo a partir de maxSpeed.
+    class TrajectoryVisualizer {
+    private:
+        OVRFW::ovrTrajectory headTrajectory;
+        OVRFW::ovrTrajectory leftTrajectory;
+        OVRFW::ovrTrajectory rightTrajectory;
+        bool leftWasTracked;
+        bool rightWasTracked;
+
+        OVRFW::ovrTrajectoryView view;
+        OVRFW::ovrDebugDraw debugDraw;
+        bool visible;
+        bool isInitialized;
+
+        static OVR::Vector3f toVector(const VRPose& pose) {
+            return OVR::Vector3f(pose.x, pose.y, pose.z);
+        }
+
+    public:
+        TrajectoryVisualizer();
+
+        // Necesita el contexto GL (llamar desde SessionInit)
+        bool initialize(float maxSpeed = 2.0f);
+        void shutdown();
+
+        void addFrame(const VRFrameData& frame);
+        void clear();
+
+        void setVisible(bool isVisible) { visible = isVisible; }
+        bool isVisible() const { return visible; }
+
+        void render(const OVR::Matrix4f& centerEyeViewMatrix,
+                    std::vector<OVRFW::ovrDrawSurface>& surfaces);
+
+        // Puntos dibujados y grabados en el último render, para comprobar la decimación
+        int getDrawnPoints() const { return view.GetNumDrawnPoints(); }
+        int getRecordedPoints() const { return view.GetNumRecordedPoints(); }
+    };
+
+} // namespace VRTelemetry
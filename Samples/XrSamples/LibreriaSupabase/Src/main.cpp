@@ -19,15 +19,16 @@
 // NUEVO: Includes para telemetría genérica
 #include "Telemetry/TelemetryManager.h"
 #include "Telemetry/Adapters/OpenXRAdapter.h"
+#include "TrajectoryVisualizer.h"
 #ifdef ANDROID
 #include "Telemetry/AndroidUploader.h"
 #endif
 
 class XrAppBaseApp : public OVRFW::XrApp {
 private:
-    OVRFW::VRMenuObject* holaMundoLabel;
-    OVRFW::VRMenuObject* toggleButton;
-    OVRFW::VRMenuObject* recordingStatusLabel;
+    OVRFW::VRMenuObject* holaMundoLabel = nullptr;
+    OVRFW::VRMenuObject* toggleButton = nullptr;
+    OVRFW::VRMenuObject* recordingStatusLabel = nullptr;
     bool debeReposicionar = false;
     bool labelCreado = false;
     bool labelVisible = true;
@@ -35,7 +36,9 @@ private:
     // NUEVO: Telemetría genérica + adapter para OpenXR
     VRTelemetry::TelemetryManager telemetryManager;
     VRTelemetry::OpenXRAdapter openXRAdapter;
-    std::chrono::high_resolution_clock::time_point startTime;
+
+    // Trayectorias grabadas de cabeza y controles, se muestran/ocultan con el botón B
+    VRTelemetry::TrajectoryVisualizer trajectoryVisualizer;
 
 public:
     XrAppBaseApp() : OVRFW::XrApp() {
@@ -53,6 +56,16 @@ public:
             return false;
         }
 
+        // El adapter lee el reloj del runtime (XrTime) para la correlación de relojes
+        openXRAdapter.setApp(this);
+
+        // Mide el error de predicción de cabeza y controles para la telemetría
+        PosePredictionAnalysis = true;
+
+        // Update() y Render() corren en el hilo principal mientras el hilo de render envía el
+        // frame anterior; los menús se crean en SessionInit() y aquí solo se mueven
+        PipelinedRendering = true;
+
         // NUEVO: Inicializar telemetría genérica
 #ifdef ANDROID
         auto androidUploader = std::make_unique<VRTelemetry::AndroidUploader>();
@@ -65,12 +78,9 @@ public:
             config.enableLocalBackup = true;
             config.enableCloudUpload = true;
 
-            telemetryManager.initialize(std::move(androidUploader), config);
+            telemetryManager.initialize(std::move(androidUploader), config, &openXRAdapter);
 #endif
 
-        // Inicializar tiempo de inicio para timestamps
-        startTime = std::chrono::high_resolution_clock::now();
-
         ALOG("VR Motion Recording started with generic adapter pattern");
         return true;
     }
@@ -85,40 +95,39 @@ public:
             return false;
         }
         cursorBeamRenderer_.Init(GetFileSys(), nullptr, OVR::Vector4f(1.0f), 1.0f);
+        if (!trajectoryVisualizer.initialize()) {
+            ALOG("SessionInit::Init trajectory visualizer FAILED.");
+        }
+
+        // Se crean con contexto GL; el primer Update() los coloca frente a la cabeza
+        const OVR::Vector3f origen(0.0f, 0.0f, 0.0f);
+        holaMundoLabel = ui_.AddLabel("Super Hola Mundo", origen, {400.0f, 100.0f});
+        toggleButton = ui_.AddButton(
+                "Ocultar Texto",
+                origen,
+                {200.0f, 75.0f},
+                [this]() {
+                    this->ToggleTextoVisibilidad();
+                }
+        );
+        recordingStatusLabel = ui_.AddLabel("GRABANDO (GENÉRICO)", origen, {350.0f, 60.0f});
+        recordingStatusLabel->SetTextColor(OVR::Vector4f(0.2f, 1.0f, 0.2f, 1.0f)); // Verde para genérico
         return true;
     }
 
     virtual void Update(const OVRFW::ovrApplFrameIn& in) override {
         // NUEVO: Conversión OpenXR → Genérico → Telemetría (¡3 líneas!)
         openXRAdapter.updateFrame(in);
-        auto now = std::chrono::high_resolution_clock::now();
-        double timestamp = std::chrono::duration<double>(now - startTime).count();
-        VRTelemetry::VRFrameData genericData = openXRAdapter.convertToGeneric(timestamp);
+        const int64_t captureTimeNs = VRTelemetry::steadyClockNs();
+        double timestamp = (captureTimeNs - telemetryManager.getStartTimeNs()) * 1e-9;
+        VRTelemetry::VRFrameData genericData =
+                openXRAdapter.convertToGeneric(timestamp, captureTimeNs);
         telemetryManager.recordFrame(genericData);
+        trajectoryVisualizer.addFrame(genericData);
 
         // Resto del código se mantiene exactamente igual...
         if(!labelCreado){
-            OVR::Matrix4f matrizInicial = OVR::Matrix4f(in.HeadPose);
-            OVR::Vector3f posiInicial = matrizInicial.Transform({0.0f, -0.35f, -2.0f});
-            holaMundoLabel = ui_.AddLabel("Super Hola Mundo", posiInicial, {400.0f, 100.0f});
-            holaMundoLabel->SetLocalRotation(in.HeadPose.Rotation);
-
-            OVR::Vector3f posicionBoton = matrizInicial.Transform({-0.75f, -0.1f, -2.0f});
-            toggleButton = ui_.AddButton(
-                    "Ocultar Texto",
-                    posicionBoton,
-                    {200.0f, 75.0f},
-                    [this]() {
-                        this->ToggleTextoVisibilidad();
-                    }
-            );
-            toggleButton->SetLocalRotation(in.HeadPose.Rotation);
-
-            OVR::Vector3f posicionEstado = matrizInicial.Transform({0.0f, 0.15f, -2.0f});
-            recordingStatusLabel = ui_.AddLabel("GRABANDO (GENÉRICO)", posicionEstado, {350.0f, 60.0f});
-            recordingStatusLabel->SetLocalRotation(in.HeadPose.Rotation);
-            recordingStatusLabel->SetTextColor(OVR::Vector4f(0.2f, 1.0f, 0.2f, 1.0f)); // Verde para genérico
-
+            ReposicionarElementos(in.HeadPose);
             labelCreado = true;
         }
 
@@ -126,7 +135,9 @@ public:
             std::ostringstream statusText;
             statusText << "GENÉRICO: " << telemetryManager.getTotalFrames()
                        << " | " << openXRAdapter.getAdapterName()
-                       << " | Sesión: " << telemetryManager.getSessionId().substr(0, 8) << "...";
+                       << " | Sesión: " << telemetryManager.getSessionId().substr(0, 8) << "..."
+                       << " | Trayectorias: " << trajectoryVisualizer.getDrawnPoints()
+                       << "/" << trajectoryVisualizer.getRecordedPoints() << " puntos";
             recordingStatusLabel->SetText(statusText.str().c_str());
         }
 
@@ -137,6 +148,10 @@ public:
             holaMundoLabel->SetTextColor(OVR::Vector4f(1.0f, 1.0f, 1.0f, 1.0f));
         }
 
+        if (in.Clicked(OVRFW::ovrApplFrameIn::kButtonB)) {
+            trajectoryVisualizer.setVisible(!trajectoryVisualizer.isVisible());
+        }
+
         if (debeReposicionar) {
             ReposicionarElementos(in.HeadPose);
             debeReposicionar = false;
@@ -171,12 +186,25 @@ public:
         }
 
         cursorBeamRenderer_.Render(in, out);
+        trajectoryVisualizer.render(out.FrameMatrices.CenterView, out.Surfaces);
     }
 
     virtual void SessionEnd() override {
         controllerRenderL_.Shutdown();
         controllerRenderR_.Shutdown();
         cursorBeamRenderer_.Shutdown();
+        trajectoryVisualizer.shutdown();
+
+        // Se liberan aquí, con contexto GL; una nueva sesión los vuelve a crear
+        if (holaMundoLabel && toggleButton && recordingStatusLabel) {
+            ui_.RemoveParentMenu(recordingStatusLabel);
+            ui_.RemoveParentMenu(toggleButton);
+            ui_.RemoveParentMenu(holaMundoLabel);
+        }
+        recordingStatusLabel = nullptr;
+        toggleButton = nullptr;
+        holaMundoLabel = nullptr;
+        labelCreado = false;
     }
 
     virtual void AppShutdown(const xrJava* context) override {
@@ -206,37 +234,23 @@ private:
              labelVisible ? "true" : "false");
     }
 
+    // Mueve los menús creados en SessionInit(); crearlos aquí necesitaría el contexto GL, que
+    // con PipelinedRendering tiene el hilo de render
     void ReposicionarElementos(const OVR::Posef& headPose) {
         if (holaMundoLabel && toggleButton && recordingStatusLabel) {
-            ui_.RemoveParentMenu(recordingStatusLabel);
-            ui_.RemoveParentMenu(toggleButton);
-            ui_.RemoveParentMenu(holaMundoLabel);
-            recordingStatusLabel = nullptr;
-            toggleButton = nullptr;
-            holaMundoLabel = nullptr;
-
             OVR::Matrix4f matrizNuevaCabeza = OVR::Matrix4f(headPose);
 
             OVR::Vector3f nuevaPosi = matrizNuevaCabeza.Transform({0.0f, -0.35f, -2.0f});
-            holaMundoLabel = ui_.AddLabel("Super Hola Mundo", nuevaPosi, {400.0f, 100.0f});
+            holaMundoLabel->SetLocalPosition(nuevaPosi);
             holaMundoLabel->SetLocalRotation(headPose.Rotation);
-            holaMundoLabel->SetVisible(labelVisible);
 
             OVR::Vector3f posicionBoton = matrizNuevaCabeza.Transform({-0.75f, -0.1f, -2.0f});
-            toggleButton = ui_.AddButton(
-                    labelVisible ? "Ocultar Texto" : "Mostrar Texto",
-                    posicionBoton,
-                    {200.0f, 75.0f},
-                    [this]() {
-                        this->ToggleTextoVisibilidad();
-                    }
-            );
+            toggleButton->SetLocalPosition(posicionBoton);
             toggleButton->SetLocalRotation(headPose.Rotation);
 
             OVR::Vector3f posicionEstado = matrizNuevaCabeza.Transform({0.0f, 0.15f, -2.0f});
-            recordingStatusLabel = ui_.AddLabel("GRABANDO (GENÉRICO)", posicionEstado, {350.0f, 60.0f});
+            recordingStatusLabel->SetLocalPosition(posicionEstado);
             recordingStatusLabel->SetLocalRotation(headPose.Rotation);
-            recordingStatusLabel->SetTextColor(OVR::Vector4f(0.2f, 1.0f, 0.2f, 1.0f)); // Verde para genérico
         }
     }
 };
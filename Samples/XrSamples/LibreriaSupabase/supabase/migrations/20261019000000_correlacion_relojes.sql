@@ -0,0 +1,11 @@
+-- Columnas para correlacionar los relojes del dispositivo (steady, runtime OpenXR y pared)
+-- con los datos de telemetría. Sin ellas PostgREST rechaza las inserciones del uploader.
+
+-- Tabla de muestras {steady_ns, runtime_ns, wall_ns} tomadas durante la sesión
+alter table public.vr_sessions
+    add column if not exists clock_correlation jsonb not null default '[]'::jsonb;
+
+-- Tiempo de display predicho (XrTime) y momento de captura (reloj steady) de cada frame
+alter table public.vr_frames
+    add column if not exists predicted_display_time_ns bigint,
+    add column if not exists capture_time_ns bigint;